@@ -24,6 +24,7 @@
 #include <string.h>
 #include <assert.h>
 #include <pthread.h>
+#include <inttypes.h>
 
 #include "default_engine.h"
 
@@ -35,11 +36,45 @@
 
 #define DEFAULT_ROOTSIZE 512
 
+/* the number of hash chains split by each item insertion while expanding */
+#define EXPAND_SPLITS_PER_INSERT 4
+
+/* the number of optimistic lookup tries before falling back to the locked lookup */
+#define OPTIMISTIC_FIND_TRIES 3
+
+/* The item memory is kept in the slab allocator and never given back to
+ * the system, so an optimistic reader may load the stale fields of an item
+ * freed concurrently. Every loaded value is validated with the sequence count.
+ */
+#define LOAD_RELAXED(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+/* hash tags: the byte of a tag way in the tag word */
+#ifdef WORDS_BIGENDIAN
+#define TAG_SHIFT(way) (8 * (7 - (way)))
+#define TAG_WAY(bit)   (7 - ((bit) >> 3))
+#else
+#define TAG_SHIFT(way) (8 * (way))
+#define TAG_WAY(bit)   ((bit) >> 3)
+#endif
+#define TAG_ONES  0x0101010101010101ULL
+#define TAG_HIGHS 0x8080808080808080ULL
+#define TAG_COUNT_MASK ((uint64_t)0xFF << TAG_SHIFT(HASH_TAG_WAYS))
+
 static struct engine_config *config=NULL; // engine config
 static struct assoc         *assocp=NULL; // engine assoc
 static SERVER_CORE_API      *svcore=NULL; // server core api
 static EXTENSION_LOGGER_DESCRIPTOR *logger;
 
+static struct hash_tags *_tagtable_alloc(uint32_t count)
+{
+    void *ptr;
+    if (posix_memalign(&ptr, sizeof(struct hash_tags), count * sizeof(struct hash_tags)) != 0) {
+        return NULL;
+    }
+    memset(ptr, 0, count * sizeof(struct hash_tags));
+    return ptr;
+}
+
 ENGINE_ERROR_CODE assoc_init(struct default_engine *engine)
 {
     /* initialize global variables */
@@ -54,9 +89,14 @@ ENGINE_ERROR_CODE assoc_init(struct default_engine *engine)
     assocp->rootsize = DEFAULT_ROOTSIZE;
     assocp->roottable = NULL;
     assocp->infotable = NULL;
-    assocp->redistributed_bucket_cnt = 0;
-
-    assocp->roottable = calloc(assocp->rootsize, sizeof(void *));
+    assocp->retired_rootcnt = 0;
+    assocp->locktable = NULL;
+    assocp->lockmask = 0;
+    assocp->expanding = false;
+    assocp->expand_bucket = 0;
+    assocp->expand_defcnt = 0;
+
+    assocp->roottable = calloc(assocp->rootsize, sizeof(struct table));
     if (assocp->roottable == NULL) {
         return ENGINE_ENOMEM;
     }
@@ -67,13 +107,53 @@ ENGINE_ERROR_CODE assoc_init(struct default_engine *engine)
         return ENGINE_ENOMEM;
     }
 
+    if (config->hash_tags) {
+        assocp->roottable[0].tagtable = _tagtable_alloc(assocp->hashsize);
+        if (assocp->roottable[0].tagtable == NULL) {
+            free(assocp->roottable[0].hashtable);
+            free(assocp->roottable);
+            return ENGINE_ENOMEM;
+        }
+        logger->log(EXTENSION_LOG_INFO, NULL, "ASSOC hash tags enabled.\n");
+    }
+
     assocp->infotable = calloc(assocp->hashsize, sizeof(struct bucket_info));
     if (assocp->infotable == NULL) {
+        free(assocp->roottable[0].tagtable);
         free(assocp->roottable[0].hashtable);
         free(assocp->roottable);
         return ENGINE_ENOMEM;
     }
 
+    if (config->lock_partitions > assocp->hashsize) {
+        /* checked by check_configuration(), but do not trust a release build */
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "ASSOC lock partitions(%u) exceed the hash size(%u).\n",
+                    config->lock_partitions, assocp->hashsize);
+        free(assocp->infotable);
+        free(assocp->roottable[0].tagtable);
+        free(assocp->roottable[0].hashtable);
+        free(assocp->roottable);
+        return ENGINE_EINVAL;
+    }
+    if (config->lock_partitions > 0) {
+        assocp->locktable = calloc(config->lock_partitions, sizeof(union bucket_lock));
+        if (assocp->locktable == NULL) {
+            free(assocp->infotable);
+            free(assocp->roottable[0].tagtable);
+            free(assocp->roottable[0].hashtable);
+            free(assocp->roottable);
+            return ENGINE_ENOMEM;
+        }
+        for (int ii=0; ii < config->lock_partitions; ++ii) {
+            pthread_mutex_init(&assocp->locktable[ii].b.lock, NULL);
+            assocp->locktable[ii].b.seq = 0;
+        }
+        assocp->lockmask = config->lock_partitions - 1;
+        logger->log(EXTENSION_LOG_INFO, NULL, "ASSOC lock partitions = %u\n",
+                    config->lock_partitions);
+    }
+
     logger->log(EXTENSION_LOG_INFO, NULL, "ASSOC module initialized.\n");
     return ENGINE_SUCCESS;
 }
@@ -87,49 +167,330 @@ void assoc_final(struct default_engine *engine)
     if (assocp->roottable) {
         if (assocp->roottable[0].hashtable)
             free(assocp->roottable[0].hashtable);
+        if (assocp->roottable[0].tagtable)
+            free(assocp->roottable[0].tagtable);
         for (int ii=0; ii < assocp->rootpower; ++ii) {
             int table_count = hashsize(ii); //2 ^ n
             if (assocp->roottable[table_count].hashtable)
                 free(assocp->roottable[table_count].hashtable);
+            if (assocp->roottable[table_count].tagtable)
+                free(assocp->roottable[table_count].tagtable);
         }
         free(assocp->roottable);
     }
+    for (int ii=0; ii < assocp->retired_rootcnt; ++ii) {
+        free(assocp->retired_roottables[ii]);
+    }
     if (assocp->infotable) {
         free(assocp->infotable);
     }
+    if (assocp->locktable) {
+        for (int ii=0; ii <= assocp->lockmask; ++ii) {
+            pthread_mutex_destroy(&assocp->locktable[ii].b.lock);
+        }
+        free(assocp->locktable);
+    }
     logger->log(EXTENSION_LOG_INFO, NULL, "ASSOC module destroyed.\n");
 }
 
-static void redistribute(unsigned int bucket)
+/*
+ * Bucket lock functions
+ */
+void assoc_bucket_lock(uint32_t hash)
+{
+    if (assocp->locktable != NULL) {
+        pthread_mutex_lock(&assocp->locktable[hash & assocp->lockmask].b.lock);
+    }
+}
+
+void assoc_bucket_unlock(uint32_t hash)
 {
-    hash_item *it, **prev;
-    uint32_t tabidx;
-    uint32_t ii, table_count = hashsize(assocp->infotable[bucket].curpower);
+    if (assocp->locktable != NULL) {
+        pthread_mutex_unlock(&assocp->locktable[hash & assocp->lockmask].b.lock);
+    }
+}
 
-    for (ii=0; ii < table_count; ++ii) {
-         prev = &assocp->roottable[ii].hashtable[bucket];
-         while (*prev != NULL) {
-             it = *prev;
-             tabidx = GET_HASH_TABIDX(it->khash, assocp->hashpower, hashmask(assocp->rootpower));
-             if (tabidx == ii) {
-                 prev = &it->h_next;
-             } else {
-                 *prev = it->h_next;
-                 it->h_next = assocp->roottable[tabidx].hashtable[bucket];
-                 assocp->roottable[tabidx].hashtable[bucket] = it;
-             }
-         }
-    }
-    assocp->infotable[bucket].curpower = assocp->rootpower;
-
-    assocp->redistributed_bucket_cnt++;
-    if (assocp->redistributed_bucket_cnt == assocp->hashsize / 2) {
-        logger->log(EXTENSION_LOG_INFO, NULL, "hash table expansion 50%% completed.\n");
-    } else if (assocp->redistributed_bucket_cnt == (assocp->hashsize / 10) * 9) {
-        logger->log(EXTENSION_LOG_INFO, NULL, "hash table expansion 90%% completed.\n");
-    } else if (assocp->redistributed_bucket_cnt == assocp->hashsize) {
-        logger->log(EXTENSION_LOG_INFO, NULL, "hash table expansion 100%% completed.\n");
-        assocp->redistributed_bucket_cnt = 0;
+/* The hash chain writers change the sequence count of the bucket lock
+ * so that the optimistic readers can detect the changes.
+ */
+static inline void _seq_write_begin(union bucket_lock *bl)
+{
+    __atomic_store_n(&bl->b.seq, bl->b.seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void _seq_write_end(union bucket_lock *bl)
+{
+    __atomic_store_n(&bl->b.seq, bl->b.seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline bool _seq_validate(union bucket_lock *bl, uint32_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&bl->b.seq, __ATOMIC_RELAXED) == seq;
+}
+
+static void _bucket_write_lock(uint32_t hash)
+{
+    if (assocp->locktable != NULL) {
+        union bucket_lock *bl = &assocp->locktable[hash & assocp->lockmask];
+        pthread_mutex_lock(&bl->b.lock);
+        _seq_write_begin(bl);
+    }
+}
+
+static void _bucket_write_unlock(uint32_t hash)
+{
+    if (assocp->locktable != NULL) {
+        union bucket_lock *bl = &assocp->locktable[hash & assocp->lockmask];
+        _seq_write_end(bl);
+        pthread_mutex_unlock(&bl->b.lock);
+    }
+}
+
+static void _lock_all_buckets(void)
+{
+    if (assocp->locktable != NULL) {
+        for (int ii=0; ii <= assocp->lockmask; ++ii) {
+            pthread_mutex_lock(&assocp->locktable[ii].b.lock);
+            _seq_write_begin(&assocp->locktable[ii]);
+        }
+    }
+}
+
+static void _unlock_all_buckets(void)
+{
+    if (assocp->locktable != NULL) {
+        for (int ii=0; ii <= assocp->lockmask; ++ii) {
+            _seq_write_end(&assocp->locktable[ii]);
+            pthread_mutex_unlock(&assocp->locktable[ii].b.lock);
+        }
+    }
+}
+
+/* returns the hash table index of the given hash in the bucket.
+ * The hash tables below splitidx have been split into the next hash power.
+ */
+static inline uint32_t _hash_tabidx(uint32_t hash, struct bucket_info *info)
+{
+    uint32_t tabidx = GET_HASH_TABIDX(hash, assocp->hashpower, hashmask(info->curpower));
+    if (tabidx < info->splitidx) {
+        tabidx = GET_HASH_TABIDX(hash, assocp->hashpower, hashmask(info->curpower + 1));
+    }
+    return tabidx;
+}
+
+/* returns the number of hash tables used by the bucket */
+static inline uint32_t _hash_tabcnt(struct bucket_info *info)
+{
+    return hashsize(info->curpower + (info->splitidx > 0 ? 1 : 0));
+}
+
+/*
+ * Hash tag functions
+ * The hash tags are changed under the bucket lock with the hash chain.
+ */
+static inline uint8_t _hash_tag(uint32_t hash)
+{
+    uint8_t tag = (uint8_t)((hash * 0x9E3779B1) >> 24);
+    return tag != 0 ? tag : 1;
+}
+
+/* returns the high bits of the tag bytes equal to the given tag.
+ * A byte above a matched byte can also be reported by the borrow,
+ * so the caller verifies the item of each reported way.
+ */
+static inline uint64_t _tags_match(uint64_t word, uint8_t tag)
+{
+    uint64_t x = (word ^ (TAG_ONES * tag)) | TAG_COUNT_MASK;
+    return (x - TAG_ONES) & ~x & TAG_HIGHS;
+}
+
+static inline bool _tags_covered(uint64_t word)
+{
+    return ((word & TAG_COUNT_MASK) >> TAG_SHIFT(HASH_TAG_WAYS)) <= HASH_TAG_WAYS;
+}
+
+static hash_item *_tags_find(struct hash_tags *ht, const char *key, const uint32_t nkey,
+                             uint32_t hash, bool *covered)
+{
+    uint64_t match = _tags_match(ht->u.word, _hash_tag(hash));
+    hash_item *it;
+
+    while (match != 0) {
+        it = ht->items[TAG_WAY(__builtin_ctzll(match))];
+        if (it != NULL && (hash == it->khash) && (nkey == it->nkey) &&
+            (memcmp(key, item_get_key(it), nkey) == 0)) {
+            return it;
+        }
+        match &= match - 1;
+    }
+    *covered = _tags_covered(ht->u.word);
+    return NULL;
+}
+
+static void _tags_index(struct hash_tags *ht, hash_item *it)
+{
+    for (int ii=0; ii < HASH_TAG_WAYS; ii++) {
+        if (ht->u.t.tags[ii] == 0) {
+            ht->items[ii] = it;
+            ht->u.t.tags[ii] = _hash_tag(it->khash);
+            break;
+        }
+    }
+}
+
+/* rebuilds the hash tags from the hash chain. The scan placeholders are skipped. */
+static void _tags_rebuild(struct hash_tags *ht, hash_item *head)
+{
+    uint32_t count = 0;
+
+    memset(ht, 0, sizeof(struct hash_tags));
+    for (hash_item *it = head; it != NULL; it = it->h_next) {
+        if (it->nkey == 0) continue; /* placeholder */
+        if (count < HASH_TAG_WAYS) {
+            _tags_index(ht, it);
+        }
+        count++;
+    }
+    ht->u.t.count = count < 255 ? count : 255;
+}
+
+static void _tags_insert(struct hash_tags *ht, hash_item *it)
+{
+    if (ht->u.t.count < HASH_TAG_WAYS) {
+        _tags_index(ht, it);
+    }
+    if (ht->u.t.count < 255) {
+        ht->u.t.count++;
+    }
+}
+
+static void _tags_delete(struct hash_tags *ht, hash_item *it, hash_item *head)
+{
+    if (ht->u.t.count > HASH_TAG_WAYS) {
+        /* index the items not indexed yet */
+        _tags_rebuild(ht, head);
+        return;
+    }
+    for (int ii=0; ii < HASH_TAG_WAYS; ii++) {
+        if (ht->items[ii] == it) {
+            ht->u.t.tags[ii] = 0;
+            ht->items[ii] = NULL;
+            break;
+        }
+    }
+    ht->u.t.count--;
+}
+
+static void _tags_replace(struct hash_tags *ht, hash_item *old_it, hash_item *new_it)
+{
+    for (int ii=0; ii < HASH_TAG_WAYS; ii++) {
+        if (ht->items[ii] == old_it) {
+            ht->items[ii] = new_it;
+            break;
+        }
+    }
+}
+
+/* splits the next hash chain of the bucket into the next hash power.
+ * It moves the items of the chain that belong to the new hash table.
+ */
+static void _split_hash_chain(uint32_t bucket)
+{
+    struct bucket_info *info = &assocp->infotable[bucket];
+    uint32_t table_count = hashsize(info->curpower);
+    hash_item *it, **prev, **dest;
+
+    assert(info->curpower < assocp->rootpower && info->refcount == 0);
+    _bucket_write_lock(bucket);
+    prev = &assocp->roottable[info->splitidx].hashtable[bucket];
+    dest = &assocp->roottable[info->splitidx + table_count].hashtable[bucket];
+    while (*prev != NULL) {
+        it = *prev;
+        if ((it->khash >> assocp->hashpower) & table_count) {
+            *prev = it->h_next;
+            it->h_next = *dest;
+            *dest = it;
+        } else {
+            prev = &it->h_next;
+        }
+    }
+    if (assocp->roottable[info->splitidx].tagtable != NULL) {
+        _tags_rebuild(&assocp->roottable[info->splitidx].tagtable[bucket],
+                      assocp->roottable[info->splitidx].hashtable[bucket]);
+        _tags_rebuild(&assocp->roottable[info->splitidx + table_count].tagtable[bucket], *dest);
+    }
+    if (++info->splitidx == table_count) {
+        info->curpower++;
+        info->splitidx = 0;
+    }
+    _bucket_write_unlock(bucket);
+}
+
+/* splits the deferred buckets that are not pinned any more.
+ * returns true if no deferred bucket is left.
+ */
+static bool _expand_deferred_step(int *work)
+{
+    uint32_t ii = 0;
+
+    while (ii < assocp->expand_defcnt && *work > 0) {
+        uint32_t bucket = assocp->expand_deferred[ii];
+        struct bucket_info *info = &assocp->infotable[bucket];
+        if (info->refcount > 0) {
+            ii++; /* still pinned. try it again later */
+            continue;
+        }
+        while (info->curpower < assocp->rootpower && *work > 0) {
+            _split_hash_chain(bucket);
+            *work -= 1;
+        }
+        if (info->curpower == assocp->rootpower) {
+            assocp->expand_deferred[ii] = assocp->expand_deferred[--assocp->expand_defcnt];
+        }
+    }
+    return (assocp->expand_defcnt == 0);
+}
+
+/* does a bounded amount of the hash table expansion.
+ * A bucket being scanned is not split until the scan leaves it.
+ * It's deferred so that a stream of scans can't stall the expansion,
+ * and it's split after all the other buckets are done.
+ */
+static void _expand_step(int work)
+{
+    while (work > 0 && assocp->expand_bucket < assocp->hashsize) {
+        struct bucket_info *info = &assocp->infotable[assocp->expand_bucket];
+        if (info->curpower < assocp->rootpower) {
+            if (info->refcount > 0) {
+                if (assocp->expand_defcnt == MAX_EXPAND_DEFERRED) {
+                    /* too many pinned buckets, wait for the scans */
+                    (void)_expand_deferred_step(&work);
+                    break;
+                }
+                assocp->expand_deferred[assocp->expand_defcnt++] = assocp->expand_bucket;
+            } else {
+                _split_hash_chain(assocp->expand_bucket);
+                work--;
+                continue;
+            }
+        }
+        /* the bucket has been split or deferred. go to the next bucket */
+        assocp->expand_bucket++;
+        work--;
+        if (assocp->expand_bucket == assocp->hashsize / 2) {
+            logger->log(EXTENSION_LOG_INFO, NULL, "hash table expansion 50%% completed.\n");
+        } else if (assocp->expand_bucket == (assocp->hashsize / 10) * 9) {
+            logger->log(EXTENSION_LOG_INFO, NULL, "hash table expansion 90%% completed.\n");
+        }
+    }
+    if (assocp->expand_bucket == assocp->hashsize && work > 0) {
+        if (_expand_deferred_step(&work)) {
+            logger->log(EXTENSION_LOG_INFO, NULL, "hash table expansion 100%% completed.\n");
+            assocp->expanding = false;
+            assocp->expand_bucket = 0;
+        }
     }
 }
 
@@ -138,9 +499,16 @@ hash_item *assoc_find(const char *key, const uint32_t nkey, uint32_t hash)
     hash_item *it;
     int depth = 0;
     uint32_t bucket = GET_HASH_BUCKET(hash, assocp->hashmask);
-    uint32_t tabidx = GET_HASH_TABIDX(hash, assocp->hashpower,
-                                      hashmask(assocp->infotable[bucket].curpower));
-
+    uint32_t tabidx = _hash_tabidx(hash, &assocp->infotable[bucket]);
+
+    if (assocp->roottable[tabidx].tagtable != NULL) {
+        bool covered = false;
+        it = _tags_find(&assocp->roottable[tabidx].tagtable[bucket], key, nkey, hash, &covered);
+        if (it != NULL || covered) {
+            MEMCACHED_ASSOC_FIND(key, nkey, depth);
+            return it;
+        }
+    }
     it = assocp->roottable[tabidx].hashtable[bucket];
     while (it) {
         if ((hash == it->khash) && (nkey == it->nkey) &&
@@ -154,14 +522,129 @@ hash_item *assoc_find(const char *key, const uint32_t nkey, uint32_t hash)
     return it;
 }
 
+#ifndef USE_SYSTEM_MALLOC
+/* walk the hash chain without the bucket lock.
+ * returns false if a concurrent change of the hash chain is detected.
+ * Each pointer is validated before dereferenced since it might be
+ * the garbage of a reused item memory.
+ */
+static bool _find_optimistic(const char *key, const uint32_t nkey, uint32_t hash,
+                             union bucket_lock *bl, uint32_t seq, hash_item **item)
+{
+    struct table *roottable;
+    struct hash_tags *tagtable;
+    hash_item *it, *next;
+    uint32_t bucket = GET_HASH_BUCKET(hash, assocp->hashmask);
+    uint32_t tabidx, curpower, splitidx;
+
+    roottable = LOAD_RELAXED(assocp->roottable);
+    curpower = LOAD_RELAXED(assocp->infotable[bucket].curpower);
+    splitidx = LOAD_RELAXED(assocp->infotable[bucket].splitidx);
+    tabidx = GET_HASH_TABIDX(hash, assocp->hashpower, hashmask(curpower));
+    if (tabidx < splitidx) {
+        tabidx = GET_HASH_TABIDX(hash, assocp->hashpower, hashmask(curpower + 1));
+    }
+    if (!_seq_validate(bl, seq)) {
+        return false;
+    }
+    tagtable = LOAD_RELAXED(roottable[tabidx].tagtable);
+    if (tagtable != NULL) {
+        uint64_t word = LOAD_RELAXED(tagtable[bucket].u.word);
+        uint64_t match = _tags_match(word, _hash_tag(hash));
+        while (match != 0) {
+            it = LOAD_RELAXED(tagtable[bucket].items[TAG_WAY(__builtin_ctzll(match))]);
+            if (!_seq_validate(bl, seq)) {
+                return false;
+            }
+            if (it != NULL) {
+                uint32_t khash = LOAD_RELAXED(it->khash);
+                uint16_t iklen = LOAD_RELAXED(it->nkey);
+                if (!_seq_validate(bl, seq)) {
+                    return false;
+                }
+                if ((hash == khash) && (nkey == iklen) &&
+                    (memcmp(key, item_get_key(it), nkey) == 0)) {
+                    break; /* found */
+                }
+            }
+            match &= match - 1;
+        }
+        if (match != 0 || _tags_covered(word)) {
+            if (!_seq_validate(bl, seq)) {
+                return false;
+            }
+            *item = (match != 0 ? it : NULL);
+            return true;
+        }
+    }
+    it = LOAD_RELAXED(roottable[tabidx].hashtable[bucket]);
+    if (!_seq_validate(bl, seq)) {
+        return false;
+    }
+    while (it) {
+        uint32_t khash = LOAD_RELAXED(it->khash);
+        uint16_t iklen = LOAD_RELAXED(it->nkey);
+        next = LOAD_RELAXED(it->h_next);
+        if (!_seq_validate(bl, seq)) {
+            return false;
+        }
+        if ((hash == khash) && (nkey == iklen) &&
+            (memcmp(key, item_get_key(it), nkey) == 0)) {
+            break; /* found */
+        }
+        it = next;
+    }
+    /* validate the whole lookup */
+    if (!_seq_validate(bl, seq)) {
+        return false;
+    }
+    *item = it;
+    return true;
+}
+#endif
+
+hash_item *assoc_find_and_lock(const char *key, const uint32_t nkey, uint32_t hash)
+{
+    union bucket_lock *bl = &assocp->locktable[hash & assocp->lockmask];
+    hash_item *it;
+
+    assert(assocp->locktable != NULL);
+#ifndef USE_SYSTEM_MALLOC
+    for (int tries = 0; tries < OPTIMISTIC_FIND_TRIES; tries++) {
+        uint32_t seq = __atomic_load_n(&bl->b.seq, __ATOMIC_ACQUIRE);
+        if ((seq & 1) != 0) {
+            continue; /* the hash chain is being changed */
+        }
+        if (!_find_optimistic(key, nkey, hash, bl, seq, &it)) {
+            continue;
+        }
+        if (it == NULL) {
+            return NULL; /* not found */
+        }
+        /* The found item is valid if nothing has changed until we get the lock. */
+        pthread_mutex_lock(&bl->b.lock);
+        if (bl->b.seq == seq) {
+            return it;
+        }
+        pthread_mutex_unlock(&bl->b.lock);
+    }
+#endif
+    /* fall back to the locked lookup */
+    pthread_mutex_lock(&bl->b.lock);
+    it = assoc_find(key, nkey, hash);
+    if (it == NULL) {
+        pthread_mutex_unlock(&bl->b.lock);
+    }
+    return it;
+}
+
 /* returns the address of the item pointer before the key.  if *item == 0,
    the item wasn't found */
 static hash_item** _hashitem_before(const char *key, const uint32_t nkey, uint32_t hash)
 {
     hash_item **pos;
     uint32_t bucket = GET_HASH_BUCKET(hash, assocp->hashmask);
-    uint32_t tabidx = GET_HASH_TABIDX(hash, assocp->hashpower,
-                                      hashmask(assocp->infotable[bucket].curpower));
+    uint32_t tabidx = _hash_tabidx(hash, &assocp->infotable[bucket]);
 
     pos = &assocp->roottable[tabidx].hashtable[bucket];
     while (*pos && ((nkey != (*pos)->nkey) || memcmp(key, item_get_key(*pos), nkey))) {
@@ -170,33 +653,74 @@ static hash_item** _hashitem_before(const char *key, const uint32_t nkey, uint32
     return pos;
 }
 
-/* grows the hashtable to the next power of 2. */
+/* returns the hash tags and the chain head of the hash, or NULL if hash tags are disabled */
+static struct hash_tags *_hashitem_tags(uint32_t hash, hash_item **head)
+{
+    uint32_t bucket = GET_HASH_BUCKET(hash, assocp->hashmask);
+    struct table *table = &assocp->roottable[_hash_tabidx(hash, &assocp->infotable[bucket])];
+
+    if (table->tagtable == NULL) {
+        return NULL;
+    }
+    *head = table->hashtable[bucket];
+    return &table->tagtable[bucket];
+}
+
+/* grows the hashtable to the next power of 2.
+ * The root table is changed while holding all the bucket locks
+ * since it's referenced by the readers holding only a bucket lock.
+ * The old root table is not freed but retired for the optimistic readers.
+ * The hash chains are split into the new hash tables by _expand_step().
+ */
 static void assoc_expand(void)
 {
     hash_item** new_hashtable;
+    struct hash_tags *new_tagtable = NULL;
+    struct table *new_roottable = NULL;
     uint32_t ii, table_count = hashsize(assocp->rootpower); // 2 ^ n
 
     if (table_count * 2 > assocp->rootsize) {
-        struct table *reallocated_roottable = realloc(assocp->roottable, sizeof(void*) * assocp->rootsize * 2);
-        if (reallocated_roottable == NULL) {
+        if (assocp->retired_rootcnt >= MAX_RETIRED_ROOTTABLES) {
+            return;
+        }
+        new_roottable = calloc(assocp->rootsize * 2, sizeof(struct table));
+        if (new_roottable == NULL) {
             return;
         }
-        assocp->roottable = reallocated_roottable;
-        assocp->rootsize *= 2;
     }
     new_hashtable = calloc(assocp->hashsize * table_count, sizeof(void *));
-    if (new_hashtable) {
-        for (ii=0; ii < table_count; ++ii) {
-            assocp->roottable[table_count+ii].hashtable = &new_hashtable[assocp->hashsize*ii];
+    if (new_hashtable == NULL) {
+        if (new_roottable) free(new_roottable);
+        return;
+    }
+    if (assocp->roottable[0].tagtable != NULL) {
+        new_tagtable = _tagtable_alloc(assocp->hashsize * table_count);
+        if (new_tagtable == NULL) {
+            free(new_hashtable);
+            if (new_roottable) free(new_roottable);
+            return;
         }
-        assocp->rootpower++;
     }
 
-    if (assocp->redistributed_bucket_cnt != 0) {
-        logger->log(EXTENSION_LOG_INFO, NULL, "hash table expansion stopped before completion. (%lf%% proceeded)",
-                (double)assocp->redistributed_bucket_cnt * 100 / assocp->hashsize);
-        assocp->redistributed_bucket_cnt = 0;
+    _lock_all_buckets();
+    if (new_roottable != NULL) {
+        memcpy(new_roottable, assocp->roottable, sizeof(struct table) * assocp->rootsize);
+        assocp->retired_roottables[assocp->retired_rootcnt++] = assocp->roottable;
+        assocp->roottable = new_roottable;
+        assocp->rootsize *= 2;
+    }
+    for (ii=0; ii < table_count; ++ii) {
+        assocp->roottable[table_count+ii].hashtable = &new_hashtable[assocp->hashsize*ii];
+        if (new_tagtable != NULL) {
+            assocp->roottable[table_count+ii].tagtable = &new_tagtable[assocp->hashsize*ii];
+        }
     }
+    assocp->rootpower++;
+    _unlock_all_buckets();
+
+    assocp->expanding = true;
+    assocp->expand_bucket = 0;
+    assocp->expand_defcnt = 0;
     logger->log(EXTENSION_LOG_INFO, NULL, "hash table expansion started(size: %u -> %u).\n",
             assocp->hashsize * table_count, assocp->hashsize * table_count * 2);
 }
@@ -209,27 +733,33 @@ int assoc_insert(hash_item *it, uint32_t hash)
 
     assert(assoc_find(item_get_key(it), it->nkey, hash) == 0); /* shouldn't have duplicately named things defined */
 
-    if (assocp->infotable[bucket].curpower != assocp->rootpower &&
-        assocp->infotable[bucket].refcount == 0) {
-        redistribute(bucket);
-    }
-    tabidx = GET_HASH_TABIDX(hash, assocp->hashpower,
-                             hashmask(assocp->infotable[bucket].curpower));
+    _bucket_write_lock(hash);
+    tabidx = _hash_tabidx(hash, &assocp->infotable[bucket]);
 
     // inserting actual hash_item to appropriate assoc_t
     it->h_next = assocp->roottable[tabidx].hashtable[bucket];
     assocp->roottable[tabidx].hashtable[bucket] = it;
+    if (assocp->roottable[tabidx].tagtable != NULL) {
+        _tags_insert(&assocp->roottable[tabidx].tagtable[bucket], it);
+    }
+    _bucket_write_unlock(hash);
 
     assocp->hash_items++;
-    if (assocp->hash_items > (hashsize(assocp->hashpower + assocp->rootpower) * 3) / 2) {
+    if (assocp->expanding) {
+        _expand_step(EXPAND_SPLITS_PER_INSERT);
+    } else if (assocp->hash_items > (hashsize(assocp->hashpower + assocp->rootpower) * 3) / 2) {
         assoc_expand();
     }
     MEMCACHED_ASSOC_INSERT(item_get_key(it), it->nkey, assocp->hash_items);
     return 1;
 }
 
+/* The ITEM_LINKED flag of the old item is cleared under the bucket lock
+ * so that the readers holding only the bucket lock can see it consistently.
+ */
 void assoc_replace(hash_item *old_it, hash_item *new_it)
 {
+    _bucket_write_lock(old_it->khash);
     hash_item **before = _hashitem_before(item_get_key(old_it), old_it->nkey, old_it->khash);
 
     /* The DTrace probe cannot be triggered as the last instruction
@@ -239,28 +769,50 @@ void assoc_replace(hash_item *old_it, hash_item *new_it)
     new_it->h_next = old_it->h_next;
     *before = new_it;
     (old_it)->h_next = NULL;
+    (old_it)->iflag &= ~ITEM_LINKED;
+
+    hash_item *head;
+    struct hash_tags *ht = _hashitem_tags(old_it->khash, &head);
+    if (ht != NULL) {
+        _tags_replace(ht, old_it, new_it);
+    }
+    _bucket_write_unlock(old_it->khash);
 
     MEMCACHED_ASSOC_INSERT(item_get_key(new_it), new_it->nkey, assocp->hash_items);
 }
 
+/* The ITEM_LINKED flag of the deleted item is cleared under the bucket lock.
+ * See assoc_replace().
+ */
 void assoc_delete(const char *key, const uint32_t nkey, uint32_t hash)
 {
+    _bucket_write_lock(hash);
     hash_item **before = _hashitem_before(key, nkey, hash);
 
     if (*before) {
-        hash_item *nxt;
+        hash_item *nxt, *del, *head;
+        struct hash_tags *ht;
         assocp->hash_items--;
 
        /* The DTrace probe cannot be triggered as the last instruction
          * due to possible tail-optimization by the compiler
          */
         MEMCACHED_ASSOC_DELETE(key, nkey, assocp->hash_items);
+        del = *before;
         nxt = (*before)->h_next;
         (*before)->h_next = 0;   /* probably pointless, but whatever. */
+        (*before)->iflag &= ~ITEM_LINKED;
         *before = nxt;
 
+        ht = _hashitem_tags(hash, &head);
+        if (ht != NULL) {
+            _tags_delete(ht, del, head);
+        }
+
+        _bucket_write_unlock(hash);
         return;
     }
+    _bucket_write_unlock(hash);
     /* Note:  we never actually get here.  the callers don't delete things
        they can't find. */
     assert(*before != 0);
@@ -284,21 +836,26 @@ static void _init_scan_placeholder(struct assoc_scan *scan)
 static void _link_scan_placeholder(struct assoc_scan *scan, hash_item *item)
 {
     /* link the placeholder item behind the given item */
+    _bucket_write_lock(scan->bucket);
     scan->ph_item.h_next = item->h_next;
     item->h_next = &scan->ph_item;
+    _bucket_write_unlock(scan->bucket);
     scan->ph_linked = true;
 }
 
 static hash_item *_unlink_scan_placeholder(struct assoc_scan *scan)
 {
     /* unlink the placeholder item and return the next item */
+    _bucket_write_lock(scan->bucket);
     hash_item **p = &assocp->roottable[scan->tabidx].hashtable[scan->bucket];
     assert(*p != NULL);
     while (*p != &scan->ph_item)
         p = &((*p)->h_next);
     *p = (*p)->h_next;
+    hash_item *next = *p;
+    _bucket_write_unlock(scan->bucket);
     scan->ph_linked = false;
-    return *p;
+    return next;
 }
 
 void assoc_scan_init(struct assoc_scan *scan)
@@ -328,7 +885,7 @@ int assoc_scan_next(struct assoc_scan *scan, hash_item **item_array,
     {
         if (scan->tabcnt == 0) {
             /* start the scan on the current bucket */
-            scan->tabcnt = hashsize(assocp->infotable[scan->bucket].curpower);
+            scan->tabcnt = _hash_tabcnt(&assocp->infotable[scan->bucket]);
             scan->tabidx = 0;
             assert(scan->tabcnt > 0);
             /* increment bucket's reference count */
@@ -404,8 +961,7 @@ bool assoc_scan_in_visited_area(struct assoc_scan *scan, hash_item *it)
         return true;
     }
     if (bucket == scan->bucket) {
-        tabidx = GET_HASH_TABIDX(it->khash, assocp->hashpower,
-                 hashmask(assocp->infotable[bucket].curpower));
+        tabidx = _hash_tabidx(it->khash, &assocp->infotable[bucket]);
         if (tabidx < scan->tabidx) {
             return true;
         }
@@ -438,3 +994,21 @@ void assoc_scan_final(struct assoc_scan *scan)
     }
     scan->initialized = false;
 }
+
+/*
+ * Assoc stats
+ */
+void assoc_stats(ADD_STAT add_stat, const void *cookie)
+{
+    char val[128];
+    int len;
+
+    len = sprintf(val, "%"PRIu64, (uint64_t)assocp->hashsize << assocp->rootpower);
+    add_stat("hash_buckets", 12, val, len, cookie);
+    len = sprintf(val, "%d", assocp->expanding ? 1 : 0);
+    add_stat("hash_is_expanding", 17, val, len, cookie);
+    len = sprintf(val, "%u", (uint32_t)(((uint64_t)assocp->expand_bucket * 100) / assocp->hashsize));
+    add_stat("hash_expand_progress", 20, val, len, cookie);
+    len = sprintf(val, "%u", assocp->expand_defcnt);
+    add_stat("hash_expand_deferred", 20, val, len, cookie);
+}
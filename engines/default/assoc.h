@@ -23,6 +23,54 @@ struct bucket_info {
     uint16_t curpower; /* current hash power:
                         * how many hash tables each hash bucket use ? (power of 2)
                         */
+    uint16_t splitidx; /* how many hash tables of the bucket have been split
+                        * into the next hash power while expanding ?
+                        */
+};
+
+/* hash tags: a cache line sized index of a hash chain.
+ * It keeps the one byte tags of the hash values and the pointers of
+ * the chain items, so that a lookup compares all the tags at once and
+ * touches only the items having the same tag instead of walking the chain.
+ * If the chain has more items than the ways, the chain is walked on a miss.
+ */
+#define HASH_TAG_WAYS 7
+
+struct hash_tags {
+    union {
+        struct {
+            uint8_t tags[HASH_TAG_WAYS]; /* the tags of the indexed items (0: empty way) */
+            uint8_t count;  /* the number of items in the chain (saturated at 255) */
+        } t;
+        uint64_t word;      /* the tags and the count loaded at once */
+    } u;
+    hash_item *items[HASH_TAG_WAYS]; /* the indexed items */
+};
+
+/* lock partitions: the number of bucket locks (0: lock partitioning disabled) */
+#define MINIMUM_LOCK_PARTITIONS 16
+#define MAXIMUM_LOCK_PARTITIONS 65536
+#define DEFAULT_LOCK_PARTITIONS 1024
+
+/* the maximum number of retired root tables (the root table size is doubled) */
+#define MAX_RETIRED_ROOTTABLES 32
+
+/* the maximum number of buckets deferred by the expansion while pinned by scans */
+#define MAX_EXPAND_DEFERRED 64
+
+/* bucket lock: one of the hash-striped locks used in lock partitioning mode.
+ * It protects the hash chains of the buckets mapped to it and
+ * the reference counts of the items linked on those chains.
+ * The sequence count is incremented before and after every change of
+ * those hash chains (odd while changing), so that readers can walk
+ * the chains optimistically without the lock and detect the changes.
+ */
+union bucket_lock {
+    struct {
+        pthread_mutex_t lock;
+        uint32_t        seq;  /* sequence count */
+    } b;
+    char pad[64]; /* avoid false sharing between locks */
 };
 
 struct assoc {
@@ -31,16 +79,37 @@ struct assoc {
     uint32_t hashmask;  /* hash bucket mask */
     uint32_t rootpower; /* how many hash tables we use ? (power of 2) */
     uint32_t rootsize;
-    uint32_t redistributed_bucket_cnt;
+
+    /* incremental expansion: the hash chains of the buckets are split
+     * one by one into the new hash tables by the item insertions.
+     */
+    bool     expanding;     /* the hash tables are being expanded */
+    uint32_t expand_bucket; /* the bucket being split */
+    /* the buckets skipped since they were pinned by scans.
+     * They're split after the other buckets are done.
+     */
+    uint32_t expand_deferred[MAX_EXPAND_DEFERRED];
+    uint32_t expand_defcnt;
 
     /* cache item hash table : an array of hash tables */
     struct table {
        hash_item** hashtable;
+       struct hash_tags *tagtable; /* NULL if hash tags are disabled */
     } *roottable;
 
+    /* root tables replaced by expansion. They're kept until assoc_final()
+     * since optimistic readers may still be referencing them.
+     */
+    struct table *retired_roottables[MAX_RETIRED_ROOTTABLES];
+    uint32_t retired_rootcnt;
+
     /* bucket info table */
     struct bucket_info *infotable;
 
+    /* bucket lock table : NULL if lock partitioning is disabled */
+    union bucket_lock *locktable;
+    uint32_t lockmask;  /* bucket lock mask */
+
     /* Number of items in the hash table. */
     unsigned int hash_items;
 };
@@ -61,7 +130,20 @@ struct assoc_scan {
 ENGINE_ERROR_CODE assoc_init(struct default_engine *engine);
 void              assoc_final(struct default_engine *engine);
 
+/* bucket lock functions: they do nothing if lock partitioning is disabled.
+ * Lock ordering: cache_lock -> bucket lock (a bucket lock holder must not
+ * wait for the cache_lock).
+ */
+void              assoc_bucket_lock(uint32_t hash);
+void              assoc_bucket_unlock(uint32_t hash);
+
 hash_item *       assoc_find(const char *key, const uint32_t nkey, uint32_t hash);
+/* find the item without holding the bucket lock during the chain walk.
+ * If found, the item is returned with the bucket lock held.
+ * Otherwise, NULL is returned without the bucket lock.
+ * It must be used only if lock partitioning is enabled.
+ */
+hash_item *       assoc_find_and_lock(const char *key, const uint32_t nkey, uint32_t hash);
 int               assoc_insert(hash_item *item, uint32_t hash);
 void              assoc_replace(hash_item *old_it, hash_item *new_it);
 void              assoc_delete(const char *key, const uint32_t nkey, uint32_t hash);
@@ -73,4 +155,7 @@ int               assoc_scan_next(struct assoc_scan *scan, hash_item **item_arra
 bool              assoc_scan_in_visited_area(struct assoc_scan *scan, hash_item *it);
 void              assoc_scan_final(struct assoc_scan *scan);
 
+/* assoc stats */
+void              assoc_stats(ADD_STAT add_stat, const void *cookie);
+
 #endif
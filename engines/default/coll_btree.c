@@ -27,6 +27,14 @@
 #include <sched.h>
 #include <inttypes.h>
 #include <sys/time.h> /* gettimeofday() */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BTREE_SKEY_SIMD 1
+#include <immintrin.h>
+#endif
+#ifdef ENABLE_BTREE_COMPRESS
+#include <stddef.h> /* offsetof() */
+#include <zlib.h>
+#endif
 
 /* Dummy PERSISTENCE_ACTION Macros */
 #define PERSISTENCE_ACTION_BEGIN(a, b)
@@ -243,8 +251,14 @@ static hash_item *do_btree_item_alloc(const void *key, const uint32_t nkey,
         info->itdist  = (uint16_t)((size_t*)info-(size_t*)it);
         info->stotal  = 0;
         info->bktype  = BKEY_TYPE_UNKNOWN;
+        /* only the b+trees that can grow large use the wide nodes */
+        info->fanout  = ((info->mcnt < 0 || info->mcnt > DEFAULT_BTREE_SIZE) ?
+                         config->btree_fanout : BTREE_ITEM_COUNT);
         info->maxbkeyrange.len = BKEY_NULL;
         info->root    = NULL;
+#ifdef ENABLE_BTREE_COMPRESS
+        info->zdict   = NULL;
+#endif
         assert((hash_item*)COLL_GET_HASH_ITEM(info) == it);
 
         /* set if forced_btree_overflow_actions is given */
@@ -253,9 +267,19 @@ static hash_item *do_btree_item_alloc(const void *key, const uint32_t nkey,
     return it;
 }
 
-static btree_indx_node *do_btree_node_alloc(const uint8_t node_depth, const void *cookie)
+static inline size_t do_btree_node_size(const uint8_t node_depth, const uint16_t capacity)
+{
+    size_t ntotal = sizeof(btree_indx_node) + capacity * (sizeof(void*) + sizeof(uint64_t));
+    if (node_depth > 0) {
+        ntotal += capacity * sizeof(uint32_t); /* ecnt */
+    }
+    return ntotal;
+}
+
+static btree_indx_node *do_btree_node_alloc(const uint8_t node_depth, const uint16_t capacity,
+                                            const void *cookie)
 {
-    size_t ntotal = (node_depth > 0 ? sizeof(btree_indx_node) : sizeof(btree_leaf_node));
+    size_t ntotal = do_btree_node_size(node_depth, capacity);
 
     btree_indx_node *node = do_item_mem_alloc(ntotal, LRU_CLSID_FOR_SMALL, cookie);
     if (node != NULL) {
@@ -265,17 +289,19 @@ static btree_indx_node *do_btree_node_alloc(const uint8_t node_depth, const void
         node->refcount    = 0;
         node->ndepth      = node_depth;
         node->used_count  = 0;
+        node->capacity    = capacity;
         node->prev = node->next = NULL;
-        memset(node->item, 0, BTREE_ITEM_COUNT*sizeof(void*));
+        memset(node->item, 0, capacity*sizeof(void*));
+        memset(BTREE_NODE_SKEY(node), 0, capacity*sizeof(uint64_t));
         if (node_depth > 0)
-            memset(node->ecnt, 0, BTREE_ITEM_COUNT*sizeof(uint16_t));
+            memset(BTREE_NODE_ECNT(node), 0, capacity*sizeof(uint32_t));
     }
     return node;
 }
 
 static void do_btree_node_free(btree_indx_node *node)
 {
-    size_t ntotal = (node->ndepth > 0 ? sizeof(btree_indx_node) : sizeof(btree_leaf_node));
+    size_t ntotal = do_btree_node_size(node->ndepth, node->capacity);
     do_item_mem_free(node, ntotal);
 }
 
@@ -291,6 +317,7 @@ static btree_elem_item *do_btree_elem_alloc(const uint32_t nbkey, const uint32_t
 
         elem->refcount    = 0;
         elem->status      = BTREE_ITEM_STATUS_UNLINK; /* unlinked state */
+        elem->zipped      = 0;
         elem->nbkey       = (uint8_t)nbkey;
         elem->neflag      = (uint8_t)neflag;
         elem->nbytes      = (uint16_t)nbytes;
@@ -375,6 +402,411 @@ static inline void do_btree_get_bkey(btree_elem_item *elem, bkey_t *bkey)
     }
 }
 
+#ifdef ENABLE_BTREE_COMPRESS
+/*
+ * Element value compression
+ * The elements of a b+tree usually have the values of the same structure.
+ * So, the values are compressed with raw deflate using a dictionary that is
+ * sampled from the values of the b+tree itself. The dictionary is built when
+ * the b+tree has BTREE_ZDICT_BUILD_COUNT elements, and it is freed when the
+ * b+tree becomes empty. The compressed element is marked with the zipped flag,
+ * and it is decompressed into a new element when it is returned to the clients.
+ * The compression runs under the cache lock, and the element allocations for it
+ * may evict other items. The cost is shown in the btree_zip_* stats.
+ */
+#define BTREE_ZDICT_BUILD_COUNT  256  /* element count to build the dictionary */
+#define BTREE_ZDICT_SAMPLE_COUNT 64   /* the number of sampled values */
+#define BTREE_ZDICT_SAMPLE_LENG  512  /* max sampled length of a value */
+#define BTREE_ZDICT_MIN_SIZE     256
+#define BTREE_ZDICT_MAX_SIZE     4096
+#define BTREE_ZIP_MIN_VLEN       32   /* min value length to be compressed */
+#define BTREE_ZIP_CHECK_COUNT    256  /* tried count to check the compression ratio */
+
+static bool          zip_enabled = false;
+static z_stream      zip_deflater;
+static z_stream      zip_inflater;
+static unsigned char zip_buffer[MAXIMUM_MAX_ELEMENT_BYTES];
+static struct {
+    uint64_t zip_count;   /* compressed values */
+    uint64_t zip_usec;    /* time spent on compression */
+    uint64_t unzip_count; /* decompressed values */
+    uint64_t unzip_usec;  /* time spent on decompression */
+} zip_stats;
+
+static inline unsigned char *do_btree_elem_value(btree_elem_item *elem)
+{
+    return elem->data + BTREE_REAL_NBKEY(elem->nbkey) + elem->neflag;
+}
+
+static inline bool do_btree_elem_zipped(btree_elem_item *elem)
+{
+    return elem->zipped != 0;
+}
+
+static inline uint64_t do_btree_zip_elapsed(struct timeval *start)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint64_t)(now.tv_sec - start->tv_sec) * 1000000 + now.tv_usec - start->tv_usec;
+}
+
+static inline size_t do_btree_zdict_ntotal(btree_zdict_info *zdict)
+{
+    return offsetof(btree_zdict_info, data) + zdict->size;
+}
+
+static void do_btree_zdict_build(btree_meta_info *info)
+{
+    btree_indx_node *node = do_btree_get_first_leaf(info->root, NULL);
+    btree_elem_item *elem;
+    btree_zdict_info *zdict;
+    uint32_t step = info->ccnt / BTREE_ZDICT_SAMPLE_COUNT;
+    uint32_t size = 0;
+    uint32_t vlen, cnt = 0;
+    size_t   ntotal;
+    int i;
+
+    /* sample the values evenly over the b+tree */
+    if (step == 0) step = 1;
+    while (node != NULL && size < BTREE_ZDICT_MAX_SIZE) {
+        for (i = 0; i < node->used_count && size < BTREE_ZDICT_MAX_SIZE; i++) {
+            if ((cnt++ % step) != 0) continue;
+            elem = (btree_elem_item *)node->item[i];
+            vlen = elem->nbytes - 2; /* except "\r\n" */
+            if (vlen > BTREE_ZDICT_SAMPLE_LENG) vlen = BTREE_ZDICT_SAMPLE_LENG;
+            if (vlen > BTREE_ZDICT_MAX_SIZE - size) vlen = BTREE_ZDICT_MAX_SIZE - size;
+            memcpy(zip_buffer + size, do_btree_elem_value(elem), vlen);
+            size += vlen;
+        }
+        node = node->next;
+    }
+    if (size < BTREE_ZDICT_MIN_SIZE) {
+        size = 0; /* too short values to be compressed */
+    }
+
+    ntotal = offsetof(btree_zdict_info, data) + size;
+    zdict = do_item_mem_alloc(ntotal, LRU_CLSID_FOR_SMALL, NULL);
+    if (zdict != NULL) {
+        zdict->slabs_clsid = slabs_clsid(ntotal);
+        assert(zdict->slabs_clsid > 0);
+
+        zdict->refcount = 0;
+        zdict->disabled = (size == 0 ? 1 : 0);
+        zdict->size     = size;
+        zdict->ntried   = 0;
+        zdict->nzipped  = 0;
+        memcpy(zdict->data, zip_buffer, size);
+        info->zdict = zdict;
+        do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_BTREE, slabs_space_size(ntotal));
+    }
+}
+
+static void do_btree_zdict_free(btree_meta_info *info)
+{
+    size_t ntotal = do_btree_zdict_ntotal(info->zdict);
+
+    if (info->stotal > 0) { /* apply memory space */
+        do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_BTREE, slabs_space_size(ntotal));
+    }
+    do_item_mem_free(info->zdict, ntotal);
+    info->zdict = NULL;
+}
+
+/* Compress the value of the given element.
+ * It returns the compressed copy of the element,
+ * or NULL if the element is to be stored as it is.
+ */
+static btree_elem_item *do_btree_elem_zip(btree_meta_info *info, btree_elem_item *elem)
+{
+    btree_zdict_info *zdict;
+    btree_elem_item *zelem;
+    struct timeval start;
+    uint32_t vlen = elem->nbytes - 2; /* except "\r\n" */
+    uint32_t zlen;
+    size_t   nhead;
+    int      zret;
+
+    if (zip_enabled != true || vlen < BTREE_ZIP_MIN_VLEN) {
+        return NULL;
+    }
+    if (info->zdict == NULL) {
+        if (info->ccnt < BTREE_ZDICT_BUILD_COUNT) {
+            return NULL;
+        }
+        do_btree_zdict_build(info);
+        if (info->zdict == NULL) {
+            return NULL;
+        }
+    }
+    zdict = info->zdict;
+    if (zdict->disabled) {
+        return NULL;
+    }
+    if (zdict->ntried == BTREE_ZIP_CHECK_COUNT &&
+        zdict->nzipped < (BTREE_ZIP_CHECK_COUNT / 8)) {
+        /* the values are hardly compressed */
+        zdict->disabled = 1;
+        return NULL;
+    }
+    zdict->ntried++;
+
+    gettimeofday(&start, NULL);
+    if (deflateReset(&zip_deflater) != Z_OK ||
+        deflateSetDictionary(&zip_deflater, zdict->data, zdict->size) != Z_OK) {
+        return NULL;
+    }
+    zip_deflater.next_in   = do_btree_elem_value(elem);
+    zip_deflater.avail_in  = vlen;
+    zip_deflater.next_out  = zip_buffer;
+    zip_deflater.avail_out = vlen;
+    zret = deflate(&zip_deflater, Z_FINISH);
+    zip_stats.zip_usec += do_btree_zip_elapsed(&start);
+    if (zret != Z_STREAM_END) {
+        return NULL; /* not smaller than the value */
+    }
+    zlen = vlen - zip_deflater.avail_out;
+
+    /* check if the compressed element uses the smaller slab space */
+    nhead = sizeof(btree_elem_item_fixed) + BTREE_REAL_NBKEY(elem->nbkey) + elem->neflag;
+    if (slabs_space_size(nhead + zlen + 2) >= slabs_space_size(nhead + elem->nbytes)) {
+        return NULL;
+    }
+    zelem = do_btree_elem_alloc(elem->nbkey, elem->neflag, zlen + 2, NULL);
+    if (zelem == NULL) {
+        return NULL;
+    }
+    memcpy(zelem->data, elem->data, BTREE_REAL_NBKEY(elem->nbkey) + elem->neflag);
+    memcpy(do_btree_elem_value(zelem), zip_buffer, zlen);
+    memcpy(do_btree_elem_value(zelem) + zlen, "\r\n", 2);
+    zelem->zipped = 1;
+    zdict->nzipped++;
+    zip_stats.zip_count++;
+    return zelem;
+}
+
+/* Decompress the value of the given element into zip_buffer.
+ * The value is terminated with "\r\n" and its length is returned.
+ */
+static int do_btree_elem_inflate(btree_meta_info *info, btree_elem_item *elem)
+{
+    btree_zdict_info *zdict = info->zdict;
+    struct timeval start;
+    uint32_t vlen;
+    int      zret;
+
+    assert(zdict != NULL);
+    gettimeofday(&start, NULL);
+    if (inflateReset(&zip_inflater) != Z_OK ||
+        inflateSetDictionary(&zip_inflater, zdict->data, zdict->size) != Z_OK) {
+        return -1;
+    }
+    zip_inflater.next_in   = do_btree_elem_value(elem);
+    zip_inflater.avail_in  = elem->nbytes - 2; /* except "\r\n" */
+    zip_inflater.next_out  = zip_buffer;
+    zip_inflater.avail_out = sizeof(zip_buffer) - 2;
+    zret = inflate(&zip_inflater, Z_FINISH);
+    zip_stats.unzip_usec += do_btree_zip_elapsed(&start);
+    if (zret != Z_STREAM_END) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "btree element decompression failed: %s\n",
+                    zip_inflater.msg ? zip_inflater.msg : "unknown");
+        return -1;
+    }
+    vlen = sizeof(zip_buffer) - 2 - zip_inflater.avail_out;
+    memcpy(zip_buffer + vlen, "\r\n", 2);
+    zip_stats.unzip_count++;
+    return (int)(vlen + 2);
+}
+
+/* Get the decompressed copy of the given element.
+ * The copy is referenced only by the caller.
+ */
+static btree_elem_item *do_btree_elem_unzip(btree_meta_info *info, btree_elem_item *elem)
+{
+    btree_elem_item *uelem;
+    int nbytes = do_btree_elem_inflate(info, elem);
+
+    if (nbytes < 0) {
+        return NULL;
+    }
+    uelem = do_btree_elem_alloc(elem->nbkey, elem->neflag, nbytes, NULL);
+    if (uelem != NULL) {
+        memcpy(uelem->data, elem->data, BTREE_REAL_NBKEY(elem->nbkey) + elem->neflag);
+        memcpy(do_btree_elem_value(uelem), zip_buffer, nbytes);
+        uelem->refcount = 1;
+    }
+    return uelem;
+}
+
+/* Get the reference of the element to be returned. */
+static btree_elem_item *do_btree_elem_result(btree_meta_info *info, btree_elem_item *elem)
+{
+    if (info->zdict != NULL && do_btree_elem_zipped(elem)) {
+        return do_btree_elem_unzip(info, elem);
+    }
+    elem->refcount++;
+    return elem;
+}
+
+/* Replace the compressed elements of the result with their decompressed copies.
+ * All the elements are released if it fails.
+ */
+static ENGINE_ERROR_CODE do_btree_elem_array_unzip(btree_meta_info *info,
+                                                   btree_elem_item **elem_array,
+                                                   const uint32_t elem_count)
+{
+    btree_elem_item *uelem;
+    uint32_t i;
+
+    if (info->zdict == NULL) {
+        return ENGINE_SUCCESS;
+    }
+    for (i = 0; i < elem_count; i++) {
+        if (do_btree_elem_zipped(elem_array[i])) {
+            if ((uelem = do_btree_elem_unzip(info, elem_array[i])) == NULL) {
+                break;
+            }
+            do_btree_elem_release(elem_array[i]);
+            elem_array[i] = uelem;
+        }
+    }
+    if (i < elem_count) {
+        for (i = 0; i < elem_count; i++) {
+            do_btree_elem_release(elem_array[i]);
+        }
+        return ENGINE_ENOMEM;
+    }
+    return ENGINE_SUCCESS;
+}
+
+static void do_btree_zip_init(void)
+{
+    memset(&zip_deflater, 0, sizeof(z_stream));
+    memset(&zip_inflater, 0, sizeof(z_stream));
+    if (deflateInit2(&zip_deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "btree compression is disabled: deflate init failed.\n");
+        return;
+    }
+    if (inflateInit2(&zip_inflater, -15) != Z_OK) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "btree compression is disabled: inflate init failed.\n");
+        deflateEnd(&zip_deflater);
+        return;
+    }
+    zip_enabled = true;
+}
+
+static void do_btree_zip_final(void)
+{
+    if (zip_enabled) {
+        deflateEnd(&zip_deflater);
+        inflateEnd(&zip_inflater);
+        zip_enabled = false;
+    }
+}
+#endif
+
+/* separator key of index nodes:
+ * the uint64 bkey itself or the first 8 bytes of the binary bkey (zero padded).
+ * The binary prefix preserves the bkey order, but it can be equal for different bkeys.
+ */
+static inline uint64_t do_btree_skey(const unsigned char *bkey, const uint32_t nbkey)
+{
+    if (nbkey == 0) {
+        return *(const uint64_t *)bkey;
+    } else {
+        uint64_t skey = 0;
+        for (int i = 0; i < sizeof(uint64_t); i++) {
+            skey <<= 8;
+            if (i < nbkey) skey |= bkey[i];
+        }
+        return skey;
+    }
+}
+
+static inline uint64_t do_btree_node_first_skey(btree_indx_node *node)
+{
+    /* both leaf and index nodes keep the first bkey (prefix) in skey[0] */
+    return BTREE_NODE_SKEY(node)[0];
+}
+
+/*
+ * skey search kernels
+ * Return the number of skeys less than the given skey in the sorted skey array.
+ * The AVX2 or SSE4.2 kernel is chosen at module init by the cpu features.
+ */
+static int do_btree_skey_lower_scalar(const uint64_t *skey, const int count, const uint64_t key)
+{
+    int left = 0, right = count;
+    int mid;
+
+    while (left < right) {
+        mid = (left + right) / 2;
+        if (skey[mid] < key) left  = mid+1;
+        else                 right = mid;
+    }
+    return left;
+}
+
+#ifdef BTREE_SKEY_SIMD
+/* The signed 64-bit compare of SIMD is used for unsigned skeys by flipping the sign bit.
+ * The node capacity is a multiple of 4, so the unused tail can be read and masked out.
+ * The scan stops at the first vector having a skey not less than the given skey.
+ */
+__attribute__((target("sse4.2")))
+static int do_btree_skey_lower_sse42(const uint64_t *skey, const int count, const uint64_t key)
+{
+    const __m128i sign = _mm_set1_epi64x(INT64_MIN);
+    const __m128i vkey = _mm_xor_si128(_mm_set1_epi64x((int64_t)key), sign);
+    int lower = 0;
+    int mask;
+
+    for (int i = 0; i < count; i += 2) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&skey[i]), sign);
+        mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(vkey, v)));
+        if (count - i < 2) mask &= ((1 << (count - i)) - 1);
+        lower += __builtin_popcount(mask);
+        if (mask != 0x3) break;
+    }
+    return lower;
+}
+
+__attribute__((target("avx2")))
+static int do_btree_skey_lower_avx2(const uint64_t *skey, const int count, const uint64_t key)
+{
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i vkey = _mm256_xor_si256(_mm256_set1_epi64x((int64_t)key), sign);
+    int lower = 0;
+    int mask;
+
+    for (int i = 0; i < count; i += 4) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&skey[i]), sign);
+        mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(vkey, v)));
+        if (count - i < 4) mask &= ((1 << (count - i)) - 1);
+        lower += __builtin_popcount(mask);
+        if (mask != 0xF) break;
+    }
+    return lower;
+}
+#endif
+
+static int (*do_btree_skey_lower)(const uint64_t *skey, const int count, const uint64_t key)
+    = do_btree_skey_lower_scalar;
+
+static void do_btree_skey_kernel_init(void)
+{
+#ifdef BTREE_SKEY_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        do_btree_skey_lower = do_btree_skey_lower_avx2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        do_btree_skey_lower = do_btree_skey_lower_sse42;
+    }
+#endif
+}
+
 /******************* BKEY COMPARISION CODE *************************/
 static inline int UINT64_COMP(const uint64_t *v1, const uint64_t *v2)
 {
@@ -723,7 +1155,7 @@ static inline void do_btree_decr_posi(btree_elem_posi *posi)
         if (posi->node != NULL)
             posi->indx = posi->node->used_count-1;
         else
-            posi->indx = BTREE_ITEM_COUNT;
+            posi->indx = BTREE_MAX_ITEM_COUNT;
     }
 }
 
@@ -753,6 +1185,30 @@ static void do_btree_decr_path(btree_elem_posi *path, int depth)
     assert(depth < BTREE_MAX_DEPTH);
 }
 
+/* search the bkey in the leaf node.
+ * Return the position of the first element whose bkey is not less than the bkey.
+ */
+static int do_btree_leaf_search(btree_indx_node *node, const unsigned char *bkey,
+                                const uint32_t nbkey, const uint64_t skey, bool *found)
+{
+    btree_elem_item *elem;
+    int indx = do_btree_skey_lower(BTREE_NODE_SKEY(node), node->used_count, skey);
+    int comp;
+
+    *found = false;
+    /* the same skey: compare with the full bkey */
+    while (indx < node->used_count && BTREE_NODE_SKEY(node)[indx] == skey) {
+        elem = BTREE_GET_ELEM_ITEM(node, indx);
+        comp = BKEY_COMP(bkey, nbkey, elem->data, elem->nbkey);
+        if (comp <= 0) {
+            *found = (comp == 0);
+            break;
+        }
+        indx++;
+    }
+    return indx;
+}
+
 static btree_indx_node *do_btree_find_leaf(btree_indx_node *root,
                                            const unsigned char *bkey, const uint32_t nbkey,
                                            btree_elem_posi *path,
@@ -760,40 +1216,42 @@ static btree_indx_node *do_btree_find_leaf(btree_indx_node *root,
 {
     btree_indx_node *node = root;
     btree_elem_item *elem;
-    int mid, left, right, comp;
+    uint64_t skey = do_btree_skey(bkey, nbkey);
+    int indx, comp;
 
     *found_elem = NULL; /* the same bkey is not found */
 
     while (node->ndepth > 0) {
-        left  = 1;
-        right = node->used_count-1;
+        indx = do_btree_skey_lower(BTREE_NODE_SKEY(node), node->used_count, skey);
 
-        while (left <= right) {
-            mid  = (left + right) / 2;
-            elem = do_btree_get_first_elem(node->item[mid]); /* separator */
+        /* equal separator key: compare with the full bkey */
+        while (indx < node->used_count && BTREE_NODE_SKEY(node)[indx] == skey) {
+            elem = do_btree_get_first_elem(node->item[indx]); /* separator */
             comp = BKEY_COMP(bkey, nbkey, elem->data, elem->nbkey);
-            if (comp == 0) { /* the same bkey is found */
+            if (comp < 0) break;
+            if (comp == 0 && indx > 0) { /* the same bkey is found */
                 *found_elem = elem;
-                if (path) {
-                    path[node->ndepth].node = node;
-                    path[node->ndepth].indx = mid;
-                }
-                node = do_btree_get_first_leaf(node->item[mid], path);
-                assert(node->ndepth == 0);
                 break;
             }
-            if (comp <  0) right = mid-1;
-            else           left  = mid+1;
+            indx++;
         }
-        if (left <= right) { /* found the element */
+        if (*found_elem != NULL) {
+            if (path) {
+                path[node->ndepth].node = node;
+                path[node->ndepth].indx = indx;
+            }
+            node = do_btree_get_first_leaf(node->item[indx], path);
+            assert(node->ndepth == 0);
             break;
         }
 
+        /* the last child whose separator is not greater than the bkey */
+        if (indx > 0) indx -= 1;
         if (path) {
             path[node->ndepth].node = node;
-            path[node->ndepth].indx = right;
+            path[node->ndepth].indx = indx;
         }
-        node = (btree_indx_node *)(node->item[right]);
+        node = (btree_indx_node *)(node->item[indx]);
     }
     return node;
 }
@@ -804,7 +1262,7 @@ static ENGINE_ERROR_CODE do_btree_find_insposi(btree_indx_node *root,
 {
     btree_indx_node *node;
     btree_elem_item *elem;
-    int mid, left, right, comp;
+    bool found;
 
     /* find leaf node */
     node = do_btree_find_leaf(root, ins_bkey, ins_nbkey, path, &elem);
@@ -818,25 +1276,12 @@ static ENGINE_ERROR_CODE do_btree_find_insposi(btree_indx_node *root,
     }
 
     /* do search the bkey(ins_bkey) in leaf node */
-    left  = 0;
-    right = node->used_count-1;
-
-    while (left <= right) {
-        mid  = (left + right) / 2;
-        elem = BTREE_GET_ELEM_ITEM(node, mid);
-        comp = BKEY_COMP(ins_bkey, ins_nbkey, elem->data, elem->nbkey);
-        if (comp == 0) break;
-        if (comp <  0) right = mid-1;
-        else           left  = mid+1;
-    }
-
-    if (left <= right) { /* the bkey(ins_bkey) is found */
-        path[0].node = node;
-        path[0].indx = mid;
+    path[0].node = node;
+    path[0].indx = do_btree_leaf_search(node, ins_bkey, ins_nbkey,
+                                        do_btree_skey(ins_bkey, ins_nbkey), &found);
+    if (found) { /* the bkey(ins_bkey) is found */
         return ENGINE_ELEM_EEXISTS;
-    } else {             /* the bkey(ins_bkey) is not found */
-        path[0].node = node;
-        path[0].indx = left;
+    } else {     /* the bkey(ins_bkey) is not found */
         return ENGINE_SUCCESS;
     }
 }
@@ -847,7 +1292,8 @@ static btree_elem_item *do_btree_find_first(btree_indx_node *root,
 {
     btree_indx_node *node;
     btree_elem_item *elem;
-    int mid, left, right, comp;
+    int left, right;
+    bool found;
 
     if (bkrange == NULL) {
         assert(bkrtype != BKEY_RANGE_TYPE_SIN);
@@ -879,24 +1325,16 @@ static btree_elem_item *do_btree_find_first(btree_indx_node *root,
     }
 
     /* do search the bkey(from_bkey) in leaf node */
-    left  = 0;
-    right = node->used_count-1;
-
-    while (left <= right) {
-        mid  = (left + right) / 2;
-        elem = BTREE_GET_ELEM_ITEM(node, mid);
-        comp = BKEY_COMP(bkrange->from_bkey, bkrange->from_nbkey, elem->data, elem->nbkey);
-        if (comp == 0) break;
-        if (comp <  0) right = mid-1;
-        else           left  = mid+1;
-    }
+    left  = do_btree_leaf_search(node, bkrange->from_bkey, bkrange->from_nbkey,
+                                 do_btree_skey(bkrange->from_bkey, bkrange->from_nbkey), &found);
+    right = left-1;
 
-    if (left <= right) { /* the bkey(from_bkey) is found. */
+    if (found) { /* the bkey(from_bkey) is found. */
         path[0].bkeq = true;
         path[0].node = node;
-        path[0].indx = mid;
-        /* elem != NULL */
-    } else {             /* the bkey(from_bkey) is not found */
+        path[0].indx = left;
+        elem = BTREE_GET_ELEM_ITEM(node, left);
+    } else {     /* the bkey(from_bkey) is not found */
         path[0].bkeq = false;
         switch (bkrtype) {
           case BKEY_RANGE_TYPE_SIN: /* single bkey */
@@ -919,7 +1357,7 @@ static btree_elem_item *do_btree_find_first(btree_indx_node *root,
                         path[0].indx = node->prev->used_count-1;
                         if (path_flag) do_btree_decr_path(path, 1);
                     } else {
-                        path[0].indx = BTREE_ITEM_COUNT;
+                        path[0].indx = BTREE_MAX_ITEM_COUNT;
                     }
                 }
             }
@@ -956,7 +1394,7 @@ static btree_elem_item *do_btree_find_first(btree_indx_node *root,
                     path[0].indx = node->prev->used_count-1;
                     if (path_flag) do_btree_decr_path(path, 1);
                 } else {
-                    path[0].indx = BTREE_ITEM_COUNT;
+                    path[0].indx = BTREE_MAX_ITEM_COUNT;
                 }
             }
             if (path[0].node == NULL) {
@@ -1075,9 +1513,9 @@ static void do_btree_consistency_check(btree_indx_node *node, uint32_t ecount, b
         tot_ecnt = 0;
         for (i = 0; i < node->used_count; i++) {
             assert(node->item[i] != NULL);
-            assert(node->ecnt[i] > 0);
-            do_btree_consistency_check((btree_indx_node*)node->item[i], node->ecnt[i], detail);
-            tot_ecnt += node->ecnt[i];
+            assert(BTREE_NODE_ECNT(node)[i] > 0);
+            do_btree_consistency_check((btree_indx_node*)node->item[i], BTREE_NODE_ECNT(node)[i], detail);
+            tot_ecnt += BTREE_NODE_ECNT(node)[i];
         }
         assert(tot_ecnt == ecount);
     } else { /* node->ndepth == 0: leaf page check */
@@ -1127,42 +1565,50 @@ static void do_btree_node_item_move(btree_indx_node *c_node, /* current node */
         if (c_node->ndepth == 0) { /* leaf node */
             for (i = (n_node->used_count-1); i >= 0; i--) {
                 n_node->item[move_count+i] = n_node->item[i];
+                BTREE_NODE_SKEY(n_node)[move_count+i] = BTREE_NODE_SKEY(n_node)[i];
             }
             for (i = 0; i < move_count; i++) {
                 n_node->item[i] = c_node->item[c_node->used_count-move_count+i];
                 c_node->item[c_node->used_count-move_count+i] = NULL;
+                BTREE_NODE_SKEY(n_node)[i] = BTREE_NODE_SKEY(c_node)[c_node->used_count-move_count+i];
             }
         } else { /* c_node->ndepth > 0: nonleaf node */
             for (i = (n_node->used_count-1); i >= 0; i--) {
                 n_node->item[move_count+i] = n_node->item[i];
-                n_node->ecnt[move_count+i] = n_node->ecnt[i];
+                BTREE_NODE_ECNT(n_node)[move_count+i] = BTREE_NODE_ECNT(n_node)[i];
+                BTREE_NODE_SKEY(n_node)[move_count+i] = BTREE_NODE_SKEY(n_node)[i];
             }
             for (i = 0; i < move_count; i++) {
                 n_node->item[i] = c_node->item[c_node->used_count-move_count+i];
                 c_node->item[c_node->used_count-move_count+i] = NULL;
-                n_node->ecnt[i] = c_node->ecnt[c_node->used_count-move_count+i];
-                c_node->ecnt[c_node->used_count-move_count+i] = 0;
+                BTREE_NODE_ECNT(n_node)[i] = BTREE_NODE_ECNT(c_node)[c_node->used_count-move_count+i];
+                BTREE_NODE_ECNT(c_node)[c_node->used_count-move_count+i] = 0;
+                BTREE_NODE_SKEY(n_node)[i] = BTREE_NODE_SKEY(c_node)[c_node->used_count-move_count+i];
             }
         }
     } else { /* BTREE_DIRECTION_PREV */
         if (c_node->ndepth == 0) { /* leaf node */
             for (i = 0; i < move_count; i++) {
                 n_node->item[n_node->used_count+i] = c_node->item[i];
+                BTREE_NODE_SKEY(n_node)[n_node->used_count+i] = BTREE_NODE_SKEY(c_node)[i];
             }
             for (i = move_count; i < c_node->used_count; i++) {
                 c_node->item[i-move_count] = c_node->item[i];
                 c_node->item[i] = NULL;
+                BTREE_NODE_SKEY(c_node)[i-move_count] = BTREE_NODE_SKEY(c_node)[i];
             }
         } else { /* c_node->ndepth > 0: nonleaf node */
             for (i = 0; i < move_count; i++) {
                 n_node->item[n_node->used_count+i] = c_node->item[i];
-                n_node->ecnt[n_node->used_count+i] = c_node->ecnt[i];
+                BTREE_NODE_ECNT(n_node)[n_node->used_count+i] = BTREE_NODE_ECNT(c_node)[i];
+                BTREE_NODE_SKEY(n_node)[n_node->used_count+i] = BTREE_NODE_SKEY(c_node)[i];
             }
             for (i = move_count; i < c_node->used_count; i++) {
                 c_node->item[i-move_count] = c_node->item[i];
                 c_node->item[i] = NULL;
-                c_node->ecnt[i-move_count] = c_node->ecnt[i];
-                c_node->ecnt[i] = 0;
+                BTREE_NODE_ECNT(c_node)[i-move_count] = BTREE_NODE_ECNT(c_node)[i];
+                BTREE_NODE_ECNT(c_node)[i] = 0;
+                BTREE_NODE_SKEY(c_node)[i-move_count] = BTREE_NODE_SKEY(c_node)[i];
             }
         }
     }
@@ -1177,7 +1623,7 @@ static void do_btree_ecnt_move_split(btree_elem_posi *path, int depth, int direc
 
     while (depth < BTREE_MAX_DEPTH) {
         posi = path[depth];
-        posi.node->ecnt[posi.indx] -= elem_count;
+        BTREE_NODE_ECNT(posi.node)[posi.indx] -= elem_count;
 
         saved_node = posi.node;
         if (direction == BTREE_DIRECTION_NEXT) {
@@ -1185,7 +1631,7 @@ static void do_btree_ecnt_move_split(btree_elem_posi *path, int depth, int direc
         } else {
             do_btree_decr_posi(&posi);
         }
-        posi.node->ecnt[posi.indx] += elem_count;
+        BTREE_NODE_ECNT(posi.node)[posi.indx] += elem_count;
         if (saved_node == posi.node) break;
         depth += 1;
     }
@@ -1199,27 +1645,131 @@ static void do_btree_ecnt_move_merge(btree_elem_posi *path, int depth, int direc
 
     while (depth < BTREE_MAX_DEPTH) {
         posi = path[depth];
-        posi.node->ecnt[posi.indx] -= elem_count;
+        BTREE_NODE_ECNT(posi.node)[posi.indx] -= elem_count;
 
         saved_node = posi.node;
         if (direction == BTREE_DIRECTION_NEXT) {
             do {
                 do_btree_incr_posi(&posi);
             } while (posi.node->used_count == 0 ||
-                     posi.node->ecnt[posi.indx] == 0);
+                     BTREE_NODE_ECNT(posi.node)[posi.indx] == 0);
         } else {
             do {
                 do_btree_decr_posi(&posi);
             } while (posi.node->used_count == 0 ||
-                     posi.node->ecnt[posi.indx] == 0);
+                     BTREE_NODE_ECNT(posi.node)[posi.indx] == 0);
         }
-        posi.node->ecnt[posi.indx] += elem_count;
+        BTREE_NODE_ECNT(posi.node)[posi.indx] += elem_count;
         if (saved_node == posi.node) break;
         depth += 1;
     }
     assert(depth < BTREE_MAX_DEPTH);
 }
 
+/*
+ * Separator key maintenance
+ *
+ * skey[i] of an index node has the first bkey (prefix) of its i-th subtree,
+ * and skey[i] of a leaf node has the bkey (prefix) of its i-th element.
+ * A leaf update changes only the separators on its path, and a node split
+ * or merge changes the separators of the nodes placed between the neighbor
+ * nodes of the restructured nodes in each btree depth.
+ */
+typedef struct _btree_skey_bound {
+    btree_indx_node *prev[BTREE_MAX_DEPTH];
+    btree_indx_node *next[BTREE_MAX_DEPTH];
+} btree_skey_bound;
+
+static void do_btree_skey_check(btree_indx_node *node)
+{
+    btree_indx_node *child;
+    btree_elem_item *elem;
+
+    if (node == NULL) return;
+
+    if (node->ndepth == 0) {
+        for (int i = 0; i < node->used_count; i++) {
+            elem = BTREE_GET_ELEM_ITEM(node, i);
+            assert(BTREE_NODE_SKEY(node)[i] == do_btree_skey(elem->data, elem->nbkey));
+        }
+        return;
+    }
+    for (int i = 0; i < node->used_count; i++) {
+        child = BTREE_GET_NODE_ITEM(node, i);
+        do_btree_skey_check(child);
+        assert(BTREE_NODE_SKEY(node)[i] == do_btree_node_first_skey(child));
+    }
+}
+
+static void do_btree_skey_path_update(btree_indx_node *root, btree_elem_posi *path, int depth)
+{
+    /* the first item of path[depth].node has been changed */
+    btree_indx_node *node = path[depth].node;
+    uint64_t skey;
+
+    if (node->used_count == 0) return; /* to be removed */
+
+    skey = do_btree_node_first_skey(node);
+    for (int i = depth+1; i <= root->ndepth; i++) {
+        BTREE_NODE_SKEY(path[i].node)[path[i].indx] = skey;
+        if (path[i].indx > 0) break;
+    }
+}
+
+static void do_btree_skey_bound_set(btree_skey_bound *bound, btree_indx_node *root,
+                                    btree_elem_posi *fpath, btree_elem_posi *lpath)
+{
+    /* fpath, lpath: the paths to the first and last leaf nodes to be restructured */
+    for (int i = 0; i < BTREE_MAX_DEPTH; i++) {
+        if (i <= root->ndepth) {
+            bound->prev[i] = fpath[i].node->prev;
+            bound->next[i] = lpath[i].node->next;
+        } else {
+            bound->prev[i] = bound->next[i] = NULL;
+        }
+    }
+}
+
+static void do_btree_skey_refresh(btree_meta_info *info, btree_skey_bound *bound)
+{
+    btree_indx_node *node;
+    btree_indx_node *child;
+    int depth, i;
+    bool inrange;
+
+    if (info->root == NULL) return;
+
+    for (depth = 1; depth <= info->root->ndepth; depth++) {
+        /* The bound nodes are never removed by the split or merge.
+         * Refresh the separators of child nodes from prev[depth-1] to next[depth-1].
+         */
+        if (bound->prev[depth] != NULL) {
+            node = bound->prev[depth];
+        } else {
+            node = info->root;
+            while (node->ndepth > depth) {
+                node = BTREE_GET_NODE_ITEM(node, 0);
+            }
+        }
+        inrange = (bound->prev[depth-1] == NULL);
+        for ( ; node != NULL; node = node->next) {
+            for (i = 0; i < node->used_count; i++) {
+                child = BTREE_GET_NODE_ITEM(node, i);
+                if (inrange == false) {
+                    if (child != bound->prev[depth-1]) continue;
+                    inrange = true;
+                }
+                BTREE_NODE_SKEY(node)[i] = do_btree_node_first_skey(child);
+                if (child == bound->next[depth-1]) break;
+            }
+            if (i < node->used_count) break; /* reached the next bound */
+        }
+    }
+    if (btree_position_debug) {
+        do_btree_skey_check(info->root);
+    }
+}
+
 static void do_btree_node_sbalance(btree_indx_node *node, btree_elem_posi *path, int depth)
 {
     btree_elem_posi *posi;
@@ -1250,7 +1800,7 @@ static void do_btree_node_sbalance(btree_indx_node *node, btree_elem_posi *path,
         } else {
             elem_count = 0;
             for (i = 0; i < move_count; i++) {
-                elem_count += node->ecnt[node->used_count-move_count+i];
+                elem_count += BTREE_NODE_ECNT(node)[node->used_count-move_count+i];
             }
         }
 
@@ -1281,7 +1831,7 @@ static void do_btree_node_sbalance(btree_indx_node *node, btree_elem_posi *path,
         } else {
             elem_count = 0;
             for (i = 0; i < move_count; i++) {
-                elem_count += node->ecnt[i];
+                elem_count += BTREE_NODE_ECNT(node)[i];
             }
         }
 
@@ -1315,7 +1865,8 @@ static void do_btree_node_link(btree_meta_info *info, btree_indx_node *node,
             node->used_count = 0;
         } else {
             node->item[0] = info->root;
-            node->ecnt[0] = info->ccnt;
+            BTREE_NODE_ECNT(node)[0] = info->ccnt;
+            BTREE_NODE_SKEY(node)[0] = do_btree_node_first_skey(info->root);
             node->used_count = 1;
         }
         info->root = node;
@@ -1342,17 +1893,18 @@ static void do_btree_node_link(btree_meta_info *info, btree_indx_node *node,
 
         for (int i = (p_node->used_count-1); i >= p_posi->indx; i--) {
             p_node->item[i+1] = p_node->item[i];
-            p_node->ecnt[i+1] = p_node->ecnt[i];
+            BTREE_NODE_ECNT(p_node)[i+1] = BTREE_NODE_ECNT(p_node)[i];
+            BTREE_NODE_SKEY(p_node)[i+1] = BTREE_NODE_SKEY(p_node)[i];
         }
         p_node->item[p_posi->indx] = node;
-        p_node->ecnt[p_posi->indx] = 0;
+        BTREE_NODE_ECNT(p_node)[p_posi->indx] = 0;
+        /* the separator key is set after the node gets its items */
         p_node->used_count++;
     }
 
     if (1) { /* apply memory space */
         size_t stotal;
-        if (node->ndepth > 0) stotal = slabs_space_size(sizeof(btree_indx_node));
-        else                  stotal = slabs_space_size(sizeof(btree_leaf_node));
+        stotal = slabs_space_size(do_btree_node_size(node->ndepth, node->capacity));
         do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_BTREE, stotal);
     }
 }
@@ -1369,20 +1921,20 @@ static ENGINE_ERROR_CODE do_btree_node_split(btree_meta_info *info, btree_elem_p
 
     s_node = path[btree_depth].node;
     do {
-        if ((s_node->next != NULL && s_node->next->used_count < (BTREE_ITEM_COUNT/2)) ||
-            (s_node->prev != NULL && s_node->prev->used_count < (BTREE_ITEM_COUNT/2))) {
+        if ((s_node->next != NULL && s_node->next->used_count < (s_node->capacity/2)) ||
+            (s_node->prev != NULL && s_node->prev->used_count < (s_node->capacity/2))) {
             do_btree_node_sbalance(s_node, path, btree_depth);
             break;
         }
 
-        n_node[btree_depth] = do_btree_node_alloc(btree_depth, cookie);
+        n_node[btree_depth] = do_btree_node_alloc(btree_depth, info->fanout, cookie);
         if (n_node[btree_depth] == NULL) {
             ret = ENGINE_ENOMEM; break;
         }
         btree_depth += 1;
         assert(btree_depth < BTREE_MAX_DEPTH);
         if (btree_depth > info->root->ndepth) {
-            btree_indx_node *r_node = do_btree_node_alloc(btree_depth, cookie);
+            btree_indx_node *r_node = do_btree_node_alloc(btree_depth, info->fanout, cookie);
             if (r_node == NULL) {
                 ret = ENGINE_ENOMEM; break;
             }
@@ -1393,13 +1945,13 @@ static ENGINE_ERROR_CODE do_btree_node_split(btree_meta_info *info, btree_elem_p
         }
         s_node = path[btree_depth].node;
     }
-    while (s_node->used_count >= BTREE_ITEM_COUNT);
+    while (s_node->used_count >= s_node->capacity);
 
     if (ret == ENGINE_SUCCESS) {
         for (i = btree_depth-1; i >= 0; i--) {
             s_node = path[i].node;
             if (s_node->prev == NULL && s_node->next == NULL) {
-                direction = (path[i].indx < (BTREE_ITEM_COUNT/2) ?
+                direction = (path[i].indx < (s_node->capacity/2) ?
                              BTREE_DIRECTION_PREV : BTREE_DIRECTION_NEXT);
             } else {
                 direction = (s_node->prev == NULL ?
@@ -1445,7 +1997,7 @@ static void do_btree_node_mbalance(btree_indx_node *node, btree_elem_posi *path,
         do_btree_node_item_move(node, node->prev, direction, node->used_count);
     }
 
-    int elem_count = path[depth+1].node->ecnt[path[depth+1].indx];
+    int elem_count = BTREE_NODE_ECNT(path[depth+1].node)[path[depth+1].indx];
     do_btree_ecnt_move_merge(path, depth+1, direction, elem_count);
 }
 
@@ -1463,20 +2015,20 @@ static void do_btree_node_unlink(btree_meta_info *info, btree_indx_node *node,
 
         /* Parent node exists */
         btree_indx_node *p_node = p_posi->node;
-        assert(p_node->ecnt[p_posi->indx] == 0);
+        assert(BTREE_NODE_ECNT(p_node)[p_posi->indx] == 0);
         for (int i = p_posi->indx+1; i < p_node->used_count; i++) {
             p_node->item[i-1] = p_node->item[i];
-            p_node->ecnt[i-1] = p_node->ecnt[i];
+            BTREE_NODE_ECNT(p_node)[i-1] = BTREE_NODE_ECNT(p_node)[i];
+            BTREE_NODE_SKEY(p_node)[i-1] = BTREE_NODE_SKEY(p_node)[i];
         }
         p_node->item[p_node->used_count-1] = NULL;
-        p_node->ecnt[p_node->used_count-1] = 0;
+        BTREE_NODE_ECNT(p_node)[p_node->used_count-1] = 0;
         p_node->used_count--;
     }
 
     if (info->stotal > 0) { /* apply memory space */
         size_t stotal;
-        if (node->ndepth > 0) stotal = slabs_space_size(sizeof(btree_indx_node));
-        else                  stotal = slabs_space_size(sizeof(btree_leaf_node));
+        stotal = slabs_space_size(do_btree_node_size(node->ndepth, node->capacity));
         do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_BTREE, stotal);
     }
 
@@ -1515,9 +2067,10 @@ static inline void do_btree_node_remove_null_items(btree_elem_posi *posi, const
             if (node->item[i] != NULL) {
                 node->item[f] = node->item[i];
                 node->item[i] = NULL;
+                BTREE_NODE_SKEY(node)[f] = BTREE_NODE_SKEY(node)[i];
                 if (node->ndepth > 0) {
-                    node->ecnt[f] = node->ecnt[i];
-                    node->ecnt[i] = 0;
+                    BTREE_NODE_ECNT(node)[f] = BTREE_NODE_ECNT(node)[i];
+                    BTREE_NODE_ECNT(node)[i] = 0;
                 }
                 f++;
             } else {
@@ -1564,9 +2117,9 @@ static void do_btree_node_merge(btree_meta_info *info, btree_elem_posi *path,
                     do_btree_node_unlink(info, node, &path[btree_depth+1]);
                     par_node_count = 1;
                 }
-                else if (node->used_count < (BTREE_ITEM_COUNT/2)) {
-                    if ((node->prev != NULL && node->prev->used_count < (BTREE_ITEM_COUNT/2)) ||
-                        (node->next != NULL && node->next->used_count < (BTREE_ITEM_COUNT/2))) {
+                else if (node->used_count < (node->capacity/2)) {
+                    if ((node->prev != NULL && node->prev->used_count < (node->capacity/2)) ||
+                        (node->next != NULL && node->next->used_count < (node->capacity/2))) {
                         do_btree_node_mbalance(node, path, btree_depth);
                         do_btree_node_unlink(info, node, &path[btree_depth+1]);
                         par_node_count = 1;
@@ -1593,7 +2146,7 @@ static void do_btree_node_merge(btree_meta_info *info, btree_elem_posi *path,
                 if (node->used_count == 0) {
                     do_btree_node_detach(node);
                     s_posi.node->item[s_posi.indx] = NULL;
-                    assert(s_posi.node->ecnt[s_posi.indx] == 0);
+                    assert(BTREE_NODE_ECNT(s_posi.node)[s_posi.indx] == 0);
                 }
 
                 if (i == cur_node_count) break;
@@ -1608,13 +2161,13 @@ static void do_btree_node_merge(btree_meta_info *info, btree_elem_posi *path,
                 if (node == NULL) {
                     cur_unlink_cnt++;
                 }
-                else if (node->used_count < (BTREE_ITEM_COUNT/2)) {
-                    if ((node->prev != NULL && node->prev->used_count < (BTREE_ITEM_COUNT/2)) ||
-                        (node->next != NULL && node->next->used_count < (BTREE_ITEM_COUNT/2))) {
+                else if (node->used_count < (node->capacity/2)) {
+                    if ((node->prev != NULL && node->prev->used_count < (node->capacity/2)) ||
+                        (node->next != NULL && node->next->used_count < (node->capacity/2))) {
                         do_btree_node_mbalance(node, upth, btree_depth);
                         do_btree_node_detach(node);
                         upth[upp_depth].node->item[upth[upp_depth].indx] = NULL;
-                        assert(upth[upp_depth].node->ecnt[upth[upp_depth].indx] == 0);
+                        assert(BTREE_NODE_ECNT(upth[upp_depth].node)[upth[upp_depth].indx] == 0);
                         cur_unlink_cnt++;
                     }
                 }
@@ -1640,8 +2193,7 @@ static void do_btree_node_merge(btree_meta_info *info, btree_elem_posi *path,
             }
             if (tot_unlink_cnt > 0 && info->stotal > 0) { /* apply memory space */
                 size_t stotal;
-                if (btree_depth > 0) stotal = tot_unlink_cnt * slabs_space_size(sizeof(btree_indx_node));
-                else                 stotal = tot_unlink_cnt * slabs_space_size(sizeof(btree_leaf_node));
+                stotal = tot_unlink_cnt * slabs_space_size(do_btree_node_size(btree_depth, info->fanout));
                 do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_BTREE, stotal);
             }
         }
@@ -1678,17 +2230,23 @@ static void do_btree_elem_unlink(btree_meta_info *info, btree_elem_posi *path,
     btree_indx_node *node = posi->node;
     for (i = posi->indx+1; i < node->used_count; i++) {
         node->item[i-1] = node->item[i];
+        BTREE_NODE_SKEY(node)[i-1] = BTREE_NODE_SKEY(node)[i];
     }
     node->item[node->used_count-1] = NULL;
     node->used_count--;
     /* decrement element count in upper nodes */
     for (i = 1; i <= info->root->ndepth; i++) {
-        path[i].node->ecnt[path[i].indx]--;
+        BTREE_NODE_ECNT(path[i].node)[path[i].indx]--;
     }
     info->ccnt--;
 
-    if (node->used_count < (BTREE_ITEM_COUNT/2)) {
+    if (node->used_count < (node->capacity/2)) {
+        btree_skey_bound bound;
+        do_btree_skey_bound_set(&bound, info->root, path, path);
         do_btree_node_merge(info, path, true, 1);
+        do_btree_skey_refresh(info, &bound);
+    } else if (posi->indx == 0) {
+        do_btree_skey_path_update(info->root, path, 0);
     }
 }
 
@@ -1775,6 +2333,7 @@ static ENGINE_ERROR_CODE do_btree_elem_update(btree_meta_info *info,
         if (value != NULL) {
             memcpy(elem->data + real_nbkey + elem->neflag, value, nbytes);
             elem->nbytes = nbytes;
+            elem->zipped = 0;
         }
         CLOG_BTREE_ELEM_INSERT(info, elem, elem);
     } else {
@@ -1816,6 +2375,7 @@ static ENGINE_ERROR_CODE do_btree_elem_update(btree_meta_info *info,
             memcpy(ptr, value, nbytes);
         } else {
             memcpy(ptr, elem->data + real_nbkey + elem->neflag, elem->nbytes);
+            new_elem->zipped = elem->zipped;
         }
 
         do_btree_elem_replace(info, &posi, new_elem);
@@ -1974,8 +2534,8 @@ static uint32_t do_btree_elem_delete(btree_meta_info *info,
                     do_btree_node_remove_null_items(&s_posi, forward, cur_found);
                     /* decrement element count in upper nodes */
                     for (i = 1; i <= root->ndepth; i++) {
-                        assert(upth[i].node->ecnt[upth[i].indx] >= cur_found);
-                        upth[i].node->ecnt[upth[i].indx] -= cur_found;
+                        assert(BTREE_NODE_ECNT(upth[i].node)[upth[i].indx] >= cur_found);
+                        BTREE_NODE_ECNT(upth[i].node)[upth[i].indx] -= cur_found;
                     }
                     tot_found += cur_found;
                     cur_found = 0;
@@ -1993,8 +2553,8 @@ static uint32_t do_btree_elem_delete(btree_meta_info *info,
             do_btree_node_remove_null_items(&s_posi, forward, cur_found);
             /* decrement element count in upper nodes */
             for (i = 1; i <= root->ndepth; i++) {
-                assert(upth[i].node->ecnt[upth[i].indx] >= cur_found);
-                upth[i].node->ecnt[upth[i].indx] -= cur_found;
+                assert(BTREE_NODE_ECNT(upth[i].node)[upth[i].indx] >= cur_found);
+                BTREE_NODE_ECNT(upth[i].node)[upth[i].indx] -= cur_found;
             }
             tot_found += cur_found;
         }
@@ -2009,13 +2569,24 @@ static uint32_t do_btree_elem_delete(btree_meta_info *info,
                 assert(tot_space <= info->stotal);
                 do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_BTREE, tot_space);
             }
+            /* the separators between the first and last visited nodes are refreshed */
+            btree_skey_bound bound;
+            upth[0] = s_posi;
+            do_btree_skey_bound_set(&bound, info->root, (forward ? path : upth),
+                                                        (forward ? upth : path));
             do_btree_node_merge(info, path, forward, node_cnt);
+            do_btree_skey_refresh(info, &bound);
         }
         CLOG_ELEM_DELETE_END((coll_meta_info*)info, cause);
     }
     if (tot_found > 0) {
         CLOG_BTREE_ELEM_DELETE_LOGICAL(info, bkrange, efilter, offset, count, cause);
     }
+#ifdef ENABLE_BTREE_COMPRESS
+    if (info->zdict != NULL && info->root == NULL) {
+        do_btree_zdict_free(info);
+    }
+#endif
     return tot_found;
 }
 
@@ -2224,11 +2795,14 @@ static ENGINE_ERROR_CODE do_btree_elem_link(btree_meta_info *info, btree_elem_it
 #endif
 
         /* If the leaf node is full of elements, split it ahead. */
-        if (path[0].node->used_count >= BTREE_ITEM_COUNT) {
+        if (path[0].node->used_count >= path[0].node->capacity) {
+            btree_skey_bound bound;
+            do_btree_skey_bound_set(&bound, info->root, path, path);
             res = do_btree_node_split(info, path, cookie);
             if (res != ENGINE_SUCCESS) {
                 return res;
             }
+            do_btree_skey_refresh(info, &bound);
         }
 
         if (info->ccnt > 0) {
@@ -2252,13 +2826,18 @@ static ENGINE_ERROR_CODE do_btree_elem_link(btree_meta_info *info, btree_elem_it
         if (path[0].indx < path[0].node->used_count) {
             for (int i = (path[0].node->used_count-1); i >= path[0].indx; i--) {
                 path[0].node->item[i+1] = path[0].node->item[i];
+                BTREE_NODE_SKEY(path[0].node)[i+1] = BTREE_NODE_SKEY(path[0].node)[i];
             }
         }
         path[0].node->item[path[0].indx] = elem;
+        BTREE_NODE_SKEY(path[0].node)[path[0].indx] = do_btree_skey(elem->data, elem->nbkey);
         path[0].node->used_count++;
         /* increment element count in upper nodes */
         for (int i = 1; i <= info->root->ndepth; i++) {
-            path[i].node->ecnt[path[i].indx]++;
+            BTREE_NODE_ECNT(path[i].node)[path[i].indx]++;
+        }
+        if (path[0].indx == 0) {
+            do_btree_skey_path_update(info->root, path, 0);
         }
         info->ccnt++;
 
@@ -2301,7 +2880,7 @@ static bool do_btree_overlapped_with_trimmed_space(btree_meta_info *info,
     switch (info->ovflact) {
       case OVFL_SMALLEST_TRIM:
            if (posi->node == NULL) {
-               if (posi->indx == BTREE_ITEM_COUNT) overlapped = true;
+               if (posi->indx == BTREE_MAX_ITEM_COUNT) overlapped = true;
            } else {
                /* the bkey of the found elem isn't same with the from_bkey of bkey range */
                assert(posi->node->ndepth == 0); /* leaf node */
@@ -2423,8 +3002,8 @@ static uint32_t do_btree_elem_get(btree_meta_info *info,
                         do_btree_node_remove_null_items(&s_posi, forward, cur_found);
                         /* decrement element count in upper nodes */
                         for (i = 1; i <= root->ndepth; i++) {
-                            assert(upth[i].node->ecnt[upth[i].indx] >= cur_found);
-                            upth[i].node->ecnt[upth[i].indx] -= cur_found;
+                            assert(BTREE_NODE_ECNT(upth[i].node)[upth[i].indx] >= cur_found);
+                            BTREE_NODE_ECNT(upth[i].node)[upth[i].indx] -= cur_found;
                         }
                     }
                     tot_found += cur_found;
@@ -2444,8 +3023,8 @@ static uint32_t do_btree_elem_get(btree_meta_info *info,
                 do_btree_node_remove_null_items(&s_posi, forward, cur_found);
                 /* decrement element count in upper nodes */
                 for (i = 1; i <= root->ndepth; i++) {
-                    assert(upth[i].node->ecnt[upth[i].indx] >= cur_found);
-                    upth[i].node->ecnt[upth[i].indx] -= cur_found;
+                    assert(BTREE_NODE_ECNT(upth[i].node)[upth[i].indx] >= cur_found);
+                    BTREE_NODE_ECNT(upth[i].node)[upth[i].indx] -= cur_found;
                 }
             }
             tot_found += cur_found;
@@ -2455,7 +3034,13 @@ static uint32_t do_btree_elem_get(btree_meta_info *info,
             info->ccnt -= tot_found;
             assert(tot_space <= info->stotal);
             do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_BTREE, tot_space);
+            /* the separators between the first and last visited nodes are refreshed */
+            btree_skey_bound bound;
+            upth[0] = s_posi;
+            do_btree_skey_bound_set(&bound, info->root, (forward ? path : upth),
+                                                        (forward ? upth : path));
             do_btree_node_merge(info, path, forward, node_cnt);
+            do_btree_skey_refresh(info, &bound);
         }
 
         /* check if end position might be trimmed */
@@ -2475,6 +3060,52 @@ static uint32_t do_btree_elem_get(btree_meta_info *info,
     return tot_found;
 }
 
+#ifdef ENABLE_BTREE_COMPRESS
+/* Get and delete the elements with their values decompressed.
+ * The elements are decompressed before they are unlinked,
+ * so nothing is deleted if the decompression fails.
+ */
+static ENGINE_ERROR_CODE do_btree_elem_get_unzipped(btree_meta_info *info,
+                                                    const int bkrtype, const bkey_range *bkrange,
+                                                    const eflag_filter *efilter,
+                                                    const uint32_t offset, const uint32_t count,
+                                                    btree_elem_item **elem_array, uint32_t *elem_count,
+                                                    uint32_t *opcost, bool *potentialbkeytrim)
+{
+    btree_elem_item **del_array;
+    uint32_t del_count;
+    uint32_t i;
+
+    *elem_count = do_btree_elem_get(info, bkrtype, bkrange, efilter, offset, count, false,
+                                    elem_array, opcost, potentialbkeytrim);
+    if (*elem_count == 0) {
+        return ENGINE_SUCCESS;
+    }
+    del_array = (btree_elem_item **)malloc(*elem_count * sizeof(btree_elem_item*));
+    if (del_array == NULL) {
+        for (i = 0; i < *elem_count; i++) {
+            do_btree_elem_release(elem_array[i]);
+        }
+        *elem_count = 0;
+        return ENGINE_ENOMEM;
+    }
+    if (do_btree_elem_array_unzip(info, elem_array, *elem_count) != ENGINE_SUCCESS) {
+        free(del_array);
+        *elem_count = 0;
+        return ENGINE_ENOMEM;
+    }
+    /* The same elements are found again under the cache lock. */
+    del_count = do_btree_elem_get(info, bkrtype, bkrange, efilter, offset, count, true,
+                                  del_array, NULL, potentialbkeytrim);
+    assert(del_count == *elem_count);
+    for (i = 0; i < del_count; i++) {
+        do_btree_elem_release(del_array[i]);
+    }
+    free(del_array);
+    return ENGINE_SUCCESS;
+}
+#endif
+
 static uint32_t do_btree_elem_count(btree_meta_info *info,
                                     const int bkrtype, const bkey_range *bkrange,
                                     const eflag_filter *efilter, uint32_t *opcost)
@@ -2564,7 +3195,7 @@ static ENGINE_ERROR_CODE do_btree_elem_insert(hash_item *it, btree_elem_item *el
     /* create the root node if it does not exist */
     bool new_root_flag = false;
     if (info->root == NULL) {
-        btree_indx_node *r_node = do_btree_node_alloc(0, cookie);
+        btree_indx_node *r_node = do_btree_node_alloc(0, info->fanout, cookie);
         if (r_node == NULL) {
             return ENGINE_ENOMEM;
         }
@@ -2573,6 +3204,21 @@ static ENGINE_ERROR_CODE do_btree_elem_insert(hash_item *it, btree_elem_item *el
     }
 
     /* insert the element */
+#ifdef ENABLE_BTREE_COMPRESS
+    btree_elem_item *zelem = do_btree_elem_zip(info, elem);
+    if (zelem != NULL) {
+        ret = do_btree_elem_link(info, zelem, replace_if_exist, replaced,
+                                 trimmed_elems, trimmed_count, cookie);
+        /* the b+tree owns the compressed copy if it's linked */
+        if (ret == ENGINE_SUCCESS) {
+            elem->status = BTREE_ITEM_STATUS_FREE;
+            do_btree_elem_free(elem);
+        } else {
+            zelem->status = BTREE_ITEM_STATUS_FREE;
+            do_btree_elem_free(zelem);
+        }
+    } else
+#endif
     ret = do_btree_elem_link(info, elem, replace_if_exist, replaced,
                              trimmed_elems, trimmed_count, cookie);
     if (ret != ENGINE_SUCCESS) {
@@ -2585,6 +3231,217 @@ static ENGINE_ERROR_CODE do_btree_elem_insert(hash_item *it, btree_elem_item *el
     return ENGINE_SUCCESS;
 }
 
+/*
+ * Bulk load of sorted elements.
+ * The elements whose bkeys are larger than the largest bkey of the b+tree are
+ * appended to the rightmost leaf node without searching the insert position.
+ * The nodes on the rightmost path are filled up to the bulk fill factor and
+ * new nodes are appended next to them instead of splitting the full nodes.
+ * So, a b+tree is built bottom-up in one pass from the sorted elements.
+ */
+#define BTREE_BULK_FILL_PERCENT 90
+
+static inline int do_btree_bulk_fill_count(btree_meta_info *info)
+{
+    int fill = (info->fanout * BTREE_BULK_FILL_PERCENT) / 100;
+    return (fill > 2 ? fill : 2);
+}
+
+static bool do_btree_elem_bulk_check(btree_meta_info *info,
+                                     btree_elem_item **elem_array, const uint32_t elem_count)
+{
+    uint32_t real_mcnt = (info->mcnt > 0 ? info->mcnt : config->max_btree_size);
+    btree_elem_item *prev = NULL;
+
+    /* The appended elements must not cause any overflow. */
+    if (info->maxbkeyrange.len != BKEY_NULL || (info->ccnt + elem_count) > real_mcnt) {
+        return false;
+    }
+    if (info->ccnt > 0) {
+        prev = do_btree_get_last_elem(info->root);
+    }
+    for (uint32_t i = 0; i < elem_count; i++) {
+        if (prev != NULL) {
+            /* the same bkey type and ascending bkey order */
+            if ((prev->nbkey == 0) != (elem_array[i]->nbkey == 0) ||
+                BKEY_ISLE(elem_array[i]->data, elem_array[i]->nbkey, prev->data, prev->nbkey)) {
+                return false;
+            }
+        }
+        prev = elem_array[i];
+    }
+    return true;
+}
+
+static ENGINE_ERROR_CODE do_btree_node_append(btree_meta_info *info, btree_elem_posi *path,
+                                              const int fill, const void *cookie)
+{
+    /* path: the rightmost path whose leaf node has been filled */
+    btree_indx_node *n_node[BTREE_MAX_DEPTH];
+    btree_indx_node *p_node;
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+    int depth, i;
+
+    /* allocate the new nodes up to the first unfilled node on the path */
+    for (depth = 0; ; depth++) {
+        n_node[depth] = do_btree_node_alloc(depth, info->fanout, cookie);
+        if (n_node[depth] == NULL) {
+            ret = ENGINE_ENOMEM; break;
+        }
+        if (depth == info->root->ndepth) {
+            assert((depth+1) < BTREE_MAX_DEPTH);
+            btree_indx_node *r_node = do_btree_node_alloc(depth+1, info->fanout, cookie);
+            if (r_node == NULL) {
+                do_btree_node_free(n_node[depth]);
+                ret = ENGINE_ENOMEM; break;
+            }
+            do_btree_node_link(info, r_node, NULL);
+            path[depth+1].node = r_node;
+            path[depth+1].indx = 0;
+            break;
+        }
+        if (path[depth+1].node->used_count < fill) {
+            break;
+        }
+    }
+    if (ret != ENGINE_SUCCESS) {
+        for (i = 0; i < depth; i++) {
+            do_btree_node_free(n_node[i]);
+        }
+        return ret;
+    }
+
+    /* link the new nodes as the last child of their parent nodes */
+    for (i = depth; i >= 0; i--) {
+        p_node = path[i+1].node;
+        n_node[i]->prev = path[i].node;
+        path[i].node->next = n_node[i];
+        p_node->item[p_node->used_count] = n_node[i];
+        BTREE_NODE_ECNT(p_node)[p_node->used_count] = 0;
+        /* the separator key is set when the node gets its first item */
+        path[i+1].indx = p_node->used_count++;
+        path[i].node = n_node[i];
+        path[i].indx = 0;
+
+        if (1) { /* apply memory space */
+            size_t stotal = slabs_space_size(do_btree_node_size(i, info->fanout));
+            do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_BTREE, stotal);
+        }
+    }
+    return ENGINE_SUCCESS;
+}
+
+static ENGINE_ERROR_CODE do_btree_elem_bulk_link(btree_meta_info *info,
+                                                 btree_elem_item **elem_array,
+                                                 const uint32_t elem_count,
+                                                 uint32_t *linked_count, const void *cookie)
+{
+    btree_elem_posi path[BTREE_MAX_DEPTH];
+    btree_indx_node *node;
+    btree_elem_item *elem;
+#ifdef ENABLE_BTREE_COMPRESS
+    btree_elem_item *zelem;
+#endif
+    int fill = do_btree_bulk_fill_count(info);
+    uint32_t i;
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+
+    path[0].node = do_btree_get_last_leaf(info->root, path);
+    path[0].indx = path[0].node->used_count;
+
+    for (i = 0; i < elem_count; i++) {
+        elem = elem_array[i];
+#ifdef ENABLE_STICKY_ITEM
+        /* sticky memory limit check */
+        if (IS_STICKY_COLLFLG(info)) {
+            if (do_item_sticky_overflowed()) {
+                ret = ENGINE_ENOMEM; break;
+            }
+        }
+#endif
+        if (path[0].node->used_count >= fill) {
+            ret = do_btree_node_append(info, path, fill, cookie);
+            if (ret != ENGINE_SUCCESS) {
+                break;
+            }
+        }
+        if (info->ccnt == 0) {
+            /* set bkey type */
+            if (elem->nbkey == 0)
+                info->bktype = BKEY_TYPE_UINT64;
+            else
+                info->bktype = BKEY_TYPE_BINARY;
+        }
+#ifdef ENABLE_BTREE_COMPRESS
+        if ((zelem = do_btree_elem_zip(info, elem)) != NULL) {
+            /* the b+tree owns the compressed copy */
+            elem->status = BTREE_ITEM_STATUS_FREE;
+            do_btree_elem_free(elem);
+            elem = zelem;
+        }
+#endif
+
+        CLOG_BTREE_ELEM_INSERT(info, NULL, elem);
+
+        /* append the element to the rightmost leaf node */
+        elem->status = BTREE_ITEM_STATUS_USED;
+        node = path[0].node;
+        node->item[node->used_count] = elem;
+        BTREE_NODE_SKEY(node)[node->used_count] = do_btree_skey(elem->data, elem->nbkey);
+        path[0].indx = node->used_count++;
+        /* increment element count in upper nodes */
+        for (int d = 1; d <= info->root->ndepth; d++) {
+            BTREE_NODE_ECNT(path[d].node)[path[d].indx]++;
+        }
+        if (path[0].indx == 0) {
+            do_btree_skey_path_update(info->root, path, 0);
+        }
+        info->ccnt++;
+
+        if (1) { /* apply memory space */
+            size_t stotal = slabs_space_size(do_btree_elem_ntotal(elem));
+            do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_BTREE, stotal);
+        }
+    }
+    *linked_count = i;
+
+    if (btree_position_debug) {
+        do_btree_consistency_check(info->root, info->ccnt, true);
+        do_btree_skey_check(info->root);
+    }
+    return ret;
+}
+
+static ENGINE_ERROR_CODE do_btree_elem_bulk_insert(hash_item *it,
+                                                   btree_elem_item **elem_array,
+                                                   const uint32_t elem_count,
+                                                   uint32_t *linked_count, const void *cookie)
+{
+    /* The elements must have passed do_btree_elem_bulk_check(). */
+    btree_meta_info *info = (btree_meta_info *)item_get_meta(it);
+    ENGINE_ERROR_CODE ret;
+
+    *linked_count = 0;
+
+    /* create the root node if it does not exist */
+    bool new_root_flag = false;
+    if (info->root == NULL) {
+        btree_indx_node *r_node = do_btree_node_alloc(0, info->fanout, cookie);
+        if (r_node == NULL) {
+            return ENGINE_ENOMEM;
+        }
+        do_btree_node_link(info, r_node, NULL);
+        new_root_flag = true;
+    }
+
+    /* append the elements */
+    ret = do_btree_elem_bulk_link(info, elem_array, elem_count, linked_count, cookie);
+    if (*linked_count == 0 && new_root_flag) {
+        do_btree_node_unlink(info, info->root, NULL);
+    }
+    return ret;
+}
+
 static ENGINE_ERROR_CODE do_btree_elem_arithmetic(btree_meta_info *info,
                                                   const int bkrtype, const bkey_range *bkrange,
                                                   const bool increment, const bool create,
@@ -2638,7 +3495,17 @@ static ENGINE_ERROR_CODE do_btree_elem_arithmetic(btree_meta_info *info,
         *result = initial;
     } else {
         real_nbkey = BTREE_REAL_NBKEY(elem->nbkey);
-        if (! safe_strtoull((const char*)elem->data + real_nbkey + elem->neflag, &value) || elem->nbytes == 2) {
+        const char *vptr = (const char*)elem->data + real_nbkey + elem->neflag;
+        int         vlen = elem->nbytes;
+#ifdef ENABLE_BTREE_COMPRESS
+        if (info->zdict != NULL && do_btree_elem_zipped(elem)) {
+            if ((vlen = do_btree_elem_inflate(info, elem)) < 0) {
+                return ENGINE_EINVAL;
+            }
+            vptr = (const char*)zip_buffer;
+        }
+#endif
+        if (! safe_strtoull(vptr, &value) || vlen == 2) {
             return ENGINE_EINVAL;
         }
 
@@ -2657,6 +3524,7 @@ static ENGINE_ERROR_CODE do_btree_elem_arithmetic(btree_meta_info *info,
 
         if (elem->refcount == 0 && elem->nbytes == nlen) {
             memcpy(elem->data + real_nbkey + elem->neflag, nbuf, elem->nbytes);
+            elem->zipped = 0;
             CLOG_BTREE_ELEM_INSERT(info, elem, elem);
         } else {
 #ifdef ENABLE_STICKY_ITEM
@@ -2687,7 +3555,7 @@ static int do_btree_posi_from_path(btree_meta_info *info,
     bpos = path[0].indx;
     for (d = 1; d <= info->root->ndepth; d++) {
         for (i = 0; i < path[d].indx; i++) {
-            bpos += path[d].node->ecnt[i];
+            bpos += BTREE_NODE_ECNT(path[d].node)[i];
         }
     }
     if (order == BTREE_ORDER_DESC) {
@@ -2792,9 +3660,9 @@ static ENGINE_ERROR_CODE do_btree_elem_get_by_posi(btree_meta_info *info,
     tot_ecnt = 0;
     while (node->ndepth > 0) {
         for (i = 0; i < node->used_count; i++) {
-            assert(node->ecnt[i] > 0);
-            if ((tot_ecnt + node->ecnt[i]) > index) break;
-            tot_ecnt += node->ecnt[i];
+            assert(BTREE_NODE_ECNT(node)[i] > 0);
+            if ((tot_ecnt + BTREE_NODE_ECNT(node)[i]) > index) break;
+            tot_ecnt += BTREE_NODE_ECNT(node)[i];
         }
         assert(i < node->used_count);
         node = (btree_indx_node *)node->item[i];
@@ -3396,6 +4264,52 @@ scan_next:
 #endif
 
 #ifdef SUPPORT_BOP_SMGET
+/*
+ * The sorted scans of do_btree_smget_scan_sort() are merged with a binary heap
+ * on the sort_sindx_buf array. The array sorted by the scan sort is already
+ * a valid heap, so the merge only sifts the advanced top scan down.
+ * It takes O(log k) comparisons per element for k scans.
+ */
+static inline int
+do_btree_smget_scan_comp(btree_scan_info *btree_scan_buf,
+                         const uint16_t idx1, const uint16_t idx2, const bool ascending)
+{
+    btree_elem_item *elem1 = BTREE_GET_ELEM_ITEM(btree_scan_buf[idx1].posi.node,
+                                                 btree_scan_buf[idx1].posi.indx);
+    btree_elem_item *elem2 = BTREE_GET_ELEM_ITEM(btree_scan_buf[idx2].posi.node,
+                                                 btree_scan_buf[idx2].posi.indx);
+    int cmp_res = BKEY_COMP(elem1->data, elem1->nbkey, elem2->data, elem2->nbkey);
+    if (cmp_res == 0) {
+        cmp_res = do_btree_comp_hkey(btree_scan_buf[idx1].it, btree_scan_buf[idx2].it);
+        assert(cmp_res != 0);
+    }
+    return (ascending ? cmp_res : -cmp_res);
+}
+
+static void
+do_btree_smget_heap_down(btree_scan_info *btree_scan_buf,
+                         uint16_t *sort_sindx_buf, const int sort_count, const bool ascending)
+{
+    uint16_t curr_idx = sort_sindx_buf[0];
+    int parent = 0;
+    int child;
+
+    while ((child = 2*parent + 1) < sort_count) {
+        if ((child+1) < sort_count &&
+            do_btree_smget_scan_comp(btree_scan_buf, sort_sindx_buf[child+1],
+                                     sort_sindx_buf[child], ascending) < 0) {
+            child += 1;
+        }
+        if (do_btree_smget_scan_comp(btree_scan_buf, curr_idx,
+                                     sort_sindx_buf[child], ascending) < 0) {
+            break;
+        }
+        sort_sindx_buf[parent] = sort_sindx_buf[child];
+        parent = child;
+    }
+    sort_sindx_buf[parent] = curr_idx;
+}
+
 #ifdef JHPARK_OLD_SMGET_INTERFACE
 static ENGINE_ERROR_CODE do_btree_smget_elem_sort_old(btree_scan_info *btree_scan_buf,
                                    uint16_t *sort_sindx_buf, const int sort_sindx_cnt,
@@ -3405,13 +4319,9 @@ static ENGINE_ERROR_CODE do_btree_smget_elem_sort_old(btree_scan_info *btree_sca
                                    bool *potentialbkeytrim, bool *bkey_duplicated)
 {
     btree_meta_info *info;
-    btree_elem_item *elem, *comp;
+    btree_elem_item *elem;
     btree_elem_item *prev = NULL;
-    uint16_t first_idx = 0;
     uint16_t curr_idx;
-    uint16_t comp_idx;
-    int i, cmp_res;
-    int mid, left, right;
     int skip_count = 0;
     int sort_count = sort_sindx_cnt;
     bool ascending = (bkrtype != BKEY_RANGE_TYPE_DSC ? true : false);
@@ -3420,7 +4330,7 @@ static ENGINE_ERROR_CODE do_btree_smget_elem_sort_old(btree_scan_info *btree_sca
     *elem_count = 0;
 
     while (sort_count > 0) {
-        curr_idx = sort_sindx_buf[first_idx];
+        curr_idx = sort_sindx_buf[0]; /* the top scan */
         elem = BTREE_GET_ELEM_ITEM(btree_scan_buf[curr_idx].posi.node,
                                    btree_scan_buf[curr_idx].posi.indx);
         dup_bkey_found = false;
@@ -3441,8 +4351,15 @@ static ENGINE_ERROR_CODE do_btree_smget_elem_sort_old(btree_scan_info *btree_sca
             if (*elem_count > 0 && dup_bkey_found) {
                 *bkey_duplicated = true;
             }
+#ifdef ENABLE_BTREE_COMPRESS
+            info = (btree_meta_info *)item_get_meta(btree_scan_buf[curr_idx].it);
+            if ((elem_array[*elem_count] = do_btree_elem_result(info, elem)) == NULL) {
+                return ENGINE_ENOMEM;
+            }
+#else
             elem->refcount++;
             elem_array[*elem_count] = elem;
+#endif
             kfnd_array[*elem_count] = btree_scan_buf[curr_idx].kidx;
             flag_array[*elem_count] = btree_scan_buf[curr_idx].it->flags;
             *elem_count += 1;
@@ -3460,7 +4377,12 @@ scan_next:
                     key_trim_found = true;
                 }
             }
-            first_idx++; sort_count--;
+            /* replace the top scan with the last one */
+            sort_count--;
+            sort_sindx_buf[0] = sort_sindx_buf[sort_count];
+            if (sort_count > 1) {
+                do_btree_smget_heap_down(btree_scan_buf, sort_sindx_buf, sort_count, ascending);
+            }
             continue;
         }
 
@@ -3468,39 +4390,10 @@ scan_next:
             goto scan_next;
         }
 
-        if (sort_count == 1) {
-            continue; /* sorting is not needed */
-        }
-
-        left  = first_idx + 1;
-        right = first_idx + sort_count - 1;
-        while (left <= right) {
-            mid  = (left + right) / 2;
-            comp_idx = sort_sindx_buf[mid];
-            comp = BTREE_GET_ELEM_ITEM(btree_scan_buf[comp_idx].posi.node,
-                                       btree_scan_buf[comp_idx].posi.indx);
-
-            cmp_res = BKEY_COMP(elem->data, elem->nbkey, comp->data, comp->nbkey);
-            if (cmp_res == 0) {
-                cmp_res = do_btree_comp_hkey(btree_scan_buf[curr_idx].it,
-                                             btree_scan_buf[comp_idx].it);
-                assert(cmp_res != 0);
-            }
-            if (ascending) {
-                if (cmp_res < 0) right = mid-1;
-                else             left  = mid+1;
-            } else {
-                if (cmp_res > 0) right = mid-1;
-                else             left  = mid+1;
-            }
-        }
-
-        assert(left > right);
-        /* right : insertion position */
-        for (i = first_idx+1; i <= right; i++) {
-            sort_sindx_buf[i-1] = sort_sindx_buf[i];
+        if (sort_count > 1) {
+            /* the top scan has advanced */
+            do_btree_smget_heap_down(btree_scan_buf, sort_sindx_buf, sort_count, ascending);
         }
-        sort_sindx_buf[right] = curr_idx;
     }
 
     if (key_trim_found && *elem_count < count) {
@@ -3521,21 +4414,17 @@ do_btree_smget_elem_sort(btree_scan_info *btree_scan_buf,
 {
     ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
     btree_meta_info *info;
-    btree_elem_item *elem, *comp;
+    btree_elem_item *elem;
     btree_elem_item *last;
     btree_elem_item *prev = NULL;
-    uint16_t first_idx = 0;
     uint16_t curr_idx;
-    uint16_t comp_idx;
-    int i, cmp_res;
-    int mid, left, right;
     int skip_count = 0;
     int sort_count = sort_sindx_cnt;
     bool ascending = (bkrtype != BKEY_RANGE_TYPE_DSC ? true : false);
     bool dup_bkey_found;
 
     while (sort_count > 0) {
-        curr_idx = sort_sindx_buf[first_idx];
+        curr_idx = sort_sindx_buf[0]; /* the top scan */
         elem = BTREE_GET_ELEM_ITEM(btree_scan_buf[curr_idx].posi.node,
                                    btree_scan_buf[curr_idx].posi.indx);
         dup_bkey_found = false;
@@ -3557,7 +4446,15 @@ do_btree_smget_elem_sort(btree_scan_info *btree_scan_buf,
             if (smres->elem_count > 0 && dup_bkey_found) {
                 smres->duplicated = true;
             }
+#ifdef ENABLE_BTREE_COMPRESS
+            info = (btree_meta_info *)item_get_meta(btree_scan_buf[curr_idx].it);
+            if ((smres->elem_array[smres->elem_count] = do_btree_elem_result(info, elem)) == NULL) {
+                ret = ENGINE_ENOMEM; break;
+            }
+#else
+            elem->refcount++;
             smres->elem_array[smres->elem_count] = elem;
+#endif
             smres->elem_kinfo[smres->elem_count].kidx = btree_scan_buf[curr_idx].kidx;
             smres->elem_kinfo[smres->elem_count].flag = btree_scan_buf[curr_idx].it->flags;
             smres->elem_count += 1;
@@ -3572,7 +4469,6 @@ do_btree_smget_elem_sort(btree_scan_info *btree_scan_buf,
                 }
             }
 #endif
-            elem->refcount++;
             if (smres->elem_count >= count) break;
         }
 
@@ -3597,7 +4493,12 @@ scan_next:
                     do_btree_smget_add_trim(smres, btree_scan_buf[curr_idx].kidx, last);
                 }
             }
-            first_idx++; sort_count--;
+            /* replace the top scan with the last one */
+            sort_count--;
+            sort_sindx_buf[0] = sort_sindx_buf[sort_count];
+            if (sort_count > 1) {
+                do_btree_smget_heap_down(btree_scan_buf, sort_sindx_buf, sort_count, ascending);
+            }
             continue;
         }
 
@@ -3605,41 +4506,10 @@ scan_next:
             goto scan_next;
         }
 
-        if (sort_count == 1) {
-            continue; /* sorting is not needed */
+        if (sort_count > 1) {
+            /* the top scan has advanced */
+            do_btree_smget_heap_down(btree_scan_buf, sort_sindx_buf, sort_count, ascending);
         }
-
-        left  = first_idx + 1;
-        right = first_idx + sort_count - 1;
-        while (left <= right) {
-            mid  = (left + right) / 2;
-            comp_idx = sort_sindx_buf[mid];
-            comp = BTREE_GET_ELEM_ITEM(btree_scan_buf[comp_idx].posi.node,
-                                       btree_scan_buf[comp_idx].posi.indx);
-
-            cmp_res = BKEY_COMP(elem->data, elem->nbkey, comp->data, comp->nbkey);
-            if (cmp_res == 0) {
-                cmp_res = do_btree_comp_hkey(btree_scan_buf[curr_idx].it,
-                                             btree_scan_buf[comp_idx].it);
-                assert(cmp_res != 0);
-            }
-            if (ascending) {
-                if (cmp_res < 0) right = mid-1;
-                else             left  = mid+1;
-            } else {
-                if (cmp_res > 0) right = mid-1;
-                else             left  = mid+1;
-            }
-        }
-        if (left <= right) { /* Duplicate bkey is found */
-            goto scan_next;
-        }
-
-        /* right : insertion position */
-        for (i = first_idx+1; i <= right; i++) {
-            sort_sindx_buf[i-1] = sort_sindx_buf[i];
-        }
-        sort_sindx_buf[right] = curr_idx;
     }
     if (ret == ENGINE_SUCCESS) {
         if (smres->trim_count > 0) {
@@ -3749,6 +4619,16 @@ ENGINE_ERROR_CODE btree_elem_insert(const char *key, const uint32_t nkey,
     if (ret == ENGINE_SUCCESS) {
         ret = do_btree_elem_insert(it, elem, replace_if_exist, replaced,
                                    trimmed_elems, trimmed_count, cookie);
+#ifdef ENABLE_BTREE_COMPRESS
+        if (trimmed_elems != NULL && *trimmed_elems != NULL) {
+            btree_meta_info *info = (btree_meta_info *)item_get_meta(it);
+            if (do_btree_elem_array_unzip(info, trimmed_elems, *trimmed_count) != ENGINE_SUCCESS) {
+                /* the trimmed element cannot be returned */
+                *trimmed_elems = NULL;
+                *trimmed_count = 0;
+            }
+        }
+#endif
         if (trimmed_elems != NULL && *trimmed_elems != NULL) {
             *trimmed_flags = it->flags;
         }
@@ -3766,6 +4646,73 @@ ENGINE_ERROR_CODE btree_elem_insert(const char *key, const uint32_t nkey,
     return ret;
 }
 
+/*
+ * Insert the given elements into one b+tree with a single cache lock
+ * acquisition. The result of each element is saved in eret_array,
+ * and only the elements inserted successfully are owned by the b+tree.
+ * The b+tree created by the insertion is removed if no element is inserted.
+ */
+ENGINE_ERROR_CODE btree_elem_minsert(const char *key, const uint32_t nkey,
+                                     btree_elem_item **elem_array, const uint32_t elem_count,
+                                     item_attr *attrp, bool *created,
+                                     ENGINE_ERROR_CODE *eret_array, const void *cookie)
+{
+    hash_item *it = NULL;
+    ENGINE_ERROR_CODE ret;
+    uint32_t i, stored = 0;
+    bool replaced;
+    PERSISTENCE_ACTION_BEGIN(cookie, UPD_BT_ELEM_INSERT);
+
+    *created = false;
+
+    LOCK_CACHE();
+    ret = do_btree_item_find(key, nkey, DONT_UPDATE, &it);
+    if (ret == ENGINE_KEY_ENOENT && attrp != NULL) {
+        it = do_btree_item_alloc(key, nkey, attrp, cookie);
+        if (it == NULL) {
+            ret = ENGINE_ENOMEM;
+        } else {
+            ret = do_item_link(it);
+            if (ret == ENGINE_SUCCESS) {
+                *created = true;
+            } else {
+                do_item_free(it);
+            }
+        }
+    }
+    if (ret == ENGINE_SUCCESS) {
+        btree_meta_info *info = (btree_meta_info *)item_get_meta(it);
+        if (do_btree_elem_bulk_check(info, elem_array, elem_count)) {
+            /* sorted elements beyond the largest bkey: build the nodes bottom-up */
+            ENGINE_ERROR_CODE bret = do_btree_elem_bulk_insert(it, elem_array, elem_count,
+                                                               &stored, cookie);
+            for (i = 0; i < elem_count; i++) {
+                eret_array[i] = (i < stored ? ENGINE_SUCCESS : bret);
+            }
+        } else {
+            for (i = 0; i < elem_count; i++) {
+                eret_array[i] = do_btree_elem_insert(it, elem_array[i], false, &replaced,
+                                                     NULL, NULL, cookie);
+                if (eret_array[i] == ENGINE_SUCCESS) {
+                    stored++;
+                }
+            }
+        }
+        if (*created) {
+            if (stored == 0) {
+                do_item_unlink(it, ITEM_UNLINK_NORMAL);
+                *created = false;
+            }
+        } else {
+            do_item_release(it);
+        }
+    }
+    UNLOCK_CACHE();
+
+    PERSISTENCE_ACTION_END(ret);
+    return ret;
+}
+
 ENGINE_ERROR_CODE btree_elem_update(const char *key, const uint32_t nkey, const bkey_range *bkrange,
                                     const eflag_update *eupdate, const char *value, const uint32_t nbytes,
                                     const void *cookie)
@@ -3871,7 +4818,7 @@ ENGINE_ERROR_CODE btree_elem_arithmetic(const char *key, const uint32_t nkey,
             }
             if (info->root == NULL && create == true) {
                 /* create new root node */
-                btree_indx_node *r_node = do_btree_node_alloc(0, cookie);
+                btree_indx_node *r_node = do_btree_node_alloc(0, info->fanout, cookie);
                 if (r_node == NULL) {
                     ret = ENGINE_ENOMEM; break;
                 }
@@ -3937,6 +4884,20 @@ ENGINE_ERROR_CODE btree_elem_get(const char *key, const uint32_t nkey,
             if (eresult->elem_array == NULL) {
                 ret = ENGINE_ENOMEM; break;
             }
+#ifdef ENABLE_BTREE_COMPRESS
+            if (delete && info->zdict != NULL) {
+                ret = do_btree_elem_get_unzipped(info, bkrtype, bkrange, efilter,
+                                                 offset, req_count,
+                                                 (btree_elem_item **)(eresult->elem_array),
+                                                 &(eresult->elem_count),
+                                                 &(eresult->opcost_or_eindex), &potentialbkeytrim);
+                if (ret != ENGINE_SUCCESS) {
+                    free(eresult->elem_array);
+                    eresult->elem_array = NULL;
+                    break;
+                }
+            } else
+#endif
             eresult->elem_count = do_btree_elem_get(info, bkrtype, bkrange, efilter,
                                                     offset, req_count, delete,
                                                     (btree_elem_item **)(eresult->elem_array),
@@ -3954,6 +4915,25 @@ ENGINE_ERROR_CODE btree_elem_get(const char *key, const uint32_t nkey,
                     eresult->trimmed = potentialbkeytrim;
                 }
                 eresult->flags = it->flags;
+#ifdef ENABLE_BTREE_COMPRESS
+                if (info->zdict != NULL) {
+                    if (delete) {
+                        /* decompressed in do_btree_elem_get_unzipped() */
+                        if (info->root == NULL) {
+                            /* all the elements are deleted */
+                            do_btree_zdict_free(info);
+                        }
+                    } else {
+                        ret = do_btree_elem_array_unzip(info, (btree_elem_item **)(eresult->elem_array),
+                                                        eresult->elem_count);
+                        if (ret != ENGINE_SUCCESS) {
+                            free(eresult->elem_array);
+                            eresult->elem_array = NULL;
+                            eresult->elem_count = 0;
+                        }
+                    }
+                }
+#endif
             } else {
                 if (potentialbkeytrim == true) {
                     ret = ENGINE_EBKEYOOR;
@@ -4073,6 +5053,15 @@ ENGINE_ERROR_CODE btree_posi_find_with_get(const char *key, const uint32_t nkey,
                                                     &(eresult->opcost_or_eindex));
             if (*position >= 0) {
                 eresult->flags = it->flags;
+#ifdef ENABLE_BTREE_COMPRESS
+                ret = do_btree_elem_array_unzip(info, (btree_elem_item **)(eresult->elem_array),
+                                                eresult->elem_count);
+                if (ret != ENGINE_SUCCESS) {
+                    free(eresult->elem_array);
+                    eresult->elem_array = NULL;
+                    eresult->elem_count = 0;
+                }
+#endif
             } else {
                 ret = ENGINE_ELEM_ENOENT;
                 free(eresult->elem_array);
@@ -4134,6 +5123,15 @@ ENGINE_ERROR_CODE btree_elem_get_by_posi(const char *key, const uint32_t nkey,
                                             &(eresult->elem_count));
             if (ret == ENGINE_SUCCESS) {
                 eresult->flags = it->flags;
+#ifdef ENABLE_BTREE_COMPRESS
+                ret = do_btree_elem_array_unzip(info, (btree_elem_item **)(eresult->elem_array),
+                                                eresult->elem_count);
+                if (ret != ENGINE_SUCCESS) {
+                    free(eresult->elem_array);
+                    eresult->elem_array = NULL;
+                    eresult->elem_count = 0;
+                }
+#endif
             } else {
                 /* ret == ENGINE_ELEM_ENOENT */
                 free(eresult->elem_array);
@@ -4182,6 +5180,13 @@ ENGINE_ERROR_CODE btree_elem_smget_old(token_t *key_array, const int key_count,
                                            bkrtype, bkrange, efilter, offset, count,
                                            elem_array, kfnd_array, flag_array, elem_count,
                                            trimmed, duplicated);
+        if (ret != ENGINE_SUCCESS) {
+            /* release the elements found so far */
+            for (i = 0; i < *elem_count; i++) {
+                do_btree_elem_release(elem_array[i]);
+            }
+            *elem_count = 0;
+        }
         for (i = 0; i <= (offset+count); i++) {
             if (btree_scan_buf[i].it != NULL)
                 do_item_release(btree_scan_buf[i].it);
@@ -4241,7 +5246,12 @@ ENGINE_ERROR_CODE btree_elem_smget(token_t *key_array, const int key_count,
                                        bkrtype, bkrange, efilter, offset, count, unique,
                                        result);
         if (ret != ENGINE_SUCCESS) {
-            break;
+            /* release the elements found so far */
+            for (i = 0; i < result->elem_count; i++) {
+                do_btree_elem_release(result->elem_array[i]);
+            }
+            result->elem_count = 0;
+            result->trim_count = 0;
         }
 
         for (i = 0; i <= (offset+count); i++) {
@@ -4293,6 +5303,24 @@ uint8_t  btree_real_nbkey(uint8_t nbkey)
     return (uint8_t)BTREE_REAL_NBKEY(nbkey);
 }
 
+#ifdef ENABLE_BTREE_COMPRESS
+/* must be called with the cache lock held */
+void btree_zip_stats(ADD_STAT add_stat, const void *cookie)
+{
+    char val[128];
+    int len;
+
+    len = sprintf(val, "%"PRIu64, zip_stats.zip_count);
+    add_stat("btree_zip_count", 15, val, len, cookie);
+    len = sprintf(val, "%"PRIu64, zip_stats.zip_usec);
+    add_stat("btree_zip_usec", 14, val, len, cookie);
+    len = sprintf(val, "%"PRIu64, zip_stats.unzip_count);
+    add_stat("btree_unzip_count", 17, val, len, cookie);
+    len = sprintf(val, "%"PRIu64, zip_stats.unzip_usec);
+    add_stat("btree_unzip_usec", 16, val, len, cookie);
+}
+#endif
+
 ENGINE_ERROR_CODE btree_coll_getattr(hash_item *it, item_attr *attrp,
                                      ENGINE_ITEM_ATTR *attr_ids, const uint32_t attr_cnt)
 {
@@ -4485,8 +5513,16 @@ ENGINE_ERROR_CODE btree_apply_elem_insert(void *engine, hash_item *it,
         }
         memcpy(elem->data, bkey, BTREE_REAL_NBKEY(nbkey) + neflag + nbytes);
 
-        ret = do_btree_elem_insert(it, elem, true /* replace_if_exist */,
-                                   &replaced, NULL, NULL, NULL);
+        if (do_btree_elem_bulk_check((btree_meta_info *)item_get_meta(it), &elem, 1)) {
+            /* The snapshot and the sorted inserts are applied in bkey order.
+             * Append them without splitting the rightmost nodes.
+             */
+            uint32_t linked;
+            ret = do_btree_elem_bulk_insert(it, &elem, 1, &linked, NULL);
+        } else {
+            ret = do_btree_elem_insert(it, elem, true /* replace_if_exist */,
+                                       &replaced, NULL, NULL, NULL);
+        }
         if (ret != ENGINE_SUCCESS) {
             do_btree_elem_free(elem);
             logger->log(EXTENSION_LOG_WARNING, NULL, "btree_apply_elem_insert failed."
@@ -4651,6 +5687,16 @@ ENGINE_ERROR_CODE item_btree_coll_init(void *engine_ptr)
         bkey_binary_max[i] = 0xFF;
     }
 
+    /* choose the skey search kernel */
+    do_btree_skey_kernel_init();
+
+#ifdef ENABLE_BTREE_COMPRESS
+    /* prepare the element compression */
+    if (config->btree_compress) {
+        do_btree_zip_init();
+    }
+#endif
+
     /* remove unused function warnings */
     if (1) {
         uint64_t val1 = 10;
@@ -4664,5 +5710,8 @@ ENGINE_ERROR_CODE item_btree_coll_init(void *engine_ptr)
 
 void item_btree_coll_final(void *engine_ptr)
 {
+#ifdef ENABLE_BTREE_COMPRESS
+    do_btree_zip_final();
+#endif
     logger->log(EXTENSION_LOG_INFO, NULL, "ITEM btree module destroyed.\n");
 }
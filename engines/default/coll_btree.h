@@ -38,6 +38,11 @@ ENGINE_ERROR_CODE btree_elem_insert(const char *key, const uint32_t nkey,
                                     bool *replaced, bool *created, btree_elem_item **trimmed_elems,
                                     uint32_t *trimmed_count, uint32_t *trimmed_flags, const void *cookie);
 
+ENGINE_ERROR_CODE btree_elem_minsert(const char *key, const uint32_t nkey,
+                                     btree_elem_item **elem_array, const uint32_t elem_count,
+                                     item_attr *attrp, bool *created,
+                                     ENGINE_ERROR_CODE *eret_array, const void *cookie);
+
 ENGINE_ERROR_CODE btree_elem_update(const char *key, const uint32_t nkey, const bkey_range *bkrange,
                                     const eflag_update *eupdate, const char *value, const uint32_t nbytes,
                                     const void *cookie);
@@ -104,6 +109,9 @@ void btree_elem_get_all(btree_meta_info *info, elems_result_t *eresult);
 
 uint32_t btree_elem_ntotal(btree_elem_item *elem);
 uint8_t  btree_real_nbkey(uint8_t nbkey);
+#ifdef ENABLE_BTREE_COMPRESS
+void btree_zip_stats(ADD_STAT add_stat, const void *cookie);
+#endif
 
 ENGINE_ERROR_CODE btree_coll_getattr(hash_item *it, item_attr *attrp,
                                      ENGINE_ITEM_ATTR *attr_ids, const uint32_t attr_cnt);
@@ -19,6 +19,7 @@
 #include "config.h"
 #include <fcntl.h>
 #include <errno.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -117,6 +118,7 @@ static hash_item *do_list_item_alloc(const void *key, const uint32_t nkey,
         info->itdist  = (uint16_t)((size_t*)info-(size_t*)it);
         info->stotal  = 0;
         info->head = info->tail = NULL;
+        info->indx = NULL;
         assert((hash_item*)COLL_GET_HASH_ITEM(info) == it);
     }
     return it;
@@ -156,10 +158,324 @@ static void do_list_elem_release(list_elem_item *elem)
     }
 }
 
+/*
+ * List Position Index
+ *
+ * A long list keeps the position index to find the element of a list index
+ * without walking the whole list. The elements are grouped into segments of
+ * consecutive elements, and the index keeps the first element and the element
+ * count of each segment. A positional access scans the segment counts and
+ * walks the elements only inside one segment.
+ * The segments are stored in blocks of LIST_INDX_BLK_SEGS segments, and the
+ * index keeps the table of the blocks. So, the table and the blocks are small
+ * memory chunks (See MAX_SM_VALUE_LEN) however long the list is, and never
+ * take the chunks of the slab classes which the slab page mover evicts.
+ * The index is built on the first access into the middle of a list having
+ * list_index_threshold elements or more, and is maintained on each element
+ * link and unlink afterwards. It is freed when the list becomes short again.
+ */
+#define LIST_INDX_SEG_SIZE 64 /* the element count of a segment when built or split */
+#define LIST_INDX_SEG_MAX  (LIST_INDX_SEG_SIZE*2)
+#define LIST_INDX_SEG_MIN  (LIST_INDX_SEG_SIZE/4)
+#define LIST_INDX_BLK_SEGS 2048 /* the number of segments in a block */
+
+#define LIST_INDX_SEG(indx, s) \
+        (&(indx)->blk[(s) / LIST_INDX_BLK_SEGS]->seg[(s) % LIST_INDX_BLK_SEGS])
+
+static inline size_t do_list_indx_size(const uint32_t capacity)
+{
+    return offsetof(list_indx_info, blk) + capacity * sizeof(list_indx_blk *);
+}
+
+static inline size_t do_list_indx_blk_size(void)
+{
+    return offsetof(list_indx_blk, seg) + LIST_INDX_BLK_SEGS * sizeof(list_indx_seg);
+}
+
+/* allocate the index table or a block. Both start with the same header. */
+static void *do_list_indx_mem_alloc(list_meta_info *info, const size_t ntotal)
+{
+    assert(ntotal <= MAX_SM_VALUE_LEN);
+    list_indx_blk *blk = do_item_mem_alloc(ntotal, LRU_CLSID_FOR_SMALL, NULL);
+    if (blk != NULL) {
+        blk->slabs_clsid = slabs_clsid(ntotal);
+        assert(blk->slabs_clsid > 0);
+        blk->refcount = 0;
+
+        if (1) { /* apply memory space */
+            size_t stotal = slabs_space_size(ntotal);
+            do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_LIST, stotal);
+        }
+    }
+    return blk;
+}
+
+static void do_list_indx_mem_free(list_meta_info *info, void *ptr, const size_t ntotal)
+{
+    if (info->stotal > 0) { /* apply memory space */
+        size_t stotal = slabs_space_size(ntotal);
+        do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_LIST, stotal);
+    }
+    do_item_mem_free(ptr, ntotal);
+}
+
+static list_indx_info *do_list_indx_alloc(list_meta_info *info, const uint32_t capacity)
+{
+    list_indx_info *indx = do_list_indx_mem_alloc(info, do_list_indx_size(capacity));
+    if (indx != NULL) {
+        indx->used_count = 0;
+        indx->capacity   = capacity;
+        indx->blk_count  = 0;
+    }
+    return indx;
+}
+
+static void do_list_indx_free(list_meta_info *info, list_indx_info *indx)
+{
+    for (int b = 0; b < indx->blk_count; b++) {
+        do_list_indx_mem_free(info, indx->blk[b], do_list_indx_blk_size());
+    }
+    do_list_indx_mem_free(info, indx, do_list_indx_size(indx->capacity));
+}
+
+/* add a block for more segments. The table is grown twice if it is full. */
+static bool do_list_indx_add_blk(list_meta_info *info)
+{
+    list_indx_info *indx = info->indx;
+    list_indx_blk *blk;
+
+    if (indx->blk_count >= indx->capacity) {
+        if (do_list_indx_size(indx->capacity * 2) > MAX_SM_VALUE_LEN) {
+            return false; /* too large */
+        }
+        list_indx_info *new_indx = do_list_indx_alloc(info, indx->capacity * 2);
+        if (new_indx == NULL) {
+            return false;
+        }
+        memcpy(new_indx->blk, indx->blk, indx->blk_count * sizeof(list_indx_blk *));
+        new_indx->used_count = indx->used_count;
+        new_indx->blk_count  = indx->blk_count;
+        do_list_indx_mem_free(info, indx, do_list_indx_size(indx->capacity));
+        info->indx = indx = new_indx;
+    }
+    blk = do_list_indx_mem_alloc(info, do_list_indx_blk_size());
+    if (blk == NULL) {
+        return false;
+    }
+    indx->blk[indx->blk_count++] = blk;
+    return true;
+}
+
+static void do_list_indx_build(list_meta_info *info)
+{
+    list_indx_seg *seg = NULL;
+    list_elem_item *elem;
+    uint32_t nseg = (info->ccnt / LIST_INDX_SEG_SIZE) * 2 + 16;
+    uint32_t capacity = 4;
+    int i;
+
+    while ((capacity * LIST_INDX_BLK_SEGS) < nseg) {
+        capacity *= 2;
+    }
+    info->indx = do_list_indx_alloc(info, capacity);
+    if (info->indx == NULL) {
+        return; /* the list is walked without the index */
+    }
+    for (elem = info->head, i = 0; elem != NULL; elem = elem->next, i++) {
+        if ((i % LIST_INDX_SEG_SIZE) == 0) {
+            if ((info->indx->used_count % LIST_INDX_BLK_SEGS) == 0 &&
+                do_list_indx_add_blk(info) == false) {
+                list_indx_info *indx = info->indx;
+                info->indx = NULL;
+                do_list_indx_free(info, indx);
+                return;
+            }
+            seg = LIST_INDX_SEG(info->indx, info->indx->used_count);
+            seg->first = elem;
+            seg->count = 0;
+            info->indx->used_count++;
+        }
+        seg->count++;
+    }
+}
+
+/* find the segment holding the element of the given index */
+static int do_list_indx_locate(list_meta_info *info, const int index, int *start)
+{
+    list_indx_info *indx = info->indx;
+    int pos, s;
+
+    assert(index >= 0 && index < info->ccnt);
+    if (index < (info->ccnt/2)) {
+        pos = 0;
+        for (s = 0; s < (indx->used_count-1); s++) {
+            if (index < (pos + LIST_INDX_SEG(indx, s)->count)) break;
+            pos += LIST_INDX_SEG(indx, s)->count;
+        }
+    } else {
+        pos = info->ccnt;
+        for (s = (indx->used_count-1); s > 0; s--) {
+            pos -= LIST_INDX_SEG(indx, s)->count;
+            if (index >= pos) break;
+        }
+        if (s == 0) pos = 0;
+    }
+    *start = pos;
+    return s;
+}
+
+static list_elem_item *do_list_indx_find(list_meta_info *info, const int index)
+{
+    list_indx_info *indx = info->indx;
+    list_indx_seg *seg;
+    list_elem_item *elem;
+    int start, s, i;
+
+    s = do_list_indx_locate(info, index, &start);
+    seg = LIST_INDX_SEG(indx, s);
+    if ((index - start) <= (seg->count/2)) {
+        elem = seg->first;
+        for (i = start; i < index; i++) {
+            elem = elem->next;
+        }
+    } else {
+        /* walk backward from the last element of the segment */
+        elem = ((s+1) < indx->used_count ? LIST_INDX_SEG(indx, s+1)->first->prev : info->tail);
+        for (i = start + seg->count - 1; i > index; i--) {
+            elem = elem->prev;
+        }
+    }
+    return elem;
+}
+
+/* make room for a segment at s shifting the segments after it across the blocks */
+static void do_list_indx_insert_seg(list_indx_info *indx, const int s)
+{
+    int sb = s / LIST_INDX_BLK_SEGS, so = s % LIST_INDX_BLK_SEGS;
+    int b = indx->used_count / LIST_INDX_BLK_SEGS;
+    int o = indx->used_count % LIST_INDX_BLK_SEGS;
+
+    assert(indx->used_count < (indx->blk_count * LIST_INDX_BLK_SEGS));
+    while (b > sb) {
+        memmove(&indx->blk[b]->seg[1], &indx->blk[b]->seg[0], o * sizeof(list_indx_seg));
+        indx->blk[b]->seg[0] = indx->blk[b-1]->seg[LIST_INDX_BLK_SEGS-1];
+        b--; o = LIST_INDX_BLK_SEGS-1;
+    }
+    memmove(&indx->blk[b]->seg[so+1], &indx->blk[b]->seg[so], (o-so) * sizeof(list_indx_seg));
+    indx->used_count++;
+}
+
+static void do_list_indx_remove_seg(list_indx_info *indx, const int s)
+{
+    int b = s / LIST_INDX_BLK_SEGS, o = s % LIST_INDX_BLK_SEGS;
+    int lb = (indx->used_count-1) / LIST_INDX_BLK_SEGS;
+    int lo = (indx->used_count-1) % LIST_INDX_BLK_SEGS;
+
+    while (b < lb) {
+        memmove(&indx->blk[b]->seg[o], &indx->blk[b]->seg[o+1],
+                (LIST_INDX_BLK_SEGS-1-o) * sizeof(list_indx_seg));
+        indx->blk[b]->seg[LIST_INDX_BLK_SEGS-1] = indx->blk[b+1]->seg[0];
+        b++; o = 0;
+    }
+    memmove(&indx->blk[b]->seg[o], &indx->blk[b]->seg[o+1], (lo-o) * sizeof(list_indx_seg));
+    indx->used_count--;
+}
+
+static void do_list_indx_split(list_meta_info *info, const int s)
+{
+    list_indx_seg *seg, *new_seg;
+    list_elem_item *elem;
+
+    if (info->indx->used_count >= (info->indx->blk_count * LIST_INDX_BLK_SEGS) &&
+        do_list_indx_add_blk(info) == false) {
+        /* drop the index. It is built again on the next access. */
+        list_indx_info *indx = info->indx;
+        info->indx = NULL;
+        do_list_indx_free(info, indx);
+        return;
+    }
+    do_list_indx_insert_seg(info->indx, s+1);
+
+    seg = LIST_INDX_SEG(info->indx, s);
+    elem = seg->first;
+    for (int i = 0; i < LIST_INDX_SEG_SIZE; i++) {
+        elem = elem->next;
+    }
+    new_seg = LIST_INDX_SEG(info->indx, s+1);
+    new_seg->first = elem;
+    new_seg->count = seg->count - LIST_INDX_SEG_SIZE;
+    seg->count = LIST_INDX_SEG_SIZE;
+}
+
+static void do_list_indx_link(list_meta_info *info, const int index, list_elem_item *elem)
+{
+    /* elem has been linked at the index, but info->ccnt is not yet incremented. */
+    list_indx_info *indx = info->indx;
+    list_indx_seg *seg;
+    int start, s;
+
+    if (index >= info->ccnt) {
+        s = indx->used_count - 1; /* appended to the tail */
+        seg = LIST_INDX_SEG(indx, s);
+    } else {
+        s = do_list_indx_locate(info, index, &start);
+        seg = LIST_INDX_SEG(indx, s);
+        if (index == start) {
+            seg->first = elem;
+        }
+    }
+    seg->count++;
+    if (seg->count > LIST_INDX_SEG_MAX) {
+        do_list_indx_split(info, s);
+    }
+}
+
+static void do_list_indx_unlink(list_meta_info *info, const int index, list_elem_item *elem)
+{
+    /* elem at the index is to be unlinked. */
+    list_indx_info *indx = info->indx;
+    list_indx_seg *seg;
+    int start, s;
+
+    s = do_list_indx_locate(info, index, &start);
+    seg = LIST_INDX_SEG(indx, s);
+    seg->count--;
+    if (seg->count == 0) {
+        do_list_indx_remove_seg(indx, s);
+        return;
+    }
+    if (index == start) {
+        assert(seg->first == elem);
+        seg->first = elem->next;
+    }
+    if (seg->count < LIST_INDX_SEG_MIN) {
+        /* merge the small segment into a neighbor segment */
+        if (s > 0 && (LIST_INDX_SEG(indx, s-1)->count + seg->count) <= LIST_INDX_SEG_MAX) {
+            LIST_INDX_SEG(indx, s-1)->count += seg->count;
+            do_list_indx_remove_seg(indx, s);
+        } else if ((s+1) < indx->used_count &&
+                   (seg->count + LIST_INDX_SEG(indx, s+1)->count) <= LIST_INDX_SEG_MAX) {
+            seg->count += LIST_INDX_SEG(indx, s+1)->count;
+            do_list_indx_remove_seg(indx, s+1);
+        }
+    }
+}
+
 static list_elem_item *do_list_elem_find(list_meta_info *info, int index)
 {
     list_elem_item *elem;
 
+    if (info->indx == NULL && config->list_index_threshold > 0 &&
+        info->ccnt >= config->list_index_threshold) {
+        /* build the index on the access far from both ends */
+        if (index >= LIST_INDX_SEG_SIZE && index < (info->ccnt - LIST_INDX_SEG_SIZE)) {
+            do_list_indx_build(info);
+        }
+    }
+    if (info->indx != NULL) {
+        return do_list_indx_find(info, index);
+    }
+
     if (index <= (info->ccnt/2)) {
         assert(index >= 0);
         elem = info->head;
@@ -199,6 +515,9 @@ static ENGINE_ERROR_CODE do_list_elem_link(list_meta_info *info, const int index
     else              prev->next = elem;
     if (next == NULL) info->tail = elem;
     else              next->prev = elem;
+    if (info->indx != NULL) {
+        do_list_indx_link(info, index, elem);
+    }
     info->ccnt++;
 
     if (1) { /* apply memory space */
@@ -208,11 +527,14 @@ static ENGINE_ERROR_CODE do_list_elem_link(list_meta_info *info, const int index
     return ENGINE_SUCCESS;
 }
 
-static void do_list_elem_unlink(list_meta_info *info, list_elem_item *elem,
+static void do_list_elem_unlink(list_meta_info *info, const int index, list_elem_item *elem,
                                 enum elem_delete_cause cause)
 {
     /* if (elem->next != (list_elem_item *)ADDR_MEANS_UNLINKED) */
     {
+        if (info->indx != NULL) {
+            do_list_indx_unlink(info, index, elem);
+        }
         if (elem->prev == NULL) info->head = elem->next;
         else                    elem->prev->next = elem->next;
         if (elem->next == NULL) info->tail = elem->prev;
@@ -220,6 +542,13 @@ static void do_list_elem_unlink(list_meta_info *info, list_elem_item *elem,
         elem->prev = elem->next = (list_elem_item *)ADDR_MEANS_UNLINKED;
         info->ccnt--;
 
+        if (info->indx != NULL && info->ccnt < (config->list_index_threshold/2)) {
+            /* the list has become short */
+            list_indx_info *indx = info->indx;
+            info->indx = NULL;
+            do_list_indx_free(info, indx);
+        }
+
         if (info->stotal > 0) { /* apply memory space */
             size_t stotal = slabs_space_size(do_list_elem_ntotal(elem));
             do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_LIST, stotal);
@@ -245,7 +574,7 @@ static uint32_t do_list_elem_delete(list_meta_info *info,
     while (elem != NULL) {
         next = elem->next;
         fcnt++;
-        do_list_elem_unlink(info, elem, cause);
+        do_list_elem_unlink(info, index, elem, cause);
         if (count > 0 && fcnt >= count) break;
         elem = next;
     }
@@ -260,6 +589,7 @@ static uint32_t do_list_elem_get(list_meta_info *info,
     list_elem_item *elem;
     list_elem_item *tobe;
     uint32_t fcnt = 0; /* found count */
+    int posi = index; /* the list index of elem */
     enum elem_delete_cause cause = ELEM_DELETE_NORMAL;
 
     if (delete) {
@@ -271,9 +601,14 @@ static uint32_t do_list_elem_get(list_meta_info *info,
         tobe = (forward ? elem->next : elem->prev);
         elem->refcount++;
         elem_array[fcnt++] = elem;
-        if (delete) do_list_elem_unlink(info, elem, cause);
+        if (delete) do_list_elem_unlink(info, posi, elem, cause);
         if (count > 0 && fcnt >= count) break;
         elem = tobe;
+        if (forward) {
+            if (!delete) posi++;
+        } else {
+            posi--;
+        }
     }
 
     return fcnt;
@@ -454,6 +789,65 @@ ENGINE_ERROR_CODE list_elem_insert(const char *key, const uint32_t nkey,
     return ret;
 }
 
+/*
+ * Insert the given elements into one list with a single cache lock
+ * acquisition. The result of each element is saved in eret_array,
+ * and only the elements inserted successfully are owned by the list.
+ * The list created by the insertion is removed if no element is inserted.
+ */
+ENGINE_ERROR_CODE list_elem_minsert(const char *key, const uint32_t nkey,
+                                    int index,
+                                    list_elem_item **elem_array, const uint32_t elem_count,
+                                    item_attr *attrp, bool *created,
+                                    ENGINE_ERROR_CODE *eret_array, const void *cookie)
+{
+    hash_item *it = NULL;
+    ENGINE_ERROR_CODE ret;
+    uint32_t i, stored = 0;
+    PERSISTENCE_ACTION_BEGIN(cookie, UPD_LIST_ELEM_INSERT);
+
+    *created = false;
+
+    LOCK_CACHE();
+    ret = do_list_item_find(key, nkey, DONT_UPDATE, &it);
+    if (ret == ENGINE_KEY_ENOENT && attrp != NULL) {
+        it = do_list_item_alloc(key, nkey, attrp, cookie);
+        if (it == NULL) {
+            ret = ENGINE_ENOMEM;
+        } else {
+            ret = do_item_link(it);
+            if (ret == ENGINE_SUCCESS) {
+                *created = true;
+            } else {
+                do_item_free(it);
+            }
+        }
+    }
+    if (ret == ENGINE_SUCCESS) {
+        for (i = 0; i < elem_count; i++) {
+            /* a non-negative index moves past the elements inserted before,
+             * and a negative index keeps the given order by itself. */
+            eret_array[i] = do_list_elem_insert(it, (index >= 0 ? index + (int)stored : index),
+                                                elem_array[i], cookie);
+            if (eret_array[i] == ENGINE_SUCCESS) {
+                stored++;
+            }
+        }
+        if (*created) {
+            if (stored == 0) {
+                do_item_unlink(it, ITEM_UNLINK_NORMAL);
+                *created = false;
+            }
+        } else {
+            do_item_release(it);
+        }
+    }
+    UNLOCK_CACHE();
+
+    PERSISTENCE_ACTION_END(ret);
+    return ret;
+}
+
 static int adjust_list_range(list_meta_info *info, int *from_index, int *to_index)
 {
     if (info->ccnt <= 0) return -1; /* out of range */
@@ -37,6 +37,12 @@ ENGINE_ERROR_CODE list_elem_insert(const char *key, const uint32_t nkey,
                                    item_attr *attrp,
                                    bool *created, const void *cookie);
 
+ENGINE_ERROR_CODE list_elem_minsert(const char *key, const uint32_t nkey,
+                                    int index,
+                                    list_elem_item **elem_array, const uint32_t elem_count,
+                                    item_attr *attrp, bool *created,
+                                    ENGINE_ERROR_CODE *eret_array, const void *cookie);
+
 ENGINE_ERROR_CODE list_elem_delete(const char *key, const uint32_t nkey,
                                    int from_index, int to_index,
                                    const bool drop_if_empty,
@@ -19,6 +19,7 @@
 #include "config.h"
 #include <fcntl.h>
 #include <errno.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -136,6 +137,7 @@ static hash_item *do_map_item_alloc(const void *key, const uint32_t nkey,
         info->itdist  = (uint16_t)((size_t*)info-(size_t*)it);
         info->stotal  = 0;
         info->root    = NULL;
+        info->indx    = NULL;
         assert((hash_item*)COLL_GET_HASH_ITEM(info) == it);
     }
     return it;
@@ -201,6 +203,232 @@ static void do_map_elem_release(map_elem_item *elem)
     }
 }
 
+/*
+ * Map element index
+ *
+ * A map of MAP_INDX_MIN_COUNT elements or more keeps an open-addressing table
+ * of <hash value, element> slots beside its hash nodes. A lookup compares the
+ * hash values stored in the adjacent slots, so it visits only the matching
+ * element instead of walking the hash chain of scattered elements.
+ * The table is built when the map grows to MAP_INDX_MIN_COUNT elements,
+ * doubled when it gets 3/4 full, and freed when the map becomes short again.
+ * The slots are stored in segments of MAP_INDX_SEG_SLOTS slots, and the table
+ * keeps the segments. So, the table and its segments are small memory chunks
+ * (See MAX_SM_VALUE_LEN) however large the map is, and never take the chunks
+ * of the slab classes which the slab page mover evicts.
+ * If the table cannot be allocated, the map is searched by its hash chains
+ * until a later insertion allocates it.
+ */
+#define MAP_INDX_MIN_COUNT 128
+#define MAP_INDX_SEG_SLOTS 2048 /* the max number of slots in a segment */
+#define MAP_INDX_FULL(indx) ((indx)->used_count >= ((indx)->capacity/4)*3)
+
+#define MAP_INDX_SLOT(indx, i) \
+        (&(indx)->seg[(i) / MAP_INDX_SEG_SLOTS]->slot[(i) % MAP_INDX_SEG_SLOTS])
+
+static inline uint32_t do_map_indx_seg_count(const uint32_t capacity)
+{
+    return (capacity + MAP_INDX_SEG_SLOTS - 1) / MAP_INDX_SEG_SLOTS;
+}
+
+static inline size_t do_map_indx_size(const uint32_t capacity)
+{
+    return offsetof(map_indx_info, seg) +
+           do_map_indx_seg_count(capacity) * sizeof(map_indx_seg *);
+}
+
+static inline size_t do_map_indx_seg_size(const uint32_t capacity)
+{
+    uint32_t nslot = (capacity < MAP_INDX_SEG_SLOTS ? capacity : MAP_INDX_SEG_SLOTS);
+    return offsetof(map_indx_seg, slot) + nslot * sizeof(map_indx_slot);
+}
+
+/* allocate the table or a segment. Both start with the same header. */
+static void *do_map_indx_mem_alloc(map_meta_info *info, const size_t ntotal)
+{
+    assert(ntotal <= MAX_SM_VALUE_LEN);
+    map_indx_seg *seg = do_item_mem_alloc(ntotal, LRU_CLSID_FOR_SMALL, NULL);
+    if (seg != NULL) {
+        seg->slabs_clsid = slabs_clsid(ntotal);
+        assert(seg->slabs_clsid > 0);
+        seg->refcount = 0;
+
+        if (1) { /* apply memory space */
+            size_t stotal = slabs_space_size(ntotal);
+            do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_MAP, stotal);
+        }
+    }
+    return seg;
+}
+
+static void do_map_indx_mem_free(map_meta_info *info, void *ptr, const size_t ntotal)
+{
+    if (info->stotal > 0) { /* apply memory space */
+        size_t stotal = slabs_space_size(ntotal);
+        do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_MAP, stotal);
+    }
+    do_item_mem_free(ptr, ntotal);
+}
+
+static void do_map_indx_free(map_meta_info *info, map_indx_info *indx)
+{
+    uint32_t nseg = do_map_indx_seg_count(indx->capacity);
+
+    for (uint32_t s = 0; s < nseg; s++) {
+        if (indx->seg[s] != NULL) {
+            do_map_indx_mem_free(info, indx->seg[s], do_map_indx_seg_size(indx->capacity));
+        }
+    }
+    do_map_indx_mem_free(info, indx, do_map_indx_size(indx->capacity));
+}
+
+static map_indx_info *do_map_indx_alloc(map_meta_info *info, const uint32_t capacity)
+{
+    uint32_t nseg = do_map_indx_seg_count(capacity);
+    size_t ntotal = do_map_indx_size(capacity);
+    size_t seg_ntotal = do_map_indx_seg_size(capacity);
+
+    if (ntotal > MAX_SM_VALUE_LEN) {
+        return NULL; /* too large */
+    }
+    map_indx_info *indx = do_map_indx_mem_alloc(info, ntotal);
+    if (indx != NULL) {
+        indx->used_count = 0;
+        indx->capacity   = capacity;
+        memset(indx->seg, 0, nseg * sizeof(map_indx_seg *));
+
+        for (uint32_t s = 0; s < nseg; s++) {
+            indx->seg[s] = do_map_indx_mem_alloc(info, seg_ntotal);
+            if (indx->seg[s] == NULL) {
+                do_map_indx_free(info, indx);
+                return NULL;
+            }
+            memset(indx->seg[s]->slot, 0, seg_ntotal - offsetof(map_indx_seg, slot));
+        }
+    }
+    return indx;
+}
+
+static void do_map_indx_put(map_indx_info *indx, const uint32_t hval, map_elem_item *elem)
+{
+    uint32_t mask = indx->capacity - 1;
+    uint32_t i = hval & mask;
+
+    while (MAP_INDX_SLOT(indx, i)->elem != NULL) {
+        i = (i + 1) & mask;
+    }
+    MAP_INDX_SLOT(indx, i)->hval = hval;
+    MAP_INDX_SLOT(indx, i)->elem = elem;
+    indx->used_count++;
+}
+
+static void do_map_indx_put_node(map_indx_info *indx, map_hash_node *node)
+{
+    map_elem_item *elem;
+    int hidx;
+
+    for (hidx = 0; hidx < MAP_HASHTAB_SIZE; hidx++) {
+        if (node->hcnt[hidx] == -1) {
+            do_map_indx_put_node(indx, (map_hash_node *)node->htab[hidx]);
+        } else {
+            for (elem = node->htab[hidx]; elem != NULL; elem = elem->next) {
+                do_map_indx_put(indx, elem->hval, elem);
+            }
+        }
+    }
+}
+
+static void do_map_indx_build(map_meta_info *info)
+{
+    uint32_t capacity = 256;
+
+    while ((capacity/4)*3 <= (uint32_t)info->ccnt) {
+        capacity *= 2;
+    }
+    info->indx = do_map_indx_alloc(info, capacity);
+    if (info->indx != NULL) {
+        do_map_indx_put_node(info->indx, info->root);
+    }
+}
+
+static void do_map_indx_grow(map_meta_info *info)
+{
+    map_indx_info *indx = info->indx;
+    map_indx_info *new_indx = do_map_indx_alloc(info, indx->capacity * 2);
+    map_indx_slot *slot;
+    uint32_t i;
+
+    if (new_indx == NULL) {
+        /* keep the table while it is searched fast enough,
+         * and try to grow it again at the next insertion.
+         */
+        if (indx->used_count < (indx->capacity/8)*7) {
+            return;
+        }
+        /* searched by its hash chains until the table is built again */
+        info->indx = NULL;
+        do_map_indx_free(info, indx);
+        return;
+    }
+    for (i = 0; i < indx->capacity; i++) {
+        slot = MAP_INDX_SLOT(indx, i);
+        if (slot->elem != NULL) {
+            do_map_indx_put(new_indx, slot->hval, slot->elem);
+        }
+    }
+    info->indx = new_indx;
+    do_map_indx_free(info, indx);
+}
+
+static map_elem_item *do_map_indx_find(map_indx_info *indx, const uint32_t hval,
+                                       const void *field, const int nfield)
+{
+    uint32_t mask = indx->capacity - 1;
+    uint32_t i;
+    map_elem_item *elem;
+
+    for (i = hval & mask; (elem = MAP_INDX_SLOT(indx, i)->elem) != NULL; i = (i + 1) & mask) {
+        if (MAP_INDX_SLOT(indx, i)->hval == hval &&
+            elem->nfield == nfield && memcmp(elem->data, field, nfield) == 0) {
+            return elem;
+        }
+    }
+    return NULL;
+}
+
+static void do_map_indx_replace(map_indx_info *indx,
+                                map_elem_item *old_elem, map_elem_item *new_elem)
+{
+    uint32_t mask = indx->capacity - 1;
+    uint32_t i;
+
+    for (i = old_elem->hval & mask; MAP_INDX_SLOT(indx, i)->elem != old_elem; i = (i + 1) & mask) {
+        assert(MAP_INDX_SLOT(indx, i)->elem != NULL);
+    }
+    MAP_INDX_SLOT(indx, i)->elem = new_elem;
+}
+
+static void do_map_indx_remove(map_indx_info *indx, map_elem_item *elem)
+{
+    uint32_t mask = indx->capacity - 1;
+    uint32_t i, j, k;
+
+    for (i = elem->hval & mask; MAP_INDX_SLOT(indx, i)->elem != elem; i = (i + 1) & mask) {
+        assert(MAP_INDX_SLOT(indx, i)->elem != NULL);
+    }
+    /* shift the following slots back to keep their probe sequences unbroken */
+    for (j = (i + 1) & mask; MAP_INDX_SLOT(indx, j)->elem != NULL; j = (j + 1) & mask) {
+        k = MAP_INDX_SLOT(indx, j)->hval & mask; /* home slot of the j-th slot */
+        if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) {
+            continue; /* it can stay on the slot */
+        }
+        *MAP_INDX_SLOT(indx, i) = *MAP_INDX_SLOT(indx, j);
+        i = j;
+    }
+    MAP_INDX_SLOT(indx, i)->elem = NULL;
+    indx->used_count--;
+}
+
 static void do_map_node_link(map_meta_info *info,
                              map_hash_node *par_node, const int par_hidx,
                              map_hash_node *node)
@@ -308,6 +536,9 @@ static void do_map_elem_replace(map_meta_info *info,
 
     CLOG_MAP_ELEM_INSERT(info, old_elem, new_elem);
 
+    if (info->indx != NULL) {
+        do_map_indx_replace(info->indx, old_elem, new_elem);
+    }
     new_elem->next = old_elem->next;
     if (prev != NULL) {
         prev->next = new_elem;
@@ -352,11 +583,19 @@ static ENGINE_ERROR_CODE do_map_elem_link(map_meta_info *info, map_elem_item *el
         node = node->htab[hidx];
     }
     assert(node != NULL);
-    for (find = node->htab[hidx]; find != NULL; find = find->next) {
-        if (map_hash_eq(elem->hval, elem->data, elem->nfield,
-                        find->hval, find->data, find->nfield))
-            break;
-        prev = find;
+    if (info->indx != NULL) {
+        find = do_map_indx_find(info->indx, elem->hval, elem->data, elem->nfield);
+        if (find != NULL && replace_if_exist && node->htab[hidx] != find) {
+            /* the previous element is needed to replace the found one */
+            for (prev = node->htab[hidx]; prev->next != find; prev = prev->next);
+        }
+    } else {
+        for (find = node->htab[hidx]; find != NULL; find = find->next) {
+            if (map_hash_eq(elem->hval, elem->data, elem->nfield,
+                            find->hval, find->data, find->nfield))
+                break;
+            prev = find;
+        }
     }
 
     if (find != NULL) {
@@ -412,6 +651,18 @@ static ENGINE_ERROR_CODE do_map_elem_link(map_meta_info *info, map_elem_item *el
         do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_MAP, stotal);
     }
 
+    if (info->indx != NULL) {
+        if (MAP_INDX_FULL(info->indx)) {
+            do_map_indx_grow(info);
+        }
+        if (info->indx != NULL) {
+            do_map_indx_put(info->indx, elem->hval, elem);
+        }
+    } else if (info->ccnt >= MAP_INDX_MIN_COUNT) {
+        /* also retried after the table failed to be allocated */
+        do_map_indx_build(info);
+    }
+
     return res;
 }
 
@@ -427,6 +678,15 @@ static void do_map_elem_unlink(map_meta_info *info,
     node->tot_elem_cnt -= 1;
     info->ccnt--;
 
+    if (info->indx != NULL) {
+        if (info->ccnt < (MAP_INDX_MIN_COUNT/2)) {
+            do_map_indx_free(info, info->indx);
+            info->indx = NULL;
+        } else {
+            do_map_indx_remove(info->indx, elem);
+        }
+    }
+
     CLOG_MAP_ELEM_DELETE(info, elem, cause);
 
     if (info->stotal > 0) { /* apply memory space */
@@ -663,8 +923,15 @@ static uint32_t do_map_elem_get(map_meta_info *info,
     } else {
         for (int ii = 0; ii < numfields; ii++) {
             int hval = genhash_string_hash(flist[ii].value, flist[ii].length);
-            if (do_map_elem_traverse_dfs_byfield(info, info->root, hval, &flist[ii],
-                                                 delete, &elem_array[fcnt])) {
+            if (info->indx != NULL && !delete) {
+                map_elem_item *elem = do_map_indx_find(info->indx, hval,
+                                                       flist[ii].value, flist[ii].length);
+                if (elem != NULL) {
+                    elem->refcount++;
+                    elem_array[fcnt++] = elem;
+                }
+            } else if (do_map_elem_traverse_dfs_byfield(info, info->root, hval, &flist[ii],
+                                                        delete, &elem_array[fcnt])) {
                 fcnt++;
             }
         }
@@ -819,6 +1086,61 @@ ENGINE_ERROR_CODE map_elem_insert(const char *key, const uint32_t nkey,
     return ret;
 }
 
+/*
+ * Insert the given elements into one map with a single cache lock
+ * acquisition. The result of each element is saved in eret_array,
+ * and only the elements inserted successfully are owned by the map.
+ * The map created by the insertion is removed if no element is inserted.
+ */
+ENGINE_ERROR_CODE map_elem_minsert(const char *key, const uint32_t nkey,
+                                   map_elem_item **elem_array, const uint32_t elem_count,
+                                   item_attr *attrp, bool *created,
+                                   ENGINE_ERROR_CODE *eret_array, const void *cookie)
+{
+    hash_item *it = NULL;
+    ENGINE_ERROR_CODE ret;
+    uint32_t i, stored = 0;
+    PERSISTENCE_ACTION_BEGIN(cookie, UPD_MAP_ELEM_INSERT);
+
+    *created = false;
+
+    LOCK_CACHE();
+    ret = do_map_item_find(key, nkey, DONT_UPDATE, &it);
+    if (ret == ENGINE_KEY_ENOENT && attrp != NULL) {
+        it = do_map_item_alloc(key, nkey, attrp, cookie);
+        if (it == NULL) {
+            ret = ENGINE_ENOMEM;
+        } else {
+            ret = do_item_link(it);
+            if (ret == ENGINE_SUCCESS) {
+                *created = true;
+            } else {
+                do_item_free(it);
+            }
+        }
+    }
+    if (ret == ENGINE_SUCCESS) {
+        for (i = 0; i < elem_count; i++) {
+            eret_array[i] = do_map_elem_insert(it, elem_array[i], false /* replace_if_exist */, cookie);
+            if (eret_array[i] == ENGINE_SUCCESS) {
+                stored++;
+            }
+        }
+        if (*created) {
+            if (stored == 0) {
+                do_item_unlink(it, ITEM_UNLINK_NORMAL);
+                *created = false;
+            }
+        } else {
+            do_item_release(it);
+        }
+    }
+    UNLOCK_CACHE();
+
+    PERSISTENCE_ACTION_END(ret);
+    return ret;
+}
+
 ENGINE_ERROR_CODE map_elem_update(const char *key, const uint32_t nkey,
                                   const field_t *field, const char *value,
                                   const uint32_t nbytes, const void *cookie)
@@ -38,6 +38,11 @@ ENGINE_ERROR_CODE map_elem_insert(const char *key, const uint32_t nkey,
                                   item_attr *attrp,
                                   bool *created, const void *cookie);
 
+ENGINE_ERROR_CODE map_elem_minsert(const char *key, const uint32_t nkey,
+                                   map_elem_item **elem_array, const uint32_t elem_count,
+                                   item_attr *attrp, bool *created,
+                                   ENGINE_ERROR_CODE *eret_array, const void *cookie);
+
 ENGINE_ERROR_CODE map_elem_update(const char *key, const uint32_t nkey,
                                   const field_t *field,
                                   const char *value, const uint32_t nbytes,
@@ -19,6 +19,7 @@
 #include "config.h"
 #include <fcntl.h>
 #include <errno.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -131,6 +132,7 @@ static hash_item *do_set_item_alloc(const void *key, const uint32_t nkey,
         info->itdist  = (uint16_t)((size_t*)info-(size_t*)it);
         info->stotal  = 0;
         info->root    = NULL;
+        info->indx    = NULL;
         assert((hash_item*)COLL_GET_HASH_ITEM(info) == it);
     }
     return it;
@@ -194,6 +196,220 @@ static void do_set_elem_release(set_elem_item *elem)
     }
 }
 
+/*
+ * Set element index
+ *
+ * A set of SET_INDX_MIN_COUNT elements or more keeps an open-addressing table
+ * of <hash value, element> slots beside its hash nodes. A lookup compares the
+ * hash values stored in the adjacent slots, so it visits only the matching
+ * element instead of walking the hash chain of scattered elements.
+ * The table is built when the set grows to SET_INDX_MIN_COUNT elements,
+ * doubled when it gets 3/4 full, and freed when the set becomes short again.
+ * The slots are stored in segments of SET_INDX_SEG_SLOTS slots, and the table
+ * keeps the segments. So, the table and its segments are small memory chunks
+ * (See MAX_SM_VALUE_LEN) however large the set is, and never take the chunks
+ * of the slab classes which the slab page mover evicts.
+ * If the table cannot be allocated, the set is searched by its hash chains
+ * until a later insertion allocates it.
+ */
+#define SET_INDX_MIN_COUNT 128
+#define SET_INDX_SEG_SLOTS 2048 /* the max number of slots in a segment */
+#define SET_INDX_FULL(indx) ((indx)->used_count >= ((indx)->capacity/4)*3)
+
+#define SET_INDX_SLOT(indx, i) \
+        (&(indx)->seg[(i) / SET_INDX_SEG_SLOTS]->slot[(i) % SET_INDX_SEG_SLOTS])
+
+static inline uint32_t do_set_indx_seg_count(const uint32_t capacity)
+{
+    return (capacity + SET_INDX_SEG_SLOTS - 1) / SET_INDX_SEG_SLOTS;
+}
+
+static inline size_t do_set_indx_size(const uint32_t capacity)
+{
+    return offsetof(set_indx_info, seg) +
+           do_set_indx_seg_count(capacity) * sizeof(set_indx_seg *);
+}
+
+static inline size_t do_set_indx_seg_size(const uint32_t capacity)
+{
+    uint32_t nslot = (capacity < SET_INDX_SEG_SLOTS ? capacity : SET_INDX_SEG_SLOTS);
+    return offsetof(set_indx_seg, slot) + nslot * sizeof(set_indx_slot);
+}
+
+/* allocate the table or a segment. Both start with the same header. */
+static void *do_set_indx_mem_alloc(set_meta_info *info, const size_t ntotal)
+{
+    assert(ntotal <= MAX_SM_VALUE_LEN);
+    set_indx_seg *seg = do_item_mem_alloc(ntotal, LRU_CLSID_FOR_SMALL, NULL);
+    if (seg != NULL) {
+        seg->slabs_clsid = slabs_clsid(ntotal);
+        assert(seg->slabs_clsid > 0);
+        seg->refcount = 0;
+
+        if (1) { /* apply memory space */
+            size_t stotal = slabs_space_size(ntotal);
+            do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_SET, stotal);
+        }
+    }
+    return seg;
+}
+
+static void do_set_indx_mem_free(set_meta_info *info, void *ptr, const size_t ntotal)
+{
+    if (info->stotal > 0) { /* apply memory space */
+        size_t stotal = slabs_space_size(ntotal);
+        do_coll_space_decr((coll_meta_info *)info, ITEM_TYPE_SET, stotal);
+    }
+    do_item_mem_free(ptr, ntotal);
+}
+
+static void do_set_indx_free(set_meta_info *info, set_indx_info *indx)
+{
+    uint32_t nseg = do_set_indx_seg_count(indx->capacity);
+
+    for (uint32_t s = 0; s < nseg; s++) {
+        if (indx->seg[s] != NULL) {
+            do_set_indx_mem_free(info, indx->seg[s], do_set_indx_seg_size(indx->capacity));
+        }
+    }
+    do_set_indx_mem_free(info, indx, do_set_indx_size(indx->capacity));
+}
+
+static set_indx_info *do_set_indx_alloc(set_meta_info *info, const uint32_t capacity)
+{
+    uint32_t nseg = do_set_indx_seg_count(capacity);
+    size_t ntotal = do_set_indx_size(capacity);
+    size_t seg_ntotal = do_set_indx_seg_size(capacity);
+
+    if (ntotal > MAX_SM_VALUE_LEN) {
+        return NULL; /* too large */
+    }
+    set_indx_info *indx = do_set_indx_mem_alloc(info, ntotal);
+    if (indx != NULL) {
+        indx->used_count = 0;
+        indx->capacity   = capacity;
+        memset(indx->seg, 0, nseg * sizeof(set_indx_seg *));
+
+        for (uint32_t s = 0; s < nseg; s++) {
+            indx->seg[s] = do_set_indx_mem_alloc(info, seg_ntotal);
+            if (indx->seg[s] == NULL) {
+                do_set_indx_free(info, indx);
+                return NULL;
+            }
+            memset(indx->seg[s]->slot, 0, seg_ntotal - offsetof(set_indx_seg, slot));
+        }
+    }
+    return indx;
+}
+
+static void do_set_indx_put(set_indx_info *indx, const uint32_t hval, set_elem_item *elem)
+{
+    uint32_t mask = indx->capacity - 1;
+    uint32_t i = hval & mask;
+
+    while (SET_INDX_SLOT(indx, i)->elem != NULL) {
+        i = (i + 1) & mask;
+    }
+    SET_INDX_SLOT(indx, i)->hval = hval;
+    SET_INDX_SLOT(indx, i)->elem = elem;
+    indx->used_count++;
+}
+
+static void do_set_indx_put_node(set_indx_info *indx, set_hash_node *node)
+{
+    set_elem_item *elem;
+    int hidx;
+
+    for (hidx = 0; hidx < SET_HASHTAB_SIZE; hidx++) {
+        if (node->hcnt[hidx] == -1) {
+            do_set_indx_put_node(indx, (set_hash_node *)node->htab[hidx]);
+        } else {
+            for (elem = node->htab[hidx]; elem != NULL; elem = elem->next) {
+                do_set_indx_put(indx, elem->hval, elem);
+            }
+        }
+    }
+}
+
+static void do_set_indx_build(set_meta_info *info)
+{
+    uint32_t capacity = 256;
+
+    while ((capacity/4)*3 <= (uint32_t)info->ccnt) {
+        capacity *= 2;
+    }
+    info->indx = do_set_indx_alloc(info, capacity);
+    if (info->indx != NULL) {
+        do_set_indx_put_node(info->indx, info->root);
+    }
+}
+
+static void do_set_indx_grow(set_meta_info *info)
+{
+    set_indx_info *indx = info->indx;
+    set_indx_info *new_indx = do_set_indx_alloc(info, indx->capacity * 2);
+    set_indx_slot *slot;
+    uint32_t i;
+
+    if (new_indx == NULL) {
+        /* keep the table while it is searched fast enough,
+         * and try to grow it again at the next insertion.
+         */
+        if (indx->used_count < (indx->capacity/8)*7) {
+            return;
+        }
+        /* searched by its hash chains until the table is built again */
+        info->indx = NULL;
+        do_set_indx_free(info, indx);
+        return;
+    }
+    for (i = 0; i < indx->capacity; i++) {
+        slot = SET_INDX_SLOT(indx, i);
+        if (slot->elem != NULL) {
+            do_set_indx_put(new_indx, slot->hval, slot->elem);
+        }
+    }
+    info->indx = new_indx;
+    do_set_indx_free(info, indx);
+}
+
+static set_elem_item *do_set_indx_find(set_indx_info *indx, const uint32_t hval,
+                                       const char *val, const int vlen)
+{
+    uint32_t mask = indx->capacity - 1;
+    uint32_t i;
+    set_elem_item *elem;
+
+    for (i = hval & mask; (elem = SET_INDX_SLOT(indx, i)->elem) != NULL; i = (i + 1) & mask) {
+        if (SET_INDX_SLOT(indx, i)->hval == hval &&
+            elem->nbytes == vlen && memcmp(elem->value, val, vlen) == 0) {
+            return elem;
+        }
+    }
+    return NULL;
+}
+
+static void do_set_indx_remove(set_indx_info *indx, set_elem_item *elem)
+{
+    uint32_t mask = indx->capacity - 1;
+    uint32_t i, j, k;
+
+    for (i = elem->hval & mask; SET_INDX_SLOT(indx, i)->elem != elem; i = (i + 1) & mask) {
+        assert(SET_INDX_SLOT(indx, i)->elem != NULL);
+    }
+    /* shift the following slots back to keep their probe sequences unbroken */
+    for (j = (i + 1) & mask; SET_INDX_SLOT(indx, j)->elem != NULL; j = (j + 1) & mask) {
+        k = SET_INDX_SLOT(indx, j)->hval & mask; /* home slot of the j-th slot */
+        if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) {
+            continue; /* it can stay on the slot */
+        }
+        *SET_INDX_SLOT(indx, i) = *SET_INDX_SLOT(indx, j);
+        i = j;
+    }
+    SET_INDX_SLOT(indx, i)->elem = NULL;
+    indx->used_count--;
+}
+
 static void do_set_node_link(set_meta_info *info,
                              set_hash_node *par_node, const int par_hidx,
                              set_hash_node *node)
@@ -302,10 +518,14 @@ static ENGINE_ERROR_CODE do_set_elem_link(set_meta_info *info, set_elem_item *el
     assert(node != NULL);
     assert(hidx != -1);
 
-    for (find = node->htab[hidx]; find != NULL; find = find->next) {
-        if (set_hash_eq(elem->hval, elem->value, elem->nbytes,
-                        find->hval, find->value, find->nbytes))
-            break;
+    if (info->indx != NULL) {
+        find = do_set_indx_find(info->indx, elem->hval, elem->value, elem->nbytes);
+    } else {
+        for (find = node->htab[hidx]; find != NULL; find = find->next) {
+            if (set_hash_eq(elem->hval, elem->value, elem->nbytes,
+                            find->hval, find->value, find->nbytes))
+                break;
+        }
     }
     if (find != NULL) {
         return ENGINE_ELEM_EEXISTS;
@@ -334,6 +554,18 @@ static ENGINE_ERROR_CODE do_set_elem_link(set_meta_info *info, set_elem_item *el
         do_coll_space_incr((coll_meta_info *)info, ITEM_TYPE_SET, stotal);
     }
 
+    if (info->indx != NULL) {
+        if (SET_INDX_FULL(info->indx)) {
+            do_set_indx_grow(info);
+        }
+        if (info->indx != NULL) {
+            do_set_indx_put(info->indx, elem->hval, elem);
+        }
+    } else if (info->ccnt >= SET_INDX_MIN_COUNT) {
+        /* also retried after the table failed to be allocated */
+        do_set_indx_build(info);
+    }
+
     return ENGINE_SUCCESS;
 }
 
@@ -349,6 +581,15 @@ static void do_set_elem_unlink(set_meta_info *info,
     node->tot_elem_cnt -= 1;
     info->ccnt--;
 
+    if (info->indx != NULL) {
+        if (info->ccnt < (SET_INDX_MIN_COUNT/2)) {
+            do_set_indx_free(info, info->indx);
+            info->indx = NULL;
+        } else {
+            do_set_indx_remove(info->indx, elem);
+        }
+    }
+
     CLOG_SET_ELEM_DELETE(info, elem, cause);
 
     if (info->stotal > 0) { /* apply memory space */
@@ -365,6 +606,9 @@ static set_elem_item *do_set_elem_find(set_meta_info *info, const char *val, con
 {
     set_elem_item *elem = NULL;
 
+    if (info->indx != NULL) {
+        return do_set_indx_find(info->indx, genhash_string_hash(val, vlen), val, vlen);
+    }
     if (info->root != NULL) {
         set_hash_node *node = info->root;
         int hval = genhash_string_hash(val, vlen);
@@ -542,6 +786,10 @@ static uint32_t do_set_elem_delete_fast(set_meta_info *info, const uint32_t coun
 {
     uint32_t fcnt = 0;
     if (info->root != NULL) {
+        if (info->indx != NULL) {
+            do_set_indx_free(info, info->indx);
+            info->indx = NULL;
+        }
         fcnt = do_set_elem_traverse_fast(info, info->root, count);
         if (info->root->tot_hash_cnt == 0 && info->root->tot_elem_cnt == 0) {
             do_set_node_free(info->root);
@@ -739,6 +987,61 @@ ENGINE_ERROR_CODE set_elem_insert(const char *key, const uint32_t nkey,
     return ret;
 }
 
+/*
+ * Insert the given elements into one set with a single cache lock
+ * acquisition. The result of each element is saved in eret_array,
+ * and only the elements inserted successfully are owned by the set.
+ * The set created by the insertion is removed if no element is inserted.
+ */
+ENGINE_ERROR_CODE set_elem_minsert(const char *key, const uint32_t nkey,
+                                   set_elem_item **elem_array, const uint32_t elem_count,
+                                   item_attr *attrp, bool *created,
+                                   ENGINE_ERROR_CODE *eret_array, const void *cookie)
+{
+    hash_item *it = NULL;
+    ENGINE_ERROR_CODE ret;
+    uint32_t i, stored = 0;
+    PERSISTENCE_ACTION_BEGIN(cookie, UPD_SET_ELEM_INSERT);
+
+    *created = false;
+
+    LOCK_CACHE();
+    ret = do_set_item_find(key, nkey, DONT_UPDATE, &it);
+    if (ret == ENGINE_KEY_ENOENT && attrp != NULL) {
+        it = do_set_item_alloc(key, nkey, attrp, cookie);
+        if (it == NULL) {
+            ret = ENGINE_ENOMEM;
+        } else {
+            ret = do_item_link(it);
+            if (ret == ENGINE_SUCCESS) {
+                *created = true;
+            } else {
+                do_item_free(it);
+            }
+        }
+    }
+    if (ret == ENGINE_SUCCESS) {
+        for (i = 0; i < elem_count; i++) {
+            eret_array[i] = do_set_elem_insert(it, elem_array[i], cookie);
+            if (eret_array[i] == ENGINE_SUCCESS) {
+                stored++;
+            }
+        }
+        if (*created) {
+            if (stored == 0) {
+                do_item_unlink(it, ITEM_UNLINK_NORMAL);
+                *created = false;
+            }
+        } else {
+            do_item_release(it);
+        }
+    }
+    UNLOCK_CACHE();
+
+    PERSISTENCE_ACTION_END(ret);
+    return ret;
+}
+
 ENGINE_ERROR_CODE set_elem_delete(const char *key, const uint32_t nkey,
                                   const char *value, const uint32_t nbytes,
                                   const bool drop_if_empty, bool *dropped,
@@ -797,6 +1100,34 @@ ENGINE_ERROR_CODE set_elem_exist(const char *key, const uint32_t nkey,
     return ret;
 }
 
+ENGINE_ERROR_CODE set_elem_mexist(const char *key, const uint32_t nkey,
+                                  const char **value_array, const uint32_t *nbytes_array,
+                                  const uint32_t value_count, bool *exist_array)
+{
+    hash_item *it;
+    ENGINE_ERROR_CODE ret;
+
+    LOCK_CACHE();
+    ret = do_set_item_find(key, nkey, DO_UPDATE, &it);
+    if (ret == ENGINE_SUCCESS) {
+        set_meta_info *info = (set_meta_info *)item_get_meta(it);
+        do {
+            if ((info->mflags & COLL_META_FLAG_READABLE) == 0) {
+                ret = ENGINE_UNREADABLE; break;
+            }
+            for (uint32_t i = 0; i < value_count; i++) {
+                if (do_set_elem_find(info, value_array[i], nbytes_array[i]) != NULL)
+                    exist_array[i] = true;
+                else
+                    exist_array[i] = false;
+            }
+        } while (0);
+        do_item_release(it);
+    }
+    UNLOCK_CACHE();
+    return ret;
+}
+
 ENGINE_ERROR_CODE set_elem_get(const char *key, const uint32_t nkey,
                                const uint32_t count,
                                const bool delete, const bool drop_if_empty,
@@ -37,6 +37,11 @@ ENGINE_ERROR_CODE set_elem_insert(const char *key, const uint32_t nkey,
                                   item_attr *attrp,
                                   bool *created, const void *cookie);
 
+ENGINE_ERROR_CODE set_elem_minsert(const char *key, const uint32_t nkey,
+                                   set_elem_item **elem_array, const uint32_t elem_count,
+                                   item_attr *attrp, bool *created,
+                                   ENGINE_ERROR_CODE *eret_array, const void *cookie);
+
 ENGINE_ERROR_CODE set_elem_delete(const char *key, const uint32_t nkey,
                                   const char *value, const uint32_t nbytes,
                                   const bool drop_if_empty,
@@ -46,6 +51,10 @@ ENGINE_ERROR_CODE set_elem_exist(const char *key, const uint32_t nkey,
                                  const char *value, const uint32_t nbytes,
                                  bool *exist);
 
+ENGINE_ERROR_CODE set_elem_mexist(const char *key, const uint32_t nkey,
+                                  const char **value_array, const uint32_t *nbytes_array,
+                                  const uint32_t value_count, bool *exist_array);
+
 ENGINE_ERROR_CODE set_elem_get(const char *key, const uint32_t nkey,
                                const uint32_t count,
                                const bool delete, const bool drop_if_empty,
@@ -107,7 +107,7 @@ default_get_info(ENGINE_HANDLE* handle)
     return &get_handle(handle)->info.engine_info;
 }
 
-static int check_configuration(struct engine_config *conf)
+static int check_configuration(struct engine_config *conf, uint32_t hashpower)
 {
     if (conf->max_list_size < MINIMUM_MAX_COLL_SIZE ||
         conf->max_list_size > MAXIMUM_MAX_COLL_SIZE) {
@@ -137,6 +137,22 @@ static int check_configuration(struct engine_config *conf)
                 conf->max_btree_size, MINIMUM_MAX_COLL_SIZE, MAXIMUM_MAX_COLL_SIZE);
         return -1;
     }
+    if (conf->list_index_threshold != 0 &&
+        (conf->list_index_threshold < MINIMUM_LIST_INDEX_THRESHOLD ||
+         conf->list_index_threshold > MAXIMUM_MAX_COLL_SIZE)) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: list_index_threshold(%u) must be 0 or in range(%u~%u).\n",
+                conf->list_index_threshold, MINIMUM_LIST_INDEX_THRESHOLD, MAXIMUM_MAX_COLL_SIZE);
+        return -1;
+    }
+    if (conf->btree_fanout < BTREE_ITEM_COUNT ||
+        conf->btree_fanout > BTREE_MAX_ITEM_COUNT ||
+        (conf->btree_fanout & (conf->btree_fanout - 1)) != 0) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: btree_fanout(%u) must be a power of 2 in range(%u~%u).\n",
+                conf->btree_fanout, BTREE_ITEM_COUNT, BTREE_MAX_ITEM_COUNT);
+        return -1;
+    }
     if (conf->max_element_bytes < MINIMUM_MAX_ELEMENT_BYTES ||
         conf->max_element_bytes > MAXIMUM_MAX_ELEMENT_BYTES) {
         logger->log(EXTENSION_LOG_WARNING, NULL,
@@ -151,6 +167,54 @@ static int check_configuration(struct engine_config *conf)
                 conf->scrub_count, MINIMUM_SCRUB_COUNT, MAXIMUM_SCRUB_COUNT);
         return -1;
     }
+    if (conf->lock_partitions != 0 &&
+        (conf->lock_partitions < MINIMUM_LOCK_PARTITIONS ||
+         conf->lock_partitions > MAXIMUM_LOCK_PARTITIONS ||
+         (conf->lock_partitions & (conf->lock_partitions - 1)) != 0)) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: lock_partitions(%u) must be 0 or a power of 2 in range(%u~%u).\n",
+                conf->lock_partitions, MINIMUM_LOCK_PARTITIONS, MAXIMUM_LOCK_PARTITIONS);
+        return -1;
+    }
+    if (conf->lock_partitions > ((uint32_t)1 << hashpower)) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: lock_partitions(%u) must not exceed the hash size(%u).\n",
+                conf->lock_partitions, ((uint32_t)1 << hashpower));
+        return -1;
+    }
+    if (conf->lru_warm_percent > MAXIMUM_LRU_WARM_PERCENT) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: lru_warm_percent(%u) is out of range(%u~%u).\n",
+                conf->lru_warm_percent, MINIMUM_LRU_WARM_PERCENT, MAXIMUM_LRU_WARM_PERCENT);
+        return -1;
+    }
+    if (conf->lru_headroom_percent > MAXIMUM_LRU_HEADROOM_PERCENT) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: lru_headroom_percent(%u) is out of range(%u~%u).\n",
+                conf->lru_headroom_percent, MINIMUM_LRU_HEADROOM_PERCENT, MAXIMUM_LRU_HEADROOM_PERCENT);
+        return -1;
+    }
+    if (conf->slab_automove > MAXIMUM_SLAB_AUTOMOVE) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: slab_automove(%u) is out of range(%u~%u).\n",
+                conf->slab_automove, MINIMUM_SLAB_AUTOMOVE, MAXIMUM_SLAB_AUTOMOVE);
+        return -1;
+    }
+#ifdef ENABLE_COMPACT_ITEM
+    if (conf->maxbytes > MAXIMUM_COMPACT_ITEM_MEMORY) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: cache_size(%zu) is too large for compact items(max %"PRIu64").\n",
+                conf->maxbytes, MAXIMUM_COMPACT_ITEM_MEMORY);
+        return -1;
+    }
+#endif
+#if defined(ENABLE_BTREE_COMPRESS) && defined(ENABLE_PERSISTENCE)
+    if (conf->btree_compress && conf->use_persistence) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                "default engine: btree_compress cannot be used with persistence.\n");
+        return -1;
+    }
+#endif
 #ifdef ENABLE_PERSISTENCE
     if (conf->use_persistence) {
         /* check data & logs directory path. */
@@ -191,6 +255,7 @@ initialize_configuration(struct default_engine *se, const char *cfg_str)
         { .key = "eviction",          .datatype = DT_BOOL,   .value.dt_bool = &se->config.evict_to_free },
         { .key = "prefix_delimiter",  .datatype = DT_CHAR,   .value.dt_char = &se->config.prefix_delimiter },
         { .key = "preallocate",       .datatype = DT_BOOL,   .value.dt_bool = &se->config.preallocate },
+        { .key = "large_pages",       .datatype = DT_BOOL,   .value.dt_bool = &se->config.large_pages },
         { .key = "factor",            .datatype = DT_FLOAT,  .value.dt_float = &se->config.factor },
         { .key = "chunk_size",        .datatype = DT_SIZE,   .value.dt_size = &se->config.chunk_size },
         { .key = "num_threads",       .datatype = DT_SIZE,   .value.dt_size = &se->config.num_threads },
@@ -200,11 +265,21 @@ initialize_configuration(struct default_engine *se, const char *cfg_str)
 #endif
         { .key = "item_size_max",     .datatype = DT_SIZE,   .value.dt_size = &se->config.item_size_max },
         { .key = "max_list_size",     .datatype = DT_UINT32, .value.dt_uint32 = &se->config.max_list_size },
+        { .key = "list_index_threshold", .datatype = DT_UINT32, .value.dt_uint32 = &se->config.list_index_threshold },
         { .key = "max_set_size",      .datatype = DT_UINT32, .value.dt_uint32 = &se->config.max_set_size },
         { .key = "max_map_size",      .datatype = DT_UINT32, .value.dt_uint32 = &se->config.max_map_size },
         { .key = "max_btree_size",    .datatype = DT_UINT32, .value.dt_uint32 = &se->config.max_btree_size },
+        { .key = "btree_fanout",      .datatype = DT_UINT32, .value.dt_uint32 = &se->config.btree_fanout },
+#ifdef ENABLE_BTREE_COMPRESS
+        { .key = "btree_compress",    .datatype = DT_BOOL,   .value.dt_bool = &se->config.btree_compress },
+#endif
         { .key = "max_element_bytes", .datatype = DT_UINT32, .value.dt_uint32 = &se->config.max_element_bytes },
         { .key = "scrub_count",       .datatype = DT_UINT32, .value.dt_uint32 = &se->config.scrub_count},
+        { .key = "lock_partitions",   .datatype = DT_UINT32, .value.dt_uint32 = &se->config.lock_partitions},
+        { .key = "hash_tags",         .datatype = DT_BOOL,   .value.dt_bool = &se->config.hash_tags},
+        { .key = "lru_warm_percent",  .datatype = DT_UINT32, .value.dt_uint32 = &se->config.lru_warm_percent},
+        { .key = "lru_headroom_percent", .datatype = DT_UINT32, .value.dt_uint32 = &se->config.lru_headroom_percent},
+        { .key = "slab_automove",     .datatype = DT_UINT32, .value.dt_uint32 = &se->config.slab_automove},
 #ifdef ENABLE_PERSISTENCE
         { .key = "use_persistence",   .datatype = DT_BOOL,   .value.dt_bool = &se->config.use_persistence },
         { .key = "data_path",         .datatype = DT_STRING, .value.dt_string = &se->config.data_path },
@@ -230,7 +305,7 @@ initialize_configuration(struct default_engine *se, const char *cfg_str)
         }
     }
     /* check engine config */
-    if (check_configuration(&se->config) < 0) {
+    if (check_configuration(&se->config, se->assoc.hashpower) < 0) {
         return ENGINE_FAILED;
     }
 
@@ -263,7 +338,12 @@ default_initialize(ENGINE_HANDLE* handle, const char* config_str)
     if (ret != ENGINE_SUCCESS) {
         return ret;
     }
-    ret = slabs_init(se, se->config.maxbytes, se->config.factor, se->config.preallocate);
+#ifdef ENABLE_COMPACT_ITEM
+    /* compact items are linked by the offsets in the preallocated memory */
+    se->config.preallocate = true;
+#endif
+    ret = slabs_init(se, se->config.maxbytes, se->config.factor,
+                     se->config.preallocate || se->config.large_pages);
     if (ret != ENGINE_SUCCESS) {
         return ret;
     }
@@ -505,6 +585,24 @@ default_list_elem_insert(ENGINE_HANDLE* handle, const void* cookie,
     return ret;
 }
 
+static ENGINE_ERROR_CODE
+default_list_elem_minsert(ENGINE_HANDLE* handle, const void* cookie,
+                          const void* key, const int nkey, int index,
+                          eitem **eitem_array, const int eitem_count,
+                          item_attr *attrp, bool *created,
+                          ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    struct default_engine* engine = get_handle(handle);
+    ENGINE_ERROR_CODE ret;
+    VBUCKET_GUARD(engine, vbucket);
+
+    ACTION_BEFORE_WRITE(cookie, key, nkey);
+    ret = list_elem_minsert(key, nkey, index, (list_elem_item **)eitem_array, eitem_count,
+                            attrp, created, eret_array, cookie);
+    ACTION_AFTER_WRITE(cookie, engine, ret);
+    return ret;
+}
+
 static ENGINE_ERROR_CODE
 default_list_elem_delete(ENGINE_HANDLE* handle, const void* cookie,
                          const void* key, const int nkey,
@@ -609,6 +707,24 @@ default_set_elem_insert(ENGINE_HANDLE* handle, const void* cookie,
     return ret;
 }
 
+static ENGINE_ERROR_CODE
+default_set_elem_minsert(ENGINE_HANDLE* handle, const void* cookie,
+                         const void* key, const int nkey,
+                         eitem **eitem_array, const int eitem_count,
+                         item_attr *attrp, bool *created,
+                         ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    struct default_engine *engine = get_handle(handle);
+    ENGINE_ERROR_CODE ret;
+    VBUCKET_GUARD(engine, vbucket);
+
+    ACTION_BEFORE_WRITE(cookie, key, nkey);
+    ret = set_elem_minsert(key, nkey, (set_elem_item **)eitem_array, eitem_count,
+                           attrp, created, eret_array, cookie);
+    ACTION_AFTER_WRITE(cookie, engine, ret);
+    return ret;
+}
+
 static ENGINE_ERROR_CODE
 default_set_elem_delete(ENGINE_HANDLE* handle, const void* cookie,
                         const void* key, const int nkey,
@@ -642,6 +758,23 @@ default_set_elem_exist(ENGINE_HANDLE* handle, const void* cookie,
     return ret;
 }
 
+static ENGINE_ERROR_CODE
+default_set_elem_mexist(ENGINE_HANDLE* handle, const void* cookie,
+                        const void* key, const int nkey,
+                        const void **value_array, const uint32_t *nbytes_array,
+                        const uint32_t value_count, bool *exist_array,
+                        uint16_t vbucket)
+{
+    struct default_engine *engine = get_handle(handle);
+    ENGINE_ERROR_CODE ret;
+    VBUCKET_GUARD(engine, vbucket);
+
+    ACTION_BEFORE_READ(cookie, key, nkey);
+    ret = set_elem_mexist(key, nkey, (const char **)value_array, nbytes_array,
+                          value_count, exist_array);
+    return ret;
+}
+
 static ENGINE_ERROR_CODE
 default_set_elem_get(ENGINE_HANDLE* handle, const void* cookie,
                      const void* key, const int nkey,
@@ -729,6 +862,24 @@ default_map_elem_insert(ENGINE_HANDLE* handle, const void* cookie,
     return ret;
 }
 
+static ENGINE_ERROR_CODE
+default_map_elem_minsert(ENGINE_HANDLE* handle, const void* cookie,
+                         const void* key, const int nkey,
+                         eitem **eitem_array, const int eitem_count,
+                         item_attr *attrp, bool *created,
+                         ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    struct default_engine *engine = get_handle(handle);
+    ENGINE_ERROR_CODE ret;
+    VBUCKET_GUARD(engine, vbucket);
+
+    ACTION_BEFORE_WRITE(cookie, key, nkey);
+    ret = map_elem_minsert(key, nkey, (map_elem_item **)eitem_array, eitem_count,
+                           attrp, created, eret_array, cookie);
+    ACTION_AFTER_WRITE(cookie, engine, ret);
+    return ret;
+}
+
 static ENGINE_ERROR_CODE
 default_map_elem_update(ENGINE_HANDLE* handle, const void* cookie,
                         const void* key, const int nkey, const field_t *field,
@@ -865,6 +1016,24 @@ default_btree_elem_insert(ENGINE_HANDLE* handle, const void* cookie,
     return ret;
 }
 
+static ENGINE_ERROR_CODE
+default_btree_elem_minsert(ENGINE_HANDLE* handle, const void* cookie,
+                           const void* key, const int nkey,
+                           eitem **eitem_array, const int eitem_count,
+                           item_attr *attrp, bool *created,
+                           ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    struct default_engine* engine = get_handle(handle);
+    ENGINE_ERROR_CODE ret;
+    VBUCKET_GUARD(engine, vbucket);
+
+    ACTION_BEFORE_WRITE(cookie, key, nkey);
+    ret = btree_elem_minsert(key, nkey, (btree_elem_item **)eitem_array, eitem_count,
+                             attrp, created, eret_array, cookie);
+    ACTION_AFTER_WRITE(cookie, engine, ret);
+    return ret;
+}
+
 static ENGINE_ERROR_CODE
 default_btree_elem_update(ENGINE_HANDLE* handle, const void* cookie,
                           const void* key, const int nkey,
@@ -1310,6 +1479,20 @@ default_set_config(ENGINE_HANDLE* handle, const void* cookie,
         }
         pthread_mutex_unlock(&engine->cache_lock);
     }
+    else if (strcmp(config_key, "slab_automove") == 0) {
+        uint32_t new_automove = *(uint32_t*)config_value;
+        pthread_mutex_lock(&engine->cache_lock);
+        if (new_automove <= MAXIMUM_SLAB_AUTOMOVE) {
+            engine->config.slab_automove = new_automove;
+        } else {
+            ret = ENGINE_EBADVALUE;
+        }
+        pthread_mutex_unlock(&engine->cache_lock);
+    }
+    else if (strcmp(config_key, "slabs_reassign") == 0) {
+        uint32_t *clsids = (uint32_t*)config_value; /* src, dst */
+        ret = item_slabs_reassign(clsids[0], clsids[1]);
+    }
     else if (strcmp(config_key, "verbosity") == 0) {
         pthread_mutex_lock(&engine->cache_lock);
         engine->config.verbose = *(size_t*)config_value;
@@ -1370,6 +1553,11 @@ default_get_config(ENGINE_HANDLE* handle, const void* cookie,
         *(uint32_t*)config_value = engine->config.scrub_count;
         pthread_mutex_unlock(&engine->cache_lock);
     }
+    else if (strcmp(config_key, "slab_automove") == 0) {
+        pthread_mutex_lock(&engine->cache_lock);
+        *(uint32_t*)config_value = engine->config.slab_automove;
+        pthread_mutex_unlock(&engine->cache_lock);
+    }
     else if (strcmp(config_key, "verbosity") == 0) {
         pthread_mutex_lock(&engine->cache_lock);
         *(size_t*)config_value = engine->config.verbose;
@@ -1697,6 +1885,7 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .list_elem_free    = default_list_elem_free,
          .list_elem_release = default_list_elem_release,
          .list_elem_insert  = default_list_elem_insert,
+         .list_elem_minsert = default_list_elem_minsert,
          .list_elem_delete  = default_list_elem_delete,
          .list_elem_get     = default_list_elem_get,
          /* SET Colleciton API */
@@ -1705,8 +1894,10 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .set_elem_free     = default_set_elem_free,
          .set_elem_release  = default_set_elem_release,
          .set_elem_insert   = default_set_elem_insert,
+         .set_elem_minsert  = default_set_elem_minsert,
          .set_elem_delete   = default_set_elem_delete,
          .set_elem_exist    = default_set_elem_exist,
+         .set_elem_mexist   = default_set_elem_mexist,
          .set_elem_get      = default_set_elem_get,
          /* MAP Collection API */
          .map_struct_create = default_map_struct_create,
@@ -1714,6 +1905,7 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .map_elem_free     = default_map_elem_free,
          .map_elem_release  = default_map_elem_release,
          .map_elem_insert   = default_map_elem_insert,
+         .map_elem_minsert  = default_map_elem_minsert,
          .map_elem_update   = default_map_elem_update,
          .map_elem_delete   = default_map_elem_delete,
          .map_elem_get      = default_map_elem_get,
@@ -1723,6 +1915,7 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .btree_elem_free    = default_btree_elem_free,
          .btree_elem_release = default_btree_elem_release,
          .btree_elem_insert  = default_btree_elem_insert,
+         .btree_elem_minsert = default_btree_elem_minsert,
          .btree_elem_update  = default_btree_elem_update,
          .btree_elem_delete  = default_btree_elem_delete,
          .btree_elem_arithmetic  = default_btree_elem_arithmetic,
@@ -1778,6 +1971,7 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .evict_to_free = true,
          .prefix_delimiter = ':',
          .preallocate = false,
+         .large_pages = false,
          .factor = 1.25,
          .chunk_size = 48,
          .num_threads = 0,
@@ -1785,11 +1979,21 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .sticky_limit = 0,
          .item_size_max= 1024 * 1024,
          .max_list_size = DEFAULT_MAX_LIST_SIZE,
+         .list_index_threshold = DEFAULT_LIST_INDEX_THRESHOLD,
          .max_set_size = DEFAULT_MAX_SET_SIZE,
          .max_map_size = DEFAULT_MAX_MAP_SIZE,
          .max_btree_size = DEFAULT_MAX_BTREE_SIZE,
+         .btree_fanout = BTREE_ITEM_COUNT,
+#ifdef ENABLE_BTREE_COMPRESS
+         .btree_compress = false,
+#endif
          .max_element_bytes = DEFAULT_MAX_ELEMENT_BYTES,
          .scrub_count = DEFAULT_SCRUB_COUNT,
+         .lock_partitions = DEFAULT_LOCK_PARTITIONS,
+         .hash_tags = false,
+         .lru_warm_percent = DEFAULT_LRU_WARM_PERCENT,
+         .lru_headroom_percent = DEFAULT_LRU_HEADROOM_PERCENT,
+         .slab_automove = DEFAULT_SLAB_AUTOMOVE,
 #ifdef ENABLE_PERSISTENCE
          .use_persistence = false,
          .async_logging = false, /* default, sync logging */
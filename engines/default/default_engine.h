@@ -54,6 +54,7 @@ struct engine_config {
    bool       evict_to_free;
    char       prefix_delimiter;
    bool       preallocate;
+   bool       large_pages;
    float      factor;
    size_t     chunk_size;
    size_t     num_threads;
@@ -61,11 +62,21 @@ struct engine_config {
    size_t     sticky_limit;
    size_t     item_size_max;
    uint32_t   max_list_size;
+   uint32_t   list_index_threshold;
    uint32_t   max_set_size;
    uint32_t   max_map_size;
    uint32_t   max_btree_size;
+   uint32_t   btree_fanout;
+#ifdef ENABLE_BTREE_COMPRESS
+   bool       btree_compress;
+#endif
    uint32_t   max_element_bytes;
    uint32_t   scrub_count;
+   uint32_t   lock_partitions;
+   bool       hash_tags;
+   uint32_t   lru_warm_percent;
+   uint32_t   lru_headroom_percent;
+   uint32_t   slab_automove;
 #ifdef ENABLE_PERSISTENCE
    bool       use_persistence;
    bool       async_logging;
@@ -153,7 +164,9 @@ struct default_engine {
 
    /**
     * The cache layer (item_* and assoc_*) is currently protected by
-    * this single mutex
+    * this single mutex. In lock partitioning mode, the hash chains and
+    * the refcounts of linked items are also protected by the bucket locks
+    * so that key-value gets can be done without this mutex. See assoc.h.
     */
    pthread_mutex_t cache_lock;
 
@@ -41,12 +41,6 @@ static SERVER_STAT_API      *svstat=NULL; // server stat api
 static SERVER_CORE_API      *svcore=NULL; // server core api
 static EXTENSION_LOGGER_DESCRIPTOR *logger;
 
-/* We only reposition items in the LRU queue if they haven't been repositioned
- * in this many seconds. That saves us from churning on frequently-accessed
- * items.
- */
-#define ITEM_UPDATE_INTERVAL 60
-
 /* How long an object can reasonably be assumed to be locked before
  * harvesting it on a low memory condition.
  */
@@ -67,6 +61,28 @@ static pthread_t       coll_del_tid; /* thread id */
 static bool            coll_del_sleep = false;
 static volatile bool   coll_del_thread_running = false;
 
+/* LRU maintainer */
+#define LRU_MAINTAINER_MIN_SLEEP 1000   /* 1 ms */
+#define LRU_MAINTAINER_MAX_SLEEP 50000  /* 50 ms */
+#define LRU_MAINTAINER_BATCH     100    /* max items freed at a cache lock hold */
+static pthread_mutex_t lru_mnt_lock;
+static pthread_cond_t  lru_mnt_cond;
+static pthread_t       lru_mnt_tid; /* thread id */
+static bool            lru_mnt_sleep = false;
+static volatile bool   lru_mnt_thread_running = false;
+
+/* slab automove */
+#define SLAB_AUTOMOVE_WINDOW  10 /* seconds of a decision window */
+#define SLAB_AUTOMOVE_WINDOWS 3  /* # of consecutive windows to decide */
+#define SLAB_REASSIGN_TRIES   4  /* # of pages tried at a reassignment */
+static struct {
+    rel_time_t   window_start;
+    unsigned int evicted[MAX_SLAB_CLASSES];  /* evicted count at window start */
+    unsigned int idle_windows[MAX_SLAB_CLASSES]; /* windows without evictions */
+    unsigned int dst_id;      /* class having the most evictions */
+    unsigned int dst_windows; /* # of windows the dst_id has kept the most */
+} automove;
+
 /*
  * Static functions
  */
@@ -80,11 +96,13 @@ static inline void UNLOCK_CACHE(void)
     pthread_mutex_unlock(&engine->cache_lock);
 }
 
+/* the maximum number of promotions in an LRU tail scan */
+#define LRU_PROMOTE_LIMIT 20
+
 #define ITEM_REFCOUNT_FULL 65535
 #define ITEM_REFCOUNT_MOVE 32768
 
-//static inline void ITEM_REFCOUNT_INCR(hash_item *it)
-void ITEM_REFCOUNT_INCR(hash_item *it)
+static inline void do_item_refcount_incr(hash_item *it)
 {
     it->refcount++;
     if (it->refcount == ITEM_REFCOUNT_FULL) {
@@ -94,8 +112,7 @@ void ITEM_REFCOUNT_INCR(hash_item *it)
     }
 }
 
-//static inline void ITEM_REFCOUNT_DECR(hash_item *it)
-void ITEM_REFCOUNT_DECR(hash_item *it)
+static inline void do_item_refcount_decr(hash_item *it)
 {
     it->refcount--;
     if (it->refcount == 0 && it->refchunk > 0) {
@@ -104,6 +121,61 @@ void ITEM_REFCOUNT_DECR(hash_item *it)
     }
 }
 
+/* The refcount of a linked item can be changed by the readers
+ * holding only its bucket lock in lock partitioning mode.
+ * So, change it while holding the bucket lock, too.
+ */
+//static inline void ITEM_REFCOUNT_INCR(hash_item *it)
+void ITEM_REFCOUNT_INCR(hash_item *it)
+{
+    if (it->iflag & ITEM_LINKED) {
+        assoc_bucket_lock(it->khash);
+        do_item_refcount_incr(it);
+        assoc_bucket_unlock(it->khash);
+    } else {
+        do_item_refcount_incr(it);
+    }
+}
+
+//static inline void ITEM_REFCOUNT_DECR(hash_item *it)
+void ITEM_REFCOUNT_DECR(hash_item *it)
+{
+    if (it->iflag & ITEM_LINKED) {
+        assoc_bucket_lock(it->khash);
+        do_item_refcount_decr(it);
+        assoc_bucket_unlock(it->khash);
+    } else {
+        do_item_refcount_decr(it);
+    }
+}
+
+/* item active level: an item becomes active when it's read again
+ * after the first read, so that the items read only once are not promoted.
+ * The level is raised by the readers that may not hold the cache lock.
+ * A lost update only delays the promotion of the item.
+ */
+#define ITEM_ACTIVE_NONE    0
+#define ITEM_ACTIVE_FETCHED 1
+#define ITEM_ACTIVE_ACTIVE  2
+
+static inline bool ITEM_IS_ACTIVE(hash_item *it)
+{
+    return __atomic_load_n(&it->active, __ATOMIC_RELAXED) >= ITEM_ACTIVE_ACTIVE;
+}
+
+static inline void ITEM_MARK_ACCESSED(hash_item *it)
+{
+    uint8_t active = __atomic_load_n(&it->active, __ATOMIC_RELAXED);
+    if (active < ITEM_ACTIVE_ACTIVE) {
+        __atomic_store_n(&it->active, active + 1, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void ITEM_CLEAR_ACTIVE(hash_item *it)
+{
+    __atomic_store_n(&it->active, ITEM_ACTIVE_FETCHED, __ATOMIC_RELAXED);
+}
+
 static inline uint32_t _hash_item_size(const hash_item *item)
 {
     uint32_t ntotal = sizeof(hash_item);
@@ -391,12 +463,12 @@ static uint64_t get_cas_id(void)
 static void push_coll_del_queue(hash_item *it)
 {
     /* push the item into the tail of delete queue */
-    it->next = NULL;
+    ITEM_SET_NEXT(it, NULL);
     pthread_mutex_lock(&coll_del_lock);
     if (coll_del_queue.tail == NULL) {
         coll_del_queue.head = it;
     } else {
-        coll_del_queue.tail->next = it;
+        ITEM_SET_NEXT(coll_del_queue.tail, it);
     }
     coll_del_queue.tail = it;
     coll_del_queue.size++;
@@ -414,7 +486,7 @@ static hash_item *pop_coll_del_queue(void)
     pthread_mutex_lock(&coll_del_lock);
     if (coll_del_queue.head != NULL) {
         it = coll_del_queue.head;
-        coll_del_queue.head = it->next;
+        coll_del_queue.head = ITEM_NEXT(it);
         if (coll_del_queue.head == NULL) {
             coll_del_queue.tail = NULL;
         }
@@ -479,14 +551,31 @@ static void item_link_q(hash_item *it)
 #endif
     assert(it != *head);
     assert((*head && *tail) || (*head == 0 && *tail == 0));
-    it->prev = 0;
-    it->next = *head;
-    if (it->next) it->next->prev = it;
+    it->iflag &= ~ITEM_WARM;
+    ITEM_SET_PREV(it, NULL);
+    ITEM_SET_NEXT(it, *head);
+    if (*head) ITEM_SET_PREV(*head, it);
     *head = it;
     if (*tail == 0) *tail = it;
     return;
 }
 
+static void item_link_warm_q(hash_item *it, const unsigned int lruid)
+{
+    hash_item **head = &itemsp->warm_heads[lruid];
+    hash_item **tail = &itemsp->warm_tails[lruid];
+
+    assert(it != *head);
+    assert((*head && *tail) || (*head == 0 && *tail == 0));
+    itemsp->warm_sizes[lruid]++;
+    it->iflag |= ITEM_WARM;
+    ITEM_SET_PREV(it, NULL);
+    ITEM_SET_NEXT(it, *head);
+    if (*head) ITEM_SET_PREV(*head, it);
+    *head = it;
+    if (*tail == 0) *tail = it;
+}
+
 static void item_unlink_q(hash_item *it)
 {
     hash_item **head, **tail;
@@ -500,48 +589,55 @@ static void item_unlink_q(hash_item *it)
     }
 #endif
 
-    if (it->prev == it && it->next == it) { /* special meaning: unlinked from LRU */
+    if (ITEM_PREV(it) == it && ITEM_NEXT(it) == it) { /* special meaning: unlinked from LRU */
         return; /* Already unlinked from LRU list */
     }
 
+    if ((it->iflag & ITEM_WARM) != 0) {
+        head = &itemsp->warm_heads[clsid];
+        tail = &itemsp->warm_tails[clsid];
+        itemsp->warm_sizes[clsid]--;
+    }
 #ifdef ENABLE_STICKY_ITEM
-    if (IS_STICKY_EXPTIME(it->exptime)) {
+    else if (IS_STICKY_EXPTIME(it->exptime)) {
         head = &itemsp->sticky_heads[clsid];
         tail = &itemsp->sticky_tails[clsid];
         itemsp->sticky_sizes[clsid]--;
         /* move curMK pointer in LRU */
         if (itemsp->sticky_curMK[clsid] == it)
-            itemsp->sticky_curMK[clsid] = it->prev;
-    } else {
+            itemsp->sticky_curMK[clsid] = ITEM_PREV(it);
+    }
 #endif
+    else {
         head = &itemsp->heads[clsid];
         tail = &itemsp->tails[clsid];
         itemsp->sizes[clsid]--;
         /* move lowMK, curMK pointer in LRU */
         if (itemsp->lowMK[clsid] == it)
-            itemsp->lowMK[clsid] = it->prev;
+            itemsp->lowMK[clsid] = ITEM_PREV(it);
         if (itemsp->curMK[clsid] == it) {
-            itemsp->curMK[clsid] = it->prev;
+            itemsp->curMK[clsid] = ITEM_PREV(it);
             if (itemsp->curMK[clsid] == NULL)
                 itemsp->curMK[clsid] = itemsp->lowMK[clsid];
         }
-#ifdef ENABLE_STICKY_ITEM
     }
-#endif
+    hash_item *next = ITEM_NEXT(it);
+    hash_item *prev = ITEM_PREV(it);
     if (*head == it) {
-        assert(it->prev == 0);
-        *head = it->next;
+        assert(prev == 0);
+        *head = next;
     }
     if (*tail == it) {
-        assert(it->next == 0);
-        *tail = it->prev;
+        assert(next == 0);
+        *tail = prev;
     }
-    assert(it->next != it);
-    assert(it->prev != it);
+    assert(next != it);
+    assert(prev != it);
 
-    if (it->next) it->next->prev = it->prev;
-    if (it->prev) it->prev->next = it->next;
-    it->prev = it->next = it; /* special meaning: unlinked from LRU */
+    if (next) ITEM_SET_PREV(next, prev);
+    if (prev) ITEM_SET_NEXT(prev, next);
+    ITEM_SET_PREV(it, it); /* special meaning: unlinked from LRU */
+    ITEM_SET_NEXT(it, it);
     return;
 }
 
@@ -580,12 +676,19 @@ static hash_item *do_item_reclaim(hash_item *it,
 #ifdef USE_SINGLE_LRU_LIST
 #else
     if (lruid != LRU_CLSID_FOR_SMALL) {
-        it->refcount = 1;
-        slabs_adjust_mem_requested(it->slabs_clsid, ITEM_ntotal(it), ntotal);
+        /* pin the item not to be freed while unlinking it */
+        ITEM_REFCOUNT_INCR(it);
         do_item_unlink(it, ITEM_UNLINK_INVALID);
+        ITEM_REFCOUNT_DECR(it);
+        if (it->refcount != 0) {
+            /* A lock-partitioned reader got the item before unlinking it.
+             * The item will be freed when the reader releases it.
+             */
+            return slabs_alloc(ntotal, clsid);
+        }
+        slabs_adjust_mem_requested(it->slabs_clsid, ITEM_ntotal(it), ntotal);
         /* Initialize the item block: */
         it->slabs_clsid = 0;
-        it->refcount = 0;
         return it;
     }
     /* collection item or small-sized kv item */
@@ -630,8 +733,10 @@ static void do_item_repair(hash_item *it, const unsigned int lruid)
 {
     /* increment # of repaired */
     itemsp->itemstats[lruid].tailrepairs++;
+    assoc_bucket_lock(it->khash);
     it->refcount = 0;
     it->refchunk = 0;
+    assoc_bucket_unlock(it->khash);
 
     /* unlink the item */
     if (IS_COLL_ITEM(it)) {
@@ -640,6 +745,97 @@ static void do_item_repair(hash_item *it, const unsigned int lruid)
     do_item_unlink(it, ITEM_UNLINK_EVICT);
 }
 
+/* Unlink the referenced item from LRU list.
+ * It will be linked to LRU list when the refcount become 0.
+ * See do_item_release(). The refcount is checked again with the bucket lock
+ * since the lock-partitioned release can decrease it without the cache lock.
+ */
+static void do_item_unlink_q_referenced(hash_item *it)
+{
+    assoc_bucket_lock(it->khash);
+    if (it->refcount != 0) {
+        item_unlink_q(it);
+    }
+    assoc_bucket_unlock(it->khash);
+}
+
+/* Keep the warm segment within lru_warm_percent of the LRU list.
+ * The active items at the warm tail get another chance in the warm segment
+ * and the others are moved to the cold head. The invalid ones are unlinked.
+ */
+static void do_item_lru_balance(const unsigned int lruid, rel_time_t current_time)
+{
+    hash_item *it;
+    int tries = 5;
+
+    while ((it = itemsp->warm_tails[lruid]) != NULL) {
+        uint64_t total = (uint64_t)itemsp->sizes[lruid] + itemsp->warm_sizes[lruid];
+        if ((uint64_t)itemsp->warm_sizes[lruid] * 100 <= total * config->lru_warm_percent) {
+            break;
+        }
+        if (!do_item_isvalid(it, current_time)) {
+            do_item_invalidate(it, lruid, false);
+        } else if (ITEM_IS_ACTIVE(it)) {
+            item_unlink_q(it);
+            ITEM_CLEAR_ACTIVE(it);
+            it->time = current_time;
+            item_link_warm_q(it, lruid);
+        } else {
+            item_unlink_q(it);
+            it->time = current_time;
+            item_link_q(it);
+            itemsp->itemstats[lruid].demoted++;
+        }
+        if ((--tries) == 0) break;
+    }
+}
+
+/* Move the active item found at the cold tail to the warm head.
+ * It's the batched LRU bump of the items marked active by the readers.
+ */
+static void do_item_lru_promote(hash_item *it, const unsigned int lruid,
+                                rel_time_t current_time)
+{
+    item_unlink_q(it);
+    ITEM_CLEAR_ACTIVE(it);
+    it->time = current_time;
+    item_link_warm_q(it, lruid);
+    itemsp->itemstats[lruid].promoted++;
+    CLOG_ITEM_UPDATE(it);
+
+    do_item_lru_balance(lruid, current_time);
+}
+
+/* Reclaim the expired items from the warm tail.
+ * The warm items are not covered by the lowMK/curMK marks of the cold
+ * segment, so the expired ones would stay until they are demoted.
+ * If ntotal is given, the first reclaimed space is returned for it.
+ */
+static hash_item *do_item_reclaim_warm(const unsigned int lruid, const size_t ntotal,
+                                       const unsigned int clsid, int tries,
+                                       rel_time_t current_time, uint32_t *nfreed)
+{
+    hash_item *search = itemsp->warm_tails[lruid];
+    hash_item *previt;
+    hash_item *it = NULL;
+
+    while (search != NULL) {
+        previt = ITEM_PREV(search);
+        if (search->refcount == 0 && !do_item_isvalid(search, current_time)) {
+            if (ntotal > 0) {
+                it = do_item_reclaim(search, ntotal, clsid, lruid);
+                if (it != NULL) break; /* allocated */
+            } else {
+                do_item_invalidate(search, lruid, true);
+                if (nfreed != NULL) (*nfreed)++;
+            }
+        }
+        search = previt;
+        if ((--tries) == 0) break;
+    }
+    return it;
+}
+
 static uint32_t do_item_regain(const uint32_t count, rel_time_t current_time,
                                const void *cookie)
 {
@@ -647,6 +843,7 @@ static uint32_t do_item_regain(const uint32_t count, rel_time_t current_time,
     hash_item *search;
     uint32_t tries = count;
     uint32_t nregains = 0;
+    int npromotes = 0;
 
 #ifdef USE_SINGLE_LRU_LIST
     unsigned int clsid = 1;
@@ -657,20 +854,23 @@ static uint32_t do_item_regain(const uint32_t count, rel_time_t current_time,
     search = itemsp->tails[clsid];
     while (search != NULL) {
         assert(search->nkey > 0);
-        previt = search->prev;
+        previt = ITEM_PREV(search);
         if (search->refcount == 0) {
             if (do_item_isvalid(search, current_time)) {
+                if (ITEM_IS_ACTIVE(search) && npromotes++ < LRU_PROMOTE_LIMIT) {
+                    do_item_lru_promote(search, clsid, current_time);
+                    search = previt;
+                    if ((--tries) == 0) break;
+                    continue;
+                }
                 do_item_evict(search, clsid, current_time, cookie);
             } else {
                 do_item_invalidate(search, clsid, true);
             }
             nregains += 1;
         } else { /* search->refcount > 0 */
-            /* We just unlink the item from LRU list.
-             * It will be linked to LRU list when the refcount become 0.
-             * See do_item_release().
-             */
-            item_unlink_q(search);
+            /* We just unlink the item from LRU list. */
+            do_item_unlink_q_referenced(search);
         }
         search = previt;
         if ((--tries) == 0) break;
@@ -678,6 +878,18 @@ static uint32_t do_item_regain(const uint32_t count, rel_time_t current_time,
     return nregains;
 }
 
+/* The collection elements(clsid == LRU_CLSID_FOR_SMALL) are allocated
+ * through the per-thread magazines of the small memory manager.
+ */
+static inline void *do_item_slabs_alloc(const size_t ntotal, const unsigned int id,
+                                        const unsigned int clsid)
+{
+    if (clsid == LRU_CLSID_FOR_SMALL) {
+        return slabs_elem_alloc(ntotal, id);
+    }
+    return slabs_alloc(ntotal, id);
+}
+
 //static void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
 //                               const void *cookie)
 void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
@@ -696,7 +908,7 @@ void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
     unsigned int lruid = 1;
     unsigned int clsid_based_on_ntotal = 1;
 
-    if ((it = slabs_alloc(ntotal, clsid_based_on_ntotal)) != NULL) {
+    if ((it = do_item_slabs_alloc(ntotal, clsid_based_on_ntotal, clsid)) != NULL) {
         it->slabs_clsid = 0;
         return (void*)it;
     }
@@ -731,7 +943,7 @@ void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
         tries = 10;
         while (itemsp->sticky_curMK[lruid] != NULL) {
             search = itemsp->sticky_curMK[lruid];
-            itemsp->sticky_curMK[lruid] = search->prev;
+            itemsp->sticky_curMK[lruid] = ITEM_PREV(search);
             if (search->refcount == 0 && !do_item_isvalid(search, current_time)) {
                 it = do_item_reclaim(search, ntotal, clsid_based_on_ntotal, lruid);
                 if (it != NULL) break; /* allocated */
@@ -758,15 +970,15 @@ void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
         search = itemsp->lowMK[lruid];
         while (search != NULL && search != itemsp->curMK[lruid]) {
             if (search->refcount == 0 && !do_item_isvalid(search, current_time)) {
-                previt = search->prev;
+                previt = ITEM_PREV(search);
                 it = do_item_reclaim(search, ntotal, clsid_based_on_ntotal, lruid);
                 if (it != NULL) break; /* allocated */
                 search = previt;
             } else {
                 if (search->exptime == 0 && search == itemsp->lowMK[lruid]) {
-                    itemsp->lowMK[lruid] = search->prev; /* move lowMK position upward */
+                    itemsp->lowMK[lruid] = ITEM_PREV(search); /* move lowMK position upward */
                 }
-                search = search->prev;
+                search = ITEM_PREV(search);
             }
             if ((--tries) == 0) break;
         }
@@ -783,7 +995,7 @@ void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
         tries += 20;
         while (itemsp->curMK[lruid] != NULL) {
             search = itemsp->curMK[lruid];
-            itemsp->curMK[lruid] = search->prev;
+            itemsp->curMK[lruid] = ITEM_PREV(search);
             if (search->refcount == 0 && !do_item_isvalid(search, current_time)) {
                 it = do_item_reclaim(search, ntotal, clsid_based_on_ntotal, lruid);
                 if (it != NULL) break; /* allocated */
@@ -805,7 +1017,12 @@ void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
         }
     }
 
-    it = slabs_alloc(ntotal, clsid_based_on_ntotal);
+    it = do_item_slabs_alloc(ntotal, clsid_based_on_ntotal, clsid);
+    if (it == NULL && itemsp->warm_tails[lruid] != NULL) {
+        /* step 3) reclaim the expired items of the warm segment */
+        it = do_item_reclaim_warm(lruid, ntotal, clsid_based_on_ntotal, 20,
+                                  current_time, NULL);
+    }
     if (it == NULL) {
         /*
         ** Could not find an expired item at the tail, and memory allocation
@@ -825,22 +1042,30 @@ void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
          * search up from tail an item with refcount==0 and unlink it; give up after 50
          * tries
          */
+        int npromotes = 0;
         tries  = 200;
         search = itemsp->tails[lruid];
         while (search != NULL) {
             assert(search->nkey > 0);
-            previt = search->prev;
+            previt = ITEM_PREV(search);
             if (search->refcount == 0) {
                 if (do_item_isvalid(search, current_time)) {
+                    if (ITEM_IS_ACTIVE(search) && npromotes++ < LRU_PROMOTE_LIMIT) {
+                        /* give the recently accessed item a chance */
+                        do_item_lru_promote(search, lruid, current_time);
+                        search = previt;
+                        if ((--tries) == 0) break;
+                        continue;
+                    }
                     do_item_evict(search, lruid, current_time, cookie);
-                    it = slabs_alloc(ntotal, clsid_based_on_ntotal);
+                    it = do_item_slabs_alloc(ntotal, clsid_based_on_ntotal, clsid);
                 } else {
                     it = do_item_reclaim(search, ntotal, clsid_based_on_ntotal, lruid);
                 }
                 if (it != NULL) break; /* allocated */
             } else { /* search->refcount > 0 */
                 /* just unlink the item from LRU list. */
-                item_unlink_q(search);
+                do_item_unlink_q_referenced(search);
             }
             search = previt;
             if ((--tries) == 0) break;
@@ -882,13 +1107,13 @@ void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
                 assert(search->nkey > 0);
                 if (search->refcount != 0 &&
                     search->time + TAIL_REPAIR_TIME < current_time) {
-                    previt = search->prev;
+                    previt = ITEM_PREV(search);
                     do_item_repair(search, lruid);
-                    it = slabs_alloc(ntotal, clsid_based_on_ntotal);
+                    it = do_item_slabs_alloc(ntotal, clsid_based_on_ntotal, clsid);
                     if (it != NULL) break; /* allocated */
                     search = previt;
                 } else {
-                    search = search->prev;
+                    search = ITEM_PREV(search);
                 }
                 if ((--tries) == 0) break;
             }
@@ -904,10 +1129,11 @@ void *do_item_mem_alloc(const size_t ntotal, const unsigned int clsid,
 //static void do_item_mem_free(void *item, size_t ntotal)
 void do_item_mem_free(void *item, size_t ntotal)
 {
+    /* only the collection elements are freed here */
     hash_item *it = (hash_item *)item;
     unsigned int clsid = it->slabs_clsid;
     it->slabs_clsid = 0; /* to notify the item memory is freed */
-    slabs_free(it, ntotal, clsid);
+    slabs_elem_free(it, ntotal, clsid);
 }
 
 /*@null@*/
@@ -943,12 +1169,14 @@ hash_item *do_item_alloc(const void *key, const uint32_t nkey,
     it->slabs_clsid = id;
     assert(it != itemsp->heads[it->slabs_clsid]);
 
-    it->next = it->prev = it; /* special meaning: unlinked from LRU */
+    ITEM_SET_NEXT(it, it); /* special meaning: unlinked from LRU */
+    ITEM_SET_PREV(it, it);
     it->h_next = 0;
     it->refcount = 0;
     it->refchunk = 0;
     DEBUG_REFCNT(it, '*');
     it->iflag = config->use_cas ? ITEM_WITH_CAS : 0;
+    it->active = ITEM_ACTIVE_NONE;
     it->nkey = nkey;
     it->nbytes = nbytes;
     it->flags = flags;
@@ -978,7 +1206,9 @@ void do_item_free(hash_item *it)
 
     /* so slab size changer can tell later if item is already free or not */
     DEBUG_REFCNT(it, 'F');
-    do_item_mem_free(it, ITEM_ntotal(it));
+    unsigned int clsid = it->slabs_clsid;
+    it->slabs_clsid = 0; /* to notify the item memory is freed */
+    slabs_free(it, ITEM_ntotal(it), clsid);
 }
 
 //static ENGINE_ERROR_CODE do_item_link(hash_item *it)
@@ -1034,9 +1264,8 @@ void do_item_unlink(hash_item *it, enum item_unlink_cause cause)
         /* unlink the item from LUR list */
         item_unlink_q(it);
 
-        /* unlink the item from hash table */
+        /* unlink the item from hash table (ITEM_LINKED is cleared) */
         assoc_delete(key, it->nkey, it->khash);
-        it->iflag &= ~ITEM_LINKED;
 
         /* unlink the item from prefix info */
         size_t stotal = ITEM_stotal(it);
@@ -1084,21 +1313,21 @@ void do_item_replace(hash_item *old_it, hash_item *new_it)
     new_it->time = svcore->get_current_time();
     new_it->khash = old_it->khash;
 
-    /* replace the item from hash table */
-    assoc_replace(old_it, new_it);
-    old_it->iflag &= ~ITEM_LINKED;
-
-    /* update prefix information */
-    prefix_t *pt = old_it->pfxptr;
+    /* update prefix information before new_it becomes visible to
+     * do_item_fast_get(), which validates the prefix of the item.
+     */
+    assert(old_it->pfxptr != NULL);
     new_it->pfxptr = old_it->pfxptr;
-    old_it->pfxptr = NULL;
-    assert(pt != NULL);
 
     /* if old_it->iflag has ITEM_INTERNAL */
     if (old_it->iflag & ITEM_INTERNAL) {
         new_it->iflag |= ITEM_INTERNAL;
     }
 
+    /* replace the item from hash table (ITEM_LINKED of old_it is cleared) */
+    assoc_replace(old_it, new_it);
+    old_it->pfxptr = NULL;
+
     /* update prefix info and stats */
     do_item_stat_replace(old_it, new_it);
 
@@ -1129,22 +1358,18 @@ void do_item_update(hash_item *it, bool force)
     MEMCACHED_ITEM_UPDATE(item_get_key(it), it->nkey, it->nbytes);
 
     if ((it->iflag & ITEM_LINKED) != 0) {
-        rel_time_t current_time = svcore->get_current_time();
         if (force) {
             /* The exceptional case when exptime is changed.
              * See do_item_setattr() for specific explanation.
              */
             item_unlink_q(it);
-            it->time = current_time;
-            item_link_q(it);
-        } else if (it->time < (current_time - ITEM_UPDATE_INTERVAL)) {
-            /* The normal case when the given item is read.
-             */
-            item_unlink_q(it);
-            it->time = current_time;
+            it->time = svcore->get_current_time();
             item_link_q(it);
-            CLOG_ITEM_UPDATE(it);
         }
+        /* The normal case when the given item is read.
+         * It's moved in LRU list when it reaches the cold tail.
+         */
+        ITEM_MARK_ACCESSED(it);
     }
 }
 
@@ -1186,6 +1411,63 @@ hash_item *do_item_get(const char *key, const uint32_t nkey, bool do_update)
     return it;
 }
 
+/*
+ * Item get/release functions for lock partitioning mode.
+ * They hold only the bucket lock of the item instead of the cache lock,
+ * and return false if the caller must retry them with the cache lock.
+ * The get walks the hash chain optimistically, so a miss takes no lock.
+ */
+bool do_item_fast_get(const char *key, const uint32_t nkey, hash_item **item)
+{
+    hash_item *it;
+    uint32_t hash;
+    rel_time_t current_time;
+
+    if (config->verbose > 2) {
+        return false; /* the key is logged in do_item_get() */
+    }
+    hash = GEN_ITEM_KEY_HASH(key, nkey);
+    current_time = svcore->get_current_time();
+
+    /* The bucket lock is held only if the item is found. */
+    it = assoc_find_and_lock(key, nkey, hash);
+    if (it != NULL) {
+        if (!do_item_isvalid(it, current_time)) {
+            /* The invalid item must be unlinked with the cache lock. */
+            assoc_bucket_unlock(hash);
+            return false;
+        }
+        do_item_refcount_incr(it);
+        DEBUG_REFCNT(it, '+');
+        /* mark it accessed instead of repositioning it in LRU list */
+        ITEM_MARK_ACCESSED(it);
+        assoc_bucket_unlock(hash);
+    }
+    *item = it;
+    return true;
+}
+
+bool do_item_fast_release(hash_item *it)
+{
+    bool released = false;
+
+    assoc_bucket_lock(it->khash);
+    if ((it->iflag & ITEM_LINKED) != 0) {
+        /* The last reference of the item unlinked from LRU list
+         * must be released with the cache lock to re-link it.
+         */
+        if (it->refcount > 1 || it->refchunk > 0 ||
+            ITEM_PREV(it) != it || ITEM_NEXT(it) != it) {
+            MEMCACHED_ITEM_REMOVE(item_get_key(it), it->nkey, it->nbytes);
+            do_item_refcount_decr(it);
+            DEBUG_REFCNT(it, '-');
+            released = true;
+        }
+    }
+    assoc_bucket_unlock(it->khash);
+    return released;
+}
+
 //static void do_item_release(hash_item *it)
 void do_item_release(hash_item *it)
 {
@@ -1199,7 +1481,7 @@ void do_item_release(hash_item *it)
         if ((it->iflag & ITEM_LINKED) == 0) {
             do_item_free(it);
         }
-        else if (it->prev == it && it->next == it) {
+        else if (ITEM_PREV(it) == it && ITEM_NEXT(it) == it) {
             /* re-link the item into the LRU list */
             rel_time_t current_time = svcore->get_current_time();
             if (do_item_isvalid(it, current_time)) {
@@ -1245,10 +1527,6 @@ static void *collection_delete_thread(void *arg)
     hash_item      *it;
     struct timespec sleep_time = {0, 0};
     uint32_t        delete_count;
-    int             current_ssl;
-    uint32_t        evict_count;
-    uint32_t        bg_evict_count = 0;
-    bool            bg_evict_start = false;
 
     coll_del_thread_running = true;
 
@@ -1272,25 +1550,268 @@ static void *collection_delete_thread(void *arg)
             continue;
         }
 
-        evict_count = 0;
-        if (config->evict_to_free) {
-            current_ssl = slabs_space_shortage_level();
-            if (current_ssl >= 10) {
-                LOCK_CACHE();
-                if (config->evict_to_free) {
-                    rel_time_t current_time = svcore->get_current_time();
-                    evict_count = do_item_regain(current_ssl, current_time, NULL);
+        coll_del_thread_sleep();
+    }
+
+    coll_del_thread_running = false;
+    return NULL;
+}
+
+void coll_del_thread_wakeup(void)
+{
+    pthread_mutex_lock(&coll_del_lock);
+    if (coll_del_sleep == true) {
+        /* wake up collection delete thead */
+        pthread_cond_signal(&coll_del_cond);
+    }
+    pthread_mutex_unlock(&coll_del_lock);
+}
+
+/* Free the items of the LRU list to keep the free chunk headroom of its
+ * slab class. The invalid items are reclaimed from curMK position and
+ * the warm tail first, and then the items are evicted from the cold tail.
+ */
+static uint32_t do_item_lru_maintain(const unsigned int lruid, const uint32_t count,
+                                     rel_time_t current_time)
+{
+    hash_item *search;
+    hash_item *previt;
+    uint32_t nfreed = 0;
+    int npromotes = 0;
+    int tries;
+
+    if (itemsp->curMK[lruid] != NULL) {
+        tries = 20;
+        while (itemsp->curMK[lruid] != NULL) {
+            search = itemsp->curMK[lruid];
+            itemsp->curMK[lruid] = ITEM_PREV(search);
+            if (search->refcount == 0 && !do_item_isvalid(search, current_time)) {
+                do_item_invalidate(search, lruid, true);
+                if ((++nfreed) >= count) break;
+            }
+            if ((--tries) == 0) break;
+        }
+        if (itemsp->curMK[lruid] == NULL) {
+            itemsp->curMK[lruid] = itemsp->lowMK[lruid];
+        }
+    }
+    if (nfreed < count && itemsp->warm_tails[lruid] != NULL) {
+        (void)do_item_reclaim_warm(lruid, 0, 0, 20, current_time, &nfreed);
+    }
+
+    tries = count * 2;
+    search = itemsp->tails[lruid];
+    while (search != NULL && nfreed < count) {
+        previt = ITEM_PREV(search);
+        if (search->refcount == 0) {
+            if (!do_item_isvalid(search, current_time)) {
+                do_item_invalidate(search, lruid, true);
+                nfreed++;
+            } else if (ITEM_IS_ACTIVE(search) && npromotes++ < LRU_PROMOTE_LIMIT) {
+                do_item_lru_promote(search, lruid, current_time);
+            } else {
+                do_item_evict(search, lruid, current_time, NULL);
+                nfreed++;
+            }
+        } else { /* search->refcount > 0 */
+            do_item_unlink_q_referenced(search);
+        }
+        search = previt;
+        if ((--tries) == 0) break;
+    }
+    return nfreed;
+}
+
+/* Check if any chunk of the slab page can't be freed right now.
+ * The slab classes hold only the kv items. (See MAX_SM_VALUE_LEN)
+ */
+static bool do_item_page_is_busy(char *page, unsigned int size, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        hash_item *it = (hash_item *)(page + (i * size));
+        if (it->slabs_clsid == 0) {
+            continue; /* free chunk */
+        }
+        if ((it->iflag & ITEM_LINKED) == 0 || it->refcount > 0 || IS_COLL_ITEM(it)) {
+            return true;
+        }
+#ifdef ENABLE_STICKY_ITEM
+        if (IS_STICKY_EXPTIME(it->exptime)) {
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+static uint32_t do_item_page_evict(char *page, unsigned int size, unsigned int count)
+{
+    uint32_t nevicted = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        hash_item *it = (hash_item *)(page + (i * size));
+        if (it->slabs_clsid != 0 && (it->iflag & ITEM_LINKED) != 0) {
+            /* The evictions are not counted in the LRU stats
+             * not to be regarded as the memory pressure of the class.
+             */
+            do_item_unlink(it, ITEM_UNLINK_EVICT);
+            nevicted++;
+        }
+    }
+    return nevicted;
+}
+
+/* Reassign a slab page of the src class to the dst class.
+ * The items in the page are evicted. If all the tried pages have
+ * the chunks being used, it fails with ENGINE_EWOULDBLOCK.
+ */
+ENGINE_ERROR_CODE do_item_slabs_reassign(unsigned int src, unsigned int dst)
+{
+    ENGINE_ERROR_CODE ret;
+    void *page;
+    unsigned int size, count;
+    uint32_t nevicted = 0;
+
+    for (int tries = 0; tries < SLAB_REASSIGN_TRIES; tries++) {
+        ret = slabs_reassign_pick(src, dst, &page, &size, &count);
+        if (ret != ENGINE_SUCCESS) {
+            return ret;
+        }
+        if (do_item_page_is_busy(page, size, count)) {
+            continue;
+        }
+        nevicted = do_item_page_evict(page, size, count);
+        /* The item can be referenced by the lock partitioning reader
+         * after the busy check. Then, it is freed on its release.
+         */
+        for (unsigned int i = 0; i < count; i++) {
+            if (((hash_item *)((char *)page + (i * size)))->slabs_clsid != 0) {
+                page = NULL;
+                break;
+            }
+        }
+        slabs_reassign_done(src, dst, page, nevicted);
+        return (page != NULL ? ENGINE_SUCCESS : ENGINE_EWOULDBLOCK);
+    }
+    slabs_reassign_done(src, dst, NULL, 0);
+    return ENGINE_EWOULDBLOCK;
+}
+
+/* Move a slab page to the class evicting the most items from a class
+ * having no evictions. slab_automove 1 decides it when the state lasts
+ * for SLAB_AUTOMOVE_WINDOWS windows of SLAB_AUTOMOVE_WINDOW seconds.
+ * slab_automove 2 decides it every second.
+ */
+static void do_item_slabs_automove(rel_time_t current_time)
+{
+    unsigned int window  = (config->slab_automove == 1 ? SLAB_AUTOMOVE_WINDOW : 1);
+    unsigned int nwindow = (config->slab_automove == 1 ? SLAB_AUTOMOVE_WINDOWS : 1);
+    unsigned int src = 0, dst = 0;
+    unsigned int max_evicted = 0;
+    unsigned int max_spare = 0;
+
+    if (current_time - automove.window_start < window) {
+        return;
+    }
+    automove.window_start = current_time;
+
+    for (int id = POWER_SMALLEST; id <= POWER_LARGEST; id++) {
+        unsigned int evicted = itemsp->itemstats[id].evicted;
+        if (evicted >= automove.evicted[id]) {
+            evicted -= automove.evicted[id];
+        } /* else: the stats were reset */
+        automove.evicted[id] = itemsp->itemstats[id].evicted;
+
+        if (evicted > 0) {
+            automove.idle_windows[id] = 0;
+            if (evicted > max_evicted) {
+                max_evicted = evicted;
+                dst = id;
+            }
+        } else if (itemsp->tails[id] != NULL || itemsp->warm_tails[id] != NULL) {
+            if (automove.idle_windows[id] < nwindow) {
+                automove.idle_windows[id]++;
+            }
+            if (automove.idle_windows[id] >= nwindow) {
+                unsigned int spare = slabs_spare_pages(id);
+                if (spare > max_spare) {
+                    max_spare = spare;
+                    src = id;
                 }
-                UNLOCK_CACHE();
             }
         }
+    }
+
+    if (dst != 0 && dst == automove.dst_id) {
+        automove.dst_windows++;
+    } else {
+        automove.dst_id = dst;
+        automove.dst_windows = (dst != 0 ? 1 : 0);
+    }
+    if (src != 0 && automove.dst_windows >= nwindow) {
+        if (do_item_slabs_reassign(src, dst) == ENGINE_SUCCESS && config->verbose > 1) {
+            logger->log(EXTENSION_LOG_INFO, NULL, "slab automove: %u => %u\n", src, dst);
+        }
+        automove.dst_windows = 0;
+    }
+}
+
+static void lru_maintainer_sleep(uint32_t sleep_us)
+{
+    struct timeval  tv;
+    struct timespec to;
+    pthread_mutex_lock(&lru_mnt_lock);
+    gettimeofday(&tv, NULL);
+    tv.tv_usec += sleep_us;
+    while (tv.tv_usec >= 1000000) {
+        tv.tv_sec += 1;
+        tv.tv_usec -= 1000000;
+    }
+    to.tv_sec = tv.tv_sec;
+    to.tv_nsec = tv.tv_usec * 1000;
+
+    lru_mnt_sleep = true;
+    pthread_cond_timedwait(&lru_mnt_cond, &lru_mnt_lock, &to);
+    lru_mnt_sleep = false;
+    pthread_mutex_unlock(&lru_mnt_lock);
+}
+
+/* The LRU maintainer frees the item space ahead of the allocations
+ * so that they don't have to evict items in the client's latency path.
+ * (1) small memory: regain the space when the space shortage level is high.
+ * (2) slab classes: keep the free chunks of lru_headroom_percent.
+ * (3) slab automove: move the slab pages to the classes evicting items.
+ */
+static void *lru_maintainer_thread(void *arg)
+{
+    struct default_engine *engine = arg;
+    uint32_t        sleep_us;
+    int             current_ssl;
+    uint32_t        evict_count;
+    uint32_t        bg_evict_count = 0;
+    bool            bg_evict_start = false;
+
+    lru_mnt_thread_running = true;
+
+    while (engine->initialized) {
+        sleep_us = LRU_MAINTAINER_MAX_SLEEP;
+        if (config->evict_to_free == false) {
+            lru_maintainer_sleep(sleep_us);
+            continue;
+        }
+
+        /* (1) small memory */
+        evict_count = 0;
+        current_ssl = slabs_space_shortage_level();
+        if (current_ssl >= (config->lru_headroom_percent > 0 ? 1 : 10)) {
+            LOCK_CACHE();
+            if (config->evict_to_free) {
+                rel_time_t current_time = svcore->get_current_time();
+                evict_count = do_item_regain(current_ssl, current_time, NULL);
+            }
+            UNLOCK_CACHE();
+        }
         if (evict_count > 0) {
             if (bg_evict_start == false) {
-                /*****
-                if (config->verbose > 1) {
-                    logger->log(EXTENSION_LOG_INFO, NULL, "background evict: start\n");
-                }
-                *****/
                 bg_evict_start = true;
                 bg_evict_count = 0;
             }
@@ -1302,34 +1823,51 @@ static void *collection_delete_thread(void *arg)
                 }
                 bg_evict_count = 0;
             }
-            sleep_time.tv_nsec = 10000000 / current_ssl; /* 10000us / ssl */
-            nanosleep(&sleep_time, NULL);
+            sleep_us = 10000 / current_ssl; /* 10000us / ssl */
         } else {
-            if (bg_evict_start == true) {
-                /*****
-                if (config->verbose > 1) {
-                    logger->log(EXTENSION_LOG_INFO, NULL, "background evict: stop count=%u\n",
-                                                           bg_evict_count);
+            bg_evict_start = false;
+        }
+
+#ifndef USE_SINGLE_LRU_LIST
+        /* (2) slab classes */
+        if (config->lru_headroom_percent > 0) {
+            for (int lruid = POWER_SMALLEST; lruid <= POWER_LARGEST; lruid++) {
+                if (itemsp->tails[lruid] == NULL) continue;
+                uint32_t shortage = slabs_headroom_shortage(lruid, config->lru_headroom_percent);
+                if (shortage == 0) continue;
+                if (shortage > LRU_MAINTAINER_BATCH) {
+                    shortage = LRU_MAINTAINER_BATCH;
                 }
-                *****/
-                bg_evict_start = false;
+                LOCK_CACHE();
+                if (do_item_lru_maintain(lruid, shortage, svcore->get_current_time()) > 0 &&
+                    sleep_us > LRU_MAINTAINER_MIN_SLEEP) {
+                    sleep_us = LRU_MAINTAINER_MIN_SLEEP;
+                }
+                UNLOCK_CACHE();
             }
-            coll_del_thread_sleep();
         }
+
+        /* (3) slab automove */
+        if (config->slab_automove > 0) {
+            LOCK_CACHE();
+            do_item_slabs_automove(svcore->get_current_time());
+            UNLOCK_CACHE();
+        }
+#endif
+        lru_maintainer_sleep(sleep_us);
     }
 
-    coll_del_thread_running = false;
+    lru_mnt_thread_running = false;
     return NULL;
 }
 
-void coll_del_thread_wakeup(void)
+static void lru_maintainer_wakeup(void)
 {
-    pthread_mutex_lock(&coll_del_lock);
-    if (coll_del_sleep == true) {
-        /* wake up collection delete thead */
-        pthread_cond_signal(&coll_del_cond);
+    pthread_mutex_lock(&lru_mnt_lock);
+    if (lru_mnt_sleep == true) {
+        pthread_cond_signal(&lru_mnt_cond);
     }
-    pthread_mutex_unlock(&coll_del_lock);
+    pthread_mutex_unlock(&lru_mnt_lock);
 }
 
 /*
@@ -1407,6 +1945,10 @@ int item_base_init(void *engine_ptr)
     svstat = engine->server.stat;
     svcore = engine->server.core;
     logger = engine->server.log->get_logger();
+#ifdef ENABLE_COMPACT_ITEM
+    itemsp->mem_base = engine->slabs.mem_base;
+    assert(itemsp->mem_base != NULL);
+#endif
 
     /* collection delete queue */
     pthread_mutex_init(&coll_del_lock, NULL);
@@ -1421,6 +1963,17 @@ int item_base_init(void *engine_ptr)
         return -1;
     }
 
+    /* LRU maintainer */
+    pthread_mutex_init(&lru_mnt_lock, NULL);
+    pthread_cond_init(&lru_mnt_cond, NULL);
+
+    ret = pthread_create(&lru_mnt_tid, NULL, lru_maintainer_thread, engine);
+    if (ret != 0) {
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "Can't create thread: %s\n", strerror(ret));
+        return -1;
+    }
+
     logger->log(EXTENSION_LOG_INFO, NULL, "ITEM base module initialized.\n");
     return 0;
 }
@@ -1431,5 +1984,9 @@ void item_base_final(void *engine_ptr)
         coll_del_thread_wakeup();
         pthread_join(coll_del_tid, NULL);
     }
+    if (lru_mnt_thread_running) {
+        lru_maintainer_wakeup();
+        pthread_join(lru_mnt_tid, NULL);
+    }
     logger->log(EXTENSION_LOG_INFO, NULL, "ITEM base module destroyed.\n");
 }
@@ -30,6 +30,10 @@
 #define DEFAULT_MAX_MAP_SIZE   50000
 #define DEFAULT_MAX_BTREE_SIZE 50000
 
+/* list position index threshold */
+#define MINIMUM_LIST_INDEX_THRESHOLD 1000
+#define DEFAULT_LIST_INDEX_THRESHOLD 4000
+
 /* default collection size */
 #define DEFAULT_LIST_SIZE  4000
 #define DEFAULT_SET_SIZE   4000
@@ -46,6 +50,21 @@
 #define MAXIMUM_SCRUB_COUNT 320
 #define DEFAULT_SCRUB_COUNT 96
 
+/* warm LRU segment percent */
+#define MINIMUM_LRU_WARM_PERCENT 0
+#define MAXIMUM_LRU_WARM_PERCENT 80
+#define DEFAULT_LRU_WARM_PERCENT 40
+
+/* LRU headroom percent: free chunks kept by the LRU maintainer */
+#define MINIMUM_LRU_HEADROOM_PERCENT 0
+#define MAXIMUM_LRU_HEADROOM_PERCENT 50
+#define DEFAULT_LRU_HEADROOM_PERCENT 0
+
+/* slab automove: 0(off), 1(conservative), 2(aggressive) */
+#define MINIMUM_SLAB_AUTOMOVE 0
+#define MAXIMUM_SLAB_AUTOMOVE 2
+#define DEFAULT_SLAB_AUTOMOVE 0
+
 /* update type */
 enum upd_type {
     /* key value command */
@@ -106,6 +125,7 @@ enum elem_delete_cause {
 #define ITEM_IFLAG_BTREE 4   /* b+tree item */
 #define ITEM_IFLAG_COLL  7   /* collection item: list/set/map/b+tree */
 /* 2) item flag: decreasing order */
+#define ITEM_WARM        16  /* linked to the warm segment of LRU list */
 #define ITEM_LINKED      32  /* linked to assoc hash table */
 #define ITEM_INTERNAL    64  /* internal cache item */
 #define ITEM_WITH_CAS    128 /* having CAS value */
@@ -150,12 +170,18 @@ typedef struct _hash_item {
     uint8_t  slabs_clsid;/* which slab class we're in */
     uint8_t  refchunk;  /* reference chunk */
     uint32_t flags;     /* Flags associated with the item (in network byte order) */
+#ifdef ENABLE_COMPACT_ITEM
+    uint32_t next;      /* LRU chain next (compact link) */
+    uint32_t prev;      /* LRU chain prev (compact link) */
+#else
     struct _hash_item *next;   /* LRU chain next */
     struct _hash_item *prev;   /* LRU chain prev */
+#endif
     struct _hash_item *h_next; /* hash chain next */
     rel_time_t time;    /* least recent access */
     rel_time_t exptime; /* When the item will expire (relative to process startup) */
     uint8_t  iflag;     /* Internal flags: item type and flag */
+    uint8_t  active;    /* active level: how it has been read in LRU list */
     uint16_t nkey;      /* The total length of the key (in bytes) */
     uint32_t nbytes;    /* The total length of the data (in bytes) */
     /* Following fields are used to trade off memory space for performance */
@@ -163,6 +189,31 @@ typedef struct _hash_item {
     void    *pfxptr;    /* pointer to prefix structure */
 } hash_item;
 
+/* LRU chain links of hash item.
+ * In compact item mode, a link is the 32-bit offset of the item in 8-byte
+ * units from the base of the preallocated cache memory (0: NULL),
+ * which addresses the cache memory up to 32GB.
+ * The hash chain links stay pointers since the scan placeholders
+ * linked on the hash chains are not in the cache memory.
+ */
+#ifdef ENABLE_COMPACT_ITEM
+#ifdef USE_SYSTEM_MALLOC
+#error "compact item header requires the slab allocator"
+#endif
+#define ITEM_LINK_PTR(off) ((off) ? (hash_item*)(itemsp->mem_base + ((size_t)((off) - 1) << 3)) : NULL)
+#define ITEM_LINK_OFF(ptr) ((ptr) ? (uint32_t)(((char*)(ptr) - itemsp->mem_base) >> 3) + 1 : 0)
+#define ITEM_NEXT(it)        ITEM_LINK_PTR((it)->next)
+#define ITEM_PREV(it)        ITEM_LINK_PTR((it)->prev)
+#define ITEM_SET_NEXT(it, p) ((it)->next = ITEM_LINK_OFF(p))
+#define ITEM_SET_PREV(it, p) ((it)->prev = ITEM_LINK_OFF(p))
+#define MAXIMUM_COMPACT_ITEM_MEMORY ((uint64_t)1 << 35)
+#else
+#define ITEM_NEXT(it)        ((it)->next)
+#define ITEM_PREV(it)        ((it)->prev)
+#define ITEM_SET_NEXT(it, p) ((it)->next = (p))
+#define ITEM_SET_PREV(it, p) ((it)->prev = (p))
+#endif
+
 /* list element */
 typedef struct _list_elem_item {
     uint16_t refcount;
@@ -174,6 +225,30 @@ typedef struct _list_elem_item {
     char     value[1];            /**< the data itself */
 } list_elem_item;
 
+/* list position index: the first element and the element count of each segment */
+typedef struct _list_indx_seg {
+    list_elem_item *first;
+    uint32_t        count;
+} list_indx_seg;
+
+/* a block of the consecutive segments */
+typedef struct _list_indx_blk {
+    uint16_t refcount;
+    uint8_t  slabs_clsid;         /* which slab class we're in */
+    uint8_t  dummy;
+    list_indx_seg seg[1];
+} list_indx_blk;
+
+typedef struct _list_indx_info {
+    uint16_t refcount;
+    uint8_t  slabs_clsid;         /* which slab class we're in */
+    uint8_t  dummy;
+    uint32_t used_count;          /* the number of segments */
+    uint16_t capacity;            /* the max number of blocks */
+    uint16_t blk_count;           /* the number of allocated blocks */
+    list_indx_blk *blk[1];
+} list_indx_info;
+
 /* set element */
 typedef struct _set_elem_item {
     uint16_t refcount;
@@ -184,6 +259,29 @@ typedef struct _set_elem_item {
     char     value[1];            /**< the data itself */
 } set_elem_item;
 
+/* set element index: an open-addressing table of hash values and elements */
+typedef struct _set_indx_slot {
+    uint32_t       hval;          /* hash value of the element */
+    set_elem_item *elem;          /* NULL: empty slot */
+} set_indx_slot;
+
+/* a segment of the consecutive slots */
+typedef struct _set_indx_seg {
+    uint16_t refcount;
+    uint8_t  slabs_clsid;         /* which slab class we're in */
+    uint8_t  dummy;
+    set_indx_slot slot[1];
+} set_indx_seg;
+
+typedef struct _set_indx_info {
+    uint16_t refcount;
+    uint8_t  slabs_clsid;         /* which slab class we're in */
+    uint8_t  dummy;
+    uint32_t used_count;          /* the number of used slots */
+    uint32_t capacity;            /* the number of slots (power of 2) */
+    set_indx_seg *seg[1];
+} set_indx_info;
+
 /* map element */
 typedef struct _map_elem_item {
     uint16_t refcount;
@@ -195,11 +293,35 @@ typedef struct _map_elem_item {
     unsigned char data[1];        /* data: <field, value> */
 } map_elem_item;
 
+/* map element index: an open-addressing table of hash values and elements */
+typedef struct _map_indx_slot {
+    uint32_t       hval;          /* hash value of the field */
+    map_elem_item *elem;          /* NULL: empty slot */
+} map_indx_slot;
+
+/* a segment of the consecutive slots */
+typedef struct _map_indx_seg {
+    uint16_t refcount;
+    uint8_t  slabs_clsid;         /* which slab class we're in */
+    uint8_t  dummy;
+    map_indx_slot slot[1];
+} map_indx_seg;
+
+typedef struct _map_indx_info {
+    uint16_t refcount;
+    uint8_t  slabs_clsid;         /* which slab class we're in */
+    uint8_t  dummy;
+    uint32_t used_count;          /* the number of used slots */
+    uint32_t capacity;            /* the number of slots (power of 2) */
+    map_indx_seg *seg[1];
+} map_indx_info;
+
 /* btree element */
 typedef struct _btree_elem_item_fixed {
     uint16_t refcount;
     uint8_t  slabs_clsid;        /* which slab class we're in */
-    uint8_t  status;             /* 3(used), 2(insert mark), 1(delete_mark), or 0(free) */
+    uint8_t  status:7;           /* 3(used), 2(insert mark), 1(delete_mark), or 0(free) */
+    uint8_t  zipped:1;           /* the value is compressed (See btree_compress) */
     uint8_t  nbkey;              /* length of bkey */
     uint8_t  neflag;             /* length of element flag */
     uint16_t nbytes;             /**< The total size of the data (in bytes) */
@@ -208,13 +330,27 @@ typedef struct _btree_elem_item_fixed {
 typedef struct _btree_elem_item {
     uint16_t refcount;
     uint8_t  slabs_clsid;        /* which slab class we're in */
-    uint8_t  status;             /* 3(used), 2(insert mark), 1(delete_mark), or 0(free) */
+    uint8_t  status:7;           /* 3(used), 2(insert mark), 1(delete_mark), or 0(free) */
+    uint8_t  zipped:1;           /* the value is compressed (See btree_compress) */
     uint8_t  nbkey;              /* length of bkey */
     uint8_t  neflag;             /* length of element flag */
     uint16_t nbytes;             /**< The total size of the data (in bytes) */
     unsigned char data[1];       /* data: <bkey, [eflag,] value> */
 } btree_elem_item;
 
+#ifdef ENABLE_BTREE_COMPRESS
+/* btree compression dictionary: sampled from the element values */
+typedef struct _btree_zdict_info {
+    uint16_t refcount;
+    uint8_t  slabs_clsid;        /* which slab class we're in */
+    uint8_t  disabled;           /* do not compress the new elements */
+    uint32_t size;               /* dictionary size */
+    uint32_t ntried;             /* the number of elements tried to compress */
+    uint32_t nzipped;            /* the number of elements compressed */
+    unsigned char data[1];       /* dictionary data */
+} btree_zdict_info;
+#endif
+
 /* list meta info */
 typedef struct _list_meta_info {
     int32_t  mcnt;      /* maximum count */
@@ -225,6 +361,7 @@ typedef struct _list_meta_info {
     uint32_t stotal;    /* total space */
     list_elem_item *head;
     list_elem_item *tail;
+    list_indx_info *indx; /* position index of a long list */
 } list_meta_info;
 
 /* set meta info */
@@ -250,6 +387,7 @@ typedef struct _set_meta_info {
     uint16_t itdist;    /* distance from hash item (unit: sizeof(size_t)) */
     uint32_t stotal;    /* total space */
     set_hash_node *root;
+    set_indx_info *indx; /* element index of a large set */
 } set_meta_info;
 
 /* map meta info */
@@ -275,35 +413,36 @@ typedef struct _map_meta_info {
     uint16_t itdist;    /* distance from hash item (unit: sizeof(size_t)) */
     uint32_t stotal;    /* total space */
     map_hash_node *root;
+    map_indx_info *indx; /* element index of a large map */
 } map_meta_info;
 
 /* btree meta info */
 #define BTREE_MAX_DEPTH  7
 #define BTREE_ITEM_COUNT 32 /* Recommend BTREE_ITEM_COUNT >= 8 */
+#define BTREE_MAX_ITEM_COUNT 128 /* the maximum node fanout */
 
-typedef struct _btree_leaf_node {
-    uint16_t refcount;
-    uint8_t  slabs_clsid;      /* which slab class we're in */
-    uint8_t  ndepth;
-    uint16_t used_count;
-    uint16_t reserved;
-    struct _btree_indx_node *prev;
-    struct _btree_indx_node *next;
-    void    *item[BTREE_ITEM_COUNT];
-} btree_leaf_node;
-
+/* A btree node has three arrays of capacity entries.
+ *   item[]: element pointers (leaf node) or child node pointers (index node)
+ *   skey[]: bkeys (prefix) of elements or first bkeys (prefix) of child nodes
+ *   ecnt[]: element counts of child nodes (index node only)
+ * The capacity(fanout) is BTREE_ITEM_COUNT, or larger for wide b+trees.
+ */
 typedef struct _btree_indx_node {
     uint16_t refcount;
     uint8_t  slabs_clsid;      /* which slab class we're in */
     uint8_t  ndepth;
     uint16_t used_count;
-    uint16_t reserved;
+    uint16_t capacity;         /* the max number of items */
     struct _btree_indx_node *prev;
     struct _btree_indx_node *next;
-    void    *item[BTREE_ITEM_COUNT];
-    uint32_t ecnt[BTREE_ITEM_COUNT];
+    void    *item[];
 } btree_indx_node;
 
+#define BTREE_NODE_SKEY(node) \
+        ((uint64_t *)((char *)(node)->item + (node)->capacity * sizeof(void *)))
+#define BTREE_NODE_ECNT(node) \
+        ((uint32_t *)((char *)(node)->item + (node)->capacity * (sizeof(void *) + sizeof(uint64_t))))
+
 typedef struct _btree_meta_info {
     int32_t  mcnt;      /* maximum count */
     int32_t  ccnt;      /* current count */
@@ -312,9 +451,13 @@ typedef struct _btree_meta_info {
     uint16_t itdist;    /* distance from hash item (unit: sizeof(size_t)) */
     uint32_t stotal;    /* total space */
     uint8_t  bktype;    /* bkey type : BKEY_TYPE_UINT64 or BKEY_TYPE_BINARY */
-    uint8_t  dummy[7];  /* reserved space */
+    uint8_t  fanout;    /* node capacity of the b+tree */
+    uint8_t  dummy[6];  /* reserved space */
     bkey_t   maxbkeyrange;
     btree_indx_node *root;
+#ifdef ENABLE_BTREE_COMPRESS
+    btree_zdict_info *zdict; /* compression dictionary */
+#endif
 } btree_meta_info;
 
 /* common meta info of list and set */
@@ -335,20 +478,35 @@ typedef struct {
     unsigned int outofmemory;
     unsigned int tailrepairs;
     unsigned int reclaimed;
+    unsigned int promoted;  /* moved from cold to warm segment */
+    unsigned int demoted;   /* moved from warm to cold segment */
 } itemstats_t;
 
-/* item global */
+/* item global
+ * Each LRU list is segmented into the warm and the cold segment.
+ * New items are linked to the cold segment (heads/tails) and the reads
+ * only raise their active level. The items read more than once are
+ * regarded as active, and the active items are moved to the warm segment
+ * when they reach the cold tail, so the LRU pointers are changed in batches
+ * by the evictors instead of every read.
+ */
 struct items {
    hash_item   *heads[MAX_SLAB_CLASSES];
    hash_item   *tails[MAX_SLAB_CLASSES];
+   hash_item   *warm_heads[MAX_SLAB_CLASSES];
+   hash_item   *warm_tails[MAX_SLAB_CLASSES];
    hash_item   *lowMK[MAX_SLAB_CLASSES]; /* low mark for invalidation(expire/flush) check */
    hash_item   *curMK[MAX_SLAB_CLASSES]; /* cur mark for invalidation(expire/flush) check */
    hash_item   *sticky_heads[MAX_SLAB_CLASSES];
    hash_item   *sticky_tails[MAX_SLAB_CLASSES];
    hash_item   *sticky_curMK[MAX_SLAB_CLASSES]; /* cur mark for invalidation(expire/flush) check */
    unsigned int sizes[MAX_SLAB_CLASSES];
+   unsigned int warm_sizes[MAX_SLAB_CLASSES];
    unsigned int sticky_sizes[MAX_SLAB_CLASSES];
    itemstats_t  itemstats[MAX_SLAB_CLASSES];
+#ifdef ENABLE_COMPACT_ITEM
+   char        *mem_base; /* the base of the compact LRU links */
+#endif
 };
 
 void ITEM_REFCOUNT_INCR(hash_item *it);
@@ -386,6 +544,12 @@ void              do_item_update(hash_item *it, bool force);
 hash_item *do_item_get(const char *key, const uint32_t nkey, bool do_update);
 void       do_item_release(hash_item *it);
 
+/* lock partitioning mode: called without the cache lock */
+bool       do_item_fast_get(const char *key, const uint32_t nkey, hash_item **item);
+bool       do_item_fast_release(hash_item *it);
+
+ENGINE_ERROR_CODE do_item_slabs_reassign(unsigned int src, unsigned int dst);
+
 
 void coll_del_thread_wakeup(void);
 
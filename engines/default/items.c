@@ -307,6 +307,9 @@ void item_free(hash_item *item)
 hash_item *item_get(const void *key, const uint32_t nkey)
 {
     hash_item *it;
+    if (config->lock_partitions > 0 && do_item_fast_get(key, nkey, &it)) {
+        return it;
+    }
     LOCK_CACHE();
     it = do_item_get(key, nkey, DO_UPDATE);
     UNLOCK_CACHE();
@@ -319,6 +322,9 @@ hash_item *item_get(const void *key, const uint32_t nkey)
  */
 void item_release(hash_item *item)
 {
+    if (config->lock_partitions > 0 && do_item_fast_release(item)) {
+        return;
+    }
     LOCK_CACHE();
     do_item_release(item);
     UNLOCK_CACHE();
@@ -498,11 +504,25 @@ static ENGINE_ERROR_CODE do_item_flush_expired(const char *prefix, const int npr
                     break;
                 }
                 if (nprefix < 0 || prefix_issame(iter->pfxptr, prefix, nprefix)) {
-                    next = iter->next;
+                    next = ITEM_NEXT(iter);
+                    do_item_unlink(iter, ITEM_UNLINK_INVALID);
+                    iter = next;
+                } else {
+                    iter = ITEM_NEXT(iter);
+                }
+            }
+            iter = itemsp->warm_heads[i];
+            while (iter != NULL) {
+                if (iter->time < oldest_live) {
+                    /* We've hit the first old item. Continue to the next queue. */
+                    break;
+                }
+                if (nprefix < 0 || prefix_issame(iter->pfxptr, prefix, nprefix)) {
+                    next = ITEM_NEXT(iter);
                     do_item_unlink(iter, ITEM_UNLINK_INVALID);
                     iter = next;
                 } else {
-                    iter = iter->next;
+                    iter = ITEM_NEXT(iter);
                 }
             }
 #ifdef ENABLE_STICKY_ITEM
@@ -515,11 +535,11 @@ static ENGINE_ERROR_CODE do_item_flush_expired(const char *prefix, const int npr
                     break;
                 }
                 if (nprefix < 0 || prefix_issame(iter->pfxptr, prefix, nprefix)) {
-                    next = iter->next;
+                    next = ITEM_NEXT(iter);
                     do_item_unlink(iter, ITEM_UNLINK_INVALID);
                     iter = next;
                 } else {
-                    iter = iter->next;
+                    iter = ITEM_NEXT(iter);
                 }
             }
 #endif
@@ -566,25 +586,40 @@ char *item_cachedump(unsigned int slabs_clsid, unsigned int limit, const bool fo
         return NULL;
     }
 
+    /* The non-sticky items are dumped in the LRU order of
+     * the warm segment followed by the cold segment.
+     */
+    hash_item *lists[2];
+    int nlists = 1;
+
     LOCK_CACHE();
     if (sticky) {
-        it = (forward ? itemsp->sticky_heads[slabs_clsid]
-                      : itemsp->sticky_tails[slabs_clsid]);
+        lists[0] = (forward ? itemsp->sticky_heads[slabs_clsid]
+                            : itemsp->sticky_tails[slabs_clsid]);
+    } else if (forward) {
+        lists[0] = itemsp->warm_heads[slabs_clsid];
+        lists[1] = itemsp->heads[slabs_clsid];
+        nlists = 2;
     } else {
-        it = (forward ? itemsp->heads[slabs_clsid]
-                      : itemsp->tails[slabs_clsid]);
-    }
-    while (it != NULL && (limit == 0 || shown < limit)) {
-        /* Copy the key since it may not be null-terminated in the struct */
-        strncpy(keybuf, item_get_key(it), it->nkey);
-        keybuf[it->nkey] = 0x00; /* terminate */
-
-        if (bufcurr + it->nkey + 100 > memlimit) break;
-        len = sprintf(buffer + bufcurr, "ITEM %s [acctime=%u, exptime=%d]\r\n",
-                      keybuf, it->time, (int32_t)it->exptime);
-        bufcurr += len;
-        shown++;
-        it = (forward ? it->next : it->prev);
+        lists[0] = itemsp->tails[slabs_clsid];
+        lists[1] = itemsp->warm_tails[slabs_clsid];
+        nlists = 2;
+    }
+    for (int i = 0; i < nlists; i++) {
+        it = lists[i];
+        while (it != NULL && (limit == 0 || shown < limit)) {
+            /* Copy the key since it may not be null-terminated in the struct */
+            strncpy(keybuf, item_get_key(it), it->nkey);
+            keybuf[it->nkey] = 0x00; /* terminate */
+
+            if (bufcurr + it->nkey + 100 > memlimit) break;
+            len = sprintf(buffer + bufcurr, "ITEM %s [acctime=%u, exptime=%d]\r\n",
+                          keybuf, it->time, (int32_t)it->exptime);
+            bufcurr += len;
+            shown++;
+            it = (forward ? ITEM_NEXT(it) : ITEM_PREV(it));
+        }
+        if (it != NULL) break; /* limit or memlimit reached */
     }
     UNLOCK_CACHE();
 
@@ -608,6 +643,10 @@ void item_stats_global(ADD_STAT add_stat, const void *cookie)
     add_stat("curr_prefixes", 13, val, len, cookie);
 
     do_item_stat_get(add_stat, cookie);
+    assoc_stats(add_stat, cookie);
+#ifdef ENABLE_BTREE_COMPRESS
+    btree_zip_stats(add_stat, cookie);
+#endif
     UNLOCK_CACHE();
 }
 
@@ -617,11 +656,14 @@ void item_stats(ADD_STAT add_stat, const void *cookie)
 
     LOCK_CACHE();
     for (int i = 0; i <= POWER_LARGEST; i++) {
-        if (itemsp->tails[i] == NULL && itemsp->sticky_tails[i] == NULL)
+        if (itemsp->tails[i] == NULL && itemsp->warm_tails[i] == NULL &&
+            itemsp->sticky_tails[i] == NULL)
             continue;
 
         add_statistics(cookie, add_stat, prefix, i, "number", "%u",
-                       itemsp->sizes[i]+itemsp->sticky_sizes[i]);
+                       itemsp->sizes[i]+itemsp->warm_sizes[i]+itemsp->sticky_sizes[i]);
+        add_statistics(cookie, add_stat, prefix, i, "warm", "%u",
+                       itemsp->warm_sizes[i]);
 #ifdef ENABLE_STICKY_ITEM
         add_statistics(cookie, add_stat, prefix, i, "sticky", "%u",
                        itemsp->sticky_sizes[i]);
@@ -640,6 +682,10 @@ void item_stats(ADD_STAT add_stat, const void *cookie)
                        "%u", itemsp->itemstats[i].tailrepairs);;
         add_statistics(cookie, add_stat, prefix, i, "reclaimed",
                        "%u", itemsp->itemstats[i].reclaimed);;
+        add_statistics(cookie, add_stat, prefix, i, "promoted",
+                       "%u", itemsp->itemstats[i].promoted);
+        add_statistics(cookie, add_stat, prefix, i, "demoted",
+                       "%u", itemsp->itemstats[i].demoted);
     }
     UNLOCK_CACHE();
 }
@@ -671,7 +717,7 @@ void item_stats_sizes(ADD_STAT add_stat, const void *cookie)
                 int bucket = ntotal / 32;
                 if ((ntotal % 32) != 0) bucket++;
                 if (bucket < num_buckets) histogram[bucket]++;
-                iter = iter->next;
+                iter = ITEM_NEXT(iter);
             }
 #ifdef ENABLE_STICKY_ITEM
             iter = itemsp->sticky_heads[i];
@@ -680,7 +726,7 @@ void item_stats_sizes(ADD_STAT add_stat, const void *cookie)
                 int bucket = ntotal / 32;
                 if ((ntotal % 32) != 0) bucket++;
                 if (bucket < num_buckets) histogram[bucket]++;
-                iter = iter->next;
+                iter = ITEM_NEXT(iter);
             }
 #endif
         }
@@ -998,6 +1044,18 @@ void item_conf_set_evict_to_free(bool value)
     UNLOCK_CACHE();
 }
 
+/*
+ * Slab page reassignment
+ */
+ENGINE_ERROR_CODE item_slabs_reassign(unsigned int src, unsigned int dst)
+{
+    ENGINE_ERROR_CODE ret;
+    LOCK_CACHE();
+    ret = do_item_slabs_reassign(src, dst);
+    UNLOCK_CACHE();
+    return ret;
+}
+
 /*
  * Item Scan Facility
  */
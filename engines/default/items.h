@@ -168,6 +168,11 @@ void              coll_elem_result_release(elems_result_t *eresult, int type);
 bool item_conf_get_evict_to_free(void);
 void item_conf_set_evict_to_free(bool value);
 
+/*
+ * Slab page reassignment
+ */
+ENGINE_ERROR_CODE item_slabs_reassign(unsigned int src, unsigned int dst);
+
 /*
  * Apply functions by recovery.
  */
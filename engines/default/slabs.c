@@ -35,6 +35,9 @@
 #include <pthread.h>
 #include <inttypes.h>
 #include <stdarg.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "default_engine.h"
 
@@ -179,6 +182,30 @@ static int SM_BBODY_SIZE = SM_BLOCK_SIZE - sizeof(sm_blck_t);
 
 static sm_anchor_t sm_anchor;
 
+/* sm magazine: per-thread cache of the small sm slots.
+ * The slots freed by a thread are kept in its magazine of the slot length
+ * and reused by its next allocations without the slabs lock. The magazine
+ * is refilled from and flushed to the free slot lists in batches.
+ * The cached slots are regarded as used slots in the sm stats.
+ */
+#define SM_MAGAZINE_MAX_SLEN 256 /* max slot length cached in magazines */
+#define SM_MAGAZINE_SIZE     16  /* max # of slots in a magazine */
+#define SM_MAGAZINE_BATCH    8   /* # of slots refilled or flushed at once */
+#define SM_MAGAZINE_COUNT    ((SM_MAGAZINE_MAX_SLEN/8)+1) /* indexed by slen/8 */
+
+typedef struct _sm_magazine {
+    uint32_t    count;
+    void       *slots[SM_MAGAZINE_SIZE];
+} sm_magazine_t;
+
+static pthread_key_t           sm_mcache_key;
+static __thread sm_magazine_t *sm_mcache = NULL; /* magazines of the thread */
+static __thread uint32_t       sm_mcache_tgen = 0; /* generation of sm_mcache */
+static uint32_t                sm_mcache_gen = 0;  /* generation of sm manager */
+static volatile bool           sm_mcache_enabled = false;
+static uint64_t                sm_mcache_refills = 0;
+static uint64_t                sm_mcache_flushes = 0;
+
 static struct engine_config *config=NULL; // engine config
 static struct slabs         *slabsp=NULL; // engine slabs;
 static EXTENSION_LOGGER_DESCRIPTOR *logger;
@@ -1049,6 +1076,173 @@ static void do_smmgr_free(void *ptr, const size_t size)
     //do_smmgr_used_blck_check();
 }
 
+/*
+ * sm magazine functions
+ */
+static void do_smmgr_mcache_flush(sm_magazine_t *mag, int slen, uint32_t count)
+{
+    while (count-- > 0 && mag->count > 0) {
+        do_smmgr_free(mag->slots[--mag->count], slen - sizeof(sm_tail_t));
+    }
+}
+
+static void smmgr_mcache_destroy(void *arg)
+{
+    sm_magazine_t *mcache = (sm_magazine_t *)arg;
+
+    /* The engine can be destroyed before the thread exits. */
+    if (sm_mcache_enabled && sm_mcache_tgen == sm_mcache_gen) {
+        pthread_mutex_lock(&slabsp->lock);
+        for (int i = 0; i < SM_MAGAZINE_COUNT; i++) {
+            do_smmgr_mcache_flush(&mcache[i], i*8, mcache[i].count);
+        }
+        pthread_mutex_unlock(&slabsp->lock);
+    }
+    free(mcache);
+    sm_mcache = NULL;
+}
+
+static sm_magazine_t *smmgr_mcache_get(int slen)
+{
+    if (sm_mcache == NULL || sm_mcache_tgen != sm_mcache_gen) {
+        if (sm_mcache == NULL) {
+            sm_mcache = malloc(SM_MAGAZINE_COUNT * sizeof(sm_magazine_t));
+            if (sm_mcache == NULL) return NULL;
+        }
+        /* The slots cached for the previous engine instance are dropped. */
+        memset(sm_mcache, 0, SM_MAGAZINE_COUNT * sizeof(sm_magazine_t));
+        sm_mcache_tgen = sm_mcache_gen;
+        pthread_setspecific(sm_mcache_key, sm_mcache);
+    }
+    return &sm_mcache[slen/8];
+}
+
+static void *smmgr_mcache_alloc(const size_t size)
+{
+    int slen = do_smmgr_slen(size);
+    sm_magazine_t *mag = smmgr_mcache_get(slen);
+    void *ptr;
+
+    if (mag == NULL) {
+        pthread_mutex_lock(&slabsp->lock);
+        ptr = do_smmgr_alloc(size);
+        pthread_mutex_unlock(&slabsp->lock);
+        return ptr;
+    }
+    if (mag->count == 0) {
+        pthread_mutex_lock(&slabsp->lock);
+        while (mag->count < SM_MAGAZINE_BATCH) {
+            if ((ptr = do_smmgr_alloc(size)) == NULL) break;
+            mag->slots[mag->count++] = ptr;
+        }
+        sm_mcache_refills++;
+        pthread_mutex_unlock(&slabsp->lock);
+        if (mag->count == 0) return NULL;
+    }
+    return mag->slots[--mag->count];
+}
+
+static void smmgr_mcache_free(void *ptr, const size_t size)
+{
+    int slen = do_smmgr_slen(size);
+    sm_magazine_t *mag = smmgr_mcache_get(slen);
+
+    if (mag == NULL) {
+        pthread_mutex_lock(&slabsp->lock);
+        do_smmgr_free(ptr, size);
+        pthread_mutex_unlock(&slabsp->lock);
+        return;
+    }
+    /* Mark the slot as used before flushing so that it is not merged
+     * as a free neighbor of the flushed slots. */
+    ((sm_slot_t*)ptr)->status = (uint32_t)-1;
+    if (mag->count == SM_MAGAZINE_SIZE) {
+        pthread_mutex_lock(&slabsp->lock);
+        do_smmgr_mcache_flush(mag, slen, SM_MAGAZINE_BATCH);
+        sm_mcache_flushes++;
+        pthread_mutex_unlock(&slabsp->lock);
+    }
+    mag->slots[mag->count++] = ptr;
+}
+
+/*
+ * memory arena functions
+ */
+#define SLABS_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/* Allocate the preallocated memory chunk.
+ * With large_pages, it is backed by the hugetlb pages reserved in the system
+ * or by the transparent huge pages. The chunk is not touched here, so each
+ * slab page is placed on the NUMA node of the thread allocating it first.
+ */
+static void *memory_arena_alloc(size_t size)
+{
+#if defined(__linux__) && defined(HAVE_SYS_MMAN_H)
+    if (config->large_pages) {
+        size_t mlen = size;
+        char *ptr;
+        if (mlen % SLABS_HUGEPAGE_SIZE) {
+            mlen += SLABS_HUGEPAGE_SIZE - (mlen % SLABS_HUGEPAGE_SIZE);
+        }
+#ifdef MAP_HUGETLB
+        ptr = mmap(NULL, mlen, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            slabsp->mem_mapped = mlen;
+            slabsp->mem_pages = "hugetlb";
+            return ptr;
+        }
+        logger->log(EXTENSION_LOG_INFO, NULL,
+                    "Failed to map hugetlb pages: %s\n", strerror(errno));
+#endif
+        /* align the chunk to the huge page size for transparent huge pages */
+        ptr = mmap(NULL, mlen + SLABS_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return NULL;
+        }
+        size_t head = (SLABS_HUGEPAGE_SIZE - ((uintptr_t)ptr % SLABS_HUGEPAGE_SIZE))
+                    % SLABS_HUGEPAGE_SIZE;
+        if (head > 0) {
+            munmap(ptr, head);
+        }
+        munmap(ptr + head + mlen, SLABS_HUGEPAGE_SIZE - head);
+        ptr += head;
+        slabsp->mem_mapped = mlen;
+        slabsp->mem_pages = "default";
+#ifdef MADV_HUGEPAGE
+        if (madvise(ptr, mlen, MADV_HUGEPAGE) == 0) {
+            slabsp->mem_pages = "thp";
+        } else {
+            logger->log(EXTENSION_LOG_WARNING, NULL,
+                        "Failed to use transparent huge pages: %s\n", strerror(errno));
+        }
+#endif
+        return ptr;
+    }
+#endif
+    slabsp->mem_mapped = 0;
+    slabsp->mem_pages = "default";
+    return malloc(size);
+}
+
+static void memory_arena_free(void)
+{
+    if (slabsp->mem_base == NULL) {
+        return;
+    }
+#ifdef HAVE_SYS_MMAN_H
+    if (slabsp->mem_mapped > 0) {
+        munmap(slabsp->mem_base, slabsp->mem_mapped);
+    } else
+#endif
+    {
+        free(slabsp->mem_base);
+    }
+    slabsp->mem_base = NULL;
+    slabsp->mem_mapped = 0;
+}
+
 /**
  * Determines the chunk sizes and initializes the slab class descriptors
  * accordingly.
@@ -1067,8 +1261,8 @@ ENGINE_ERROR_CODE slabs_init(struct default_engine *engine,
         slabsp->mem_reserved = (RSVD_SLAB_COUNT*config->item_size_max);
 
     if (prealloc) {
-        /* Allocate everything in a big chunk with malloc */
-        slabsp->mem_base = malloc(slabsp->mem_limit);
+        /* Allocate everything in a big chunk */
+        slabsp->mem_base = memory_arena_alloc(slabsp->mem_limit);
         if (slabsp->mem_base != NULL) {
             slabsp->mem_current = slabsp->mem_base;
             slabsp->mem_avail = slabsp->mem_limit;
@@ -1079,6 +1273,8 @@ ENGINE_ERROR_CODE slabs_init(struct default_engine *engine,
         slabsp->mem_base = NULL;
         slabsp->mem_current = NULL;
         slabsp->mem_avail = 0;
+        slabsp->mem_mapped = 0;
+        slabsp->mem_pages = "default";
     }
 
     /* initialize slab classes */
@@ -1134,13 +1330,15 @@ ENGINE_ERROR_CODE slabs_init(struct default_engine *engine,
 #endif
 
     if (do_smmgr_init() != 0) {
-        if (slabsp->mem_base != NULL) {
-            free(slabsp->mem_base);
-            slabsp->mem_base = NULL;
-        }
+        memory_arena_free();
         return ENGINE_ENOMEM;
     }
 
+    if (pthread_key_create(&sm_mcache_key, smmgr_mcache_destroy) == 0) {
+        sm_mcache_gen++;
+        sm_mcache_enabled = true;
+    }
+
     logger->log(EXTENSION_LOG_INFO, NULL, "SLABS module initialized.\n");
     return ENGINE_SUCCESS;
 }
@@ -1151,10 +1349,13 @@ void slabs_final(struct default_engine *engine)
         return; /* nothing to do */
     }
 
-    /* Free memory allocated. */
-    if (slabsp->mem_base) {
-        free(slabsp->mem_base);
+    if (sm_mcache_enabled) {
+        sm_mcache_enabled = false;
+        pthread_key_delete(sm_mcache_key);
     }
+
+    /* Free memory allocated. */
+    memory_arena_free();
     do_smmgr_final();
     logger->log(EXTENSION_LOG_INFO, NULL, "SLABS module destroyed.\n");
 }
@@ -1196,6 +1397,29 @@ int slabs_space_shortage_level(void)
     return sm_anchor.space_shortage_level;
 }
 
+unsigned int slabs_headroom_shortage(unsigned int id, unsigned int percent)
+{
+    slabclass_t *p;
+    size_t len;
+    unsigned int shortage = 0;
+
+    if (id < POWER_SMALLEST || id > slabsp->power_largest)
+        return 0;
+    pthread_mutex_lock(&slabsp->lock);
+    p = &slabsp->slabclass[id];
+    len = config->item_size_max;
+    /* See do_slabs_newslab() */
+    if ((slabsp->mem_limit && slabsp->mem_malloced + len > slabsp->mem_limit && p->slabs >= p->rsvd_slabs) ||
+        (slabsp->mem_base != NULL && slabsp->mem_avail < len)) {
+        uint64_t target = ((uint64_t)p->slabs * p->perslab * percent + 99) / 100;
+        uint64_t nfree = p->sl_curr + p->end_page_free;
+        if (nfree < target)
+            shortage = (unsigned int)(target - nfree);
+    }
+    pthread_mutex_unlock(&slabsp->lock);
+    return shortage;
+}
+
 void slabs_dump_SM_info(void)
 {
     logger->log(EXTENSION_LOG_WARNING, NULL,
@@ -1258,7 +1482,8 @@ static void *memory_allocate(size_t size)
 static int do_slabs_newslab(const unsigned int id)
 {
     slabclass_t *p = &slabsp->slabclass[id];
-    int len = p->size * p->perslab;
+    /* All slab pages have the same size so that they can be reassigned */
+    int len = config->item_size_max;
     char *ptr;
 
     if ((slabsp->mem_limit && slabsp->mem_malloced + len > slabsp->mem_limit && p->slabs >= p->rsvd_slabs) ||
@@ -1457,6 +1682,8 @@ static void do_slabs_stats(ADD_STAT add_stats, const void *cookie)
     add_statistics(cookie, add_stats, "SM", -1, "free_chunk_space", "%"PRIu64, sm_anchor.free_chunk_space);
     add_statistics(cookie, add_stats, "SM", -1, "free_limit_space", "%"PRIu64, sm_anchor.free_limit_space);
     add_statistics(cookie, add_stats, "SM", -1, "space_shortage_level", "%d", sm_anchor.space_shortage_level);
+    add_statistics(cookie, add_stats, "SM", -1, "magazine_refills", "%"PRIu64, sm_mcache_refills);
+    add_statistics(cookie, add_stats, "SM", -1, "magazine_flushes", "%"PRIu64, sm_mcache_flushes);
 
     total = 0;
     int min_slab_id = POWER_SMALLEST;
@@ -1486,6 +1713,10 @@ static void do_slabs_stats(ADD_STAT add_stats, const void *cookie)
     add_statistics(cookie, add_stats, NULL, -1, "active_slabs", "%d", total);
     add_statistics(cookie, add_stats, NULL, -1, "memory_limit", "%llu", (unsigned long long)slabsp->mem_limit);
     add_statistics(cookie, add_stats, NULL, -1, "total_malloced", "%llu", (unsigned long long)slabsp->mem_malloced);
+    add_statistics(cookie, add_stats, NULL, -1, "memory_pages", "%s", slabsp->mem_pages);
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_moves", "%"PRIu64, slabsp->reassign_moves);
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_busy", "%"PRIu64, slabsp->reassign_busy);
+    add_statistics(cookie, add_stats, NULL, -1, "slab_reassign_evicted", "%"PRIu64, slabsp->reassign_evicted);
 }
 
 static ENGINE_ERROR_CODE do_slabs_set_memlimit(size_t memlimit)
@@ -1539,6 +1770,27 @@ void slabs_free(void *ptr, size_t size, unsigned int id)
     pthread_mutex_unlock(&slabsp->lock);
 }
 
+void *slabs_elem_alloc(size_t size, unsigned int id)
+{
+    if (sm_mcache_enabled && do_smmgr_slen(size) <= SM_MAGAZINE_MAX_SLEN) {
+        if (id < POWER_SMALLEST || id > slabsp->power_largest)
+            return NULL;
+        return smmgr_mcache_alloc(size);
+    }
+    return slabs_alloc(size, id);
+}
+
+void slabs_elem_free(void *ptr, size_t size, unsigned int id)
+{
+    if (sm_mcache_enabled && do_smmgr_slen(size) <= SM_MAGAZINE_MAX_SLEN) {
+        if (id < POWER_SMALLEST || id > slabsp->power_largest)
+            return;
+        smmgr_mcache_free(ptr, size);
+        return;
+    }
+    slabs_free(ptr, size, id);
+}
+
 void slabs_stats(ADD_STAT add_stats, const void *c)
 {
     pthread_mutex_lock(&slabsp->lock);
@@ -1567,3 +1819,135 @@ ENGINE_ERROR_CODE slabs_set_memlimit(size_t memlimit)
     return ret;
 }
 
+
+/*
+ * Slab page reassignment
+ */
+unsigned int slabs_spare_pages(unsigned int id)
+{
+    slabclass_t *p;
+    unsigned int spare = 0;
+
+    if (id < POWER_SMALLEST || id > slabsp->power_largest)
+        return 0;
+    pthread_mutex_lock(&slabsp->lock);
+    p = &slabsp->slabclass[id];
+    if (p->slabs > p->rsvd_slabs)
+        spare = p->slabs - p->rsvd_slabs;
+    pthread_mutex_unlock(&slabsp->lock);
+    return spare;
+}
+
+static ENGINE_ERROR_CODE do_slabs_reassign_pick(unsigned int src, unsigned int dst,
+                                                void **page, unsigned int *size,
+                                                unsigned int *count)
+{
+#ifdef USE_SYSTEM_MALLOC
+    return ENGINE_ENOTSUP;
+#endif
+    if (src < POWER_SMALLEST || src > slabsp->power_largest ||
+        dst < POWER_SMALLEST || dst > slabsp->power_largest || src == dst) {
+        return ENGINE_EBADVALUE;
+    }
+    slabclass_t *s = &slabsp->slabclass[src];
+    slabclass_t *d = &slabsp->slabclass[dst];
+    if (d->size <= MAX_SM_VALUE_LEN) {
+        /* The class is not used. The items go to the small memory manager. */
+        return ENGINE_EBADVALUE;
+    }
+    /* The reserved slabs are not reassigned.
+     * The class would allocate a new slab over the memory limit, otherwise.
+     */
+    if (s->slabs <= s->rsvd_slabs) {
+        return ENGINE_ENOMEM;
+    }
+    /* Make room for the page in the destination class in advance,
+     * so that the page can be moved without failure.
+     */
+    if (grow_slab_list(dst) == 0) {
+        return ENGINE_ENOMEM;
+    }
+    if (d->end_page_ptr != 0 && d->sl_total < d->sl_curr + d->perslab) {
+        unsigned int new_size = d->sl_curr + d->perslab;
+        void **new_slots = realloc(d->slots, new_size * sizeof(void *));
+        if (new_slots == NULL) {
+            return ENGINE_ENOMEM;
+        }
+        d->slots = new_slots;
+        d->sl_total = new_size;
+    }
+
+    /* The pages are picked in round robin. */
+    if (s->killing == 0 || s->killing > s->slabs) {
+        s->killing = 1;
+    }
+    *page = s->slab_list[s->killing - 1];
+    *size = s->size;
+    *count = s->perslab;
+    s->killing = (s->killing % s->slabs) + 1;
+    return ENGINE_SUCCESS;
+}
+
+static void do_slabs_reassign_move(unsigned int src, unsigned int dst, void *page)
+{
+    slabclass_t *s = &slabsp->slabclass[src];
+    slabclass_t *d = &slabsp->slabclass[dst];
+    char *page_end = (char *)page + config->item_size_max;
+    unsigned int i, j;
+
+    /* All chunks of the page are free.
+     * Take them out of the free chunks of the source class.
+     */
+    for (i = 0, j = 0; i < s->sl_curr; i++) {
+        if ((char *)s->slots[i] < (char *)page || (char *)s->slots[i] >= page_end) {
+            s->slots[j++] = s->slots[i];
+        }
+    }
+    s->sl_curr = j;
+    if (s->end_page_ptr != 0 &&
+        (char *)s->end_page_ptr >= (char *)page && (char *)s->end_page_ptr < page_end) {
+        s->end_page_ptr = 0;
+        s->end_page_free = 0;
+    }
+    for (i = 0; i < s->slabs; i++) {
+        if (s->slab_list[i] == page) {
+            s->slab_list[i] = s->slab_list[--s->slabs];
+            break;
+        }
+    }
+
+    /* Split the page into the chunks of the destination class. */
+    memset(page, 0, config->item_size_max);
+    d->slab_list[d->slabs++] = page;
+    if (d->end_page_ptr == 0) {
+        d->end_page_ptr = page;
+        d->end_page_free = d->perslab;
+    } else {
+        for (i = d->perslab; i > 0; i--) {
+            d->slots[d->sl_curr++] = (char *)page + ((i - 1) * d->size);
+        }
+    }
+}
+
+ENGINE_ERROR_CODE slabs_reassign_pick(unsigned int src, unsigned int dst,
+                                      void **page, unsigned int *size, unsigned int *count)
+{
+    ENGINE_ERROR_CODE ret;
+    pthread_mutex_lock(&slabsp->lock);
+    ret = do_slabs_reassign_pick(src, dst, page, size, count);
+    pthread_mutex_unlock(&slabsp->lock);
+    return ret;
+}
+
+void slabs_reassign_done(unsigned int src, unsigned int dst, void *page, uint32_t nevicted)
+{
+    pthread_mutex_lock(&slabsp->lock);
+    if (page != NULL) {
+        do_slabs_reassign_move(src, dst, page);
+        slabsp->reassign_moves++;
+    } else {
+        slabsp->reassign_busy++;
+    }
+    slabsp->reassign_evicted += nevicted;
+    pthread_mutex_unlock(&slabsp->lock);
+}
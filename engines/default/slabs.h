@@ -40,7 +40,7 @@ typedef struct {
     void       **slab_list; /* array of slab pointers */
     unsigned int list_size; /* size of prev array */
 
-    unsigned int killing;   /* index+1 of dying slab, or zero if none */
+    unsigned int killing;   /* index+1 of next slab to reassign, or zero if none */
     size_t       requested; /* The number of requested bytes */
 } slabclass_t;
 
@@ -54,6 +54,13 @@ struct slabs {
    void  *mem_base;
    void  *mem_current;
    size_t mem_avail;
+   size_t mem_mapped; /* size of the mmapped mem_base, 0 if it is malloced */
+   const char *mem_pages; /* kind of the pages backing mem_base */
+
+   /* slab page reassignment stats */
+   uint64_t reassign_moves;   /* # of pages moved */
+   uint64_t reassign_busy;    /* # of failures due to the busy chunks */
+   uint64_t reassign_evicted; /* # of items evicted to move the pages */
 
    /**
     * Access to the slab allocator is protected by this lock
@@ -87,6 +94,10 @@ unsigned int slabs_space_size(const size_t size);
 
 int   slabs_space_shortage_level(void);
 
+/** Get the number of free chunks lacking for the given headroom(percent of
+    the chunks) of the slab class. It's 0 if the class can get a new slab. */
+unsigned int slabs_headroom_shortage(unsigned int id, unsigned int percent);
+
 /* temporary SM dump function */
 void  slabs_dump_SM_info(void);
 
@@ -96,6 +107,11 @@ void *slabs_alloc(const size_t size, unsigned int id);
 /** Free previously allocated object */
 void  slabs_free(void *ptr, size_t size, unsigned int id);
 
+/** Allocate and free the collection elements.
+    The small ones are cached in the per-thread magazines. */ /*@null@*/
+void *slabs_elem_alloc(const size_t size, unsigned int id);
+void  slabs_elem_free(void *ptr, size_t size, unsigned int id);
+
 /** Fill buffer with stats */ /*@null@*/
 void  slabs_stats(ADD_STAT add_stats, const void *c);
 
@@ -107,4 +123,17 @@ void  add_statistics(const void *cookie, ADD_STAT add_stats,
                      const char *fmt, ...);
 
 ENGINE_ERROR_CODE slabs_set_memlimit(size_t memlimit);
+
+/** Get the number of slab pages that can be reassigned from the class */
+unsigned int slabs_spare_pages(unsigned int id);
+
+/** Check the slab classes of a page reassignment and pick the next page
+    of the src class. The chunk size and count of the page are returned.
+    ENGINE_EBADVALUE: bad class, ENGINE_ENOMEM: no spare page */
+ENGINE_ERROR_CODE slabs_reassign_pick(unsigned int src, unsigned int dst,
+                                      void **page, unsigned int *size, unsigned int *count);
+
+/** Move the picked page whose chunks are all free to the dst class.
+    The page is NULL if the reassignment failed due to the busy chunks. */
+void slabs_reassign_done(unsigned int src, unsigned int dst, void *page, uint32_t nevicted);
 #endif
@@ -95,6 +95,9 @@ initialize_configuration(struct demo_engine *se, const char *cfg_str)
             { .key = "preallocate",
               .datatype = DT_BOOL,
               .value.dt_bool = &se->config.preallocate },
+            { .key = "large_pages",
+              .datatype = DT_BOOL,
+              .value.dt_bool = &se->config.large_pages },
             { .key = "factor",
               .datatype = DT_FLOAT,
               .value.dt_float = &se->config.factor },
@@ -325,6 +328,16 @@ Demo_list_elem_insert(ENGINE_HANDLE* handle, const void* cookie,
     return ENGINE_ENOTSUP;
 }
 
+static ENGINE_ERROR_CODE
+Demo_list_elem_minsert(ENGINE_HANDLE* handle, const void* cookie,
+                          const void* key, const int nkey, int index,
+                          eitem **eitem_array, const int eitem_count,
+                          item_attr *attrp, bool *created,
+                          ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    return ENGINE_ENOTSUP;
+}
+
 static ENGINE_ERROR_CODE
 Demo_list_elem_delete(ENGINE_HANDLE* handle, const void* cookie,
                          const void* key, const int nkey,
@@ -385,6 +398,16 @@ Demo_set_elem_insert(ENGINE_HANDLE* handle, const void* cookie,
     return ENGINE_ENOTSUP;
 }
 
+static ENGINE_ERROR_CODE
+Demo_set_elem_minsert(ENGINE_HANDLE* handle, const void* cookie,
+                         const void* key, const int nkey,
+                         eitem **eitem_array, const int eitem_count,
+                         item_attr *attrp, bool *created,
+                         ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    return ENGINE_ENOTSUP;
+}
+
 static ENGINE_ERROR_CODE
 Demo_set_elem_delete(ENGINE_HANDLE* handle, const void* cookie,
                         const void* key, const int nkey,
@@ -404,6 +427,16 @@ Demo_set_elem_exist(ENGINE_HANDLE* handle, const void* cookie,
     return ENGINE_ENOTSUP;
 }
 
+static ENGINE_ERROR_CODE
+Demo_set_elem_mexist(ENGINE_HANDLE* handle, const void* cookie,
+                     const void* key, const int nkey,
+                     const void **value_array, const uint32_t *nbytes_array,
+                     const uint32_t value_count, bool *exist_array,
+                     uint16_t vbucket)
+{
+    return ENGINE_ENOTSUP;
+}
+
 static ENGINE_ERROR_CODE
 Demo_set_elem_get(ENGINE_HANDLE* handle, const void* cookie,
                      const void* key, const int nkey,
@@ -455,6 +488,16 @@ Demo_map_elem_insert(ENGINE_HANDLE* handle, const void* cookie,
     return ENGINE_ENOTSUP;
 }
 
+static ENGINE_ERROR_CODE
+Demo_map_elem_minsert(ENGINE_HANDLE* handle, const void* cookie,
+                         const void* key, const int nkey,
+                         eitem **eitem_array, const int eitem_count,
+                         item_attr *attrp, bool *created,
+                         ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    return ENGINE_ENOTSUP;
+}
+
 static ENGINE_ERROR_CODE
 Demo_map_elem_update(ENGINE_HANDLE* handle, const void* cookie,
                         const void* key, const int nkey, const field_t *field,
@@ -527,6 +570,16 @@ Demo_btree_elem_insert(ENGINE_HANDLE* handle, const void* cookie,
     return ENGINE_ENOTSUP;
 }
 
+static ENGINE_ERROR_CODE
+Demo_btree_elem_minsert(ENGINE_HANDLE* handle, const void* cookie,
+                          const void* key, const int nkey,
+                          eitem **eitem_array, const int eitem_count,
+                          item_attr *attrp, bool *created,
+                          ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    return ENGINE_ENOTSUP;
+}
+
 static ENGINE_ERROR_CODE
 Demo_btree_elem_update(ENGINE_HANDLE* handle, const void* cookie,
                           const void* key, const int nkey,
@@ -811,6 +864,7 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .list_elem_free    = Demo_list_elem_free,
          .list_elem_release = Demo_list_elem_release,
          .list_elem_insert  = Demo_list_elem_insert,
+         .list_elem_minsert = Demo_list_elem_minsert,
          .list_elem_delete  = Demo_list_elem_delete,
          .list_elem_get     = Demo_list_elem_get,
          /* SET Colleciton API */
@@ -819,8 +873,10 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .set_elem_free     = Demo_set_elem_free,
          .set_elem_release  = Demo_set_elem_release,
          .set_elem_insert   = Demo_set_elem_insert,
+         .set_elem_minsert  = Demo_set_elem_minsert,
          .set_elem_delete   = Demo_set_elem_delete,
          .set_elem_exist    = Demo_set_elem_exist,
+         .set_elem_mexist   = Demo_set_elem_mexist,
          .set_elem_get      = Demo_set_elem_get,
          /* MAP Collection API */
          .map_struct_create = Demo_map_struct_create,
@@ -828,6 +884,7 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .map_elem_free     = Demo_map_elem_free,
          .map_elem_release  = Demo_map_elem_release,
          .map_elem_insert   = Demo_map_elem_insert,
+         .map_elem_minsert  = Demo_map_elem_minsert,
          .map_elem_update   = Demo_map_elem_update,
          .map_elem_delete   = Demo_map_elem_delete,
          .map_elem_get      = Demo_map_elem_get,
@@ -837,6 +894,7 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .btree_elem_free    = Demo_btree_elem_free,
          .btree_elem_release = Demo_btree_elem_release,
          .btree_elem_insert  = Demo_btree_elem_insert,
+         .btree_elem_minsert = Demo_btree_elem_minsert,
          .btree_elem_update  = Demo_btree_elem_update,
          .btree_elem_delete  = Demo_btree_elem_delete,
          .btree_elem_arithmetic  = Demo_btree_elem_arithmetic,
@@ -884,6 +942,7 @@ create_instance(uint64_t interface, GET_SERVER_API get_server_api,
          .maxbytes = 64 * 1024 * 1024,
          .sticky_limit = 0,
          .preallocate = false,
+         .large_pages = false,
          .factor = 1.25,
          .chunk_size = 48,
          .item_size_max= 1024 * 1024,
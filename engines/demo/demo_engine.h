@@ -50,6 +50,7 @@ struct engine_config {
    size_t maxbytes;
    size_t sticky_limit;
    bool   preallocate;
+   bool   large_pages;
    float  factor;
    size_t chunk_size;
    size_t item_size_max;
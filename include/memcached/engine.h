@@ -371,6 +371,13 @@ extern "C" {
                                               item_attr *attrp, bool *created,
                                               uint16_t vbucket);
 
+        ENGINE_ERROR_CODE (*list_elem_minsert)(ENGINE_HANDLE* handle, const void* cookie,
+                                               const void* key, const int nkey, int index,
+                                               eitem **eitem_array, const int eitem_count,
+                                               item_attr *attrp, bool *created,
+                                               ENGINE_ERROR_CODE *eret_array,
+                                               uint16_t vbucket);
+
         ENGINE_ERROR_CODE (*list_elem_delete)(ENGINE_HANDLE* handle, const void* cookie,
                                               const void* key, const int nkey,
                                               int from_index, int to_index,
@@ -405,6 +412,13 @@ extern "C" {
                                              item_attr *attrp, bool *created,
                                              uint16_t vbucket);
 
+        ENGINE_ERROR_CODE (*set_elem_minsert)(ENGINE_HANDLE* handle, const void* cookie,
+                                              const void* key, const int nkey,
+                                              eitem **eitem_array, const int eitem_count,
+                                              item_attr *attrp, bool *created,
+                                              ENGINE_ERROR_CODE *eret_array,
+                                              uint16_t vbucket);
+
         ENGINE_ERROR_CODE (*set_elem_delete)(ENGINE_HANDLE* handle, const void* cookie,
                                              const void* key, const int nkey,
                                              const void* value, const int nbytes,
@@ -416,6 +430,13 @@ extern "C" {
                                             const void* value, const int nbytes,
                                             bool *exist, uint16_t vbucket);
 
+        ENGINE_ERROR_CODE (*set_elem_mexist)(ENGINE_HANDLE* handle, const void* cookie,
+                                             const void* key, const int nkey,
+                                             const void **value_array,
+                                             const uint32_t *nbytes_array,
+                                             const uint32_t value_count,
+                                             bool *exist_array, uint16_t vbucket);
+
         ENGINE_ERROR_CODE (*set_elem_get)(ENGINE_HANDLE* handle, const void* cookie,
                                           const void* key, const int nkey,
                                           const uint32_t count,
@@ -453,6 +474,16 @@ extern "C" {
                                              item_attr *attrp,
                                              bool *created,
                                              uint16_t vbucket);
+        ENGINE_ERROR_CODE (*map_elem_minsert)(ENGINE_HANDLE* handle,
+                                              const void* cookie,
+                                              const void* key,
+                                              const int nkey,
+                                              eitem **eitem_array,
+                                              const int eitem_count,
+                                              item_attr *attrp,
+                                              bool *created,
+                                              ENGINE_ERROR_CODE *eret_array,
+                                              uint16_t vbucket);
         ENGINE_ERROR_CODE (*map_elem_update)(ENGINE_HANDLE* handle,
                                              const void* cookie,
                                              const void* key,
@@ -503,6 +534,13 @@ extern "C" {
                                               eitem_result *trimmed,
                                               uint16_t vbucket);
 
+        ENGINE_ERROR_CODE (*btree_elem_minsert)(ENGINE_HANDLE* handle, const void* cookie,
+                                               const void* key, const int nkey,
+                                               eitem **eitem_array, const int eitem_count,
+                                               item_attr *attrp, bool *created,
+                                               ENGINE_ERROR_CODE *eret_array,
+                                               uint16_t vbucket);
+
         ENGINE_ERROR_CODE (*btree_elem_update)(ENGINE_HANDLE* handle, const void* cookie,
                                               const void* key, const int nkey,
                                               const bkey_range *bkrange,
@@ -187,6 +187,7 @@ extern "C"
         PROTOCOL_BINARY_CMD_LOP_GET     = 0x53,
         PROTOCOL_BINARY_CMD_LOP_INSERTQ = 0x54,
         PROTOCOL_BINARY_CMD_LOP_DELETEQ = 0x55,
+        PROTOCOL_BINARY_CMD_LOP_MINSERT = 0x56,
         /* End LIST */
 
         /* SET commands */
@@ -197,6 +198,8 @@ extern "C"
         PROTOCOL_BINARY_CMD_SOP_GET     = 0x64,
         PROTOCOL_BINARY_CMD_SOP_INSERTQ = 0x65,
         PROTOCOL_BINARY_CMD_SOP_DELETEQ = 0x66,
+        PROTOCOL_BINARY_CMD_SOP_MEXIST  = 0x67,
+        PROTOCOL_BINARY_CMD_SOP_MINSERT = 0x68,
         /* End SET */
 
         /* B+Tree commands */
@@ -220,6 +223,9 @@ extern "C"
 
         PROTOCOL_BINARY_CMD_FLUSH_PREFIX = 0x90,
 
+        /* B+Tree commands beyond the B+Tree range */
+        PROTOCOL_BINARY_CMD_BOP_MINSERT = 0x91,
+
         PROTOCOL_BINARY_CMD_LAST_RESERVED = 0xef,
 
         /* Scrub the data */
@@ -559,6 +565,25 @@ extern "C"
         uint8_t bytes[sizeof(protocol_binary_request_header) + 20];
     } protocol_binary_request_lop_insert;
 
+    /* The value is the list of <length(uint32_t), data> pairs of the elements. */
+    typedef union {
+        struct {
+            protocol_binary_request_header header;
+            struct {
+                int32_t  index;
+                uint32_t count;
+                uint32_t flags;
+                int32_t  exptime;
+                int32_t  maxcount;
+                uint8_t  create;
+                uint8_t  reserved1;
+                uint8_t  reserved2;
+                uint8_t  reserved3;
+            } body;
+        } message;
+        uint8_t bytes[sizeof(protocol_binary_request_header) + 24];
+    } protocol_binary_request_lop_minsert;
+
     typedef union {
         struct {
             protocol_binary_request_header header;
@@ -640,6 +665,24 @@ extern "C"
         uint8_t bytes[sizeof(protocol_binary_request_header) + 16];
     } protocol_binary_request_sop_insert;
 
+    /* The value is the list of <length(uint32_t), data> pairs of the elements. */
+    typedef union {
+        struct {
+            protocol_binary_request_header header;
+            struct {
+                uint32_t count;
+                uint32_t flags;
+                int32_t  exptime;
+                int32_t  maxcount;
+                uint8_t  create;
+                uint8_t  reserved1;
+                uint8_t  reserved2;
+                uint8_t  reserved3;
+            } body;
+        } message;
+        uint8_t bytes[sizeof(protocol_binary_request_header) + 20];
+    } protocol_binary_request_sop_minsert;
+
     typedef union {
         struct {
             protocol_binary_request_header header;
@@ -655,6 +698,17 @@ extern "C"
 
     typedef protocol_binary_request_no_extras protocol_binary_request_sop_exist;
 
+    /* The value is the list of <length(uint32_t), data> pairs of the values. */
+    typedef union {
+        struct {
+            protocol_binary_request_header header;
+            struct {
+                uint32_t count;
+            } body;
+        } message;
+        uint8_t bytes[sizeof(protocol_binary_request_header) + 4];
+    } protocol_binary_request_sop_mexist;
+
     typedef union {
         struct {
             protocol_binary_request_header header;
@@ -694,6 +748,18 @@ extern "C"
         uint8_t bytes[sizeof(protocol_binary_response_header) + 4];
     } protocol_binary_response_sop_exist;
 
+    /* The value is the bitmap of the existence: the (i%8)-th bit of the
+     * (i/8)-th byte is set if the i-th value exists. */
+    typedef union {
+        struct {
+            protocol_binary_response_header header;
+            struct {
+                uint32_t count;
+            } body;
+        } message;
+        uint8_t bytes[sizeof(protocol_binary_response_header) + 4];
+    } protocol_binary_response_sop_mexist;
+
     /**
      * Definition of the structure used by b+tree insert/delete/get command.
      * See section 4
@@ -735,6 +801,12 @@ extern "C"
                       MAX_BKEY_LENG+1 + MAX_EFLAG_LENG+1 + 16];
     } protocol_binary_request_bop_insert;
 
+    /* The value is the list of the elements, each of which is
+     * <nbkey(uint8_t), bkey, neflag(uint8_t), eflag, length(uint32_t), data>.
+     * The bkey is the 8 bytes of uint64_t if nbkey is 0.
+     */
+    typedef protocol_binary_request_sop_minsert protocol_binary_request_bop_minsert;
+
     typedef union {
         struct {
             protocol_binary_request_header header;
@@ -824,6 +896,19 @@ extern "C"
     typedef protocol_binary_request_bop_mkeys protocol_binary_request_bop_smget;
 #endif
 
+    /* The response of lop, sop and bop minsert.
+     * The value is the list of the uint16_t statuses of the elements.
+     */
+    typedef union {
+        struct {
+            protocol_binary_response_header header;
+            struct {
+                uint32_t count;
+            } body;
+        } message;
+        uint8_t bytes[sizeof(protocol_binary_response_header) + 4];
+    } protocol_binary_response_coll_minsert;
+
     typedef protocol_binary_response_no_extras protocol_binary_response_bop_create;
     typedef protocol_binary_response_no_extras protocol_binary_response_bop_insert;
     typedef protocol_binary_response_no_extras protocol_binary_response_bop_update;
@@ -113,6 +113,7 @@ extern "C" {
         OPERATION_LOP_INSERT,        /**< List operation with insert element semantics */
         OPERATION_LOP_DELETE,        /**< List operation with delete element semantics */
         OPERATION_LOP_GET,           /**< List operation with get element semantics */
+        OPERATION_LOP_MINSERT,       /**< List operation with minsert(multiple insert) element semantics */
 
         /* set operation */
         OPERATION_SOP_CREATE = 0x60, /**< Set operation with create structure semantics */
@@ -120,6 +121,8 @@ extern "C" {
         OPERATION_SOP_DELETE,        /**< Set operation with delete element semantics */
         OPERATION_SOP_EXIST,         /**< Set operation with check existence of element semantics */
         OPERATION_SOP_GET,           /**< Set operation with get element semantics */
+        OPERATION_SOP_MEXIST,        /**< Set operation with check existence of multiple elements semantics */
+        OPERATION_SOP_MINSERT,       /**< Set operation with minsert(multiple insert) element semantics */
 
         /* map operation */
         OPERATION_MOP_CREATE = 0x70, /**< Map operation with create structure semantics */
@@ -127,6 +130,7 @@ extern "C" {
         OPERATION_MOP_UPDATE,        /**< Map operation with update element semantics */
         OPERATION_MOP_DELETE,        /**< Map operation with delete element semantics */
         OPERATION_MOP_GET,            /**< Map operation with get element semantics */
+        OPERATION_MOP_MINSERT,       /**< Map operation with minsert(multiple insert) element semantics */
 
         /* b+tree operation */
         OPERATION_BOP_CREATE = 0x80, /**< B+tree operation with create structure semantics */
@@ -142,7 +146,8 @@ extern "C" {
         // SUPPORT_BOP_MGET
         OPERATION_BOP_MGET,          /**< B+tree operation with mget(multiple get) element semantics */
         // SUPPORT_BOP_SMGET
-        OPERATION_BOP_SMGET          /**< B+tree operation with smget(sort-merge get) element semantics */
+        OPERATION_BOP_SMGET,         /**< B+tree operation with smget(sort-merge get) element semantics */
+        OPERATION_BOP_MINSERT        /**< B+tree operation with minsert(multiple insert) element semantics */
     } ENGINE_COLL_OPERATION;
 
     /* item type */
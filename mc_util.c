@@ -164,6 +164,77 @@ void mblck_list_free(mblck_pool_t *pool, mblck_list_t *list)
     list->pool = NULL;
 }
 
+/*
+ * memory block reader functions
+ */
+void mblck_reader_init(mblck_reader_t *reader, mblck_list_t *list, uint32_t length)
+{
+    reader->list = list;
+    reader->blck = MBLCK_GET_HEADBLK(list);
+    reader->dptr = MBLCK_GET_BODYPTR(reader->blck);
+    reader->dlen = length < MBLCK_GET_BODYLEN(list)
+                 ? length : MBLCK_GET_BODYLEN(list);
+    reader->tlen = length;
+}
+
+static void do_mblck_reader_next(mblck_reader_t *reader)
+{
+    assert(reader->dlen == 0 && reader->tlen > 0);
+    reader->blck = MBLCK_GET_NEXTBLK(reader->blck);
+    reader->dptr = MBLCK_GET_BODYPTR(reader->blck);
+    reader->dlen = reader->tlen < MBLCK_GET_BODYLEN(reader->list)
+                 ? reader->tlen : MBLCK_GET_BODYLEN(reader->list);
+}
+
+int mblck_reader_line(mblck_reader_t *reader, char *buf, uint32_t size)
+{
+    uint32_t len = 0;
+    char ch;
+
+    while (reader->tlen > 0) {
+        if (reader->dlen == 0) {
+            do_mblck_reader_next(reader);
+        }
+        ch = *reader->dptr++;
+        reader->dlen -= 1;
+        reader->tlen -= 1;
+        if (ch == '\n') {
+            if (len == 0 || buf[len-1] != '\r') {
+                break; /* no "\r\n" */
+            }
+            buf[len-1] = '\0';
+            return (int)(len-1);
+        }
+        if (len >= (size-1)) {
+            break; /* too long line */
+        }
+        buf[len++] = ch;
+    }
+    return -1;
+}
+
+int mblck_reader_data(mblck_reader_t *reader, char *buf, uint32_t length)
+{
+    uint32_t copy;
+
+    if (length > reader->tlen) {
+        return -1; /* not enough data */
+    }
+    while (length > 0) {
+        if (reader->dlen == 0) {
+            do_mblck_reader_next(reader);
+        }
+        copy = length < reader->dlen ? length : reader->dlen;
+        memcpy(buf, reader->dptr, copy);
+        buf += copy;
+        length -= copy;
+        reader->dptr += copy;
+        reader->dlen -= copy;
+        reader->tlen -= copy;
+    }
+    return 0;
+}
+
 /*
  * token buffer functions
  */
@@ -58,6 +58,15 @@ typedef struct _mblck_pool {
     uint32_t  free_cnt;
 } mblck_pool_t;
 
+/* memory block reader: reads a memory block list sequentially */
+typedef struct _mblck_reader {
+    mblck_list_t *list;
+    mblck_node_t *blck; /* the current block */
+    char     *dptr;     /* the current data pointer */
+    uint32_t  dlen;     /* data length left in the current block */
+    uint32_t  tlen;     /* total data length left */
+} mblck_reader_t;
+
 /*
  * memory block macros
  */
@@ -78,6 +87,11 @@ int  mblck_list_alloc(mblck_pool_t *pool, uint32_t item_len, uint32_t item_cnt,
 void mblck_list_merge(mblck_list_t *pri_list, mblck_list_t *add_list);
 void mblck_list_free(mblck_pool_t *pool, mblck_list_t *list);
 
+/* memory block reader functions */
+void mblck_reader_init(mblck_reader_t *reader, mblck_list_t *list, uint32_t length);
+int  mblck_reader_line(mblck_reader_t *reader, char *buf, uint32_t size);
+int  mblck_reader_data(mblck_reader_t *reader, char *buf, uint32_t length);
+
 /* token buffer functions */
 int   token_buff_create(token_buff_t *buff, uint32_t count);
 void  token_buff_destroy(token_buff_t *buff);
@@ -59,6 +59,15 @@
 #include <ctype.h>
 #include <stdarg.h>
 #include <stddef.h>
+#ifdef __linux__
+#include <linux/filter.h>
+#include <sched.h>
+#endif
+#if defined(HAVE_LINUX_ERRQUEUE_H) && defined(SO_ZEROCOPY) && \
+    defined(MSG_ZEROCOPY) && defined(EV_ET)
+#include <linux/errqueue.h>
+#define ZEROCOPY_SEND 1
+#endif
 
 
 /* Lock for global stats */
@@ -110,6 +119,7 @@ static union {
 /** file scope variables **/
 static conn *listen_conn = NULL;
 static struct event_base *main_base;
+static bool cpu_steering = false; /* the connections are steered by cpu */
 struct thread_stats *default_thread_stats;
 topkeys_t *default_topkeys = NULL;
 
@@ -153,11 +163,13 @@ static void update_stat_cas(conn *c, ENGINE_ERROR_CODE ret);
 static void settings_init(void);
 
 /* event handling, network IO */
-static void event_handler(const int fd, const short which, void *arg);
 static bool update_event(conn *c, const int new_flags);
 static void complete_nread(conn *c);
 static void process_command(conn *c, char *command, int cmdlen);
 static void write_and_free(conn *c, char *buf, int bytes);
+#ifdef ZEROCOPY_SEND
+static bool conn_zerocopy_close(conn *c);
+#endif
 static int ensure_iov_space(conn *c);
 static int add_iov(conn *c, const void *buf, int len);
 static int add_msghdr(conn *c);
@@ -325,6 +337,11 @@ static void settings_init(void)
     settings.reqs_per_event = DEFAULT_REQS_PER_EVENT;
     settings.backlog = 1024;
     settings.binding_protocol = negotiating_prot;
+    settings.listen_mode = tcp_listen_shared;
+    settings.conn_placement = conn_place_roundrobin;
+    settings.conn_migrate = false;
+    settings.io_backend = io_backend_libevent;
+    settings.zerocopy_size = 0;
     settings.item_size_max = 1024 * 1024; /* The famous 1MB upper limit. */
     settings.max_list_size = 50000; /* DEFAULT_MAX_LIST_SIZE */
     settings.max_set_size = 50000; /* DEFAULT_MAX_SET_SIZE */
@@ -388,6 +405,29 @@ static const char *prot_text(enum protocol prot)
     else return "unknown";
 }
 
+static const char *listen_mode_text(enum tcp_listen_mode mode)
+{
+    if (mode == tcp_listen_shared) return "shared";
+    else if (mode == tcp_listen_reuseport) return "reuseport";
+    else if (mode == tcp_listen_cpu) return "cpu";
+    else return "unknown";
+}
+
+static const char *placement_text(enum conn_placement placement)
+{
+    if (placement == conn_place_roundrobin) return "roundrobin";
+    else if (placement == conn_place_leastconn) return "leastconn";
+    else if (placement == conn_place_leastcpu) return "leastcpu";
+    else return "unknown";
+}
+
+static const char *io_backend_text(enum io_backend backend)
+{
+    if (backend == io_backend_libevent) return "libevent";
+    else if (backend == io_backend_uring) return "io_uring";
+    else return "unknown";
+}
+
 void safe_close(int sfd)
 {
     if (sfd != -1) {
@@ -575,6 +615,7 @@ static void conn_destructor(void *buffer, void *unused)
     free(c->suffixlist);
     free(c->iov);
     free(c->msglist);
+    free(c->udp_batch);
 
     LOCK_STATS();
     mc_stats.conn_structs--;
@@ -706,6 +747,27 @@ conn *conn_new(const int sfd, STATE_FUNC init_state,
 #else
     c->premature_io_complete = false;
 #endif
+#ifdef ENABLE_IO_URING
+    c->uring = NULL;
+    c->uring_closing = false;
+    c->uring_blocked = false;
+    c->uring_resuming = false;
+    c->uring_recving = false;
+    c->uring_recvstop = false;
+    c->uring_inflight = 0;
+    c->uring_sends = 0;
+    c->uring_sendcurr = 0;
+    c->uring_senderr = 0;
+    c->uring_recverr = -1;
+    c->uring_data = NULL;
+    c->uring_dlen = 0;
+    c->uring_inoff = 0;
+    c->uring_inlen = 0;
+#endif
+    c->zc_state = 0;
+    c->zc_sent = 0;
+    c->zc_done = 0;
+    c->zc_closing = false;
 
     /* save client ip address in connection object */
     struct sockaddr_in addr;
@@ -745,6 +807,7 @@ static void conn_coll_eitem_free(conn *c)
         break;
       case OPERATION_SOP_DELETE:
       case OPERATION_SOP_EXIST:
+      case OPERATION_SOP_MEXIST:
         free(c->coll_eitem);
         break;
       case OPERATION_SOP_GET:
@@ -783,6 +846,13 @@ static void conn_coll_eitem_free(conn *c)
       case OPERATION_BOP_UPDATE:
         free(c->coll_eitem);
         break;
+      /* minsert */
+      case OPERATION_LOP_MINSERT:
+      case OPERATION_SOP_MINSERT:
+      case OPERATION_MOP_MINSERT:
+      case OPERATION_BOP_MINSERT:
+        free(c->coll_eitem);
+        break;
       case OPERATION_BOP_GET:
       case OPERATION_BOP_PWG: /* position with get */
       case OPERATION_BOP_GBP: /* get by position */
@@ -874,6 +944,7 @@ static void conn_cleanup(conn *c)
 
     c->engine_storage = NULL;
     /* disconnect it from the conn_list of a thread in charge */
+    __atomic_sub_fetch(&c->thread->conn_count, 1, __ATOMIC_RELAXED);
     if (c->conn_prev != NULL) {
         c->conn_prev->conn_next = c->conn_next;
     } else {
@@ -902,6 +973,17 @@ void conn_close(conn *c)
 {
     assert(c != NULL);
 
+#ifdef ENABLE_IO_URING
+    if (c->uring != NULL && uring_conn_close(c)) {
+        return; /* closed when its io_uring requests complete */
+    }
+#endif
+#ifdef ZEROCOPY_SEND
+    if (c->zc_done != c->zc_sent && conn_zerocopy_close(c)) {
+        return; /* closed when the kernel releases its zero-copy sends */
+    }
+#endif
+
     /* delete the event, the socket and the conn */
     if (c->sfd != -1) {
         MEMCACHED_CONN_RELEASE(c->sfd);
@@ -937,6 +1019,49 @@ void conn_close(conn *c)
     cache_free(conn_cache, c);
 }
 
+/*
+ * Returns true if the connection is waiting for a new command with
+ * nothing in progress, so that it can be moved to another thread.
+ */
+bool conn_is_idle(conn *c)
+{
+    /* a new connection waits in conn_new_cmd until its first command */
+    if (c->state != conn_read && c->state != conn_new_cmd) {
+        return false;
+    }
+    if (IS_UDP(c->transport) || c->ev_flags != (EV_READ | EV_PERSIST) || c->rbytes != 0) {
+        return false;
+    }
+#ifdef ENABLE_IO_URING
+    if (c->uring != NULL) {
+        return false; /* its requests are bound to the io_uring of the thread */
+    }
+#endif
+    if (c->ewouldblock || c->io_blocked || c->next != NULL) {
+        return false;
+    }
+#ifdef MULTI_NOTIFY_IO_COMPLETE
+    if (c->current_io_wait != 0) {
+        return false;
+    }
+#endif
+    return c->item == NULL && c->ileft == 0 && c->suffixleft == 0 &&
+           c->coll_eitem == NULL && c->coll_strkeys == NULL &&
+           c->write_and_free == NULL && c->ascii_cmd == NULL;
+}
+
+/*
+ * Registers the event of an idle connection to the given event base.
+ * The event must have been deleted from the previous event base.
+ */
+bool conn_set_event_base(conn *c, struct event_base *base)
+{
+    event_set(&c->event, c->sfd, c->ev_flags, event_handler, (void *)c);
+    event_base_set(base, &c->event);
+    if (event_add(&c->event, 0) == -1) return false;
+    return true;
+}
+
 /*
  * Shrinks a connection's buffers if they're too big.  This prevents
  * periodic large "get" requests from permanently chewing lots of server
@@ -1388,6 +1513,25 @@ static void einfo_set_ascii_tail_string(eitem_info *einfo)
     }
 }
 
+static int einfo_read_value_mblck(eitem_info *einfo, mblck_reader_t *reader)
+{
+    if (einfo->naddnl == 0) {
+        return mblck_reader_data(reader, (char*)einfo->value, einfo->nbytes);
+    }
+
+    if (einfo->nvalue > 0) {
+        if (mblck_reader_data(reader, (char*)einfo->value, einfo->nvalue) != 0) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < einfo->naddnl; i++) {
+        if (mblck_reader_data(reader, einfo->addnl[i]->ptr, einfo->addnl[i]->len) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /*
  * Constructs a set of UDP headers and attaches them to the outgoing messages.
  */
@@ -1802,6 +1946,119 @@ static void process_sop_exist_complete(conn *c)
     c->coll_eitem = NULL;
 }
 
+static ENGINE_ERROR_CODE
+process_sop_mexist_read_values(conn *c, const void **value_array, uint32_t *nbytes_array,
+                               char **dataptr)
+{
+    mblck_reader_t reader;
+    char headbuf[MAX_SMEXIST_HEAD_LENG+1];
+    int headlen;
+    int32_t vlen;
+
+    mblck_reader_init(&reader, &c->memblist, MBLCK_GET_ITEMCNT(&c->memblist));
+    for (uint32_t i = 0; i < c->coll_ecount; i++) {
+        /* value head line: <bytes>\r\n */
+        headlen = mblck_reader_line(&reader, headbuf, sizeof(headbuf));
+        if (headlen <= 0 || (! safe_strtol(headbuf, &vlen)) ||
+            (vlen < 0 || vlen > (INT_MAX-2))) {
+            return ENGINE_EBADVALUE;
+        }
+        vlen += 2;
+        if (vlen > settings.max_element_bytes) {
+            return ENGINE_E2BIG;
+        }
+
+        /* value data: <data>\r\n */
+        if (mblck_reader_data(&reader, *dataptr, vlen) != 0 ||
+            strncmp(*dataptr + vlen - 2, "\r\n", 2) != 0) {
+            return ENGINE_EBADVALUE;
+        }
+        value_array[i] = *dataptr;
+        nbytes_array[i] = vlen;
+        *dataptr += vlen;
+    }
+    if (reader.tlen > 0) {
+        return ENGINE_EBADVALUE; /* more data than the given values */
+    }
+    return ENGINE_SUCCESS;
+}
+
+static void process_sop_mexist_complete(conn *c)
+{
+    assert(c->coll_op == OPERATION_SOP_MEXIST);
+    assert(c->coll_eitem != NULL);
+    const void **value_array = (const void **)c->coll_eitem;
+    uint32_t *nbytes_array = (uint32_t *)&value_array[c->coll_ecount];
+    bool *exist_array = (bool *)&nbytes_array[c->coll_ecount];
+    char *respbuf = (char *)&exist_array[c->coll_ecount];
+    char *respptr;
+    ENGINE_ERROR_CODE ret;
+
+    /* the values are copied at the front of the buffer,
+     * and the response string is made after them. */
+    ret = process_sop_mexist_read_values(c, value_array, nbytes_array, &respbuf);
+
+    /* free the value string memory blocks */
+    assert(c->coll_strkeys == (void*)&c->memblist);
+    mblck_list_free(&c->thread->mblck_pool, &c->memblist);
+    c->coll_strkeys = NULL;
+
+    if (ret == ENGINE_SUCCESS) {
+        ret = mc_engine.v1->set_elem_mexist(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                            value_array, nbytes_array, c->coll_ecount,
+                                            exist_array, 0);
+    }
+
+    if (ret != ENGINE_SUCCESS) {
+        if (settings.detail_enabled) {
+            stats_prefix_record_sop_exist(c->coll_key, c->coll_nkey, false);
+        }
+        if (ret == ENGINE_KEY_ENOENT || ret == ENGINE_UNREADABLE) {
+            STATS_MISSES(c, sop_exist, c->coll_key, c->coll_nkey);
+        } else {
+            STATS_CMD_NOKEY(c, sop_exist);
+        }
+        free(c->coll_eitem);
+        c->coll_eitem = NULL;
+
+        if (ret == ENGINE_KEY_ENOENT)        out_string(c, "NOT_FOUND");
+        else if (ret == ENGINE_UNREADABLE)   out_string(c, "UNREADABLE");
+        else if (ret == ENGINE_EBADTYPE)     out_string(c, "TYPE_MISMATCH");
+        else if (ret == ENGINE_EBADVALUE)    out_string(c, "CLIENT_ERROR bad data chunk");
+        else if (ret == ENGINE_E2BIG)        out_string(c, "CLIENT_ERROR too large value");
+        else handle_unexpected_errorcode_ascii(c, __func__, ret);
+        return;
+    }
+
+    /* a hit is counted once per command as in the binary protocol */
+    if (settings.detail_enabled) {
+        stats_prefix_record_sop_exist(c->coll_key, c->coll_nkey, true);
+    }
+    STATS_HITS(c, sop_exist, c->coll_key, c->coll_nkey);
+
+    /* make the response of each value */
+    respptr = respbuf;
+    sprintf(respptr, "RESPONSE %u\r\n", c->coll_ecount);
+    respptr += strlen(respptr);
+    for (uint32_t i = 0; i < c->coll_ecount; i++) {
+        sprintf(respptr, "%s\r\n", (exist_array[i] ? "EXIST" : "NOT_EXIST"));
+        respptr += strlen(respptr);
+    }
+    sprintf(respptr, "END\r\n");
+    respptr += strlen(respptr);
+
+    if ((add_iov(c, respbuf, respptr - respbuf) != 0) ||
+        (IS_UDP(c->transport) && build_udp_headers(c) != 0)) {
+        free(c->coll_eitem);
+        c->coll_eitem = NULL;
+        out_string(c, "SERVER_ERROR out of memory writing mexist response");
+        return;
+    }
+    /* the response buffer is freed with c->coll_eitem */
+    conn_set_state(c, conn_mwrite);
+    c->msgcurr = 0;
+}
+
 static int make_mop_elem_response(char *bufptr, eitem_info *einfo)
 {
     char *tmpptr = bufptr;
@@ -2289,6 +2546,301 @@ static void process_bop_insert_complete(conn *c)
     }
 }
 
+static void process_coll_minsert_stats(conn *c, ENGINE_ERROR_CODE ret)
+{
+    bool is_hit = (ret == ENGINE_SUCCESS);
+
+    switch (c->coll_op) {
+    case OPERATION_LOP_MINSERT:
+        if (settings.detail_enabled) {
+            stats_prefix_record_lop_insert(c->coll_key, c->coll_nkey, is_hit);
+        }
+        if (is_hit) {
+            STATS_HITS(c, lop_insert, c->coll_key, c->coll_nkey);
+        } else if (ret == ENGINE_KEY_ENOENT) {
+            STATS_MISSES(c, lop_insert, c->coll_key, c->coll_nkey);
+        } else {
+            STATS_CMD_NOKEY(c, lop_insert);
+        }
+        break;
+    case OPERATION_SOP_MINSERT:
+        if (settings.detail_enabled) {
+            stats_prefix_record_sop_insert(c->coll_key, c->coll_nkey, is_hit);
+        }
+        if (is_hit) {
+            STATS_HITS(c, sop_insert, c->coll_key, c->coll_nkey);
+        } else if (ret == ENGINE_KEY_ENOENT) {
+            STATS_MISSES(c, sop_insert, c->coll_key, c->coll_nkey);
+        } else {
+            STATS_CMD_NOKEY(c, sop_insert);
+        }
+        break;
+    case OPERATION_MOP_MINSERT:
+        if (settings.detail_enabled) {
+            stats_prefix_record_mop_insert(c->coll_key, c->coll_nkey, is_hit);
+        }
+        if (is_hit) {
+            STATS_HITS(c, mop_insert, c->coll_key, c->coll_nkey);
+        } else if (ret == ENGINE_KEY_ENOENT) {
+            STATS_MISSES(c, mop_insert, c->coll_key, c->coll_nkey);
+        } else {
+            STATS_CMD_NOKEY(c, mop_insert);
+        }
+        break;
+    default: /* OPERATION_BOP_MINSERT */
+        if (settings.detail_enabled) {
+            stats_prefix_record_bop_insert(c->coll_key, c->coll_nkey, is_hit);
+        }
+        if (is_hit) {
+            STATS_HITS(c, bop_insert, c->coll_key, c->coll_nkey);
+        } else if (ret == ENGINE_KEY_ENOENT) {
+            STATS_MISSES(c, bop_insert, c->coll_key, c->coll_nkey);
+        } else {
+            STATS_CMD_NOKEY(c, bop_insert);
+        }
+    }
+}
+
+static void process_coll_minsert_elem_free(conn *c, eitem *elem)
+{
+    switch (c->coll_op) {
+    case OPERATION_LOP_MINSERT:
+        mc_engine.v1->list_elem_free(mc_engine.v0, c, elem);
+        break;
+    case OPERATION_SOP_MINSERT:
+        mc_engine.v1->set_elem_free(mc_engine.v0, c, elem);
+        break;
+    case OPERATION_MOP_MINSERT:
+        mc_engine.v1->map_elem_free(mc_engine.v0, c, elem);
+        break;
+    default: /* OPERATION_BOP_MINSERT */
+        mc_engine.v1->btree_elem_free(mc_engine.v0, c, elem);
+    }
+}
+
+static ENGINE_ERROR_CODE
+process_coll_minsert_engine(conn *c, eitem **elem_array, uint32_t elem_count,
+                            bool *created, ENGINE_ERROR_CODE *eret_array, uint16_t vbucket)
+{
+    switch (c->coll_op) {
+    case OPERATION_LOP_MINSERT:
+        return mc_engine.v1->list_elem_minsert(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                               c->coll_index, elem_array, elem_count,
+                                               c->coll_attrp, created, eret_array, vbucket);
+    case OPERATION_SOP_MINSERT:
+        return mc_engine.v1->set_elem_minsert(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                              elem_array, elem_count,
+                                              c->coll_attrp, created, eret_array, vbucket);
+    case OPERATION_MOP_MINSERT:
+        return mc_engine.v1->map_elem_minsert(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                              elem_array, elem_count,
+                                              c->coll_attrp, created, eret_array, vbucket);
+    default: /* OPERATION_BOP_MINSERT */
+        return mc_engine.v1->btree_elem_minsert(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                                elem_array, elem_count,
+                                                c->coll_attrp, created, eret_array, vbucket);
+    }
+}
+
+static inline int get_bkey_from_str(const char *str, unsigned char *bkey);
+static inline int get_eflag_from_str(const char *str, unsigned char *eflag);
+
+static ENGINE_ERROR_CODE
+process_coll_minsert_read_elems(conn *c, eitem **elem_array, uint32_t *elem_count)
+{
+    mblck_reader_t reader;
+    token_t tokens[6];
+    char headbuf[MAX_MINSERT_HEAD_LENG+1];
+    unsigned char bkey[MAX_BKEY_LENG];
+    unsigned char eflag[MAX_EFLAG_LENG];
+    int headlen, ntokens;
+    int nbkey = 0, neflag = 0;
+    int32_t vlen;
+    ENGINE_ITEM_TYPE itype;
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+
+    *elem_count = 0;
+    mblck_reader_init(&reader, &c->memblist, MBLCK_GET_ITEMCNT(&c->memblist));
+    while (*elem_count < c->coll_ecount) {
+        /* element head line: <bytes> in lop and sop, <field> <bytes> in mop,
+         * and <bkey> [<eflag>] <bytes> in bop. */
+        headlen = mblck_reader_line(&reader, headbuf, sizeof(headbuf));
+        if (headlen <= 0) {
+            ret = ENGINE_EBADVALUE; break;
+        }
+        ntokens = tokenize_command(headbuf, headlen, tokens, 5);
+        if (tokens[ntokens-1].value != NULL ||
+            (c->coll_op == OPERATION_BOP_MINSERT ? (ntokens < 3 || ntokens > 4)
+             : ntokens != (c->coll_op == OPERATION_MOP_MINSERT ? 3 : 2))) {
+            ret = ENGINE_EBADVALUE; break;
+        }
+        if ((! safe_strtol(tokens[ntokens-2].value, &vlen)) ||
+            (vlen < 0 || vlen > (INT_MAX-2))) {
+            ret = ENGINE_EBADVALUE; break;
+        }
+        vlen += 2;
+        if (c->coll_op == OPERATION_BOP_MINSERT) {
+            nbkey = get_bkey_from_str(tokens[0].value, bkey);
+            neflag = (ntokens == 4 ? get_eflag_from_str(tokens[1].value, eflag) : 0);
+            if (nbkey == -1 || neflag == -1) {
+                ret = ENGINE_EBADVALUE; break;
+            }
+        } else if (c->coll_op == OPERATION_MOP_MINSERT) {
+            if (tokens[0].length > MAX_FIELD_LENG) {
+                ret = ENGINE_EBADVALUE; break;
+            }
+        }
+        if (vlen > settings.max_element_bytes) {
+            ret = ENGINE_E2BIG; break;
+        }
+
+        /* element data: <data>\r\n */
+        switch (c->coll_op) {
+        case OPERATION_LOP_MINSERT:
+            itype = ITEM_TYPE_LIST;
+            ret = mc_engine.v1->list_elem_alloc(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                                vlen, &elem_array[*elem_count]);
+            break;
+        case OPERATION_SOP_MINSERT:
+            itype = ITEM_TYPE_SET;
+            ret = mc_engine.v1->set_elem_alloc(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                               vlen, &elem_array[*elem_count]);
+            break;
+        case OPERATION_MOP_MINSERT:
+            itype = ITEM_TYPE_MAP;
+            ret = mc_engine.v1->map_elem_alloc(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                               tokens[0].length, vlen, &elem_array[*elem_count]);
+            break;
+        default: /* OPERATION_BOP_MINSERT */
+            itype = ITEM_TYPE_BTREE;
+            ret = mc_engine.v1->btree_elem_alloc(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                                 nbkey, neflag, vlen, &elem_array[*elem_count]);
+        }
+        if (ret != ENGINE_SUCCESS) {
+            break;
+        }
+        mc_engine.v1->get_elem_info(mc_engine.v0, c, itype,
+                                    elem_array[*elem_count], &c->einfo);
+        *elem_count += 1;
+        if (c->coll_op == OPERATION_BOP_MINSERT) {
+            memcpy((void*)c->einfo.score, bkey, (c->einfo.nscore==0 ? sizeof(uint64_t) : c->einfo.nscore));
+            if (c->einfo.neflag > 0)
+                memcpy((void*)c->einfo.eflag, eflag, c->einfo.neflag);
+        } else if (c->coll_op == OPERATION_MOP_MINSERT) {
+            /* copy the field string into the element item. */
+            memcpy((void*)c->einfo.score, tokens[0].value, tokens[0].length);
+        }
+        if (einfo_read_value_mblck(&c->einfo, &reader) != 0 ||
+            einfo_check_ascii_tail_string(&c->einfo) != 0) { /* check "\r\n" */
+            ret = ENGINE_EBADVALUE; break;
+        }
+    }
+    if (ret == ENGINE_SUCCESS && reader.tlen > 0) {
+        ret = ENGINE_EBADVALUE; /* more data than the given elements */
+    }
+    if (ret != ENGINE_SUCCESS) {
+        for (uint32_t i = 0; i < *elem_count; i++) {
+            process_coll_minsert_elem_free(c, elem_array[i]);
+        }
+        *elem_count = 0;
+    }
+    return ret;
+}
+
+static void process_coll_minsert_complete(conn *c)
+{
+    assert(c->coll_op == OPERATION_LOP_MINSERT || c->coll_op == OPERATION_SOP_MINSERT ||
+           c->coll_op == OPERATION_MOP_MINSERT || c->coll_op == OPERATION_BOP_MINSERT);
+    assert(c->coll_eitem != NULL);
+    eitem **elem_array = (eitem **)c->coll_eitem;
+    ENGINE_ERROR_CODE *eret_array = (ENGINE_ERROR_CODE *)&elem_array[c->coll_ecount];
+    char *respbuf = (char *)&eret_array[c->coll_ecount];
+    char *respptr = respbuf;
+    const char *respstr;
+    uint32_t elem_count;
+    uint32_t i;
+    bool created;
+    ENGINE_ERROR_CODE ret;
+
+    ret = process_coll_minsert_read_elems(c, elem_array, &elem_count);
+
+    /* free the element string memory blocks */
+    assert(c->coll_strkeys == (void*)&c->memblist);
+    mblck_list_free(&c->thread->mblck_pool, &c->memblist);
+    c->coll_strkeys = NULL;
+
+    if (ret == ENGINE_SUCCESS) {
+        ret = process_coll_minsert_engine(c, elem_array, elem_count, &created, eret_array, 0);
+        CONN_CHECK_AND_SET_EWOULDBLOCK(ret, c);
+        if (ret != ENGINE_SUCCESS) {
+            for (i = 0; i < elem_count; i++) {
+                process_coll_minsert_elem_free(c, elem_array[i]);
+            }
+        }
+    }
+
+    if (ret != ENGINE_SUCCESS) {
+        process_coll_minsert_stats(c, ret);
+        free(c->coll_eitem);
+        c->coll_eitem = NULL;
+
+        if (ret == ENGINE_KEY_ENOENT)        out_string(c, "NOT_FOUND");
+        else if (ret == ENGINE_EBADTYPE)     out_string(c, "TYPE_MISMATCH");
+        else if (ret == ENGINE_EBADVALUE)    out_string(c, "CLIENT_ERROR bad data chunk");
+        else if (ret == ENGINE_E2BIG)        out_string(c, "CLIENT_ERROR too large value");
+        else if (ret == ENGINE_PREFIX_ENAME) out_string(c, "CLIENT_ERROR invalid prefix name");
+        else if (ret == ENGINE_ENOMEM)       out_string(c, "SERVER_ERROR out of memory");
+        else handle_unexpected_errorcode_ascii(c, __func__, ret);
+        return;
+    }
+
+    /* make the response of each element */
+    sprintf(respptr, "RESPONSE %u\r\n", elem_count);
+    respptr += strlen(respptr);
+    for (i = 0; i < elem_count; i++) {
+        process_coll_minsert_stats(c, eret_array[i]);
+        if (eret_array[i] == ENGINE_SUCCESS) {
+            if (created) {
+                respstr = "CREATED_STORED";
+                created = false;
+            } else {
+                respstr = "STORED";
+            }
+        } else {
+            process_coll_minsert_elem_free(c, elem_array[i]);
+            if (eret_array[i] == ENGINE_EBADBKEY)          respstr = "BKEY_MISMATCH";
+            else if (eret_array[i] == ENGINE_EOVERFLOW)    respstr = "OVERFLOWED";
+            else if (eret_array[i] == ENGINE_EBKEYOOR)     respstr = "OUT_OF_RANGE";
+            else if (eret_array[i] == ENGINE_EINDEXOOR)    respstr = "OUT_OF_RANGE";
+            else if (eret_array[i] == ENGINE_ELEM_EEXISTS) respstr = "ELEMENT_EXISTS";
+            else if (eret_array[i] == ENGINE_ENOMEM)       respstr = "SERVER_ERROR out of memory";
+            else                                           respstr = "SERVER_ERROR internal";
+        }
+        sprintf(respptr, "%s\r\n", respstr);
+        respptr += strlen(respptr);
+    }
+    sprintf(respptr, "END\r\n");
+    respptr += strlen(respptr);
+
+    if (c->noreply) {
+        /* no response is written, but out_string() resets the noreply */
+        free(c->coll_eitem);
+        c->coll_eitem = NULL;
+        out_string(c, "END");
+        return;
+    }
+    if ((add_iov(c, respbuf, respptr - respbuf) != 0) ||
+        (IS_UDP(c->transport) && build_udp_headers(c) != 0)) {
+        free(c->coll_eitem);
+        c->coll_eitem = NULL;
+        out_string(c, "SERVER_ERROR out of memory writing minsert response");
+        return;
+    }
+    /* the response buffer is freed with c->coll_eitem */
+    conn_set_state(c, conn_mwrite);
+    c->msgcurr = 0;
+}
+
 static void process_bop_update_complete(conn *c)
 {
     assert(c->coll_op == OPERATION_BOP_UPDATE);
@@ -3155,6 +3707,7 @@ static void complete_update_ascii(conn *c)
         else if (c->coll_op == OPERATION_SOP_INSERT) process_sop_insert_complete(c);
         else if (c->coll_op == OPERATION_SOP_DELETE) process_sop_delete_complete(c);
         else if (c->coll_op == OPERATION_SOP_EXIST) process_sop_exist_complete(c);
+        else if (c->coll_op == OPERATION_SOP_MEXIST) process_sop_mexist_complete(c);
         else if (c->coll_op == OPERATION_MOP_INSERT) process_mop_insert_complete(c);
         else if (c->coll_op == OPERATION_MOP_UPDATE) process_mop_update_complete(c);
         else if (c->coll_op == OPERATION_MOP_DELETE) process_mop_delete_complete(c);
@@ -3162,6 +3715,10 @@ static void complete_update_ascii(conn *c)
         else if (c->coll_op == OPERATION_BOP_INSERT ||
                  c->coll_op == OPERATION_BOP_UPSERT) process_bop_insert_complete(c);
         else if (c->coll_op == OPERATION_BOP_UPDATE) process_bop_update_complete(c);
+        else if (c->coll_op == OPERATION_LOP_MINSERT ||
+                 c->coll_op == OPERATION_SOP_MINSERT ||
+                 c->coll_op == OPERATION_MOP_MINSERT ||
+                 c->coll_op == OPERATION_BOP_MINSERT) process_coll_minsert_complete(c);
 #ifdef SUPPORT_BOP_MGET
         else if (c->coll_op == OPERATION_BOP_MGET) process_bop_mget_complete(c);
 #endif
@@ -5086,16 +5643,178 @@ static void process_bin_sop_nread_complete(conn *c)
         process_bin_sop_exist_complete(c);
 }
 
-static ENGINE_ERROR_CODE
-out_bin_sop_get_response(conn *c, bool delete, struct elems_result *eresultp)
+static void process_bin_sop_mexist_prepare_nread(conn *c)
 {
-    protocol_binary_response_sop_get* rsp = (protocol_binary_response_sop_get*)c->wbuf;
-    eitem  **elem_array = eresultp->elem_array;
-    uint32_t elem_count = eresultp->elem_count;
-    uint32_t bodylen;
-    uint32_t *vlenptr;
-    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
-
+    assert(c != NULL);
+    assert(c->cmd == PROTOCOL_BINARY_CMD_SOP_MEXIST);
+    char *key = binary_get_key(c);
+    uint32_t nkey = c->binary_header.request.keylen;
+    uint32_t vlen = c->binary_header.request.bodylen - (nkey + c->binary_header.request.extlen);
+
+    /* fix byteorder in the request */
+    protocol_binary_request_sop_mexist* req = binary_get_request(c);
+    uint32_t count = ntohl(req->message.body.count);
+
+    if (settings.verbose > 1) {
+        fprintf(stderr, "<%d SOP MEXIST ", c->sfd);
+        for (int ii = 0; ii < nkey; ++ii) {
+            fprintf(stderr, "%c", key[ii]);
+        }
+        fprintf(stderr, " Count(%u) NBytes(%u)\n", count, vlen);
+    }
+
+    if (count == 0 || count > MAX_SMEXIST_VAL_COUNT ||
+        vlen < (count * sizeof(uint32_t))) {
+        if (settings.detail_enabled)
+            stats_prefix_record_sop_exist(key, nkey, false);
+        STATS_CMD_NOKEY(c, sop_exist);
+        write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_EINVAL, vlen);
+        return;
+    }
+    if (vlen > (count * (sizeof(uint32_t) + settings.max_element_bytes))) {
+        if (settings.detail_enabled)
+            stats_prefix_record_sop_exist(key, nkey, false);
+        STATS_CMD_NOKEY(c, sop_exist);
+        write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_E2BIG, vlen);
+        return;
+    }
+
+    /* the value, length and existence arrays, the received values,
+     * the values copied with "\r\n" and the existence bitmap */
+    int need_size = count * (sizeof(void*) + sizeof(uint32_t) + sizeof(bool))
+                  + vlen + vlen + ((count + 7) / 8);
+    char *buffer = (char *)malloc(need_size);
+    if (buffer == NULL) {
+        if (settings.detail_enabled)
+            stats_prefix_record_sop_exist(key, nkey, false);
+        STATS_CMD_NOKEY(c, sop_exist);
+        write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_ENOMEM, vlen);
+        return;
+    }
+
+    c->ritem   = buffer + count * (sizeof(void*) + sizeof(uint32_t) + sizeof(bool));
+    c->rlbytes = vlen;
+    c->rltotal = 0;
+    c->coll_eitem  = (void *)buffer;
+    c->coll_ecount = count;
+    c->coll_op     = OPERATION_SOP_MEXIST;
+    c->coll_key    = key;
+    c->coll_nkey   = nkey;
+    conn_set_state(c, conn_nread);
+    c->substate = bin_reading_sop_mexist_nread_complete;
+}
+
+static void process_bin_sop_mexist_complete(conn *c)
+{
+    assert(c->coll_op == OPERATION_SOP_MEXIST);
+    assert(c->coll_eitem != NULL);
+    const void **value_array = (const void **)c->coll_eitem;
+    uint32_t *nbytes_array = (uint32_t *)&value_array[c->coll_ecount];
+    bool *exist_array = (bool *)&nbytes_array[c->coll_ecount];
+    char *readptr = (char *)&exist_array[c->coll_ecount];
+    uint32_t readlen = c->binary_header.request.bodylen
+                     - (c->binary_header.request.keylen + c->binary_header.request.extlen);
+    char *dataptr = readptr + readlen;
+    unsigned char *bitmap;
+    uint32_t bitmap_len = (c->coll_ecount + 7) / 8;
+    uint32_t vlen;
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+
+    /* We don't actually receive the trailing two characters in the bin
+     * protocol, so the values are copied with them. */
+    for (uint32_t i = 0; i < c->coll_ecount; i++) {
+        if (readlen < sizeof(uint32_t)) {
+            ret = ENGINE_EBADVALUE; break;
+        }
+        memcpy(&vlen, readptr, sizeof(uint32_t));
+        vlen = ntohl(vlen);
+        readptr += sizeof(uint32_t);
+        readlen -= sizeof(uint32_t);
+        if (vlen > readlen) {
+            ret = ENGINE_EBADVALUE; break;
+        }
+        if ((vlen + 2) > settings.max_element_bytes) {
+            ret = ENGINE_E2BIG; break;
+        }
+        memcpy(dataptr, readptr, vlen);
+        memcpy(dataptr + vlen, "\r\n", 2);
+        value_array[i] = dataptr;
+        nbytes_array[i] = vlen + 2;
+        dataptr += (vlen + 2);
+        readptr += vlen;
+        readlen -= vlen;
+    }
+    if (ret == ENGINE_SUCCESS && readlen > 0) {
+        ret = ENGINE_EBADVALUE; /* more data than the given values */
+    }
+
+    if (ret == ENGINE_SUCCESS) {
+        ret = mc_engine.v1->set_elem_mexist(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                            value_array, nbytes_array, c->coll_ecount,
+                                            exist_array, c->binary_header.request.vbucket);
+    }
+
+    if (settings.detail_enabled) {
+        stats_prefix_record_sop_exist(c->coll_key, c->coll_nkey, (ret==ENGINE_SUCCESS));
+    }
+
+    switch (ret) {
+    case ENGINE_SUCCESS:
+        {
+        STATS_HITS(c, sop_exist, c->coll_key, c->coll_nkey);
+
+        /* the bitmap is made where the values were received */
+        bitmap = (unsigned char *)&exist_array[c->coll_ecount];
+        memset(bitmap, 0, bitmap_len);
+        for (uint32_t i = 0; i < c->coll_ecount; i++) {
+            if (exist_array[i]) bitmap[i / 8] |= (1 << (i % 8));
+        }
+
+        protocol_binary_response_sop_mexist* rsp = (protocol_binary_response_sop_mexist*)c->wbuf;
+        add_bin_header(c, 0, sizeof(rsp->message.body), 0,
+                       sizeof(rsp->message.body) + bitmap_len);
+        rsp->message.body.count = htonl(c->coll_ecount);
+        add_iov(c, &rsp->message.body, sizeof(rsp->message.body));
+        add_iov(c, bitmap, bitmap_len);
+        /* the bitmap is freed with c->coll_eitem */
+        conn_set_state(c, conn_mwrite);
+        }
+        return;
+    case ENGINE_KEY_ENOENT:
+    case ENGINE_UNREADABLE:
+        STATS_MISSES(c, sop_exist, c->coll_key, c->coll_nkey);
+        if (ret == ENGINE_KEY_ENOENT)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_KEY_ENOENT, 0);
+        else
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_UNREADABLE, 0);
+        break;
+    default:
+        STATS_CMD_NOKEY(c, sop_exist);
+        if (ret == ENGINE_EBADTYPE)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_EBADTYPE, 0);
+        else if (ret == ENGINE_EBADVALUE)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_EINVAL, 0);
+        else if (ret == ENGINE_E2BIG)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_E2BIG, 0);
+        else
+            handle_unexpected_errorcode_bin(c, __func__, ret, 0);
+    }
+
+    /* release the c->coll_eitem reference */
+    free(c->coll_eitem);
+    c->coll_eitem = NULL;
+}
+
+static ENGINE_ERROR_CODE
+out_bin_sop_get_response(conn *c, bool delete, struct elems_result *eresultp)
+{
+    protocol_binary_response_sop_get* rsp = (protocol_binary_response_sop_get*)c->wbuf;
+    eitem  **elem_array = eresultp->elem_array;
+    uint32_t elem_count = eresultp->elem_count;
+    uint32_t bodylen;
+    uint32_t *vlenptr;
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+
     do {
         bodylen = sizeof(rsp->message.body) + (elem_count * sizeof(uint32_t));
         if ((vlenptr = (uint32_t*)malloc(elem_count * sizeof(uint32_t))) == NULL) {
@@ -6463,6 +7182,306 @@ static void process_bin_bop_nread_keys_complete(conn *c)
 }
 #endif
 
+static void process_bin_coll_minsert_prepare_nread(conn *c)
+{
+    assert(c != NULL);
+    assert(c->cmd == PROTOCOL_BINARY_CMD_LOP_MINSERT ||
+           c->cmd == PROTOCOL_BINARY_CMD_SOP_MINSERT ||
+           c->cmd == PROTOCOL_BINARY_CMD_BOP_MINSERT);
+    char *key = binary_get_key(c);
+    uint32_t nkey = c->binary_header.request.keylen;
+    uint32_t vlen = c->binary_header.request.bodylen - (nkey + c->binary_header.request.extlen);
+    uint32_t count;
+    uint32_t elem_head_size; /* max size of the element fields before the data */
+    uint8_t create;
+
+    /* fix byteorder in the request */
+    if (c->cmd == PROTOCOL_BINARY_CMD_LOP_MINSERT) {
+        protocol_binary_request_lop_minsert* req = binary_get_request(c);
+        c->coll_op    = OPERATION_LOP_MINSERT;
+        c->coll_index = ntohl(req->message.body.index);
+        count  = ntohl(req->message.body.count);
+        create = req->message.body.create;
+        c->coll_attr_space.flags    = req->message.body.flags;
+        c->coll_attr_space.exptime  = ntohl(req->message.body.exptime);
+        c->coll_attr_space.maxcount = ntohl(req->message.body.maxcount);
+        elem_head_size = sizeof(uint32_t);
+    } else {
+        /* sop and bop minsert have the same extras */
+        protocol_binary_request_sop_minsert* req = binary_get_request(c);
+        c->coll_op = (c->cmd == PROTOCOL_BINARY_CMD_SOP_MINSERT ? OPERATION_SOP_MINSERT
+                                                                : OPERATION_BOP_MINSERT);
+        count  = ntohl(req->message.body.count);
+        create = req->message.body.create;
+        c->coll_attr_space.flags    = req->message.body.flags;
+        c->coll_attr_space.exptime  = ntohl(req->message.body.exptime);
+        c->coll_attr_space.maxcount = ntohl(req->message.body.maxcount);
+        elem_head_size = (c->cmd == PROTOCOL_BINARY_CMD_SOP_MINSERT ? sizeof(uint32_t)
+                          : (1+MAX_BKEY_LENG) + (1+MAX_EFLAG_LENG) + sizeof(uint32_t));
+    }
+    c->coll_key  = key;
+    c->coll_nkey = nkey;
+
+    if (settings.verbose > 1) {
+        fprintf(stderr, "<%d %s MINSERT ", c->sfd,
+                (c->coll_op == OPERATION_LOP_MINSERT ? "LOP" :
+                 c->coll_op == OPERATION_SOP_MINSERT ? "SOP" : "BOP"));
+        for (int ii = 0; ii < nkey; ++ii) {
+            fprintf(stderr, "%c", key[ii]);
+        }
+        fprintf(stderr, " Count(%u) NBytes(%u)", count, vlen);
+        if (create) {
+            fprintf(stderr, " %s", "Create");
+        }
+        fprintf(stderr, "\n");
+    }
+
+    if (count == 0 || count > MAX_MINSERT_ELM_COUNT ||
+        vlen < (count * sizeof(uint32_t))) {
+        process_coll_minsert_stats(c, ENGINE_EINVAL);
+        write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_EINVAL, vlen);
+        return;
+    }
+    if (vlen > (count * (elem_head_size + settings.max_element_bytes))) {
+        process_coll_minsert_stats(c, ENGINE_E2BIG);
+        write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_E2BIG, vlen);
+        return;
+    }
+
+    /* the element, result and status arrays, and the received elements */
+    int need_size = count * (sizeof(eitem*) + sizeof(ENGINE_ERROR_CODE) + sizeof(uint16_t))
+                  + vlen;
+    char *buffer = (char *)malloc(need_size);
+    if (buffer == NULL) {
+        process_coll_minsert_stats(c, ENGINE_ENOMEM);
+        write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_ENOMEM, vlen);
+        return;
+    }
+
+    if (create) {
+        c->coll_attrp = &c->coll_attr_space; /* create if not exist */
+        c->coll_attrp->exptime  = realtime(c->coll_attrp->exptime);
+        c->coll_attrp->readable = 1;
+    } else {
+        c->coll_attrp = NULL;
+    }
+    c->ritem   = buffer + count * (sizeof(eitem*) + sizeof(ENGINE_ERROR_CODE) + sizeof(uint16_t));
+    c->rlbytes = vlen;
+    c->rltotal = 0;
+    c->coll_eitem  = (void *)buffer;
+    c->coll_ecount = count;
+    conn_set_state(c, conn_nread);
+    c->substate = bin_reading_coll_minsert_nread_complete;
+}
+
+/* copy the data received without the trailing "\r\n" into the element value */
+static void einfo_copy_value_bin(eitem_info *einfo, const char *data)
+{
+    uint32_t left = einfo->nbytes - 2;
+    uint32_t copy;
+
+    if (einfo->naddnl == 0) {
+        memcpy((char*)einfo->value, data, left);
+    } else {
+        copy = einfo->nvalue < left ? einfo->nvalue : left;
+        memcpy((char*)einfo->value, data, copy);
+        data += copy; left -= copy;
+        for (int i = 0; i < einfo->naddnl && left > 0; i++) {
+            copy = einfo->addnl[i]->len < left ? einfo->addnl[i]->len : left;
+            memcpy(einfo->addnl[i]->ptr, data, copy);
+            data += copy; left -= copy;
+        }
+    }
+    einfo_set_ascii_tail_string(einfo);
+}
+
+/*
+ * The received value is the list of the elements, each of which is
+ * <length(uint32_t)><data> in lop and sop, and
+ * <nbkey(uint8_t)><bkey><neflag(uint8_t)><eflag><length(uint32_t)><data> in bop.
+ * The bkey is 8 bytes of uint64_t if nbkey is 0.
+ */
+static ENGINE_ERROR_CODE
+process_bin_coll_minsert_read_elems(conn *c, char *readptr, uint32_t readlen,
+                                    eitem **elem_array, uint32_t *elem_count)
+{
+    unsigned char bkey[MAX_BKEY_LENG];
+    unsigned char eflag[MAX_EFLAG_LENG];
+    uint8_t nbkey = 0, neflag = 0;
+    uint32_t nbkey_size;
+    uint32_t vlen;
+    ENGINE_ITEM_TYPE itype;
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+
+    *elem_count = 0;
+    while (*elem_count < c->coll_ecount) {
+        if (c->coll_op == OPERATION_BOP_MINSERT) {
+            if (readlen < 1) {
+                ret = ENGINE_EBADVALUE; break;
+            }
+            nbkey = (uint8_t)*readptr;
+            nbkey_size = (nbkey == 0 ? sizeof(uint64_t) : nbkey);
+            if (nbkey > MAX_BKEY_LENG || readlen < (1 + nbkey_size + 1)) {
+                ret = ENGINE_EBADVALUE; break;
+            }
+            memcpy(bkey, readptr + 1, nbkey_size);
+            if (nbkey == 0) {
+                uint64_t bkey_temp;
+                memcpy((uint8_t*)&bkey_temp, bkey, sizeof(uint64_t));
+                bkey_temp = ntohll(bkey_temp);
+                memcpy(bkey, (uint8_t*)&bkey_temp, sizeof(uint64_t));
+            }
+            readptr += (1 + nbkey_size);
+            readlen -= (1 + nbkey_size);
+
+            neflag = (uint8_t)*readptr;
+            if (neflag > MAX_EFLAG_LENG || readlen < (1 + neflag)) {
+                ret = ENGINE_EBADVALUE; break;
+            }
+            memcpy(eflag, readptr + 1, neflag);
+            readptr += (1 + neflag);
+            readlen -= (1 + neflag);
+        }
+        if (readlen < sizeof(uint32_t)) {
+            ret = ENGINE_EBADVALUE; break;
+        }
+        memcpy(&vlen, readptr, sizeof(uint32_t));
+        vlen = ntohl(vlen);
+        readptr += sizeof(uint32_t);
+        readlen -= sizeof(uint32_t);
+        if (vlen > readlen) {
+            ret = ENGINE_EBADVALUE; break;
+        }
+        if ((vlen + 2) > settings.max_element_bytes) {
+            ret = ENGINE_E2BIG; break;
+        }
+
+        switch (c->coll_op) {
+        case OPERATION_LOP_MINSERT:
+            itype = ITEM_TYPE_LIST;
+            ret = mc_engine.v1->list_elem_alloc(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                                vlen+2, &elem_array[*elem_count]);
+            break;
+        case OPERATION_SOP_MINSERT:
+            itype = ITEM_TYPE_SET;
+            ret = mc_engine.v1->set_elem_alloc(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                               vlen+2, &elem_array[*elem_count]);
+            break;
+        default: /* OPERATION_BOP_MINSERT */
+            itype = ITEM_TYPE_BTREE;
+            ret = mc_engine.v1->btree_elem_alloc(mc_engine.v0, c, c->coll_key, c->coll_nkey,
+                                                 nbkey, neflag, vlen+2, &elem_array[*elem_count]);
+        }
+        if (ret != ENGINE_SUCCESS) {
+            break;
+        }
+        mc_engine.v1->get_elem_info(mc_engine.v0, c, itype,
+                                    elem_array[*elem_count], &c->einfo);
+        *elem_count += 1;
+        if (c->coll_op == OPERATION_BOP_MINSERT) {
+            memcpy((void*)c->einfo.score, bkey, (c->einfo.nscore==0 ? sizeof(uint64_t) : c->einfo.nscore));
+            if (c->einfo.neflag > 0)
+                memcpy((void*)c->einfo.eflag, eflag, c->einfo.neflag);
+        }
+        /* We don't actually receive the trailing two characters in the bin
+         * protocol, so they are set with the value. */
+        einfo_copy_value_bin(&c->einfo, readptr);
+        readptr += vlen;
+        readlen -= vlen;
+    }
+    if (ret == ENGINE_SUCCESS && readlen > 0) {
+        ret = ENGINE_EBADVALUE; /* more data than the given elements */
+    }
+    if (ret != ENGINE_SUCCESS) {
+        for (uint32_t i = 0; i < *elem_count; i++) {
+            process_coll_minsert_elem_free(c, elem_array[i]);
+        }
+        *elem_count = 0;
+    }
+    return ret;
+}
+
+static void process_bin_coll_minsert_complete(conn *c)
+{
+    assert(c->coll_op == OPERATION_LOP_MINSERT ||
+           c->coll_op == OPERATION_SOP_MINSERT ||
+           c->coll_op == OPERATION_BOP_MINSERT);
+    assert(c->coll_eitem != NULL);
+    eitem **elem_array = (eitem **)c->coll_eitem;
+    ENGINE_ERROR_CODE *eret_array = (ENGINE_ERROR_CODE *)&elem_array[c->coll_ecount];
+    uint16_t *status_array = (uint16_t *)&eret_array[c->coll_ecount];
+    char *readptr = (char *)&status_array[c->coll_ecount];
+    uint32_t readlen = c->binary_header.request.bodylen
+                     - (c->binary_header.request.keylen + c->binary_header.request.extlen);
+    protocol_binary_response_status status;
+    uint32_t elem_count;
+    uint32_t i;
+    bool created;
+    ENGINE_ERROR_CODE ret;
+
+    ret = process_bin_coll_minsert_read_elems(c, readptr, readlen, elem_array, &elem_count);
+    if (ret == ENGINE_SUCCESS) {
+        ret = process_coll_minsert_engine(c, elem_array, elem_count, &created, eret_array,
+                                          c->binary_header.request.vbucket);
+        CONN_CHECK_AND_SET_EWOULDBLOCK(ret, c);
+        if (ret != ENGINE_SUCCESS) {
+            for (i = 0; i < elem_count; i++) {
+                process_coll_minsert_elem_free(c, elem_array[i]);
+            }
+        }
+    }
+
+    if (ret != ENGINE_SUCCESS) {
+        process_coll_minsert_stats(c, ret);
+        if (ret == ENGINE_KEY_ENOENT)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_KEY_ENOENT, 0);
+        else if (ret == ENGINE_EBADTYPE)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_EBADTYPE, 0);
+        else if (ret == ENGINE_EBADVALUE)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_EINVAL, 0);
+        else if (ret == ENGINE_E2BIG)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_E2BIG, 0);
+        else if (ret == ENGINE_PREFIX_ENAME)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_PREFIX_ENAME, 0);
+        else if (ret == ENGINE_ENOMEM)
+            write_bin_packet(c, PROTOCOL_BINARY_RESPONSE_ENOMEM, 0);
+        else
+            handle_unexpected_errorcode_bin(c, __func__, ret, 0);
+
+        /* release the c->coll_eitem reference */
+        free(c->coll_eitem);
+        c->coll_eitem = NULL;
+        return;
+    }
+
+    /* make the status of each element */
+    for (i = 0; i < elem_count; i++) {
+        process_coll_minsert_stats(c, eret_array[i]);
+        if (eret_array[i] == ENGINE_SUCCESS) {
+            status = PROTOCOL_BINARY_RESPONSE_SUCCESS;
+        } else {
+            process_coll_minsert_elem_free(c, elem_array[i]);
+            if (eret_array[i] == ENGINE_EBADBKEY)          status = PROTOCOL_BINARY_RESPONSE_EBADBKEY;
+            else if (eret_array[i] == ENGINE_EOVERFLOW)    status = PROTOCOL_BINARY_RESPONSE_EOVERFLOW;
+            else if (eret_array[i] == ENGINE_EBKEYOOR)     status = PROTOCOL_BINARY_RESPONSE_EBKEYOOR;
+            else if (eret_array[i] == ENGINE_EINDEXOOR)    status = PROTOCOL_BINARY_RESPONSE_EINDEXOOR;
+            else if (eret_array[i] == ENGINE_ELEM_EEXISTS) status = PROTOCOL_BINARY_RESPONSE_ELEM_EEXISTS;
+            else if (eret_array[i] == ENGINE_ENOMEM)       status = PROTOCOL_BINARY_RESPONSE_ENOMEM;
+            else                                           status = PROTOCOL_BINARY_RESPONSE_EINTERNAL;
+        }
+        status_array[i] = htons(status);
+    }
+
+    protocol_binary_response_coll_minsert* rsp = (protocol_binary_response_coll_minsert*)c->wbuf;
+    add_bin_header(c, 0, sizeof(rsp->message.body), 0,
+                   sizeof(rsp->message.body) + elem_count * sizeof(uint16_t));
+    rsp->message.body.count = htonl(elem_count);
+    add_iov(c, &rsp->message.body, sizeof(rsp->message.body));
+    add_iov(c, status_array, elem_count * sizeof(uint16_t));
+    /* the status array is freed with c->coll_eitem */
+    conn_set_state(c, conn_mwrite);
+}
+
 static void process_bin_getattr(conn *c)
 {
     assert(c != NULL);
@@ -6968,6 +7987,28 @@ static void dispatch_bin_command(conn *c)
             protocol_error = 1;
         }
         break;
+    case PROTOCOL_BINARY_CMD_SOP_MEXIST:
+        if (keylen > 0 && extlen == 4 && bodylen > (keylen + extlen)) {
+            bin_read_key(c, bin_reading_sop_mexist_prepare_nread, 4);
+        } else {
+            protocol_error = 1;
+        }
+        break;
+    case PROTOCOL_BINARY_CMD_LOP_MINSERT:
+        if (keylen > 0 && extlen == 24 && bodylen > (keylen + extlen)) {
+            bin_read_key(c, bin_reading_coll_minsert_prepare_nread, 24);
+        } else {
+            protocol_error = 1;
+        }
+        break;
+    case PROTOCOL_BINARY_CMD_SOP_MINSERT:
+    case PROTOCOL_BINARY_CMD_BOP_MINSERT:
+        if (keylen > 0 && extlen == 20 && bodylen > (keylen + extlen)) {
+            bin_read_key(c, bin_reading_coll_minsert_prepare_nread, 20);
+        } else {
+            protocol_error = 1;
+        }
+        break;
     case PROTOCOL_BINARY_CMD_BOP_CREATE:
         if (keylen > 0 && extlen == 16 && bodylen == (keylen + extlen)) {
             bin_read_key(c, bin_reading_bop_create, 16);
@@ -7420,6 +8461,18 @@ static void complete_nread_binary(conn *c)
     case bin_reading_sop_get:
         process_bin_sop_get(c);
         break;
+    case bin_reading_sop_mexist_prepare_nread:
+        process_bin_sop_mexist_prepare_nread(c);
+        break;
+    case bin_reading_sop_mexist_nread_complete:
+        process_bin_sop_mexist_complete(c);
+        break;
+    case bin_reading_coll_minsert_prepare_nread:
+        process_bin_coll_minsert_prepare_nread(c);
+        break;
+    case bin_reading_coll_minsert_nread_complete:
+        process_bin_coll_minsert_complete(c);
+        break;
     case bin_reading_bop_create:
         process_bin_bop_create(c);
         break;
@@ -7869,6 +8922,7 @@ static void server_stats(ADD_STAT add_stats, conn *c, bool aggregate)
     APPEND_STAT("reject_connections", "%u", mc_stats.rejected_conns);
     APPEND_STAT("total_connections", "%u", mc_stats.total_conns);
     APPEND_STAT("connection_structures", "%u", mc_stats.conn_structs);
+    APPEND_STAT("migrated_connections", "%u", mc_stats.migrated_conns);
     APPEND_STAT("cmd_get", "%"PRIu64, thread_stats.cmd_get);
     APPEND_STAT("cmd_set", "%"PRIu64, thread_stats.cmd_set);
     APPEND_STAT("cmd_incr", "%"PRIu64, thread_stats.cmd_incr);
@@ -8000,6 +9054,7 @@ static void server_stats(ADD_STAT add_stats, conn *c, bool aggregate)
     APPEND_STAT("limit_maxbytes", "%"PRIu64, settings.maxbytes);
     APPEND_STAT("threads", "%d", settings.num_threads);
     APPEND_STAT("conn_yields", "%"PRIu64, thread_stats.conn_yields);
+    APPEND_STAT("zerocopy_sends", "%"PRIu64, thread_stats.zerocopy_sends);
     UNLOCK_STATS();
 }
 
@@ -8035,6 +9090,14 @@ static void process_stat_settings(ADD_STAT add_stats, void *c)
     APPEND_STAT("tcp_backlog", "%d", settings.backlog);
     APPEND_STAT("binding_protocol", "%s",
                 prot_text(settings.binding_protocol));
+    APPEND_STAT("tcp_listen_mode", "%s",
+                listen_mode_text(settings.listen_mode));
+    APPEND_STAT("tcp_cpu_steering", "%s", cpu_steering ? "yes" : "no");
+    APPEND_STAT("conn_placement", "%s",
+                placement_text(settings.conn_placement));
+    APPEND_STAT("conn_migrate", "%s", settings.conn_migrate ? "yes" : "no");
+    APPEND_STAT("io_backend", "%s", io_backend_text(settings.io_backend));
+    APPEND_STAT("zerocopy_size", "%zu", settings.zerocopy_size);
 #ifdef SASL_ENABLED
     APPEND_STAT("auth_enabled_sasl", "%s", "yes");
 #else
@@ -8934,42 +9997,90 @@ static void process_scrubcount_command(conn *c, token_t *tokens, const size_t nt
     }
 }
 
-static void process_verbosity_command(conn *c, token_t *tokens, const size_t ntokens)
+static void process_slabautomove_command(conn *c, token_t *tokens, const size_t ntokens)
 {
-    assert(c != NULL);
     char *config_key = tokens[SUBCOMMAND_TOKEN].value;
     char *config_val = tokens[SUBCOMMAND_TOKEN+1].value;
-    unsigned int level;
+    ENGINE_ERROR_CODE ret;
+    uint32_t automove;
 
     if (ntokens == 3) {
-        char buf[50];
-        sprintf(buf, "verbosity %d\r\nEND", settings.verbose);
-        out_string(c, buf);
-    } else if (ntokens == 4 && safe_strtoul(config_val, &level)) {
-        if (level > MAX_VERBOSITY_LEVEL) {
-            out_string(c, "SERVER_ERROR cannot change the verbosity over the limit");
-            return;
+        ret = mc_engine.v1->get_config(mc_engine.v0, c, config_key, (void*)&automove);
+        if (ret == ENGINE_SUCCESS) {
+            char buf[50];
+            sprintf(buf, "slab_automove %u\r\nEND", automove);
+            out_string(c, buf);
+        } else {
+            handle_unexpected_errorcode_ascii(c, __func__, ret);
         }
-        LOCK_SETTING();
-        mc_engine.v1->set_config(mc_engine.v0, c, config_key, (void*)&level);
-        settings.verbose = level;
-        perform_callbacks(ON_LOG_LEVEL, NULL, NULL);
-        UNLOCK_SETTING();
-        out_string(c, "END");
+    } else if (ntokens == 4 && safe_strtoul(config_val, &automove)) {
+        ret = mc_engine.v1->set_config(mc_engine.v0, c, config_key, (void*)&automove);
+        if (ret == ENGINE_SUCCESS)        out_string(c, "END");
+        else if (ret == ENGINE_EBADVALUE) out_string(c, "CLIENT_ERROR bad value");
+        else handle_unexpected_errorcode_ascii(c, __func__, ret);
     } else {
         print_invalid_command(c, tokens, ntokens);
         out_string(c, "CLIENT_ERROR bad command line format");
     }
 }
 
-static void process_config_command(conn *c, token_t *tokens, const size_t ntokens)
+static void process_slabsreassign_command(conn *c, token_t *tokens, const size_t ntokens)
 {
     char *config_key = tokens[SUBCOMMAND_TOKEN].value;
+    uint32_t clsids[2]; /* src, dst */
 
-    if (ntokens < 3 || ntokens > 4) {
+    if (ntokens == 5 && safe_strtoul(tokens[SUBCOMMAND_TOKEN+1].value, &clsids[0])
+                     && safe_strtoul(tokens[SUBCOMMAND_TOKEN+2].value, &clsids[1])) {
+        ENGINE_ERROR_CODE ret;
+        ret = mc_engine.v1->set_config(mc_engine.v0, c, config_key, (void*)clsids);
+        if (ret == ENGINE_SUCCESS)          out_string(c, "END");
+        else if (ret == ENGINE_EBADVALUE)   out_string(c, "CLIENT_ERROR bad value");
+        else if (ret == ENGINE_ENOMEM)      out_string(c, "SERVER_ERROR no spare page");
+        else if (ret == ENGINE_EWOULDBLOCK) out_string(c, "SERVER_ERROR busy page");
+        else handle_unexpected_errorcode_ascii(c, __func__, ret);
+    } else {
         print_invalid_command(c, tokens, ntokens);
         out_string(c, "CLIENT_ERROR bad command line format");
-        return;
+    }
+}
+
+static void process_verbosity_command(conn *c, token_t *tokens, const size_t ntokens)
+{
+    assert(c != NULL);
+    char *config_key = tokens[SUBCOMMAND_TOKEN].value;
+    char *config_val = tokens[SUBCOMMAND_TOKEN+1].value;
+    unsigned int level;
+
+    if (ntokens == 3) {
+        char buf[50];
+        sprintf(buf, "verbosity %d\r\nEND", settings.verbose);
+        out_string(c, buf);
+    } else if (ntokens == 4 && safe_strtoul(config_val, &level)) {
+        if (level > MAX_VERBOSITY_LEVEL) {
+            out_string(c, "SERVER_ERROR cannot change the verbosity over the limit");
+            return;
+        }
+        LOCK_SETTING();
+        mc_engine.v1->set_config(mc_engine.v0, c, config_key, (void*)&level);
+        settings.verbose = level;
+        perform_callbacks(ON_LOG_LEVEL, NULL, NULL);
+        UNLOCK_SETTING();
+        out_string(c, "END");
+    } else {
+        print_invalid_command(c, tokens, ntokens);
+        out_string(c, "CLIENT_ERROR bad command line format");
+    }
+}
+
+static void process_config_command(conn *c, token_t *tokens, const size_t ntokens)
+{
+    char *config_key = tokens[SUBCOMMAND_TOKEN].value;
+
+    if (ntokens < 3 || ntokens > 5 ||
+        (ntokens == 5 && strcmp(config_key, "slabs_reassign") != 0)) {
+        print_invalid_command(c, tokens, ntokens);
+        out_string(c, "CLIENT_ERROR bad command line format");
+        return;
     }
 
     if (strcmp(config_key, "maxconns") == 0) {
@@ -8996,6 +10107,12 @@ static void process_config_command(conn *c, token_t *tokens, const size_t ntoken
     else if (strcmp(config_key, "scrub_count") == 0) {
         process_scrubcount_command(c, tokens, ntokens);
     }
+    else if (strcmp(config_key, "slab_automove") == 0) {
+        process_slabautomove_command(c, tokens, ntokens);
+    }
+    else if (strcmp(config_key, "slabs_reassign") == 0) {
+        process_slabsreassign_command(c, tokens, ntokens);
+    }
 #ifdef ENABLE_ZK_INTEGRATION
     else if (strcmp(config_key, "zkfailstop") == 0) {
         process_zkfailstop_command(c, tokens, ntokens);
@@ -9253,6 +10370,8 @@ static void process_help_command(conn *c, token_t *tokens, const size_t ntokens)
         "\t" "config max_btree_size [<maxsize>]\\r\\n" "\n"
         "\t" "config max_element_bytes [<maxbytes>]\\r\\n" "\n"
         "\t" "config scrub_count [<count>]\\r\\n" "\n"
+        "\t" "config slab_automove [<0|1|2>]\\r\\n" "\n"
+        "\t" "config slabs_reassign <src_clsid> <dst_clsid>\\r\\n" "\n"
 #ifdef ENABLE_ZK_INTEGRATION
         "\t" "config hbtimeout [<hbtimeout>]\\r\\n" "\n"
         "\t" "config hbfailstop [<hbfailstop>]\\r\\n" "\n"
@@ -9559,6 +10678,113 @@ static inline int get_coll_create_attr_from_tokens(token_t *tokens, const int nt
     return 0;
 }
 
+static void process_coll_prepare_nread_elems(conn *c, int cmd, char *key, size_t nkey,
+                                             uint32_t vlen, uint32_t ecnt)
+{
+    eitem *elem = NULL;
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+    int need_size;
+
+    /* the element array, the result array and the response string */
+    need_size = ecnt * (sizeof(eitem*) + sizeof(ENGINE_ERROR_CODE) + 30)
+              + (UINT32_STR_LENG + 20); /* response head and tail size */
+
+    if ((elem = (eitem *)malloc(need_size)) == NULL) {
+        ret = ENGINE_ENOMEM;
+    } else {
+        /* allocate memory blocks needed */
+        if (mblck_list_alloc(&c->thread->mblck_pool, 1, vlen, &c->memblist) < 0) {
+            free((void*)elem);
+            ret = ENGINE_ENOMEM;
+        }
+    }
+    c->coll_op     = cmd;
+    c->coll_key    = key;
+    c->coll_nkey   = nkey;
+    if (ret == ENGINE_SUCCESS) {
+        c->coll_strkeys = (void*)&c->memblist;
+        ritem_set_first(c, CONN_RTYPE_MBLCK, vlen);
+        c->coll_eitem  = (void *)elem;
+        c->coll_ecount = ecnt;
+        conn_set_state(c, conn_nread);
+    } else {
+        process_coll_minsert_stats(c, ret);
+        out_string(c, "SERVER_ERROR out of memory");
+
+        /* swallow the data line */
+        c->sbytes = vlen;
+        c->write_and_go = conn_swallow;
+    }
+}
+
+/*
+ * <type> minsert <key> [<index>] <lenelems> <numelems> [create <attributes>] [noreply]
+ * The tokens from <lenelems> are parsed here for all the collection types.
+ */
+static void process_coll_minsert_command(conn *c, int cmd, char *key, size_t nkey,
+                                         token_t *tokens, const size_t ntokens, int read_ntokens)
+{
+    ENGINE_ITEM_TYPE itype;
+    uint32_t lenelems, numelems;
+
+    if (cmd == OPERATION_LOP_MINSERT)      itype = ITEM_TYPE_LIST;
+    else if (cmd == OPERATION_SOP_MINSERT) itype = ITEM_TYPE_SET;
+    else if (cmd == OPERATION_MOP_MINSERT) itype = ITEM_TYPE_MAP;
+    else                                   itype = ITEM_TYPE_BTREE;
+
+    set_noreply_maybe(c, tokens, ntokens);
+
+    if ((! safe_strtoul(tokens[read_ntokens].value, &lenelems)) ||
+        (! safe_strtoul(tokens[read_ntokens+1].value, &numelems)) ||
+        (numelems == 0 || numelems > MAX_MINSERT_ELM_COUNT) ||
+        (lenelems < (numelems * 5))) { /* the shortest element: "0\r\n\r\n" */
+        print_invalid_command(c, tokens, ntokens);
+        out_string(c, "CLIENT_ERROR bad command line format");
+        return;
+    }
+    read_ntokens += 2;
+
+    int post_ntokens = 1 + (c->noreply ? 1 : 0);
+    int rest_ntokens = ntokens - read_ntokens - post_ntokens;
+
+    if (rest_ntokens >= 2) {
+        if (strcmp(tokens[read_ntokens].value, "create") != 0) {
+            print_invalid_command(c, tokens, ntokens);
+            out_string(c, "CLIENT_ERROR bad command line format");
+            return;
+        }
+
+        c->coll_attrp = &c->coll_attr_space; /* create if not exist */
+        if (get_coll_create_attr_from_tokens(&tokens[read_ntokens+1], rest_ntokens-1,
+                                             itype, c->coll_attrp) != 0) {
+            print_invalid_command(c, tokens, ntokens);
+            out_string(c, "CLIENT_ERROR bad command line format");
+            return;
+        }
+    } else {
+        if (rest_ntokens != 0) {
+            print_invalid_command(c, tokens, ntokens);
+            out_string(c, "CLIENT_ERROR bad command line format");
+            return;
+        }
+        c->coll_attrp = NULL;
+    }
+
+    if (lenelems > (numelems * (MAX_MINSERT_HEAD_LENG + settings.max_element_bytes))) {
+        c->coll_op   = cmd;
+        c->coll_key  = key;
+        c->coll_nkey = nkey;
+        process_coll_minsert_stats(c, ENGINE_E2BIG);
+        out_string(c, "CLIENT_ERROR too large value");
+        /* swallow the data line */
+        c->sbytes = lenelems;
+        c->write_and_go = conn_swallow;
+        return;
+    }
+
+    process_coll_prepare_nread_elems(c, cmd, key, nkey, lenelems, numelems);
+}
+
 static ENGINE_ERROR_CODE
 out_lop_get_response(conn *c, bool delete, struct elems_result *eresultp)
 {
@@ -9873,6 +11099,16 @@ static void process_lop_command(conn *c, token_t *tokens, const size_t ntokens)
             conn_set_state(c, conn_swallow);
         }
     }
+    else if ((ntokens >= 7 && ntokens <= 14) && (strcmp(subcommand, "minsert") == 0))
+    {
+        if (! safe_strtol(tokens[LOP_KEY_TOKEN+1].value, &c->coll_index)) {
+            print_invalid_command(c, tokens, ntokens);
+            out_string(c, "CLIENT_ERROR bad command line format");
+            return;
+        }
+        process_coll_minsert_command(c, (int)OPERATION_LOP_MINSERT, key, nkey,
+                                     tokens, ntokens, LOP_KEY_TOKEN+2);
+    }
     else if ((ntokens >= 7 && ntokens <= 10) && (strcmp(subcommand, "create") == 0))
     {
         set_noreply_maybe(c, tokens, ntokens);
@@ -10137,6 +11373,49 @@ static void process_sop_prepare_nread(conn *c, int cmd, size_t vlen, char *key,
     }
 }
 
+static void process_sop_prepare_nread_values(conn *c, char *key, size_t nkey,
+                                             uint32_t vlen, uint32_t vcnt)
+{
+    eitem *elem = NULL;
+    ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
+    int need_size;
+
+    /* the value, length and existence arrays, the copied values
+     * and the response string */
+    need_size = vcnt * (sizeof(void*) + sizeof(uint32_t) + sizeof(bool)) + vlen
+              + vcnt * 11 /* "NOT_EXIST\r\n" */
+              + (UINT32_STR_LENG + 20); /* response head and tail size */
+
+    if ((elem = (eitem *)malloc(need_size)) == NULL) {
+        ret = ENGINE_ENOMEM;
+    } else {
+        /* allocate memory blocks needed */
+        if (mblck_list_alloc(&c->thread->mblck_pool, 1, vlen, &c->memblist) < 0) {
+            free((void*)elem);
+            ret = ENGINE_ENOMEM;
+        }
+    }
+    if (ret == ENGINE_SUCCESS) {
+        c->coll_strkeys = (void*)&c->memblist;
+        ritem_set_first(c, CONN_RTYPE_MBLCK, vlen);
+        c->coll_eitem  = (void *)elem;
+        c->coll_ecount = vcnt;
+        c->coll_op     = OPERATION_SOP_MEXIST;
+        c->coll_key    = key;
+        c->coll_nkey   = nkey;
+        conn_set_state(c, conn_nread);
+    } else {
+        if (settings.detail_enabled)
+            stats_prefix_record_sop_exist(key, nkey, false);
+        STATS_CMD_NOKEY(c, sop_exist);
+        out_string(c, "SERVER_ERROR out of memory");
+
+        /* swallow the data line */
+        c->sbytes = vlen;
+        c->write_and_go = conn_swallow;
+    }
+}
+
 static void process_sop_create(conn *c, char *key, size_t nkey, item_attr *attrp)
 {
     assert(c->ewouldblock == false);
@@ -10222,6 +11501,11 @@ static void process_sop_command(conn *c, token_t *tokens, const size_t ntokens)
             conn_set_state(c, conn_swallow);
         }
     }
+    else if ((ntokens >= 6 && ntokens <= 13) && (strcmp(subcommand, "minsert") == 0))
+    {
+        process_coll_minsert_command(c, (int)OPERATION_SOP_MINSERT, key, nkey,
+                                     tokens, ntokens, SOP_KEY_TOKEN+1);
+    }
     else if ((ntokens >= 7 && ntokens <= 10) && (strcmp(subcommand, "create") == 0))
     {
         set_noreply_maybe(c, tokens, ntokens);
@@ -10299,6 +11583,30 @@ static void process_sop_command(conn *c, token_t *tokens, const size_t ntokens)
             conn_set_state(c, conn_swallow);
         }
     }
+    else if ((ntokens == 6) && (strcmp(subcommand, "mexist") == 0))
+    {
+        uint32_t lenvalues, numvalues;
+
+        if ((! safe_strtoul(tokens[SOP_KEY_TOKEN+1].value, &lenvalues)) ||
+            (! safe_strtoul(tokens[SOP_KEY_TOKEN+2].value, &numvalues)) ||
+            (numvalues == 0 || numvalues > MAX_SMEXIST_VAL_COUNT) ||
+            (lenvalues < (numvalues * 5))) { /* the shortest value: "0\r\n\r\n" */
+            print_invalid_command(c, tokens, ntokens);
+            out_string(c, "CLIENT_ERROR bad command line format");
+            return;
+        }
+
+        if (lenvalues > (numvalues * (MAX_SMEXIST_HEAD_LENG + settings.max_element_bytes))) {
+            STATS_CMD_NOKEY(c, sop_exist);
+            out_string(c, "CLIENT_ERROR too large value");
+            /* swallow the data line */
+            c->sbytes = lenvalues;
+            c->write_and_go = conn_swallow;
+            return;
+        }
+
+        process_sop_prepare_nread_values(c, key, nkey, lenvalues, numvalues);
+    }
     else if ((ntokens==5 || ntokens==6) && (strcmp(subcommand, "get") == 0))
     {
         bool delete = false;
@@ -11438,6 +12746,11 @@ static void process_mop_command(conn *c, token_t *tokens, const size_t ntokens)
             conn_set_state(c, conn_swallow);
         }
     }
+    else if ((ntokens >= 6 && ntokens <= 13) && (strcmp(subcommand, "minsert") == 0))
+    {
+        process_coll_minsert_command(c, (int)OPERATION_MOP_MINSERT, key, nkey,
+                                     tokens, ntokens, MOP_KEY_TOKEN+1);
+    }
     else if ((ntokens >= 7 && ntokens <= 10) && (strcmp(subcommand, "create") == 0))
     {
         set_noreply_maybe(c, tokens, ntokens);
@@ -11727,6 +13040,11 @@ static void process_bop_command(conn *c, token_t *tokens, const size_t ntokens)
             conn_set_state(c, conn_swallow);
         }
     }
+    else if ((ntokens >= 6 && ntokens <= 13) && (strcmp(subcommand, "minsert") == 0))
+    {
+        process_coll_minsert_command(c, (int)OPERATION_BOP_MINSERT, key, nkey,
+                                     tokens, ntokens, BOP_KEY_TOKEN+1);
+    }
     else if ((ntokens >= 7 && ntokens <= 10) && (strcmp(subcommand, "create") == 0))
     {
         set_noreply_maybe(c, tokens, ntokens);
@@ -12894,19 +14212,187 @@ static int try_read_command(conn *c)
     return 1;
 }
 
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+#define UDP_BATCH_SIZE 32
+
+/*
+ * A UDP "connection" receives up to UDP_BATCH_SIZE requests with one
+ * recvmmsg(), and queues the response datagrams of them to send them
+ * with one sendmmsg(). The queue is flushed when it is full, or before
+ * the connection waits for the next event.
+ */
+struct udp_batch {
+    /* requests received by the last recvmmsg() */
+    struct mmsghdr rmsgs[UDP_BATCH_SIZE];
+    struct iovec riovs[UDP_BATCH_SIZE];
+    struct sockaddr raddrs[UDP_BATCH_SIZE];
+    int rnext;
+    int rcount;
+    /* responses queued for the next sendmmsg() */
+    struct mmsghdr smsgs[UDP_BATCH_SIZE];
+    struct iovec siovs[UDP_BATCH_SIZE];
+    struct sockaddr saddrs[UDP_BATCH_SIZE];
+    int snext;
+    int scount;
+    char sbufs[UDP_BATCH_SIZE][UDP_MAX_PAYLOAD_SIZE];
+    char rbufs[UDP_BATCH_SIZE][UDP_READ_BUFFER_SIZE];
+};
+
+static struct udp_batch *udp_batch_get(conn *c)
+{
+    if (c->udp_batch == NULL) {
+        /* only the touched pages of rbufs take memory */
+        struct udp_batch *b = malloc(sizeof(struct udp_batch));
+        if (b == NULL) {
+            return NULL; /* recvfrom() and sendmsg() one by one */
+        }
+        for (int i = 0; i < UDP_BATCH_SIZE; i++) {
+            b->riovs[i].iov_base = b->rbufs[i];
+            b->riovs[i].iov_len = UDP_READ_BUFFER_SIZE;
+            b->siovs[i].iov_base = b->sbufs[i];
+        }
+        b->rnext = b->rcount = 0;
+        b->snext = b->scount = 0;
+        c->udp_batch = b;
+    }
+    return c->udp_batch;
+}
+
+static bool udp_batch_pending(conn *c)
+{
+    struct udp_batch *b = c->udp_batch;
+    return b != NULL && (b->rnext < b->rcount || b->snext < b->scount);
+}
+
+/*
+ * Takes the next request datagram, receiving a new batch if needed.
+ * Returns the length of the datagram, or -1 if none is received.
+ */
+static int udp_batch_recv(conn *c, unsigned char **buf)
+{
+    struct udp_batch *b = c->udp_batch;
+    int i;
+
+    if (b->rnext == b->rcount) {
+        for (i = 0; i < UDP_BATCH_SIZE; i++) {
+            struct msghdr *m = &b->rmsgs[i].msg_hdr;
+            memset(m, 0, sizeof(*m));
+            m->msg_name = &b->raddrs[i];
+            m->msg_namelen = sizeof(b->raddrs[i]);
+            m->msg_iov = &b->riovs[i];
+            m->msg_iovlen = 1;
+        }
+        b->rnext = b->rcount = 0;
+        int res = recvmmsg(c->sfd, b->rmsgs, UDP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+        if (res <= 0) {
+            return -1;
+        }
+        b->rcount = res;
+    }
+    i = b->rnext++;
+    memcpy(&c->request_addr, &b->raddrs[i], sizeof(c->request_addr));
+    c->request_addr_size = b->rmsgs[i].msg_hdr.msg_namelen;
+    *buf = (unsigned char *)b->rbufs[i];
+    return b->rmsgs[i].msg_len;
+}
+
+/*
+ * Sends the queued response datagrams.
+ * Returns false if the socket is not writable for the rest of them.
+ */
+static bool udp_batch_flush(conn *c)
+{
+    struct udp_batch *b = c->udp_batch;
+
+    while (b->snext < b->scount) {
+        int res = sendmmsg(c->sfd, &b->smsgs[b->snext], b->scount - b->snext, 0);
+        if (res > 0) {
+            b->snext += res;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        }
+        /* drop the datagram as transmit() does on a hard error */
+        if (settings.verbose > 0) {
+            mc_logger->log(EXTENSION_LOG_INFO, c,
+                           "Failed to write, and not due to blocking: %s\n",
+                           strerror(errno));
+        }
+        b->snext++;
+    }
+    b->snext = b->scount = 0;
+    return true;
+}
+
+/*
+ * Queues a response datagram to send it with the others of the batch.
+ * It has the same return value and errno as sendmsg().
+ */
+static ssize_t udp_batch_send(conn *c, struct msghdr *m)
+{
+    struct udp_batch *b = c->udp_batch;
+    size_t len = 0;
+    int i;
+
+    for (i = 0; i < m->msg_iovlen; i++) {
+        len += m->msg_iov[i].iov_len;
+    }
+    if (b->scount == UDP_BATCH_SIZE || len > UDP_MAX_PAYLOAD_SIZE) {
+        if (!udp_batch_flush(c)) {
+            errno = EAGAIN;
+            return -1;
+        }
+        if (len > UDP_MAX_PAYLOAD_SIZE) {
+            return sendmsg(c->sfd, m, 0);
+        }
+    }
+
+    char *p = b->sbufs[b->scount];
+    for (i = 0; i < m->msg_iovlen; i++) {
+        memcpy(p, m->msg_iov[i].iov_base, m->msg_iov[i].iov_len);
+        p += m->msg_iov[i].iov_len;
+    }
+    memcpy(&b->saddrs[b->scount], &c->request_addr, sizeof(c->request_addr));
+    b->siovs[b->scount].iov_len = len;
+
+    struct msghdr *sm = &b->smsgs[b->scount].msg_hdr;
+    memset(sm, 0, sizeof(*sm));
+    sm->msg_name = &b->saddrs[b->scount];
+    sm->msg_namelen = c->request_addr_size;
+    sm->msg_iov = &b->siovs[b->scount];
+    sm->msg_iovlen = 1;
+    b->scount++;
+    return len;
+}
+#endif
+
 /*
  * read a UDP request.
  */
 static enum try_read_result try_read_udp(conn *c)
 {
     assert(c != NULL);
+    unsigned char *buf = (unsigned char *)c->rbuf;
     int res;
 
+#ifdef UDP_BATCH_SIZE
+    if (udp_batch_get(c) != NULL) {
+        res = udp_batch_recv(c, &buf);
+    } else {
+        c->request_addr_size = sizeof(c->request_addr);
+        res = recvfrom(c->sfd, c->rbuf, c->rsize,
+                       0, &c->request_addr, &c->request_addr_size);
+    }
+#else
     c->request_addr_size = sizeof(c->request_addr);
     res = recvfrom(c->sfd, c->rbuf, c->rsize,
                    0, &c->request_addr, &c->request_addr_size);
+#endif
     if (res > 8) {
-        unsigned char *buf = (unsigned char *)c->rbuf;
         STATS_ADD(c, bytes_read, res);
 
         /* Beginning of UDP packet is the request ID; save it. */
@@ -12920,7 +14406,7 @@ static enum try_read_result try_read_udp(conn *c)
 
         /* Don't care about any of the rest of the header. */
         res -= 8;
-        memmove(c->rbuf, c->rbuf + 8, res);
+        memmove(c->rbuf, buf + 8, res);
 
         c->rbytes += res;
         c->rcurr = c->rbuf;
@@ -12929,6 +14415,20 @@ static enum try_read_result try_read_udp(conn *c)
     return READ_NO_DATA_RECEIVED;
 }
 
+/*
+ * Reads from the socket of a TCP connection, or takes the data that
+ * the io_uring backend has received for the connection.
+ */
+static inline ssize_t conn_recv(conn *c, void *buf, size_t len)
+{
+#ifdef ENABLE_IO_URING
+    if (c->uring != NULL) {
+        return uring_conn_recv(c, buf, len);
+    }
+#endif
+    return read(c->sfd, buf, len);
+}
+
 /*
  * read from network as much as we can, handle buffer overflow and connection
  * close.
@@ -12979,7 +14479,7 @@ static enum try_read_result try_read_network(conn *c)
         }
 
         int avail = c->rsize - c->rbytes;
-        int res = read(c->sfd, c->rbuf + c->rbytes, avail);
+        int res = conn_recv(c, c->rbuf + c->rbytes, avail);
         if (res > 0) {
             STATS_ADD(c, bytes_read, res);
             gotdata = READ_DATA_RECEIVED;
@@ -13019,6 +14519,16 @@ static bool update_event(conn *c, const int new_flags)
     assert(c != NULL);
     struct event_base *base = c->event.ev_base;
 
+#ifdef ENABLE_IO_URING
+    if (c->uring != NULL) {
+        /* the completions drive the connection: a read is always armed,
+         * and a write event is only used to resume the state machine.
+         */
+        c->ev_flags = new_flags;
+        if (new_flags & EV_WRITE) return uring_conn_resume(c);
+        return true;
+    }
+#endif
     if (c->ev_flags == new_flags)
         return true;
 
@@ -13035,6 +14545,140 @@ static bool update_event(conn *c, const int new_flags)
     return true;
 }
 
+/*
+ * Accounts the bytes sent of a msghdr, and removes the completed iovec
+ * entries from it so that the next write does the rest.
+ */
+void conn_msg_sent(conn *c, struct msghdr *m, ssize_t res)
+{
+    STATS_ADD(c, bytes_written, res);
+
+    /* We've written some of the data. Remove the completed
+       iovec entries from the list of pending writes. */
+    while (m->msg_iovlen > 0 && res >= m->msg_iov->iov_len) {
+        res -= m->msg_iov->iov_len;
+        m->msg_iovlen--;
+        m->msg_iov++;
+    }
+
+    /* Might have written just part of the last iovec entry;
+       adjust it so the next write will do the rest. */
+    if (res > 0) {
+        m->msg_iov->iov_base = (caddr_t)m->msg_iov->iov_base + res;
+        m->msg_iov->iov_len -= res;
+    }
+}
+
+/*
+ * Tells whether a msghdr of the connection is large enough to be sent
+ * with zero-copy (-Z option).
+ */
+bool conn_msg_zerocopy(conn *c, struct msghdr *m)
+{
+    size_t bytes = 0;
+    int i;
+
+    if (settings.zerocopy_size == 0 || c->transport != tcp_transport) {
+        return false;
+    }
+    for (i = 0; i < m->msg_iovlen && bytes < settings.zerocopy_size; i++) {
+        bytes += m->msg_iov[i].iov_len;
+    }
+    return bytes >= settings.zerocopy_size;
+}
+
+#ifdef ZEROCOPY_SEND
+/*
+ * A large message is sent with MSG_ZEROCOPY, and the kernel keeps
+ * referencing the items and the elements of it after sendmsg() returns.
+ * So the connection stays in its write state, which holds them, until
+ * the completion notifications of all its zero-copy sends are read from
+ * the error queue of the socket.
+ */
+static int conn_zerocopy_flags(conn *c, struct msghdr *m)
+{
+    if (c->zc_state < 0 || !conn_msg_zerocopy(c, m)) {
+        return 0;
+    }
+    if (c->zc_state == 0) {
+        int flags = 1;
+        if (setsockopt(c->sfd, SOL_SOCKET, SO_ZEROCOPY,
+                       (void *)&flags, sizeof(flags)) != 0) {
+            c->zc_state = -1;
+            return 0;
+        }
+        c->zc_state = 1;
+    }
+    return MSG_ZEROCOPY;
+}
+
+/*
+ * Reads the zero-copy completion notifications of the connection.
+ * Returns false if some of its sends are still referenced by the kernel.
+ */
+static bool conn_zerocopy_reap(conn *c)
+{
+    char control[128];
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    struct sock_extended_err *serr;
+
+    while (c->zc_done != c->zc_sent) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(c->sfd, &msg, MSG_ERRQUEUE) == -1) {
+            return false; /* EAGAIN: not notified yet */
+        }
+        for (cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+                !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            serr = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (serr->ee_errno == 0 && serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                /* the sends of [ee_info, ee_data] have completed */
+                c->zc_done += serr->ee_data - serr->ee_info + 1;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Defers closing the connection while the kernel still references
+ * the items and the elements of its zero-copy sends, which are released
+ * by closing it. The socket is shut down, and the connection waits in
+ * conn_closing state for the remaining notifications with an edge-triggered
+ * read event, as transmit() does. It may wait until the tcp retransmission
+ * gives up if the peer stops acknowledging.
+ * Returns true if the close is deferred.
+ */
+static bool conn_zerocopy_close(conn *c)
+{
+    if (c->sfd == -1 || conn_zerocopy_reap(c)) {
+        return false;
+    }
+    if (c->zc_closing) {
+        return true; /* still waiting */
+    }
+    if (settings.verbose > 1) {
+        mc_logger->log(EXTENSION_LOG_DEBUG, c,
+                       "<%d connection waiting for %u zero-copy sends to close.\n",
+                       c->sfd, c->zc_sent - c->zc_done);
+    }
+    conn_set_state(c, conn_closing);
+    shutdown(c->sfd, SHUT_RDWR);
+    if (!update_event(c, EV_READ | EV_ET | EV_PERSIST)) {
+        mc_logger->log(EXTENSION_LOG_WARNING, c,
+                       "Couldn't wait for zero-copy sends, closing.\n");
+        return false;
+    }
+    c->zc_closing = true;
+    return true;
+}
+#endif
+
 /*
  * Transmit the next chunk of data from our list of msgbuf structures.
  *
@@ -13048,6 +14692,27 @@ static enum transmit_result transmit(conn *c)
 {
     assert(c != NULL);
 
+#ifdef ENABLE_IO_URING
+    if (c->uring != NULL) {
+        /* all the sendmsg requests of the last transmit have completed */
+        while (c->msgcurr < c->msgused && c->msglist[c->msgcurr].msg_iovlen == 0) {
+            c->msgcurr++;
+        }
+        if (c->msgcurr == c->msgused) {
+            return TRANSMIT_COMPLETE;
+        }
+        if (c->uring_senderr == 0 && uring_conn_send(c)) {
+            return TRANSMIT_SOFT_ERROR; /* resumed by the completions */
+        }
+        if (settings.verbose > 0) {
+            mc_logger->log(EXTENSION_LOG_INFO, c,
+                           "Failed to write with io_uring: %s, client_ip: %s\n",
+                           strerror(c->uring_senderr), c->client_ip);
+        }
+        conn_set_state(c, conn_closing);
+        return TRANSMIT_HARD_ERROR;
+    }
+#endif
     if (c->msgcurr < c->msgused && c->msglist[c->msgcurr].msg_iovlen == 0) {
         /* Finished writing the current msg; advance to the next. */
         c->msgcurr++;
@@ -13056,24 +14721,28 @@ static enum transmit_result transmit(conn *c)
         ssize_t res;
         struct msghdr *m = &c->msglist[c->msgcurr];
 
-        res = sendmsg(c->sfd, m, 0);
-        if (res > 0) {
-            STATS_ADD(c, bytes_written, res);
-
-            /* We've written some of the data. Remove the completed
-               iovec entries from the list of pending writes. */
-            while (m->msg_iovlen > 0 && res >= m->msg_iov->iov_len) {
-                res -= m->msg_iov->iov_len;
-                m->msg_iovlen--;
-                m->msg_iov++;
-            }
-
-            /* Might have written just part of the last iovec entry;
-               adjust it so the next write will do the rest. */
+#ifdef UDP_BATCH_SIZE
+        if (c->udp_batch != NULL) {
+            res = udp_batch_send(c, m);
+        } else
+#endif
+#ifdef ZEROCOPY_SEND
+        if (conn_zerocopy_flags(c, m) != 0) {
+            res = sendmsg(c->sfd, m, MSG_ZEROCOPY);
             if (res > 0) {
-                m->msg_iov->iov_base = (caddr_t)m->msg_iov->iov_base + res;
-                m->msg_iov->iov_len -= res;
+                c->zc_sent++;
+                STATS_ADD(c, zerocopy_sends, 1);
+            } else if (res == -1 && errno == ENOBUFS) {
+                /* out of the notification memory of the socket */
+                res = sendmsg(c->sfd, m, 0);
             }
+        } else
+#endif
+        {
+            res = sendmsg(c->sfd, m, 0);
+        }
+        if (res > 0) {
+            conn_msg_sent(c, m, res);
             return TRANSMIT_INCOMPLETE;
         }
         if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
@@ -13102,6 +14771,22 @@ static enum transmit_result transmit(conn *c)
             conn_set_state(c, conn_closing);
         return TRANSMIT_HARD_ERROR;
     } else {
+#ifdef ZEROCOPY_SEND
+        if (c->zc_done != c->zc_sent && !conn_zerocopy_reap(c)) {
+            /* an edge-triggered read event is woken by each notification,
+             * without spinning on the next request already received.
+             */
+            if (!update_event(c, EV_READ | EV_ET | EV_PERSIST)) {
+                if (settings.verbose > 0) {
+                    mc_logger->log(EXTENSION_LOG_WARNING, c,
+                                   "Couldn't update event in transmit.\n");
+                }
+                conn_set_state(c, conn_closing);
+                return TRANSMIT_HARD_ERROR;
+            }
+            return TRANSMIT_SOFT_ERROR;
+        }
+#endif
         return TRANSMIT_COMPLETE;
     }
 }
@@ -13112,6 +14797,12 @@ bool conn_listening(conn *c)
     struct sockaddr_storage addr;
     socklen_t addrlen = sizeof(addr);
 
+    if (memcached_shutdown && c->thread != NULL) {
+        /* the listen socket of this worker has been shut down */
+        conn_close(c);
+        return false;
+    }
+
     if ((sfd = accept(c->sfd, (struct sockaddr *)&addr, &addrlen)) == -1) {
         if (errno == EMFILE) {
             if (settings.verbose > 0) {
@@ -13158,14 +14849,35 @@ bool conn_listening(conn *c)
         return false;
     }
 
-    dispatch_conn_new(sfd, conn_new_cmd, EV_READ | EV_PERSIST,
-                      DATA_BUFFER_SIZE, tcp_transport);
+    if (c->thread != NULL) {
+        /* accepted on the worker's own SO_REUSEPORT listen socket */
+        dispatch_conn_local(c->thread, sfd, conn_new_cmd, EV_READ | EV_PERSIST,
+                            DATA_BUFFER_SIZE, tcp_transport);
+    } else {
+        dispatch_conn_new(sfd, conn_new_cmd, EV_READ | EV_PERSIST,
+                          DATA_BUFFER_SIZE, tcp_transport);
+    }
     return false;
 }
 
 bool conn_waiting(conn *c)
 {
-    if (!update_event(c, EV_READ | EV_PERSIST)) {
+    int flags = EV_READ | EV_PERSIST;
+
+#ifdef UDP_BATCH_SIZE
+    if (c->udp_batch != NULL) {
+        if (c->udp_batch->rnext < c->udp_batch->rcount) {
+            /* more requests of the last recvmmsg() */
+            conn_set_state(c, conn_read);
+            return true;
+        }
+        if (!udp_batch_flush(c)) {
+            /* send the rest when the socket becomes writable */
+            flags = EV_WRITE | EV_PERSIST;
+        }
+    }
+#endif
+    if (!update_event(c, flags)) {
         if (settings.verbose > 0) {
             mc_logger->log(EXTENSION_LOG_WARNING, c,
                            "Couldn't update event in conn_waiting.\n");
@@ -13228,7 +14940,11 @@ bool conn_new_cmd(conn *c)
         reset_cmd_handler(c);
     } else {
         STATS_ADD(c, conn_yields, 1);
+#ifdef UDP_BATCH_SIZE
+        if (c->rbytes > 0 || udp_batch_pending(c)) {
+#else
         if (c->rbytes > 0) {
+#endif
             /* We have already read in data into the input buffer,
                so libevent will most likely not signal read events
                on the socket (unless more data is available. As a
@@ -13270,7 +14986,7 @@ bool conn_swallow(conn *c)
     }
 
     /*  now try reading from the socket */
-    res = read(c->sfd, c->rbuf, c->rsize > c->sbytes ? c->sbytes : c->rsize);
+    res = conn_recv(c, c->rbuf, c->rsize > c->sbytes ? c->sbytes : c->rsize);
     if (res > 0) {
         STATS_ADD(c, bytes_read, res);
         c->sbytes -= res;
@@ -13358,7 +15074,7 @@ bool conn_nread(conn *c)
     }
 
     /*  now try reading from the socket */
-    res = read(c->sfd, c->ritem, c->rlbytes);
+    res = conn_recv(c, c->ritem, c->rlbytes);
     if (res > 0) {
         STATS_ADD(c, bytes_read, res);
         if (c->rcurr == c->ritem) {
@@ -13636,6 +15352,184 @@ static void maximize_sndbuf(const int sfd)
     }
 }
 
+static void set_tcp_listen_sockopt(int sfd)
+{
+    struct linger ling = {0, 0};
+    int flags = 1;
+    int error;
+
+    error = setsockopt(sfd, SOL_SOCKET, SO_KEEPALIVE, (void *)&flags, sizeof(flags));
+    if (error != 0)
+        perror("setsockopt");
+
+    error = setsockopt(sfd, SOL_SOCKET, SO_LINGER, (void *)&ling, sizeof(ling));
+    if (error != 0)
+        perror("setsockopt");
+
+    error = setsockopt(sfd, IPPROTO_TCP, TCP_NODELAY, (void *)&flags, sizeof(flags));
+    if (error != 0)
+        perror("setsockopt");
+
+#ifdef SO_REUSEPORT
+    if (settings.listen_mode != tcp_listen_shared) {
+        error = setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, (void *)&flags, sizeof(flags));
+        if (error != 0)
+            perror("setsockopt");
+    }
+#endif
+}
+
+#ifdef SO_REUSEPORT
+/* The listen sockets owned by the worker threads.
+ * They are shut down by the main thread and closed by the workers.
+ */
+static int *reuseport_sfds = NULL;
+static int reuseport_count = 0;
+
+/*
+ * Steer each new connection by the receiving cpu to a listen socket
+ * of the SO_REUSEPORT group, and bind the worker threads to the cpus.
+ * The j-th cpu of the process affinity goes to the listen socket and
+ * the worker thread of index (j % num_threads). The connections received
+ * on the other cpus are left to the hashing of the kernel.
+ */
+static void attach_reuseport_cpu_steering(int sfd)
+{
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(SKF_AD_CPU) && defined(CPU_SETSIZE)
+    static struct sock_filter code[2 + 2 * CPU_SETSIZE];
+    static int cpus[CPU_SETSIZE];
+    struct sock_fprog prog;
+    cpu_set_t cpuset;
+    int ncpus = 0;
+    int i;
+
+    CPU_ZERO(&cpuset);
+    if (sched_getaffinity(0, sizeof(cpuset), &cpuset) != 0) {
+        mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                "Failed to get the cpu affinity: %s,"
+                " not steering connections by cpu\n", strerror(errno));
+        cpu_steering = false;
+        return;
+    }
+    for (i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &cpuset)) {
+            cpus[ncpus++] = i;
+        }
+    }
+    if (ncpus < settings.num_threads) {
+        mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                "%d cpus are not enough for %d worker threads,"
+                " not steering connections by cpu\n", ncpus, settings.num_threads);
+        cpu_steering = false;
+        return;
+    }
+
+    /* the socket index of the receiving cpu, or out of range if unknown */
+    code[0] = (struct sock_filter){ BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU };
+    for (i = 0; i < ncpus; i++) {
+        code[1 + 2*i] = (struct sock_filter){ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, cpus[i] };
+        code[2 + 2*i] = (struct sock_filter){ BPF_RET | BPF_K, 0, 0, i % settings.num_threads };
+    }
+    code[1 + 2*ncpus] = (struct sock_filter){ BPF_RET | BPF_K, 0, 0, settings.num_threads };
+    prog.len = 2 + 2*ncpus;
+    prog.filter = code;
+
+    if (setsockopt(sfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                   &prog, sizeof(prog)) != 0) {
+        mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                "Failed to attach cpu steering program: %s\n", strerror(errno));
+        cpu_steering = false;
+        return;
+    }
+    if (threads_bind_cpus(cpus, ncpus) != 0) {
+#ifdef SO_DETACH_REUSEPORT_BPF
+        int dummy = 0;
+        if (setsockopt(sfd, SOL_SOCKET, SO_DETACH_REUSEPORT_BPF,
+                       &dummy, sizeof(dummy)) != 0) {
+            perror("setsockopt");
+        }
+#endif
+        mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                "Failed to bind worker threads to cpus,"
+                " not steering connections by cpu\n");
+        cpu_steering = false;
+        return;
+    }
+    if (reuseport_count == 0) { /* the first listen socket group */
+        cpu_steering = true;
+    }
+#else
+    mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+            "SO_ATTACH_REUSEPORT_CBPF is not supported,"
+            " not steering connections by cpu\n");
+#endif
+}
+
+/*
+ * Open the rest of the SO_REUSEPORT group of a bound and listening socket,
+ * one listen socket for each worker thread, and hand them to the workers.
+ * The i-th socket of the group goes to the i-th worker thread.
+ */
+static void server_socket_reuseport(int sfd, struct addrinfo *ai,
+                                    enum network_transport transport)
+{
+    struct sockaddr_storage addr;
+    socklen_t addrlen = sizeof(addr);
+    int *sfds;
+    int flags = 1;
+    int i;
+
+    /* bind the others to the actual port in case of an ephemeral port */
+    if (getsockname(sfd, (struct sockaddr *)&addr, &addrlen) != 0) {
+        perror("getsockname()");
+        exit(EXIT_FAILURE);
+    }
+    sfds = realloc(reuseport_sfds,
+                   sizeof(int) * (reuseport_count + settings.num_threads));
+    if (sfds == NULL) {
+        mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                "failed to allocate reuseport listen sockets\n");
+        exit(EXIT_FAILURE);
+    }
+    reuseport_sfds = sfds;
+    sfds = &reuseport_sfds[reuseport_count];
+
+    sfds[0] = sfd;
+    for (i = 1; i < settings.num_threads; i++) {
+        if ((sfds[i] = new_socket(ai)) == -1) {
+            perror("socket()");
+            exit(EXIT_FAILURE);
+        }
+#ifdef IPV6_V6ONLY
+        if (ai->ai_family == AF_INET6) {
+            setsockopt(sfds[i], IPPROTO_IPV6, IPV6_V6ONLY, (char *) &flags, sizeof(flags));
+        }
+#endif
+        setsockopt(sfds[i], SOL_SOCKET, SO_REUSEADDR, (void *)&flags, sizeof(flags));
+        set_tcp_listen_sockopt(sfds[i]);
+        if (bind(sfds[i], (struct sockaddr *)&addr, addrlen) == -1) {
+            perror("bind()");
+            exit(EXIT_FAILURE);
+        }
+        if (listen(sfds[i], settings.backlog) == -1) {
+            perror("listen()");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (settings.listen_mode == tcp_listen_cpu) {
+        attach_reuseport_cpu_steering(sfd);
+    }
+
+    for (i = 0; i < settings.num_threads; i++) {
+        dispatch_conn_thread(i, sfds[i], conn_listening, EV_READ | EV_PERSIST, 1,
+                             transport);
+        LOCK_STATS();
+        ++mc_stats.daemon_conns;
+        UNLOCK_STATS();
+    }
+    reuseport_count += settings.num_threads;
+}
+#endif
 
 /**
  * Create a socket and bind it to a specific port number
@@ -13649,7 +15543,6 @@ static int server_socket(int port, enum network_transport transport,
                          FILE *portnumber_file)
 {
     int sfd;
-    struct linger ling = {0, 0};
     struct addrinfo *ai;
     struct addrinfo *next;
     struct addrinfo hints = { .ai_flags = AI_PASSIVE,
@@ -13701,17 +15594,7 @@ static int server_socket(int port, enum network_transport transport,
         if (IS_UDP(transport)) {
             maximize_sndbuf(sfd);
         } else {
-            error = setsockopt(sfd, SOL_SOCKET, SO_KEEPALIVE, (void *)&flags, sizeof(flags));
-            if (error != 0)
-                perror("setsockopt");
-
-            error = setsockopt(sfd, SOL_SOCKET, SO_LINGER, (void *)&ling, sizeof(ling));
-            if (error != 0)
-                perror("setsockopt");
-
-            error = setsockopt(sfd, IPPROTO_TCP, TCP_NODELAY, (void *)&flags, sizeof(flags));
-            if (error != 0)
-                perror("setsockopt");
+            set_tcp_listen_sockopt(sfd);
         }
 
         if (bind(sfd, next->ai_addr, next->ai_addrlen) == -1) {
@@ -13764,13 +15647,16 @@ static int server_socket(int port, enum network_transport transport,
             int c;
 
             for (c = 0; c < settings.num_threads; c++) {
-                /* this is guaranteed to hit all threads because we round-robin */
-                dispatch_conn_new(sfd, conn_read, EV_READ | EV_PERSIST,
-                                  UDP_READ_BUFFER_SIZE, transport);
+                dispatch_conn_thread(c, sfd, conn_read, EV_READ | EV_PERSIST,
+                                     UDP_READ_BUFFER_SIZE, transport);
                 LOCK_STATS();
                 ++mc_stats.daemon_conns;
                 UNLOCK_STATS();
             }
+#ifdef SO_REUSEPORT
+        } else if (settings.listen_mode != tcp_listen_shared) {
+            server_socket_reuseport(sfd, next, transport);
+#endif
         } else {
             if (!(listen_conn_add = conn_new(sfd, conn_listening,
                                              EV_READ | EV_PERSIST, 1,
@@ -13907,6 +15793,7 @@ static void clock_handler(const int fd, const short which, void *arg)
     evtimer_add(&clockevent, &t);
 
     set_current_time();
+    threads_balance();
 }
 
 static void usage(void)
@@ -13944,7 +15831,8 @@ static void usage(void)
            "              the memory page size could reduce the number of TLB misses\n"
            "              and improve the performance. In order to get large pages\n"
            "              from the OS, memcached will allocate the total item-cache\n"
-           "              in one large chunk.\n");
+           "              in one large chunk. On Linux, the chunk is backed by the\n"
+           "              hugetlb pages if reserved, or by transparent huge pages.\n");
     printf("-D <char>     Use <char> as the delimiter between key prefixes and IDs.\n"
            "              This is used for per-prefix stats reporting. The default is\n"
            "              \":\" (colon). If this option is specified, stats collection\n"
@@ -13957,6 +15845,23 @@ static void usage(void)
     printf("-C            Disable use of CAS\n");
     printf("-b            Set the backlog queue limit (default: 1024)\n");
     printf("-B            Binding protocol - one of ascii, binary, or auto (default)\n");
+    printf("-T            TCP listen mode - one of shared (default), reuseport, or cpu\n"
+           "              shared: the main thread accepts and dispatches connections\n"
+           "              reuseport: each worker accepts on its own SO_REUSEPORT socket\n"
+           "              cpu: reuseport, steered to the worker bound to the receiving cpu\n");
+    printf("-W            Connection placement on the worker threads - one of roundrobin (default),\n"
+           "              leastconn, or leastcpu, optionally followed by \",migrate\"\n"
+           "              leastconn: the worker with the fewest connections\n"
+           "              leastcpu: the worker that used the least cpu recently\n"
+           "              migrate: move idle connections off a persistently overloaded worker\n");
+#ifdef ENABLE_IO_URING
+    printf("-O            Network I/O backend of the worker threads - one of libevent (default),\n"
+           "              or io_uring (completion-driven reads and writes of TCP connections)\n");
+#endif
+#ifdef ZEROCOPY_SEND
+    printf("-Z <size>     Send the messages of at least <size> bytes of a response with\n"
+           "              zero-copy, e.g. 64k (default: 0, disabled, min: 4k)\n");
+#endif
     printf("-I            Override the size of each slab page. Adjusts max item size\n"
            "              (default: 1mb, min: 1k, max: 128m)\n");
     printf("-E <engine>   Engine to load, must be given (for example, -E .libs/default_engine.so)\n");
@@ -14638,6 +16543,15 @@ static void close_listen_sockets(void)
         close(conn->sfd);
         conn = conn->next;
     }
+#ifdef SO_REUSEPORT
+    /* The worker threads close their own listen sockets and conns
+     * when the shutdown wakes them up (See conn_listening). The sockets
+     * not woken up yet are closed when the worker threads terminate.
+     */
+    for (int i = 0; i < reuseport_count; i++) {
+        shutdown(reuseport_sfds[i], SHUT_RDWR);
+    }
+#endif
 }
 
 int main (int argc, char **argv)
@@ -14716,6 +16630,10 @@ int main (int argc, char **argv)
           "C"   /* Disable use of CAS */
           "b:"  /* backlog queue limit */
           "B:"  /* Binding protocol */
+          "T:"  /* TCP listen mode */
+          "W:"  /* connection placement on worker threads */
+          "O:"  /* network I/O backend */
+          "Z:"  /* zero-copy send size */
           "I:"  /* Max item size */
           "S"   /* Sasl ON */
           "E:"  /* Engine to load */
@@ -14861,6 +16779,9 @@ int main (int argc, char **argv)
             if (enable_large_pages() == 0) {
                 //preallocate = true;
                 old_opts += sprintf(old_opts, "preallocate=true;");
+#ifdef __linux__
+                old_opts += sprintf(old_opts, "large_pages=true;");
+#endif
             }
             break;
         case 'C' :
@@ -14885,6 +16806,97 @@ int main (int argc, char **argv)
                 exit(EX_USAGE);
             }
             break;
+        case 'W':
+            {
+                char *migrate = strchr(optarg, ',');
+                if (migrate != NULL) {
+                    *migrate++ = '\0';
+                }
+                if (strcmp(optarg, "roundrobin") == 0) {
+                    settings.conn_placement = conn_place_roundrobin;
+                } else if (strcmp(optarg, "leastconn") == 0) {
+                    settings.conn_placement = conn_place_leastconn;
+                } else if (strcmp(optarg, "leastcpu") == 0) {
+                    settings.conn_placement = conn_place_leastcpu;
+                } else {
+                    mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                            "Invalid value for connection placement: %s\n"
+                            " -- should be one of roundrobin, leastconn, or leastcpu\n", optarg);
+                    exit(EX_USAGE);
+                }
+                if (migrate != NULL) {
+                    if (strcmp(migrate, "migrate") != 0) {
+                        mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                                "Invalid suffix for connection placement: %s\n"
+                                " -- should be migrate\n", migrate);
+                        exit(EX_USAGE);
+                    }
+                    settings.conn_migrate = true;
+                }
+            }
+            break;
+        case 'O':
+            if (strcmp(optarg, "libevent") == 0) {
+                settings.io_backend = io_backend_libevent;
+#ifdef ENABLE_IO_URING
+            } else if (strcmp(optarg, "io_uring") == 0) {
+                settings.io_backend = io_backend_uring;
+#endif
+            } else {
+                mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                        "Invalid value for network I/O backend: %s\n"
+#ifdef ENABLE_IO_URING
+                        " -- should be one of libevent, or io_uring\n", optarg);
+#else
+                        " -- io_uring is not enabled, should be libevent\n", optarg);
+#endif
+                exit(EX_USAGE);
+            }
+            break;
+        case 'Z':
+#ifdef ZEROCOPY_SEND
+            {
+                char *end;
+                unsigned long long size = strtoull(optarg, &end, 10);
+                if (*end == 'k' || *end == 'K') {
+                    size *= 1024; end++;
+                } else if (*end == 'm' || *end == 'M') {
+                    size *= 1024 * 1024; end++;
+                }
+                if (end == optarg || *end != '\0' || (size > 0 && size < 4096)) {
+                    mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                            "Invalid value for zero-copy send size: %s\n"
+                            " -- should be 0 or at least 4k\n", optarg);
+                    exit(EX_USAGE);
+                }
+                settings.zerocopy_size = (size_t)size;
+            }
+#else
+            mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "Zero-copy send is not supported on this platform.\n");
+            exit(EX_USAGE);
+#endif
+            break;
+        case 'T':
+            if (strcmp(optarg, "shared") == 0) {
+                settings.listen_mode = tcp_listen_shared;
+#ifdef SO_REUSEPORT
+            } else if (strcmp(optarg, "reuseport") == 0) {
+                settings.listen_mode = tcp_listen_reuseport;
+            } else if (strcmp(optarg, "cpu") == 0) {
+                settings.listen_mode = tcp_listen_cpu;
+#endif
+            } else {
+                mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                        "Invalid value for TCP listen mode: %s\n"
+#ifdef SO_REUSEPORT
+                        " -- should be one of shared, reuseport, or cpu\n", optarg);
+#else
+                        " -- SO_REUSEPORT is not supported, should be shared\n", optarg);
+#endif
+                exit(EX_USAGE);
+            }
+            break;
         case 'I':
             unit = optarg[strlen(optarg)-1];
             if (unit == 'k' || unit == 'm' ||
@@ -102,6 +102,19 @@
 #define MAX_SMGET_REQ_COUNT     2000
 #endif
 
+/* In collection minsert, max limit on the number of given elements */
+#define MAX_MINSERT_ELM_COUNT   500
+/* In collection minsert, max length of an element head line:
+ * <bytes> in lop and sop, <bkey> [<eflag>] <bytes> in bop,
+ * and <field> <bytes> in mop which is the longest one.
+ */
+#define MAX_MINSERT_HEAD_LENG   (MAX_FIELD_LENG+UINT32_STR_LENG+4)
+
+/* In sop mexist, max limit on the number of given values */
+#define MAX_SMEXIST_VAL_COUNT   1000
+/* In sop mexist, max length of a value head line: <bytes> */
+#define MAX_SMEXIST_HEAD_LENG   (UINT32_STR_LENG+2)
+
 /* command pipelining limits */
 #define PIPE_MAX_CMD_COUNT  500
 #define PIPE_HEAD_RES_SIZE  20 /* head response string size */
@@ -159,6 +172,10 @@ enum bin_substates {
     bin_reading_sop_prepare_nread,
     bin_reading_sop_nread_complete,
     bin_reading_sop_get,
+    bin_reading_sop_mexist_prepare_nread,
+    bin_reading_sop_mexist_nread_complete,
+    bin_reading_coll_minsert_prepare_nread,
+    bin_reading_coll_minsert_nread_complete,
     bin_reading_bop_create,
     bin_reading_bop_prepare_nread,
     bin_reading_bop_nread_complete,
@@ -191,6 +208,23 @@ enum network_transport {
 
 #define IS_UDP(x) (x == udp_transport)
 
+enum tcp_listen_mode {
+    tcp_listen_shared,    /* the main thread accepts and dispatches */
+    tcp_listen_reuseport, /* each worker accepts on its own SO_REUSEPORT socket */
+    tcp_listen_cpu        /* tcp_listen_reuseport steered by the receiving cpu */
+};
+
+enum conn_placement {
+    conn_place_roundrobin, /* the next worker thread in turn */
+    conn_place_leastconn,  /* the worker thread with the fewest connections */
+    conn_place_leastcpu    /* the worker thread that used the least cpu recently */
+};
+
+enum io_backend {
+    io_backend_libevent,   /* readiness by libevent, then read()/sendmsg() */
+    io_backend_uring       /* completions of the io_uring of each worker */
+};
+
 /**
  * Global stats.
  */
@@ -202,6 +236,7 @@ struct mc_stats {
     unsigned int  rejected_conns; /* number of times I reject a client */
     unsigned int  total_conns;
     unsigned int  conn_structs;
+    unsigned int  migrated_conns; /* idle conns moved to other worker threads */
 };
 
 #define MAX_VERBOSITY_LEVEL 2
@@ -231,6 +266,11 @@ struct settings {
     int reqs_per_event;     /* Maximum number of io to process on each io-event. */
     bool use_cas;
     enum protocol binding_protocol;
+    enum tcp_listen_mode listen_mode;
+    enum conn_placement conn_placement;
+    bool conn_migrate;      /* migrate idle connections on persistent imbalance */
+    enum io_backend io_backend;
+    size_t zerocopy_size;   /* min bytes of a message sent with zero-copy, 0 if disabled */
     int backlog;
     size_t item_size_max;   /* Maximum item size, and upper end for slabs */
     bool sasl;              /* SASL on/off */
@@ -256,6 +296,7 @@ struct engine_event_handler {
 };
 
 extern struct settings settings;
+extern struct mc_stats mc_stats;
 extern EXTENSION_LOGGER_DESCRIPTOR *mc_logger;
 
 typedef struct conn conn;
@@ -386,6 +427,13 @@ struct conn {
     socklen_t request_addr_size;
     unsigned char *hdrbuf; /* udp packet headers */
     int    hdrsize;   /* number of headers' worth of space is allocated */
+    struct udp_batch *udp_batch; /* datagrams batched by recvmmsg/sendmmsg */
+
+    /* zero-copy sends of the large messages (-Z option) */
+    int8_t   zc_state;  /* SO_ZEROCOPY of the socket: 0 unknown, 1 on, -1 unsupported */
+    uint32_t zc_sent;   /* # of sendmsg calls with MSG_ZEROCOPY */
+    uint32_t zc_done;   /* # of them whose completion the kernel has notified */
+    bool     zc_closing; /* closing after the completion of them */
 
     /* command pipelining processing fields */
     int               pipe_state;
@@ -485,6 +533,30 @@ struct conn {
     bool io_blocked;
     bool premature_io_complete;
 #endif
+#ifdef ENABLE_IO_URING
+    /* io_uring backend: set when the connection is served by the
+     * io_uring instance of its worker thread instead of libevent.
+     * The connection is driven by the completions, and it can be freed
+     * only after all its requests have completed (uring_inflight == 0).
+     */
+    struct uring *uring;
+    bool uring_closing;   /* waiting for the inflight requests to close */
+    bool uring_blocked;   /* blocked by the engine (see should_io_blocked) */
+    bool uring_resuming;  /* a nop is submitted to resume (yield) */
+    bool uring_recving;   /* a multishot recv is armed */
+    bool uring_recvstop;  /* the recv is stopped until the stash is drained */
+    int  uring_inflight;  /* # of requests not completed yet */
+    int  uring_sends;     /* # of sendmsg requests not completed yet */
+    int  uring_sendcurr;  /* msglist index of the next sendmsg completion */
+    int  uring_senderr;   /* errno of a failed sendmsg */
+    int  uring_recverr;   /* -1: none, 0: end of stream, >0: errno */
+    char *uring_data;     /* received data in a provided buffer */
+    int  uring_dlen;
+    char *uring_inbuf;    /* received data not consumed yet */
+    int  uring_insize;
+    int  uring_inoff;
+    int  uring_inlen;
+#endif
 };
 
 /* set connection's ewouldblock according to the given return value */
@@ -579,6 +651,7 @@ extern int daemonize(int nochdir, int noclose);
 #include "stats.h"
 #include "trace.h"
 #include "hash.h"
+#include "uring.h"
 #include <memcached/util.h>
 
 void LOCK_STATS(void);
@@ -603,6 +676,11 @@ void safe_close(int sfd);
 void init_check_stdin(struct event_base *base);
 
 void conn_close(conn *c);
+bool conn_is_idle(conn *c);
+bool conn_set_event_base(conn *c, struct event_base *base);
+void event_handler(const int fd, const short which, void *arg);
+void conn_msg_sent(conn *c, struct msghdr *m, ssize_t res);
+bool conn_msg_zerocopy(conn *c, struct msghdr *m);
 
 #if HAVE_DROP_PRIVILEGES
 extern void drop_privileges(void);
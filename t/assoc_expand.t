@@ -0,0 +1,74 @@
+#!/usr/bin/perl
+# Test the incremental expansion of the hash table.
+
+use strict;
+use Test::More tests => 9;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 256");
+my $sock = $server->sock;
+my $stats;
+my $key;
+
+sub set_keys {
+    my ($from, $to) = @_;
+    my $buf = "";
+    for ($key = $from; $key < $to; $key++) {
+        $buf .= "set key$key 0 0 " . length("v$key") . " noreply\r\nv$key\r\n";
+        if (length($buf) > 65536) {
+            print $sock $buf; $buf = "";
+        }
+    }
+    print $sock $buf;
+    # wait until all the sets are processed.
+    mem_cmd_is($sock, "get key$from", "", "VALUE key$from 0 " . length("v$from") . "\nv$from\nEND");
+}
+
+sub count_keys {
+    my ($from, $to) = @_;
+    my $found = 0;
+    for (my $k = $from; $k < $to; $k += 100) {
+        my $cmd = "get";
+        for (my $i = $k; $i < $k + 100 && $i < $to; $i++) {
+            $cmd .= " key$i";
+        }
+        print $sock "$cmd\r\n";
+        while (<$sock>) {
+            last if /^END/;
+            if (/^VALUE key(\d+) 0 \d+/) {
+                my $id = $1;
+                my $data = <$sock>;
+                $data =~ s/\r\n$//;
+                $found++ if $data eq "v$id";
+            }
+        }
+    }
+    return $found;
+}
+
+$stats = mem_stats($sock);
+my $buckets = $stats->{"hash_buckets"};
+is($stats->{"hash_is_expanding"}, 0, "not expanding");
+
+# exceed 1.5 items per bucket to start the expansion.
+my $nkeys = int($buckets * 3 / 2) + 100;
+set_keys(0, $nkeys);
+$stats = mem_stats($sock);
+is($stats->{"hash_buckets"}, $buckets * 2, "hash buckets doubled");
+is($stats->{"hash_is_expanding"}, 1, "expanding");
+cmp_ok($stats->{"hash_expand_progress"}, '<', 100, "expansion in progress");
+
+# all the items are found during the expansion.
+is(count_keys(0, $nkeys), $nkeys, "items found while expanding");
+
+# the insertions complete the expansion.
+set_keys($nkeys, $nkeys + $buckets);
+$stats = mem_stats($sock);
+is($stats->{"hash_is_expanding"}, 0, "expansion completed");
+is(count_keys(0, $nkeys + $buckets), $nkeys + $buckets, "items found after expansion");
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,104 @@
+#!/usr/bin/perl
+# Test the incremental expansion of the hash table while scans are running.
+# The buckets pinned by the scans are deferred instead of stalling the expansion.
+
+use strict;
+use Test::More tests => 9;
+use POSIX;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 256 -X .libs/ascii_scrub.so -e scrub_count=16");
+my $sock = $server->sock;
+my $stats;
+my $key;
+
+sub set_keys {
+    my ($from, $to) = @_;
+    my $buf = "";
+    for ($key = $from; $key < $to; $key++) {
+        $buf .= "set key$key 0 0 " . length("v$key") . " noreply\r\nv$key\r\n";
+        if (length($buf) > 65536) {
+            print $sock $buf; $buf = "";
+        }
+    }
+    print $sock $buf;
+    # wait until all the sets are processed.
+    mem_cmd_is($sock, "get key$from", "", "VALUE key$from 0 " . length("v$from") . "\nv$from\nEND");
+}
+
+sub count_keys {
+    my ($from, $to) = @_;
+    my $found = 0;
+    for (my $k = $from; $k < $to; $k += 100) {
+        my $cmd = "get";
+        for (my $i = $k; $i < $k + 100 && $i < $to; $i++) {
+            $cmd .= " key$i";
+        }
+        print $sock "$cmd\r\n";
+        while (<$sock>) {
+            last if /^END/;
+            if (/^VALUE key(\d+) 0 \d+/) {
+                my $id = $1;
+                my $data = <$sock>;
+                $data =~ s/\r\n$//;
+                $found++ if $data eq "v$id";
+            }
+        }
+    }
+    return $found;
+}
+
+$stats = mem_stats($sock);
+my $buckets = $stats->{"hash_buckets"};
+my $nkeys = int($buckets * 3 / 2) - 100;
+set_keys(0, $nkeys);
+
+# the scrubs keep the buckets pinned by their scans.
+my $pid = fork();
+die "fork failed: $!" unless defined $pid;
+if ($pid == 0) {
+    my $conn = $server->new_sock;
+    my $until = time() + 60;
+    while (time() < $until) {
+        my $scrub = mem_stats($conn, "scrub");
+        if ($scrub->{"scrubber:status"} ne "running") {
+            print $conn "scrub\r\n";
+            my $line = <$conn>;
+            last unless defined $line;
+        }
+        select(undef, undef, undef, 0.001);
+    }
+    # _exit() not to stop the server in the destructors of the child.
+    POSIX::_exit(0);
+}
+
+# the insertions start and complete the expansion while scrubbing.
+set_keys($nkeys, $nkeys + $buckets + 200);
+$stats = mem_stats($sock);
+is($stats->{"hash_buckets"}, $buckets * 2, "hash buckets doubled");
+ok($stats->{"hash_is_expanding"} == 0 || $stats->{"hash_expand_progress"} == 100,
+   "all buckets visited while scrubbing");
+my $deferred = $stats->{"hash_expand_deferred"};
+cmp_ok($deferred, '<=', 64, "deferred buckets are bounded");
+
+kill('TERM', $pid);
+waitpid($pid, 0);
+# wait for the last scrub to finish.
+for (my $i = 0; $i < 100; $i++) {
+    my $scrub = mem_stats($sock, "scrub");
+    last if $scrub->{"scrubber:status"} ne "running";
+    select(undef, undef, undef, 0.1);
+}
+
+# the deferred buckets are split by the next insertions.
+set_keys($nkeys + $buckets + 200, $nkeys + $buckets + 300);
+$stats = mem_stats($sock);
+is($stats->{"hash_is_expanding"}, 0, "expansion completed");
+is($stats->{"hash_expand_deferred"}, 0, "no deferred buckets");
+is(count_keys(0, $nkeys + $buckets + 300), $nkeys + $buckets + 300, "items found after expansion");
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,102 @@
+#!/usr/bin/perl
+# Test the lop, sop and bop minsert commands of the binary protocol.
+
+use strict;
+use warnings;
+use Test::More tests => 16;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+use constant CMD_LOP_MINSERT => 0x56;
+use constant CMD_SOP_MINSERT => 0x68;
+use constant CMD_BOP_MINSERT => 0x91;
+
+use constant ST_SUCCESS      => 0x00;
+use constant ST_KEY_ENOENT   => 0x01;
+use constant ST_EINVAL       => 0x04;
+use constant ST_EOVERFLOW    => 0x33;
+use constant ST_EINDEXOOR    => 0x35;
+use constant ST_ELEM_EEXISTS => 0x38;
+use constant ST_EBADBKEY     => 0x3a;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $bsock = $server->new_sock;
+my $sock = $server->sock;
+
+# the statuses of the elements in the minsert response
+sub minsert_statuses {
+    my ($extras, $value) = @_;
+    my $count = unpack("N", $extras);
+    return join(",", unpack("n$count", $value));
+}
+
+sub lop_extras {
+    my ($index, $count, $create) = @_;
+    return pack("NNNNNCCCC", $index & 0xffffffff, $count, 0, 0, 0, $create, 0, 0, 0);
+}
+
+sub coll_extras {
+    my ($count, $create, $maxcount) = @_;
+    return pack("NNNNCCCC", $count, 0, 0, $maxcount, $create, 0, 0, 0);
+}
+
+sub elems {
+    return join("", map { pack("N", length($_)) . $_ } @_);
+}
+
+sub bop_elems {
+    my $value = "";
+    foreach my $e (@_) {
+        my ($bkey, $eflag, $data) = @$e;
+        $value .= pack("C", 0) . pack("NN", 0, $bkey)
+                . pack("C", length($eflag)) . $eflag
+                . pack("N", length($data)) . $data;
+    }
+    return $value;
+}
+
+my ($status, $extras, $value);
+
+# lop minsert
+($status) = bin_cmd($bsock, CMD_LOP_MINSERT, "lkey", lop_extras(-1, 1, 0), elems("a"));
+is($status, ST_KEY_ENOENT, "lop minsert: not found");
+($status, $extras, $value) = bin_cmd($bsock, CMD_LOP_MINSERT, "lkey", lop_extras(-1, 3, 1),
+                                     elems("a", "b", "c"));
+is($status, ST_SUCCESS, "lop minsert: created");
+is(minsert_statuses($extras, $value), "0,0,0", "lop minsert: all stored");
+($status, $extras, $value) = bin_cmd($bsock, CMD_LOP_MINSERT, "lkey", lop_extras(1, 2, 0), elems("x", "y"));
+is(minsert_statuses($extras, $value), "0,0", "lop minsert: stored at the index");
+($status, $extras, $value) = bin_cmd($bsock, CMD_LOP_MINSERT, "lkey", lop_extras(10, 1, 0), elems("z"));
+is(minsert_statuses($extras, $value), ST_EINDEXOOR, "lop minsert: out of range");
+mem_cmd_is($sock, "lop get lkey 0..-1", "",
+           "VALUE 0 5\n1 a\n1 x\n1 y\n1 b\n1 c\nEND");
+
+# sop minsert
+($status, $extras, $value) = bin_cmd($bsock, CMD_SOP_MINSERT, "skey", coll_extras(3, 1, 0),
+                                     elems("a", "b", "a"));
+is($status, ST_SUCCESS, "sop minsert: created");
+is(minsert_statuses($extras, $value), "0,0,".ST_ELEM_EEXISTS, "sop minsert: element exists");
+mem_cmd_is($sock, "sop create skey2 0 0 1", "", "CREATED");
+($status, $extras, $value) = bin_cmd($bsock, CMD_SOP_MINSERT, "skey2", coll_extras(2, 0, 0), elems("a", "b"));
+is(minsert_statuses($extras, $value), "0,".ST_EOVERFLOW, "sop minsert: overflowed");
+
+# bop minsert
+($status, $extras, $value) = bin_cmd($bsock, CMD_BOP_MINSERT, "bkey", coll_extras(3, 1, 0),
+                                     bop_elems([3, "", "c"], [1, "\x0f", "a"], [3, "", "d"]));
+is($status, ST_SUCCESS, "bop minsert: created");
+is(minsert_statuses($extras, $value), "0,0,".ST_ELEM_EEXISTS, "bop minsert: element exists");
+mem_cmd_is($sock, "bop get bkey 0..10", "",
+           "VALUE 0 2\n1 0x0F 1 a\n3 1 c\nEND");
+
+# bad element data: nothing is inserted
+($status) = bin_cmd($bsock, CMD_BOP_MINSERT, "bkey", coll_extras(2, 0, 0),
+                    bop_elems([5, "", "e"]) . pack("C", 0));
+is($status, ST_EINVAL, "bop minsert: bad element data");
+($status) = bin_cmd($bsock, CMD_SOP_MINSERT, "skey", coll_extras(0, 0, 0), elems("e"));
+is($status, ST_EINVAL, "sop minsert: bad element count");
+mem_cmd_is($sock, "bop count bkey 0..10", "", "COUNT=2");
+
+# after test
+release_memcached($engine, $server);
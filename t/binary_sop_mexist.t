@@ -0,0 +1,101 @@
+#!/usr/bin/perl
+# Test the sop mexist command of the binary protocol.
+
+use strict;
+use warnings;
+use Test::More tests => 20;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+use constant CMD_SOP_MEXIST => 0x67;
+
+use constant ST_SUCCESS    => 0x00;
+use constant ST_KEY_ENOENT => 0x01;
+use constant ST_EINVAL     => 0x04;
+use constant ST_EBADTYPE   => 0x32;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $bsock = $server->new_sock;
+my $sock = $server->sock;
+
+# send the values and return the status and the existence of each value.
+sub bin_mexist {
+    my ($key, @values) = @_;
+    my $value = join("", map { pack("N", length($_)) . $_ } @values);
+    my ($status, $extras, $bitmap) = bin_cmd($bsock, CMD_SOP_MEXIST, $key, pack("N", scalar(@values)), $value);
+    return ($status, "") if ($status != ST_SUCCESS);
+    my $count = unpack("N", $extras);
+    my @bits = split(//, unpack("b*", $bitmap));
+    return ($status, join("", @bits[0 .. $count - 1]));
+}
+
+sub sop_exist_stats {
+    my $stats = mem_stats($sock);
+    return join(",", $stats->{"cmd_sop_exist"}, $stats->{"sop_exist_hits"},
+                     $stats->{"sop_exist_misses"});
+}
+
+my $status;
+my $exist;
+my $cmd;
+my $val;
+my $rst;
+
+# key miss
+($status, $exist) = bin_mexist("skey1", "datum");
+is($status, ST_KEY_ENOENT, "mexist on a missing key");
+is(sop_exist_stats(), "1,0,1", "a miss is counted once");
+
+# a small set
+$cmd = "sop create skey1 0 0 100"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "sop insert skey1 6"; $val = "datum1"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "sop insert skey1 6"; $val = "datum2"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+($status, $exist) = bin_mexist("skey1", "datum1", "datum3", "datum2", "datum");
+is($status, ST_SUCCESS, "mexist on a small set");
+is($exist, "1010", "existence bitmap of a small set");
+is(sop_exist_stats(), "2,1,1", "a hit is counted once per command");
+
+# the ascii protocol counts a hit the same way
+$val = "6\r\ndatum1\r\n6\r\ndatum3\r\n6\r\ndatum2";
+$cmd = "sop mexist skey1 " . (length($val)+2) . " 3";
+$rst = "RESPONSE 3\nEXIST\nNOT_EXIST\nEXIST\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+is(sop_exist_stats(), "3,2,1", "an ascii hit is counted once per command");
+
+# a large set having the element index
+my $buf = "";
+for (my $i = 0; $i < 1000; $i++) {
+    $buf .= "sop insert skey2 6 create 0 0 0 noreply\r\n" . sprintf("e%05d", $i*2) . "\r\n";
+}
+print $sock $buf;
+mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+($status, $exist) = bin_mexist("skey2", map { sprintf("e%05d", $_) } (0 .. 999));
+is($status, ST_SUCCESS, "mexist on a large set");
+is($exist, "10" x 500, "existence bitmap of a large set");
+is(sop_exist_stats(), "4,3,1", "a hit of many values is counted once");
+
+# not a set
+$cmd = "set kvkey 0 0 5"; $val = "datum"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+($status, $exist) = bin_mexist("kvkey", "datum");
+is($status, ST_EBADTYPE, "mexist on a kv item");
+
+# bad values
+($status) = bin_cmd($bsock, CMD_SOP_MEXIST, "skey1", pack("N", 0), pack("N", 6) . "datum1");
+is($status, ST_EINVAL, "mexist of zero count");
+($status) = bin_cmd($bsock, CMD_SOP_MEXIST, "skey1", pack("N", 2),
+                    pack("N", 6) . "datum1" . pack("N", 7) . "datum2");
+is($status, ST_EINVAL, "mexist of a short value");
+($status) = bin_cmd($bsock, CMD_SOP_MEXIST, "skey1", pack("N", 1),
+                    pack("N", 6) . "datum1" . pack("N", 6) . "datum2");
+is($status, ST_EINVAL, "mexist of more values than the count");
+is(sop_exist_stats(), "8,3,1", "the failures are counted as commands");
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,117 @@
+#!/usr/bin/perl
+# Test the b+tree operations on the compressed elements of btree_compress.
+
+use strict;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+if (MemcachedTest::supports_btree_compress()) {
+    plan tests => 27;
+} else {
+    plan skip_all => 'b+tree compression is not enabled';
+}
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 64 -e btree_compress=true");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+sub elem_value {
+    my ($bkey) = @_;
+    return sprintf("{\"id\":%d,\"name\":\"user%05d\",\"status\":\"active\","
+                 . "\"created\":\"2020-01-01T00:%02d:00Z\",\"tags\":[\"a\",\"b\",\"c\"],"
+                 . "\"score\":%d}", 100000 + $bkey, $bkey, $bkey % 60, ($bkey * 7) % 1000);
+}
+
+sub elem_lines {
+    my ($key, @bkeys) = @_;
+    my $lines = "";
+    foreach my $bkey (@bkeys) {
+        my $value = elem_value($bkey);
+        $lines .= ($key eq "" ? "" : "$key 0 ") . "$bkey " . length($value) . " $value\n";
+    }
+    return $lines;
+}
+
+# compressed elements
+$cmd = "bop create zbt 0 0 4000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+my $vals = bop_insert_all($sock, "zbt", [0..999], \&elem_value);
+my $stats = mem_stats($sock);
+ok($stats->{bytes} < $vals, "compressed: bytes $stats->{bytes} < values $vals");
+ok($stats->{btree_zip_count} > 0, "zip count: $stats->{btree_zip_count}");
+
+$cmd = "bop get zbt 10..12"; $rst = "VALUE 0 3\n" . elem_lines("", 10, 11, 12) . "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop get zbt 900..898"; $rst = "VALUE 0 3\n" . elem_lines("", 900, 899, 898) . "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop gbp zbt desc 0..1"; $rst = "VALUE 0 2\n" . elem_lines("", 999, 998) . "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop pwg zbt 500 asc 1"; $rst = "VALUE 500 0 3 1\n" . elem_lines("", 499, 500, 501) . "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$stats = mem_stats($sock);
+ok($stats->{btree_unzip_count} >= 8, "unzip count: $stats->{btree_unzip_count}");
+
+# update of the compressed elements
+my $elem600 = "600 0x01 " . length(elem_value(600)) . " " . elem_value(600) . "\n";
+$cmd = "bop update zbt 600 0x01 -1"; $rst = "UPDATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop get zbt 600"; $rst = "VALUE 0 1\n" . $elem600 . "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop update zbt 601 5"; $val = "datum"; $rst = "UPDATED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "bop get zbt 601"; $rst = "VALUE 0 1\n601 5 datum\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# smget with the uncompressed b+tree
+$cmd = "bop create rbt 0 0 4000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop insert rbt 998 5"; $val = "datum"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "bop smget 7 2 997..999 4 duplicate"; $val = "zbt rbt";
+$rst = "ELEMENTS 4\n" . elem_lines("zbt", 997) . "rbt 0 998 5 datum\n" . elem_lines("zbt", 998, 999)
+     . "MISSED_KEYS 0\nTRIMMED_KEYS 0\nDUPLICATED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "bop smget 7 2 997..999 4"; $val = "zbt,rbt";
+$rst = "VALUE 4\n" . elem_lines("zbt", 997) . "rbt 0 998 5 datum\n" . elem_lines("zbt", 998, 999)
+     . "MISSED_KEYS 0\nDUPLICATED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# arithmetic on the compressed number
+$val = "100" . (" " x 37);
+$cmd = "bop insert zbt 1000 " . length($val); $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "bop incr zbt 1000 5"; $rst = "105";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# getrim of the compressed element
+$cmd = "setattr zbt maxcount=1001"; $rst = "OK";
+mem_cmd_is($sock, $cmd, "", $rst);
+$val = elem_value(1001);
+$cmd = "bop insert zbt 1001 " . length($val) . " getrim";
+$rst = "VALUE 0 1\n" . elem_lines("", 0) . "TRIMMED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# get and delete all the elements
+$cmd = "bop get zbt 300..302 delete"; $rst = "VALUE 0 3\n" . elem_lines("", 300..302) . "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop get zbt 299..303"; $rst = "VALUE 0 2\n" . elem_lines("", 299, 303) . "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop get zbt 1..999 delete";
+$rst = "VALUE 0 996\n" . elem_lines("", 1..299, 303..599) . $elem600 . "601 5 datum\n"
+     . elem_lines("", 602..999) . "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop delete zbt 0..2000 drop"; $rst = "DELETED_DROPPED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "delete rbt"; $rst = "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$stats = mem_stats($sock);
+ok($stats->{bytes} < 1000, "released: bytes $stats->{bytes}");
+
+# after test
+release_memcached($engine, $server);
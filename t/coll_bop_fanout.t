@@ -0,0 +1,69 @@
+#!/usr/bin/perl
+# Test the b+tree operations on the wide nodes of btree_fanout.
+
+use strict;
+use Test::More tests => 15;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 256 -e btree_fanout=128");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# the bkeys in a scattered order to split the nodes everywhere.
+sub scattered_bkeys {
+    my ($cnt) = @_;
+    return [map { ($_ * 7919) % $cnt } (0..$cnt-1)];
+}
+
+sub elem_value {
+    my ($bkey) = @_;
+    return sprintf("e%05d", $bkey);
+}
+
+sub bop_get_is {
+    my ($key, $from, $to) = @_;
+    my $step = ($from <= $to ? 1 : -1);
+    my $cnt = abs($to - $from) + 1;
+    my $vals = "";
+    for (my $bkey = $from; $bkey != $to + $step; $bkey += $step) {
+        $vals .= "$bkey 6 " . elem_value($bkey) . "\n";
+    }
+    mem_cmd_is($sock, "bop get $key $from..$to", "", "VALUE 0 $cnt\n${vals}END");
+}
+
+# the wide nodes: maxcount larger than the default b+tree size
+$cmd = "bop create wide 0 0 10000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+bop_insert_all($sock, "wide", scattered_bkeys(5000), \&elem_value);
+$cmd = "bop count wide 0..9999"; $rst = "COUNT=5000";
+mem_cmd_is($sock, $cmd, "", $rst);
+bop_get_is("wide", 1020, 1040);
+bop_get_is("wide", 4010, 3990);
+$cmd = "bop position wide 2500 asc"; $rst = "POSITION=2500";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop delete wide 1000..3999"; $rst = "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop count wide 0..9999"; $rst = "COUNT=2000";
+mem_cmd_is($sock, $cmd, "", $rst);
+bop_get_is("wide", 995, 999);
+$cmd = "bop position wide 4000 asc"; $rst = "POSITION=1000";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# the default nodes: maxcount of the default b+tree size
+$cmd = "bop create narrow 0 0 4000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+bop_insert_all($sock, "narrow", scattered_bkeys(4000), \&elem_value);
+$cmd = "bop count narrow 0..9999"; $rst = "COUNT=4000";
+mem_cmd_is($sock, $cmd, "", $rst);
+bop_get_is("narrow", 2990, 3010);
+$cmd = "bop position narrow 3999 desc"; $rst = "POSITION=0";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,97 @@
+#!/usr/bin/perl
+# Test the bop minsert command inserting many elements into a b+tree at once.
+
+use strict;
+use Test::More tests => 20;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# key miss without create
+$val = "1 5\r\ndatum";
+$cmd = "bop minsert bkey1 " . (length($val)+2) . " 1"; $rst = "NOT_FOUND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# create the b+tree and insert the elements
+$val = "1 6\r\ndatum1\r\n2 0x0F 6\r\ndatum2\r\n3 6\r\ndatum3\r\n2 6\r\ndatum4";
+$cmd = "bop minsert bkey1 " . (length($val)+2) . " 4 create 11 0 0";
+$rst = "RESPONSE 4\nCREATED_STORED\nSTORED\nSTORED\nELEMENT_EXISTS\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "bop get bkey1 0..10";
+$rst = "VALUE 11 3\n1 6 datum1\n2 0x0F 6 datum2\n3 6 datum3\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# insert into the existing b+tree
+$val = "5 6\r\ndatum5\r\n0x05 6\r\ndatum6\r\n4 6\r\ndatum4";
+$cmd = "bop minsert bkey1 " . (length($val)+2) . " 3";
+$rst = "RESPONSE 3\nSTORED\nBKEY_MISMATCH\nSTORED\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "bop count bkey1 0..10"; $rst = "COUNT=5";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# overflow with the maxcount
+$cmd = "bop create bkey2 0 0 2"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$val = "2 1\r\nb\r\n3 1\r\nc\r\n1 1\r\na";
+$cmd = "bop minsert bkey2 " . (length($val)+2) . " 3";
+$rst = "RESPONSE 3\nSTORED\nSTORED\nOUT_OF_RANGE\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# noreply
+$val = "6 6\r\ndatum6\r\n7 6\r\ndatum7";
+$cmd = "bop minsert bkey1 " . (length($val)+2) . " 2 noreply"; $rst = "";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "bop count bkey1 0..10"; $rst = "COUNT=7";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# bad data chunk: nothing is inserted
+$val = "8 6\r\ndatum8\r\n9 6\r\ndatum9X";
+$cmd = "bop minsert bkey1 " . (length($val)+2) . " 2"; $rst = "CLIENT_ERROR bad data chunk";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$val = "8 6\r\ndatum8\r\n9 6\r\ndatum9";
+$cmd = "bop minsert bkey1 " . (length($val)+2) . " 1"; $rst = "CLIENT_ERROR bad data chunk";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "bop count bkey1 0..10"; $rst = "COUNT=7";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# sorted elements appended to the b+tree
+sub bop_minsert_sorted {
+    my ($key, $from, $count, $create) = @_;
+    my $elems = "";
+    my $resps = "";
+    for (my $bkey = $from; $bkey < $from + $count; $bkey++) {
+        $elems .= "$bkey 6\r\n" . sprintf("e%05d", $bkey) . "\r\n";
+        $resps .= ($bkey == $from && $create ne "" ? "CREATED_STORED\n" : "STORED\n");
+    }
+    $elems = substr($elems, 0, length($elems)-2);
+    mem_cmd_is($sock, "bop minsert $key " . (length($elems)+2) . " $count$create",
+               $elems, "RESPONSE $count\n${resps}END");
+}
+bop_minsert_sorted("bkey3", 1000, 500, " create 0 0 0");
+bop_minsert_sorted("bkey3", 2000, 500, "");
+bop_minsert_sorted("bkey3", 1500, 500, "");
+$cmd = "bop count bkey3 0..9999"; $rst = "COUNT=1500";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop position bkey3 1800 asc"; $rst = "POSITION=800";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "bop get bkey3 1498..1501";
+$rst = "VALUE 0 4\n1498 6 e01498\n1499 6 e01499\n1500 6 e01500\n1501 6 e01501\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# type mismatch
+$cmd = "set kvkey 0 0 1"; $val = "x"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$val = "1 5\r\ndatum";
+$cmd = "bop minsert kvkey " . (length($val)+2) . " 1"; $rst = "TYPE_MISMATCH";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,105 @@
+#!/usr/bin/perl
+# Test the element index of large sets and maps with the slab page reassignment.
+# The index is kept in segments of the small memory, not in the slab classes.
+
+use strict;
+use Test::More tests => 154;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 256");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+my $key;
+my $val_a = "A"x66560;
+my $val_b = "B"x200000;
+
+sub insert_elems {
+    my ($type, $key, $count) = @_;
+    my $buf = "";
+    for (my $i = 0; $i < $count; $i++) {
+        if ($type eq "set") {
+            $buf .= sprintf("sop insert $key 6 noreply\r\ne%05d\r\n", $i);
+        } else {
+            $buf .= sprintf("mop insert $key f%05d 6 noreply\r\nv%05d\r\n", $i, $i);
+        }
+        if (length($buf) > 65536) {
+            print $sock $buf; $buf = "";
+        }
+    }
+    print $sock $buf;
+    # wait until all the commands are processed.
+    mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+}
+
+sub check_elems {
+    my ($key, $count) = @_;
+    my $last = sprintf("%05d", $count - 1);
+    my $over = sprintf("%05d", $count);
+    if ($key =~ /^s/) {
+        mem_cmd_is($sock, "sop exist $key 6", "e$last", "EXIST");
+        mem_cmd_is($sock, "sop exist $key 6", "e$over", "NOT_EXIST");
+    } else {
+        mem_cmd_is($sock, "mop get $key 13 2", "f$last f$over",
+                   "VALUE 0 1\nf$last 6 v$last\nEND");
+        mem_cmd_is($sock, "getattr $key count", "", "ATTR count=$count\nEND");
+    }
+}
+
+# the sets and maps having the index of 4096 slots
+for ($key = 0; $key < 16; $key++) {
+    mem_cmd_is($sock, "sop create skey$key 0 0 10000", "", "CREATED");
+    insert_elems("set", "skey$key", 1600);
+    mem_cmd_is($sock, "mop create mkey$key 0 0 10000", "", "CREATED");
+    insert_elems("map", "mkey$key", 1600);
+}
+# a very large set and map having the index of many segments
+$cmd = "config max_set_size 100000"; $rst = "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "config max_map_size 100000"; $rst = "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "sop create skeyL 0 0 100000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+insert_elems("set", "skeyL", 60000);
+$cmd = "mop create mkeyL 0 0 100000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+insert_elems("map", "mkeyL", 60000);
+$cmd = "sop insert skeyL 6"; $val = "e45678"; $rst = "ELEMENT_EXISTS";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "mop insert mkeyL f45678 6"; $val = "x45678"; $rst = "ELEMENT_EXISTS";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# the kv items take the chunks of the slab classes
+for ($key = 0; $key < 8; $key++) {
+    $cmd = "set b$key 0 0 200000"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val_b, $rst);
+}
+for ($key = 0; $key < 100; $key++) {
+    print $sock "set a$key 0 0 66560 noreply\r\n$val_a\r\n";
+}
+mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+is(slabs_large_used_chunks($sock), 108, "no index chunks in the slab classes");
+
+# move the pages holding the kv items only
+my $cls_a = slabs_clsid($sock, 66560);
+my $cls_b = slabs_clsid($sock, 200000);
+for (my $i = 0; $i < 4; $i++) {
+    $cmd = "config slabs_reassign $cls_a $cls_b"; $rst = "END";
+    mem_cmd_is($sock, $cmd, "", $rst);
+}
+
+# the sets and maps are intact
+for ($key = 0; $key < 16; $key++) {
+    check_elems("skey$key", 1600);
+    check_elems("mkey$key", 1600);
+}
+check_elems("skeyL", 60000);
+check_elems("mkeyL", 60000);
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,62 @@
+#!/usr/bin/perl
+# Test the positional list operations on a long list having the position index.
+
+use strict;
+use Test::More tests => 12;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-e list_index_threshold=1000");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# a long list: e00000 ~ e02999
+$cmd = "lop create lkey 0 0 10000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+my $buf = "";
+for (my $i = 0; $i < 3000; $i++) {
+    $buf .= "lop insert lkey -1 6 noreply\r\n" . sprintf("e%05d", $i) . "\r\n";
+}
+print $sock $buf;
+mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+
+# the access into the middle builds the index
+$cmd = "lop get lkey 1500..1502";
+$rst = "VALUE 0 3\n6 e01500\n6 e01501\n6 e01502\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "lop get lkey -1000..-1002";
+$rst = "VALUE 0 3\n6 e02000\n6 e01999\n6 e01998\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# insert and delete in the middle
+$cmd = "lop insert lkey 1000 6"; $val = "x01000"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "lop get lkey 999..1001";
+$rst = "VALUE 0 3\n6 e00999\n6 x01000\n6 e01000\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "lop delete lkey 1001..1500"; $rst = "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "lop get lkey 1000..1002";
+$rst = "VALUE 0 3\n6 x01000\n6 e01500\n6 e01501\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "lop get lkey 2000..1998 delete";
+$rst = "VALUE 0 3\n6 e02499\n6 e02498\n6 e02497\nDELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "lop get lkey 1997..2000";
+$rst = "VALUE 0 4\n6 e02496\n6 e02500\n6 e02501\n6 e02502\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# shrink the list below the threshold
+$cmd = "lop delete lkey 100..-3"; $rst = "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "lop get lkey 98..101";
+$rst = "VALUE 0 4\n6 e00098\n6 e00099\n6 e02998\n6 e02999\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,89 @@
+#!/usr/bin/perl
+# Test the position index of a very long list with the slab page reassignment.
+# The index is kept in blocks of the small memory, not in the slab classes.
+
+use strict;
+use Test::More tests => 51;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 128 -e list_index_threshold=1000");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+my $key;
+my @list;
+my $val_a = "A"x66560;
+my $val_b = "B"x200000;
+
+sub lop_get_is {
+    my ($index) = @_;
+    my $v = $list[$index];
+    mem_cmd_is($sock, "lop get lkey $index", "", "VALUE 0 1\n7 $v\nEND");
+}
+
+# a very long list of 200000 elements. The index has two blocks of segments.
+$cmd = "config max_list_size 1000000"; $rst = "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "lop create lkey 0 0 1000000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+for (my $i = 0; $i < 200000; $i += 10000) {
+    my $buf = "";
+    for (my $j = $i; $j < $i + 10000; $j++) {
+        push(@list, sprintf("e%06d", $j));
+        $buf .= "lop insert lkey -1 7 noreply\r\n$list[$j]\r\n";
+    }
+    print $sock $buf;
+    mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+}
+# the access into the middle builds the index
+lop_get_is(150000);
+
+# split the segments before the block boundary and shift them across it
+my $buf = "";
+for (my $i = 0; $i < 1000; $i++) {
+    $val = sprintf("x%06d", $i);
+    splice(@list, 100000, 0, $val);
+    $buf .= "lop insert lkey 100000 7 noreply\r\n$val\r\n";
+}
+print $sock $buf;
+mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+# remove the segments and shift them back across the block boundary
+$cmd = "lop delete lkey 50000..53999"; $rst = "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+splice(@list, 50000, 4000);
+
+foreach my $index (0, 49999, 50000, 99999, 100000, 100999, 101000,
+                   131071, 131072, 131073, 150000, scalar(@list) - 1) {
+    lop_get_is($index);
+}
+
+# the kv items take the chunks of the slab classes
+for ($key = 0; $key < 8; $key++) {
+    $cmd = "set b$key 0 0 200000"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val_b, $rst);
+}
+for ($key = 0; $key < 100; $key++) {
+    print $sock "set a$key 0 0 66560 noreply\r\n$val_a\r\n";
+}
+mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+is(slabs_large_used_chunks($sock), 108, "no index chunks in the slab classes");
+
+# move a page holding the kv items only
+my $cls_a = slabs_clsid($sock, 66560);
+my $cls_b = slabs_clsid($sock, 200000);
+$cmd = "config slabs_reassign $cls_a $cls_b"; $rst = "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# the list is intact
+lop_get_is(131072);
+lop_get_is(scalar(@list) - 1);
+$cmd = "getattr lkey count"; $rst = "ATTR count=" . scalar(@list) . "\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
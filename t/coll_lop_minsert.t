@@ -0,0 +1,74 @@
+#!/usr/bin/perl
+# Test the lop minsert command inserting many elements into a list at once.
+
+use strict;
+use Test::More tests => 12;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# key miss without create
+$val = "5\r\ndatum";
+$cmd = "lop minsert lkey1 0 " . (length($val)+2) . " 1"; $rst = "NOT_FOUND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# create the list and append the elements in the given order
+$val = "6\r\ndatum1\r\n6\r\ndatum2\r\n6\r\ndatum3";
+$cmd = "lop minsert lkey1 -1 " . (length($val)+2) . " 3 create 11 0 0";
+$rst = "RESPONSE 3\nCREATED_STORED\nSTORED\nSTORED\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# insert at a non-negative index in the given order
+$val = "1\r\na\r\n1\r\nb";
+$cmd = "lop minsert lkey1 1 " . (length($val)+2) . " 2";
+$rst = "RESPONSE 2\nSTORED\nSTORED\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "lop get lkey1 0..-1";
+$rst = "VALUE 11 5\n6 datum1\n1 a\n1 b\n6 datum2\n6 datum3\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# out of range index
+$val = "1\r\nx";
+$cmd = "lop minsert lkey1 10 " . (length($val)+2) . " 1";
+$rst = "RESPONSE 1\nOUT_OF_RANGE\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# overflow with the maxcount
+$cmd = "lop create lkey2 0 0 2 error"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$val = "1\r\na\r\n1\r\nb\r\n1\r\nc";
+$cmd = "lop minsert lkey2 -1 " . (length($val)+2) . " 3";
+$rst = "RESPONSE 3\nSTORED\nSTORED\nOVERFLOWED\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# noreply
+$val = "1\r\nc\r\n1\r\nd";
+$cmd = "lop minsert lkey1 -1 " . (length($val)+2) . " 2 noreply"; $rst = "";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "lop get lkey1 -2..-1";
+$rst = "VALUE 11 2\n1 c\n1 d\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# bad data chunk: nothing is inserted
+$val = "1\r\ne\r\n1\r\nfX";
+$cmd = "lop minsert lkey1 -1 " . (length($val)+2) . " 2"; $rst = "CLIENT_ERROR bad data chunk";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "lop get lkey1 -1";
+$rst = "VALUE 11 1\n1 d\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# type mismatch
+$val = "1\r\na";
+$cmd = "sop minsert lkey1 " . (length($val)+2) . " 1"; $rst = "TYPE_MISMATCH";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# after test
+release_memcached($engine, $server);
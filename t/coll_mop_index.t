@@ -0,0 +1,53 @@
+#!/usr/bin/perl
+# Test the map operations on a large map having the element index.
+
+use strict;
+use Test::More tests => 10;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# a large map: f00000 ~ f02999
+$cmd = "mop create mkey 0 0 10000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+my $buf = "";
+for (my $i = 0; $i < 3000; $i++) {
+    $buf .= sprintf("mop insert mkey f%05d 6 noreply\r\nv%05d\r\n", $i, $i);
+}
+print $sock $buf;
+mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+
+$cmd = "mop insert mkey f01234 6"; $val = "x01234"; $rst = "ELEMENT_EXISTS";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "mop get mkey 20 3"; $val = "f00007 f03000 f02999";
+$rst = "VALUE 0 2\nf00007 6 v00007\nf02999 6 v02999\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# update the fields in place and with new elements
+$cmd = "mop update mkey f00007 6"; $val = "u00007"; $rst = "UPDATED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "mop update mkey f02999 10"; $val = "u000002999"; $rst = "UPDATED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "mop get mkey 13 2"; $val = "f00007 f02999";
+$rst = "VALUE 0 2\nf00007 6 u00007\nf02999 10 u000002999\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# delete the fields
+$cmd = "mop delete mkey 13 2"; $val = "f00007 f00008"; $rst = "DELETED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "mop get mkey 20 3"; $val = "f00007 f00008 f00009";
+$rst = "VALUE 0 1\nf00009 6 v00009\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "mop delete mkey 0 0"; $rst = "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
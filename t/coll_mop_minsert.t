@@ -0,0 +1,53 @@
+#!/usr/bin/perl
+# Test the mop minsert command inserting many elements into a map at once.
+
+use strict;
+use Test::More tests => 8;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# key miss without create
+$val = "f1 5\r\ndatum";
+$cmd = "mop minsert mkey1 " . (length($val)+2) . " 1"; $rst = "NOT_FOUND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# create the map and insert the elements
+$val = "f1 6\r\ndatum1\r\nf2 6\r\ndatum2\r\nf1 6\r\ndatum3";
+$cmd = "mop minsert mkey1 " . (length($val)+2) . " 3 create 11 0 0";
+$rst = "RESPONSE 3\nCREATED_STORED\nSTORED\nELEMENT_EXISTS\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "mop get mkey1 5 2"; $val = "f1 f2";
+$rst = "VALUE 11 2\nf1 6 datum1\nf2 6 datum2\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# overflow with the maxcount
+$cmd = "mop create mkey2 0 0 1"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$val = "a 1\r\na\r\nb 1\r\nb";
+$cmd = "mop minsert mkey2 " . (length($val)+2) . " 2";
+$rst = "RESPONSE 2\nSTORED\nOVERFLOWED\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# bad element head line: nothing is inserted
+$val = "f3 1\r\na\r\n1\r\nb";
+$cmd = "mop minsert mkey1 " . (length($val)+2) . " 2"; $rst = "CLIENT_ERROR bad data chunk";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "getattr mkey1 count"; $rst = "ATTR count=2\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# type mismatch
+$val = "1\r\na";
+$cmd = "sop minsert mkey1 " . (length($val)+2) . " 1"; $rst = "TYPE_MISMATCH";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,65 @@
+#!/usr/bin/perl
+# Test the set operations on a large set having the element index.
+
+use strict;
+use Test::More tests => 11;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+sub sop_insert_range {
+    my ($key, $from, $to) = @_;
+    my $buf = "";
+    for (my $i = $from; $i <= $to; $i++) {
+        $buf .= "sop insert $key 6 noreply\r\n" . sprintf("e%05d", $i) . "\r\n";
+    }
+    print $sock $buf;
+    # wait until all the commands are processed.
+    mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+}
+
+sub sop_delete_range {
+    my ($key, $from, $to) = @_;
+    my $buf = "";
+    for (my $i = $from; $i <= $to; $i++) {
+        $buf .= "sop delete $key 6 noreply\r\n" . sprintf("e%05d", $i) . "\r\n";
+    }
+    print $sock $buf;
+    mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+}
+
+# a large set: e00000 ~ e02999
+$cmd = "sop create skey 0 0 10000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+sop_insert_range("skey", 0, 2999);
+$cmd = "sop insert skey 6"; $val = "e01234"; $rst = "ELEMENT_EXISTS";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "sop exist skey 6"; $val = "e02999"; $rst = "EXIST";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "sop exist skey 6"; $val = "e03000"; $rst = "NOT_EXIST";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# delete the most elements
+sop_delete_range("skey", 0, 2899);
+$cmd = "sop exist skey 6"; $val = "e02899"; $rst = "NOT_EXIST";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "sop exist skey 6"; $val = "e02900"; $rst = "EXIST";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# shrink the set below the index size
+sop_delete_range("skey", 2900, 2979);
+$cmd = "sop exist skey 6"; $val = "e02990"; $rst = "EXIST";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "getattr skey count"; $rst = "ATTR count=20\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
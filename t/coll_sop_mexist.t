@@ -0,0 +1,78 @@
+#!/usr/bin/perl
+# Test the sop mexist command checking the existence of many values at once.
+
+use strict;
+use Test::More tests => 13;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# key miss
+$val = "5\r\ndatum";
+$cmd = "sop mexist skey1 " . (length($val)+2) . " 1"; $rst = "NOT_FOUND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# a small set
+$cmd = "sop create skey1 0 0 100"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "sop insert skey1 6"; $val = "datum1"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "sop insert skey1 6"; $val = "datum2"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+# an empty value: mem_cmd_is() does not send the empty data line
+$cmd = "sop insert skey1 0"; $rst = "STORED";
+print $sock "$cmd\r\n\r\n";
+is(scalar <$sock>, "$rst\r\n", "$cmd: $rst");
+
+$val = "6\r\ndatum1\r\n6\r\ndatum3\r\n0\r\n\r\n6\r\ndatum2\r\n5\r\ndatum";
+$cmd = "sop mexist skey1 " . (length($val)+2) . " 5";
+$rst = "RESPONSE 5\nEXIST\nNOT_EXIST\nEXIST\nEXIST\nNOT_EXIST\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# a large set having the element index
+my $buf = "";
+my $exp = "";
+for (my $i = 0; $i < 1000; $i++) {
+    $buf .= "sop insert skey2 6 create 0 0 0 noreply\r\n" . sprintf("e%05d", $i*2) . "\r\n";
+}
+print $sock $buf;
+mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+$val = "";
+for (my $i = 0; $i < 1000; $i++) {
+    $val .= "6\r\n" . sprintf("e%05d", $i) . "\r\n";
+    $exp .= ($i % 2 == 0 ? "EXIST\n" : "NOT_EXIST\n");
+}
+$val =~ s/\r\n$//;
+$cmd = "sop mexist skey2 " . (length($val)+2) . " 1000";
+$rst = "RESPONSE 1000\n${exp}END";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# not a set
+$cmd = "set kvkey 0 0 5"; $val = "datum"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$val = "5\r\ndatum";
+$cmd = "sop mexist kvkey " . (length($val)+2) . " 1"; $rst = "TYPE_MISMATCH";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# bad data chunk
+$val = "6\r\ndatum1\r\n6\r\ndatum2X";
+$cmd = "sop mexist skey1 " . (length($val)+2) . " 2"; $rst = "CLIENT_ERROR bad data chunk";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$val = "6\r\ndatum1\r\n6\r\ndatum2";
+$cmd = "sop mexist skey1 " . (length($val)+2) . " 1"; $rst = "CLIENT_ERROR bad data chunk";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# too many values
+$cmd = "sop mexist skey1 10000 1001"; $rst = "CLIENT_ERROR bad command line format";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
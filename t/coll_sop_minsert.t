@@ -0,0 +1,52 @@
+#!/usr/bin/perl
+# Test the sop minsert command inserting many elements into a set at once.
+
+use strict;
+use Test::More tests => 8;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# key miss without create
+$val = "5\r\ndatum";
+$cmd = "sop minsert skey1 " . (length($val)+2) . " 1"; $rst = "NOT_FOUND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# create the set and insert the elements
+$val = "6\r\ndatum1\r\n6\r\ndatum2\r\n6\r\ndatum1";
+$cmd = "sop minsert skey1 " . (length($val)+2) . " 3 create 11 0 0";
+$rst = "RESPONSE 3\nCREATED_STORED\nSTORED\nELEMENT_EXISTS\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "getattr skey1 count"; $rst = "ATTR count=2\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# overflow with the maxcount
+$cmd = "sop create skey2 0 0 2"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+$val = "1\r\na\r\n1\r\nb\r\n1\r\nc";
+$cmd = "sop minsert skey2 " . (length($val)+2) . " 3";
+$rst = "RESPONSE 3\nSTORED\nSTORED\nOVERFLOWED\nEND";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# bad data chunk and bad command line
+$val = "1\r\na\r\n2\r\nb";
+$cmd = "sop minsert skey1 " . (length($val)+2) . " 2"; $rst = "CLIENT_ERROR bad data chunk";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "sop minsert skey1 10 0"; $rst = "CLIENT_ERROR bad command line format";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# noreply
+$val = "1\r\nx\r\n1\r\ny";
+$cmd = "sop minsert skey1 " . (length($val)+2) . " 2 noreply"; $rst = "";
+mem_cmd_is($sock, $cmd, $val, $rst);
+
+# after test
+release_memcached($engine, $server);
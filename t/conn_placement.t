@@ -0,0 +1,122 @@
+#!/usr/bin/perl
+# Test the connection placement and the idle connection migration of -W option.
+
+use strict;
+use Test::More tests => 55;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-t 4 -W roundrobin,migrate");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+my $settings = mem_stats($sock, "settings");
+is($settings->{"conn_placement"}, "roundrobin", "conn_placement is roundrobin");
+is($settings->{"conn_migrate"}, "yes", "conn_migrate is yes");
+
+# the connections are placed on 4 threads in turn.
+# leave only the connections placed on the thread of $sock.
+my @socks;
+for (my $i = 0; $i < 40; $i++) {
+    push(@socks, $server->new_sock);
+}
+my @kept;
+for (my $i = 0; $i < 40; $i++) {
+    if ($i % 4 == 3) {
+        push(@kept, $socks[$i]);
+    } else {
+        close($socks[$i]);
+    }
+}
+@socks = ();
+
+# the imbalance of 11 connections on a thread and none on the others
+# persists for 3 seconds, and then the idle connections are migrated.
+sleep(4.5);
+my $stats = mem_stats($sock);
+is($stats->{"curr_connections"}, 11, "curr_connections is 11");
+ok($stats->{"migrated_connections"} >= 5, "idle connections are migrated");
+
+# the migrated connections keep working.
+for (my $i = 0; $i < 10; $i++) {
+    $cmd = "set key$i 0 0 6"; $val = sprintf("val%03d", $i); $rst = "STORED";
+    mem_cmd_is($kept[$i], $cmd, $val, $rst);
+}
+for (my $i = 0; $i < 10; $i++) {
+    my $j = 9 - $i;
+    $cmd = "get key$j"; $rst = "VALUE key$j 0 6\n" . sprintf("val%03d", $j) . "\nEND";
+    mem_cmd_is($kept[$i], $cmd, "", $rst);
+}
+
+release_memcached($engine, $server);
+
+# the least connection placement
+$server = get_memcached($engine, "-t 4 -W leastconn,migrate");
+$sock = $server->sock;
+$settings = mem_stats($sock, "settings");
+is($settings->{"conn_placement"}, "leastconn", "conn_placement is leastconn");
+is($settings->{"conn_migrate"}, "yes", "conn_migrate is yes");
+
+# leave 10 of 40 connections in the same pattern as above.
+for (my $i = 0; $i < 40; $i++) {
+    push(@socks, $server->new_sock);
+}
+@kept = ();
+for (my $i = 0; $i < 40; $i++) {
+    if ($i % 4 == 3) {
+        push(@kept, $socks[$i]);
+    } else {
+        close($socks[$i]);
+    }
+}
+@socks = ();
+sleep(0.5);
+
+# whichever threads the kept connections are on, the new connections
+# fill the other threads first, so no imbalance is left to migrate.
+my @added;
+for (my $i = 0; $i < 30; $i++) {
+    push(@added, $server->new_sock);
+}
+sleep(4.5);
+$stats = mem_stats($sock);
+is($stats->{"curr_connections"}, 41, "curr_connections is 41");
+is($stats->{"migrated_connections"}, 0, "no connections are migrated");
+
+for (my $i = 0; $i < 10; $i++) {
+    $cmd = "set ckey$i 0 0 6"; $val = sprintf("val%03d", $i); $rst = "STORED";
+    mem_cmd_is($kept[$i], $cmd, $val, $rst);
+}
+for (my $i = 0; $i < 10; $i++) {
+    my $j = 9 - $i;
+    $cmd = "get ckey$j"; $rst = "VALUE ckey$j 0 6\n" . sprintf("val%03d", $j) . "\nEND";
+    mem_cmd_is($added[$i], $cmd, "", $rst);
+}
+release_memcached($engine, $server);
+
+# the least cpu placement
+# the load is the cpu time, so the idle connections are not migrated
+# however they are placed.
+$server = get_memcached($engine, "-t 4 -W leastcpu,migrate");
+$sock = $server->sock;
+$settings = mem_stats($sock, "settings");
+is($settings->{"conn_placement"}, "leastcpu", "conn_placement is leastcpu");
+is($settings->{"conn_migrate"}, "yes", "conn_migrate is yes");
+for (my $i = 0; $i < 20; $i++) {
+    push(@socks, $server->new_sock);
+}
+sleep(4.5);
+$stats = mem_stats($sock);
+is($stats->{"migrated_connections"}, 0, "idle connections are not migrated");
+for (my $i = 0; $i < 4; $i++) {
+    $cmd = "set lkey$i 0 0 1"; $val = "$i"; $rst = "STORED";
+    mem_cmd_is($socks[$i], $cmd, $val, $rst);
+}
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,75 @@
+#!/usr/bin/perl
+# Test the item lookups through the hash tags.
+
+use strict;
+use Test::More tests => 9;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 256 -e hash_tags=true");
+my $sock = $server->sock;
+my $stats;
+
+sub send_cmds {
+    my ($cmd, $from, $to, $val) = @_;
+    my $buf = "";
+    for (my $key = $from; $key < $to; $key++) {
+        if ($cmd eq "delete") {
+            $buf .= "delete key$key noreply\r\n";
+        } else {
+            $buf .= "$cmd key$key 0 0 " . length("$val$key") . " noreply\r\n$val$key\r\n";
+        }
+        if (length($buf) > 65536) {
+            print $sock $buf; $buf = "";
+        }
+    }
+    print $sock $buf;
+    # wait until all the commands are processed.
+    mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+}
+
+sub count_keys {
+    my ($from, $to, $val) = @_;
+    my $found = 0;
+    for (my $k = $from; $k < $to; $k += 100) {
+        my $cmd = "get";
+        for (my $i = $k; $i < $k + 100 && $i < $to; $i++) {
+            $cmd .= " key$i";
+        }
+        print $sock "$cmd\r\n";
+        while (<$sock>) {
+            last if /^END/;
+            if (/^VALUE key(\d+) 0 \d+/) {
+                my $id = $1;
+                my $data = <$sock>;
+                $data =~ s/\r\n$//;
+                $found++ if $data eq "$val$id";
+            }
+        }
+    }
+    return $found;
+}
+
+$stats = mem_stats($sock);
+my $nkeys = int($stats->{"hash_buckets"} * 3 / 2) + 1000;
+my $half = int($nkeys / 2);
+
+# the insertions expand the hash table.
+send_cmds("set", 0, $nkeys, "v");
+is(count_keys(0, $nkeys, "v"), $nkeys, "items found");
+
+# deletions and replacements
+send_cmds("delete", 0, $half, "");
+send_cmds("set", $half, $nkeys, "w");
+is(count_keys(0, $half, "v"), 0, "deleted items not found");
+is(count_keys($half, $nkeys, "w"), $half, "replaced items found");
+
+# reinsertions
+send_cmds("add", 0, $half, "x");
+is(count_keys(0, $nkeys, "x") + count_keys(0, $nkeys, "w"), $nkeys, "all items found");
+is(count_keys($nkeys, $nkeys * 2, "v"), 0, "missing items not found");
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,112 @@
+#!/usr/bin/perl
+# Test the io_uring network backend of -O option.
+
+use strict;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+if (MemcachedTest::supports_io_uring()) {
+    plan tests => 39;
+} else {
+    plan skip_all => 'io_uring backend is not enabled';
+}
+
+my $engine = shift;
+my $server = get_memcached($engine, "-t 4 -R 2 -O io_uring");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+my $settings = mem_stats($sock, "settings");
+is($settings->{"io_backend"}, "io_uring", "io_backend is io_uring");
+
+# the connections are served by the completions of all worker threads.
+my @socks;
+for (my $i = 0; $i < 8; $i++) {
+    my $conn = $server->new_sock;
+    ok($conn, "connection $i");
+    push(@socks, $conn);
+}
+for (my $i = 0; $i < 8; $i++) {
+    $cmd = "set key$i 0 0 6"; $val = sprintf("val%03d", $i); $rst = "STORED";
+    mem_cmd_is($socks[$i], $cmd, $val, $rst);
+}
+for (my $i = 0; $i < 8; $i++) {
+    my $j = 7 - $i;
+    $cmd = "get key$j"; $rst = "VALUE key$j 0 6\n" . sprintf("val%03d", $j) . "\nEND";
+    mem_cmd_is($socks[$i], $cmd, "", $rst);
+}
+
+# a large value is received in many buffers and sent in many iovecs.
+my $big = "a" x 300000;
+$cmd = "set bigkey 0 0 300000"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $big, $rst);
+$cmd = "get bigkey"; $rst = "VALUE bigkey 0 300000\n$big\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "get bigkey key0 bigkey";
+$rst = "VALUE bigkey 0 300000\n$big\nVALUE key0 0 6\nval000\nVALUE bigkey 0 300000\n$big\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# pipelined commands in a single write yield every 2 requests (-R 2).
+my $stats = mem_stats($sock);
+my $yields = $stats->{"conn_yields"};
+my $pipe = "";
+for (my $i = 0; $i < 20; $i++) {
+    $pipe .= "set pipe$i 0 0 1\r\n" . ($i % 10) . "\r\n";
+}
+print $sock $pipe;
+my $stored = 0;
+for (my $i = 0; $i < 20; $i++) {
+    my $line = scalar <$sock>;
+    $stored++ if ($line eq "STORED\r\n");
+}
+is($stored, 20, "pipelined sets are stored");
+$stats = mem_stats($sock);
+cmp_ok($stats->{"conn_yields"}, ">", $yields, "pipelined sets yield");
+$cmd = "get pipe3 pipe17"; $rst = "VALUE pipe3 0 1\n3\nVALUE pipe17 0 1\n7\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# the connections closed with a response in flight are released.
+for (my $i = 0; $i < 4; $i++) {
+    my $conn = $socks[$i];
+    print $conn "get bigkey\r\n";
+    close($conn);
+}
+sleep(1);
+$stats = mem_stats($sock);
+is($stats->{"curr_connections"}, 5, "curr_connections is 5");
+for (my $i = 4; $i < 8; $i++) {
+    $cmd = "delete key$i"; $rst = "DELETED";
+    mem_cmd_is($socks[$i], $cmd, "", $rst);
+}
+$cmd = "get key4"; $rst = "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# a client not reading its responses cannot make the server buffer
+# its requests without bound: the recv stops while the stash is full.
+my $conn = $server->new_sock;
+$conn->blocking(0);
+my $chunk = "get bigkey\r\n" x 6000;
+my $sent = 0;
+my $limit = 64 * 1024 * 1024;
+while ($sent < $limit) {
+    my $n = syswrite($conn, $chunk);
+    if (defined $n) {
+        $sent += $n;
+        next;
+    }
+    my $wout = "";
+    vec($wout, fileno($conn), 1) = 1;
+    last if (select(undef, $wout, undef, 2) == 0);
+}
+cmp_ok($sent, "<", $limit / 2, "requests of a client not reading are not buffered");
+close($conn);
+$cmd = "get key0"; $rst = "VALUE key0 0 6\nval000\nEND";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
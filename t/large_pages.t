@@ -0,0 +1,40 @@
+#!/usr/bin/perl
+# Test the slab memory preallocated with large pages.
+
+use strict;
+use Test::More tests => 203;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 64 -L");
+my $sock = $server->sock;
+my $cmd;
+my $rst;
+my $val;
+my $stats;
+my $key;
+
+$stats = mem_stats($sock, "slabs");
+like($stats->{"memory_pages"}, qr/^(hugetlb|thp|default)$/, "memory pages");
+is($stats->{"memory_limit"}, 64*1024*1024, "memory limit");
+
+for ($key = 0; $key < 100; $key++) {
+    $val = "value$key" x ($key + 1);
+    $cmd = "set key$key 0 0 " . length($val); $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val, $rst);
+}
+for ($key = 0; $key < 100; $key++) {
+    $val = "value$key" x ($key + 1);
+    $cmd = "get key$key";
+    $rst = "VALUE key$key 0 " . length($val) . "\n$val\nEND";
+    mem_cmd_is($sock, $cmd, "", $rst);
+}
+
+# the memory limit of the preallocated memory cannot be changed.
+$cmd = "config memlimit 128"; $rst = "CLIENT_ERROR bad value";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
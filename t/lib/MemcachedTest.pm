@@ -17,6 +17,7 @@ my $builddir = getcwd;
              getattr_is lop_get_is sop_get_is mop_get_is bop_get_is bop_gbp_is bop_pwg_is bop_smget_is
              bop_ext_get_is bop_ext_smget_is bop_new_smget_is bop_old_smget_is
              stats_prefixes_is stats_noprefix_is stats_prefix_is
+             slabs_clsid slabs_large_used_chunks bin_cmd bop_insert_all
              supports_sasl free_port);
 
 sub sleep {
@@ -1015,6 +1016,70 @@ sub stats_prefix_is {
     Test::More::is($response, $expected, $msg);
 }
 
+# insert the elements of the given bkeys with noreply,
+# and return the total length of the values.
+sub bop_insert_all {
+    my ($sock, $key, $bkeys, $value_of) = @_;
+    my $buf = "";
+    my $vals = 0;
+    foreach my $bkey (@$bkeys) {
+        my $value = $value_of->($bkey);
+        $buf .= "bop insert $key $bkey " . length($value) . " noreply\r\n$value\r\n";
+        $vals += length($value);
+        if (length($buf) > 65536) {
+            print $sock $buf; $buf = "";
+        }
+    }
+    print $sock $buf;
+    # wait until all the commands are processed.
+    mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+    return $vals;
+}
+
+# send a binary request and return the status, the extras and the value.
+sub bin_cmd {
+    my ($sock, $opcode, $key, $extras, $value) = @_;
+    my $msg = pack("CCnCCnNNNN", 0x80, $opcode, length($key), length($extras),
+                   0, 0, length($extras) + length($key) + length($value), 0, 0, 0);
+    print $sock $msg . $extras . $key . $value;
+
+    my $header = "";
+    while (length($header) < 24) {
+        read($sock, my $buf, 24 - length($header)) or croak("read failed");
+        $header .= $buf;
+    }
+    my ($magic, $cmd, $keylen, $extlen, $datatype, $status, $bodylen) = unpack("CCnCCnNNNN", $header);
+    my $body = "";
+    while (length($body) < $bodylen) {
+        read($sock, my $buf, $bodylen - length($body)) or croak("read failed");
+        $body .= $buf;
+    }
+    return ($status, substr($body, 0, $extlen), substr($body, $extlen + $keylen));
+}
+
+# the smallest slab class whose chunks can hold the given size.
+sub slabs_clsid {
+    my ($sock, $chunk_size) = @_;
+    my $stats = mem_stats($sock, "slabs");
+    my ($cls) = sort { $stats->{"$a:chunk_size"} <=> $stats->{"$b:chunk_size"} }
+                grep { $_ > 0 && $stats->{"$_:chunk_size"} >= $chunk_size }
+                map { /^(\d+):chunk_size$/ ? $1 : () } keys %$stats;
+    return $cls;
+}
+
+# the used chunks of the slab classes larger than the small memory blocks.
+sub slabs_large_used_chunks {
+    my ($sock) = @_;
+    my $stats = mem_stats($sock, "slabs");
+    my $used = 0;
+    foreach my $cls (map { /^(\d+):chunk_size$/ ? $1 : () } keys %$stats) {
+        if ($cls > 0 && $stats->{"$cls:chunk_size"} > 49152) {
+            $used += $stats->{"$cls:used_chunks"};
+        }
+    }
+    return $used;
+}
+
 sub free_port {
     my $type = shift || "tcp";
     my $sock;
@@ -1041,6 +1106,20 @@ sub supports_sasl {
     return 0;
 }
 
+sub supports_btree_compress {
+    open(my $fh, "<", "$builddir/config.h") or return 0;
+    my $found = grep { /^#define ENABLE_BTREE_COMPRESS 1/ } <$fh>;
+    close($fh);
+    return $found ? 1 : 0;
+}
+
+sub supports_io_uring {
+    open(my $fh, "<", "$builddir/config.h") or return 0;
+    my $found = grep { /^#define ENABLE_IO_URING 1/ } <$fh>;
+    close($fh);
+    return $found ? 1 : 0;
+}
+
 sub get_memcached {
     my ($engine, $args, $port) = @_;
     if ("$engine" eq "default" || "$engine" eq "") {
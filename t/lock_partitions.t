@@ -0,0 +1,69 @@
+#!/usr/bin/perl
+# Test the concurrent replace and get of the same keys with lock_partitions.
+
+use strict;
+use Test::More tests => 5;
+use POSIX;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-t 4 -e lock_partitions=1024");
+my $sock = $server->sock;
+
+my $settings = mem_stats($sock, "settings");
+ok(defined $settings, "server is up");
+
+my @keys = ("hot", "pfx:hot");
+foreach my $key (@keys) {
+    mem_cmd_is($sock, "set $key 0 0 6", "value0", "STORED");
+}
+
+# the setters replace the keys while the getters read them.
+my $rounds = 5000;
+my @pids;
+for (my $i = 0; $i < 6; $i++) {
+    my $pid = fork();
+    die "fork failed: $!" unless defined $pid;
+    if ($pid == 0) {
+        my $conn = $server->new_sock;
+        my $bad = 0;
+        for (my $r = 0; $r < $rounds; $r++) {
+            my $key = $keys[$r % 2];
+            if ($i % 2 == 0) {
+                my $val = sprintf("value%d", $r % 10);
+                print $conn "set $key 0 0 6\r\n$val\r\n";
+                my $line = <$conn>;
+                $bad++ unless (defined $line && $line eq "STORED\r\n");
+            } else {
+                print $conn "get $key\r\n";
+                my $line = <$conn>;
+                if (!defined $line || $line ne "VALUE $key 0 6\r\n") {
+                    $bad++;
+                    last unless defined $line;
+                    next;
+                }
+                $line = <$conn>;
+                $bad++ unless (defined $line && $line =~ /^value\d\r\n$/);
+                $line = <$conn>;
+                $bad++ unless (defined $line && $line eq "END\r\n");
+            }
+        }
+        # _exit() not to stop the server in the destructors of the child.
+        POSIX::_exit($bad == 0 ? 0 : 1);
+    }
+    push(@pids, $pid);
+}
+my $failed = 0;
+foreach my $pid (@pids) {
+    waitpid($pid, 0);
+    $failed++ if $? != 0;
+}
+is($failed, 0, "concurrent replaces and gets are consistent");
+
+my $stats = mem_stats($sock);
+cmp_ok($stats->{"cmd_get"}, ">=", $rounds, "the gets are served");
+
+# after test
+release_memcached($engine, $server);
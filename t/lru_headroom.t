@@ -0,0 +1,39 @@
+#!/usr/bin/perl
+# Test the LRU maintainer keeping the free chunk headroom of slab classes.
+
+use strict;
+use Test::More tests => 83;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 3 -e lru_headroom_percent=20");
+my $sock = $server->sock;
+my $cmd;
+my $val = "B"x66560;
+my $rst;
+my $key = 0;
+
+for ($key = 0; $key < 80; $key++) {
+    $cmd = "set key$key 0 0 66560"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val, $rst);
+}
+
+# wait for the LRU maintainer to evict items in background.
+sleep(1);
+
+my $stats = mem_stats($sock, "items");
+my ($cls) = map { /^items:(\d+):number$/ ? $1 : () } keys %$stats;
+cmp_ok($stats->{"items:$cls:evicted"}, '>', 0, "check evicted");
+
+$stats = mem_stats($sock, "slabs");
+my $free = $stats->{"$cls:free_chunks"} + $stats->{"$cls:free_chunks_end"};
+my $total = $stats->{"$cls:total_chunks"};
+ok($free * 100 >= $total * 20, "check free chunk headroom");
+
+# the last item is still there.
+mem_get_is($sock, "key79", $val);
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,86 @@
+#!/usr/bin/perl
+# Test the segmented LRU: the items read are moved to the warm segment
+# instead of being evicted when they reach the LRU tail.
+
+use strict;
+use Test::More tests => 155;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 3");
+my $sock = $server->sock;
+my $cmd;
+my $val = "B"x66560;
+my $rst;
+my $key = 0;
+
+for ($key = 0; $key < 20; $key++) {
+    $cmd = "set key$key 0 0 66560"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val, $rst);
+}
+
+# Read the oldest items twice to make them active.
+for ($key = 0; $key < 5; $key++) {
+    mem_get_is($sock, "key$key", $val);
+    mem_get_is($sock, "key$key", $val);
+}
+# The items read only once are not active.
+for ($key = 5; $key < 10; $key++) {
+    mem_get_is($sock, "key$key", $val);
+}
+
+# These make the oldest items reach the LRU tail.
+for ($key = 20; $key < 100; $key++) {
+    $cmd = "set key$key 0 0 66560"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val, $rst);
+}
+
+my $stats  = mem_stats($sock, "items");
+my ($cls) = map { /^items:(\d+):number$/ ? $1 : () } keys %$stats;
+cmp_ok($stats->{"items:$cls:evicted"}, '>', 0, "check evicted");
+cmp_ok($stats->{"items:$cls:promoted"}, '>', 0, "check promoted");
+
+# The active items have survived the eviction.
+for ($key = 0; $key < 5; $key++) {
+    mem_get_is($sock, "key$key", $val);
+}
+# The inactive ones have been evicted.
+for ($key = 5; $key < 20; $key++) {
+    mem_get_is($sock, "key$key", undef);
+}
+
+# The warm items are shown in cachedump.
+print $sock "stats cachedump $cls 0 forward\r\n";
+my %dumped;
+while (my $line = <$sock>) {
+    last if $line =~ /^END/;
+    $dumped{$1} = 1 if $line =~ /^ITEM (\S+) /;
+}
+is(scalar(grep { $dumped{"key$_"} } (0..4)), 5, "cachedump shows the warm items");
+
+# The expired warm items are reclaimed without being demoted.
+for ($key = 0; $key < 5; $key++) {
+    $cmd = "set exp$key 0 3 66560"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val, $rst);
+    mem_get_is($sock, "exp$key", $val);
+    mem_get_is($sock, "exp$key", $val);
+}
+for ($key = 100; $key < 150; $key++) {
+    print $sock "set key$key 0 0 66560\r\n$val\r\n";
+    my $line = <$sock>;
+}
+$stats = mem_stats($sock, "items");
+my $reclaimed = $stats->{"items:$cls:reclaimed"};
+cmp_ok($stats->{"items:$cls:warm"}, '>=', 5, "check warm");
+sleep(4);
+for ($key = 150; $key < 155; $key++) {
+    print $sock "set key$key 0 0 66560\r\n$val\r\n";
+    my $line = <$sock>;
+}
+$stats = mem_stats($sock, "items");
+cmp_ok($stats->{"items:$cls:reclaimed"}, '>', $reclaimed, "expired warm items are reclaimed");
+
+# after test
+release_memcached($engine, $server);
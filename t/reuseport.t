@@ -0,0 +1,42 @@
+#!/usr/bin/perl
+# Test the per-worker SO_REUSEPORT listen sockets of -T option.
+
+use strict;
+use Test::More tests => 46;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-t 4 -T reuseport");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+my $settings = mem_stats($sock, "settings");
+is($settings->{"tcp_listen_mode"}, "reuseport", "tcp_listen_mode is reuseport");
+
+# the connections are accepted by all the worker threads.
+my @socks;
+for (my $i = 0; $i < 20; $i++) {
+    my $conn = $server->new_sock;
+    ok($conn, "connection $i");
+    push(@socks, $conn);
+}
+for (my $i = 0; $i < 20; $i++) {
+    $cmd = "set key$i 0 0 6"; $val = sprintf("val%03d", $i); $rst = "STORED";
+    mem_cmd_is($socks[$i], $cmd, $val, $rst);
+}
+for (my $i = 0; $i < 4; $i++) {
+    my $j = 19 - $i;
+    $cmd = "get key$j"; $rst = "VALUE key$j 0 6\n" . sprintf("val%03d", $j) . "\nEND";
+    mem_cmd_is($socks[$i], $cmd, "", $rst);
+}
+
+my $stats = mem_stats($sock);
+is($stats->{"curr_connections"}, 21, "curr_connections is 21");
+
+# after test
+release_memcached($engine, $server);
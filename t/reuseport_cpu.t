@@ -0,0 +1,115 @@
+#!/usr/bin/perl
+# Test the cpu steering of -T cpu option.
+
+use strict;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+if ($^O eq 'linux') {
+    plan tests => 31;
+} else {
+    plan skip_all => 'cpu steering is supported only on Linux';
+}
+
+my $engine = shift;
+my $server;
+my $sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+# the cpus allowed for the given task.
+sub cpus_allowed {
+    my ($path) = @_;
+    my @cpus;
+    open(my $fh, "<", "$path/status") or return ();
+    while (<$fh>) {
+        if (/^Cpus_allowed_list:\s*(\S+)/) {
+            foreach my $range (split(/,/, $1)) {
+                my ($from, $to) = split(/-/, $range);
+                $to = $from unless defined $to;
+                push(@cpus, $from..$to);
+            }
+        }
+    }
+    close($fh);
+    return @cpus;
+}
+
+# the cpus of the threads bound to other cpus than the process.
+sub bound_threads {
+    my ($pid) = @_;
+    my $all = join(",", cpus_allowed("/proc/$pid"));
+    my @bound;
+    opendir(my $dh, "/proc/$pid/task") or return ();
+    foreach my $tid (sort grep { /^\d+$/ } readdir($dh)) {
+        my $cpus = join(",", cpus_allowed("/proc/$pid/task/$tid"));
+        push(@bound, $cpus) if $cpus ne $all;
+    }
+    closedir($dh);
+    return sort @bound;
+}
+
+sub check_conns {
+    my ($name) = @_;
+    my @socks;
+    for (my $i = 0; $i < 4; $i++) {
+        my $conn = $server->new_sock;
+        ok($conn, "$name: connection $i");
+        push(@socks, $conn);
+    }
+    for (my $i = 0; $i < 4; $i++) {
+        $cmd = "set key$i 0 0 6"; $val = sprintf("val%03d", $i); $rst = "STORED";
+        mem_cmd_is($socks[$i], $cmd, $val, $rst);
+    }
+    for (my $i = 0; $i < 4; $i++) {
+        my $j = 3 - $i;
+        $cmd = "get key$j"; $rst = "VALUE key$j 0 6\n" . sprintf("val%03d", $j) . "\nEND";
+        mem_cmd_is($socks[$i], $cmd, "", $rst);
+    }
+}
+
+my @cpus = cpus_allowed("/proc/self");
+my $ncpus = scalar(@cpus);
+my $settings;
+my $stats;
+
+# one worker thread is always steered.
+$server = get_memcached($engine, "-t 1 -T cpu");
+$sock = $server->sock;
+$settings = mem_stats($sock, "settings");
+is($settings->{"tcp_listen_mode"}, "cpu", "tcp_listen_mode is cpu");
+is($settings->{"tcp_cpu_steering"}, "yes", "steered with 1 worker thread");
+check_conns("1 worker");
+release_memcached($engine, $server);
+
+# more worker threads than cpus are neither steered nor bound.
+my $nthreads = $ncpus + 1;
+$server = get_memcached($engine, "-t $nthreads -T cpu");
+$sock = $server->sock;
+$settings = mem_stats($sock, "settings");
+is($settings->{"tcp_cpu_steering"}, "no", "not steered with $nthreads worker threads");
+$stats = mem_stats($sock);
+my @bound = bound_threads($stats->{"pid"});
+is(scalar(@bound), 0, "no threads bound");
+check_conns("$nthreads workers");
+release_memcached($engine, $server);
+
+# the worker i is bound to the cpus of the even or odd order in the affinity.
+SKIP: {
+    skip "needs 2 cpus or more", 3 if $ncpus < 2;
+    $server = get_memcached($engine, "-t 2 -T cpu");
+    $sock = $server->sock;
+    $settings = mem_stats($sock, "settings");
+    is($settings->{"tcp_cpu_steering"}, "yes", "steered with 2 worker threads");
+    $stats = mem_stats($sock);
+    my @even = map { $cpus[$_] } grep { $_ % 2 == 0 } (0..$ncpus-1);
+    my @odd  = map { $cpus[$_] } grep { $_ % 2 == 1 } (0..$ncpus-1);
+    @bound = bound_threads($stats->{"pid"});
+    is(scalar(@bound), 2, "2 worker threads bound");
+    is_deeply(\@bound, [sort(join(",", @even), join(",", @odd))], "bound to the steered cpus");
+    release_memcached($engine, $server);
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/perl
+# Test the slab page reassignment between slab classes.
+
+use strict;
+use Test::More tests => 392;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-m 16");
+my $sock = $server->sock;
+my $cmd;
+my $rst;
+my $stats;
+my $key;
+my $val_a = "A"x66560;
+my $val_b = "B"x200000;
+
+# the class B takes its pages before the memory is full.
+# The pages can't go over the memory limit when the memory is
+# preallocated (e.g. compact item build), so they are taken first.
+for ($key = 0; $key < 8; $key++) {
+    $cmd = "set b$key 0 0 200000"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val_b, $rst);
+}
+# fill the memory with the items of class A.
+for ($key = 0; $key < 250; $key++) {
+    $cmd = "set a$key 0 0 66560"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val_a, $rst);
+}
+# the items of class B are evicted in its own pages.
+for ($key = 8; $key < 40; $key++) {
+    $cmd = "set b$key 0 0 200000"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val_b, $rst);
+}
+my $cls_a = slabs_clsid($sock, 66560);
+my $cls_b = slabs_clsid($sock, 200000);
+$stats = mem_stats($sock, "slabs");
+my $pages_a = $stats->{"$cls_a:total_pages"};
+my $pages_b = $stats->{"$cls_b:total_pages"};
+my $chunks_b = $stats->{"$cls_b:total_chunks"};
+
+# bad arguments
+$cmd = "config slabs_reassign $cls_a"; $rst = "CLIENT_ERROR bad command line format";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "config slabs_reassign $cls_a $cls_a"; $rst = "CLIENT_ERROR bad value";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "config slabs_reassign $cls_a 250"; $rst = "CLIENT_ERROR bad value";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "config slabs_reassign $cls_b $cls_a"; $rst = "SERVER_ERROR no spare page";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "config memlimit 100 200"; $rst = "CLIENT_ERROR bad command line format";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# move a page from class A to class B.
+$cmd = "config slabs_reassign $cls_a $cls_b"; $rst = "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+$stats = mem_stats($sock, "slabs");
+is($stats->{"$cls_a:total_pages"}, $pages_a - 1, "check pages of the source class");
+is($stats->{"$cls_b:total_pages"}, $pages_b + 1, "check pages of the destination class");
+cmp_ok($stats->{"$cls_b:total_chunks"}, '>', $chunks_b, "check chunks of the destination class");
+is($stats->{"slab_reassign_moves"}, 1, "check slab_reassign_moves");
+cmp_ok($stats->{"slab_reassign_evicted"}, '>', 0, "check slab_reassign_evicted");
+
+# the class B uses the new page without eviction.
+my $evicted_b = mem_stats($sock, "items")->{"items:$cls_b:evicted"};
+for ($key = 40; $key < 44; $key++) {
+    $cmd = "set b$key 0 0 200000"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val_b, $rst);
+}
+$stats = mem_stats($sock, "items");
+is($stats->{"items:$cls_b:evicted"}, $evicted_b, "check no evictions in the new page");
+for ($key = 40; $key < 44; $key++) {
+    mem_get_is($sock, "b$key", $val_b);
+}
+
+# slab automove
+print $sock "config slab_automove\r\n";
+is(scalar <$sock>, "slab_automove 0\r\n", "config slab_automove");
+is(scalar <$sock>, "END\r\n", "config slab_automove END");
+$cmd = "config slab_automove 3"; $rst = "CLIENT_ERROR bad value";
+mem_cmd_is($sock, $cmd, "", $rst);
+$cmd = "config slab_automove 2"; $rst = "END";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# the class B keeps evicting items, and the class A has no evictions.
+for ($key = 44; $key < 120; $key++) {
+    $cmd = "set b$key 0 0 200000"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val_b, $rst);
+    select(undef, undef, undef, 0.05);
+}
+$stats = mem_stats($sock, "slabs");
+cmp_ok($stats->{"slab_reassign_moves"}, '>', 1, "check slab automove");
+cmp_ok($stats->{"$cls_b:total_pages"}, '>', $pages_b + 1, "check pages moved by slab automove");
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,54 @@
+#!/usr/bin/perl
+# Test the per-thread magazines of the small memory manager.
+
+use strict;
+use Test::More tests => 613;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine);
+my $sock = $server->sock;
+my $cmd;
+my $rst;
+my $val;
+my $stats;
+my $bkey;
+
+$cmd = "bop create bkey1 0 0 1000"; $rst = "CREATED";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# insert and delete the elements repeatedly so that the freed slots
+# are cached in magazines and reused by the next insertions.
+for (my $round = 0; $round < 5; $round++) {
+    for ($bkey = 0; $bkey < 100; $bkey++) {
+        $val = "datum$round$bkey";
+        $cmd = "bop insert bkey1 $bkey " . length($val); $rst = "STORED";
+        mem_cmd_is($sock, $cmd, $val, $rst);
+    }
+    $cmd = "bop count bkey1 0..99"; $rst = "COUNT=100";
+    mem_cmd_is($sock, $cmd, "", $rst);
+    if ($round < 4) {
+        $cmd = "bop delete bkey1 0..99"; $rst = "DELETED";
+        mem_cmd_is($sock, $cmd, "", $rst);
+    }
+}
+
+# the last inserted elements are kept intact.
+for ($bkey = 0; $bkey < 100; $bkey++) {
+    $val = "datum4$bkey";
+    $cmd = "bop get bkey1 $bkey";
+    $rst = "VALUE 0 1\n$bkey " . length($val) . " $val\nEND";
+    mem_cmd_is($sock, $cmd, "", $rst);
+}
+
+$stats = mem_stats($sock, "slabs");
+cmp_ok($stats->{"SM:magazine_refills"}, '>', 0, "magazine refills");
+cmp_ok($stats->{"SM:magazine_flushes"}, '>', 0, "magazine flushes");
+
+$cmd = "delete bkey1"; $rst = "DELETED";
+mem_cmd_is($sock, $cmd, "", $rst);
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,90 @@
+#!/usr/bin/perl
+# Test a burst of UDP requests received and answered in batches.
+
+use strict;
+use Test::More tests => 8;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+my $engine = shift;
+my $server = get_memcached($engine, "-t 1");
+my $sock = $server->sock;
+
+my $cmd;
+my $val;
+my $rst;
+
+my $big = "b" x 5000;
+$cmd = "set small 0 0 5"; $val = "hello"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $val, $rst);
+$cmd = "set big 0 0 5000"; $rst = "STORED";
+mem_cmd_is($sock, $cmd, $big, $rst);
+
+my $usock = $server->new_udp_sock
+    or die "Can't bind : $@\n";
+
+# more requests than a batch, sent before reading any response.
+my $count = 48;
+my %expected;
+for (my $id = 1; $id <= $count; $id++) {
+    my $key = ($id % 8 == 0) ? "big" : (($id % 8 == 1) ? "none" : "small");
+    my $pkt = pack("nnnn", $id, 0, 1, 0) . "get $key\r\n";
+    send($usock, $pkt, 0);
+    if ($key eq "big") {
+        $expected{$id} = "VALUE big 0 5000\r\n$big\r\nEND\r\n";
+    } elsif ($key eq "small") {
+        $expected{$id} = "VALUE small 0 5\r\nhello\r\nEND\r\n";
+    } else {
+        $expected{$id} = "END\r\n";
+    }
+}
+
+my %datagrams;
+my %numpkts;
+my $badhdr = 0;
+while (1) {
+    my $rin = '';
+    vec($rin, fileno($usock), 1) = 1;
+    last unless select(my $rout = $rin, undef, undef, 1.5);
+    my $res;
+    $usock->recv($res, 1500, 0);
+    my ($id, $seq, $num, $resv) = unpack("nnnn", substr($res, 0, 8));
+    $badhdr++ if ($resv != 0 || !exists $expected{$id} ||
+                  (defined $numpkts{$id} && $numpkts{$id} != $num));
+    $numpkts{$id} = $num;
+    $datagrams{$id}{$seq} = substr($res, 8);
+}
+is($badhdr, 0, "all the response headers are valid");
+
+my $complete = 0;
+my $multi = 0;
+my $matched = 0;
+foreach my $id (keys %expected) {
+    next unless defined $numpkts{$id};
+    next unless keys %{$datagrams{$id}} == $numpkts{$id};
+    $complete++;
+    $multi++ if $numpkts{$id} > 1;
+    my $msg = join("", map { $datagrams{$id}{$_} } (0 .. $numpkts{$id} - 1));
+    $matched++ if $msg eq $expected{$id};
+}
+is($complete, $count, "all the responses are complete");
+is($matched, $count, "all the responses match their requests");
+is($multi, $count / 8, "multi-datagram responses are complete");
+
+my $stats = mem_stats($sock);
+is($stats->{"cmd_get"}, $count, "cmd_get is $count");
+
+# a single request is still answered right away.
+my $pkt = pack("nnnn", 999, 0, 1, 0) . "get small\r\n";
+send($usock, $pkt, 0);
+my $rin = '';
+vec($rin, fileno($usock), 1) = 1;
+my $res = "";
+if (select(my $rout = $rin, undef, undef, 1.5)) {
+    $usock->recv($res, 1500, 0);
+}
+is(substr($res, 8), "VALUE small 0 5\r\nhello\r\nEND\r\n", "single request is answered");
+
+# after test
+release_memcached($engine, $server);
@@ -0,0 +1,104 @@
+#!/usr/bin/perl
+# Test the zero-copy sends of the large responses of -Z option.
+
+use strict;
+use Test::More;
+use FindBin qw($Bin);
+use lib "$Bin/lib";
+use MemcachedTest;
+
+if (MemcachedTest::supports_io_uring()) {
+    plan tests => 28;
+} else {
+    plan tests => 14;
+}
+
+my $engine = shift;
+
+sub elem_value {
+    my ($bkey) = @_;
+    return sprintf("%04d", $bkey) x 250;
+}
+
+sub test_zerocopy {
+    my ($backend) = @_;
+    my $server = get_memcached($engine, "-Z 16k -O $backend");
+    my $sock = $server->sock;
+    my $cmd;
+    my $val;
+    my $rst;
+
+    my $settings = mem_stats($sock, "settings");
+    is($settings->{"zerocopy_size"}, 16384, "$backend: zerocopy_size is 16384");
+
+    # large values
+    my $big = "a" x 300000;
+    $cmd = "set big 0 0 300000"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $big, $rst);
+    $cmd = "set small 0 0 5"; $val = "hello"; $rst = "STORED";
+    mem_cmd_is($sock, $cmd, $val, $rst);
+    $cmd = "get big"; $rst = "VALUE big 0 300000\n$big\nEND";
+    mem_cmd_is($sock, $cmd, "", $rst);
+    $cmd = "get big small big";
+    $rst = "VALUE big 0 300000\n$big\nVALUE small 0 5\nhello\nVALUE big 0 300000\n$big\nEND";
+    mem_cmd_is($sock, $cmd, "", $rst);
+
+    # the value is replaced right after the response that references it.
+    my $big2 = "b" x 300000;
+    print $sock "get big\r\nset big 0 0 300000\r\n$big2\r\nget big\r\n";
+    my $res = "";
+    for (my $i = 0; $i < 7; $i++) {
+        $res .= scalar <$sock>;
+    }
+    is($res, "VALUE big 0 300000\r\n$big\r\nEND\r\nSTORED\r\n"
+           . "VALUE big 0 300000\r\n$big2\r\nEND\r\n",
+       "$backend: replaced value is sent after the in-flight response");
+
+    # large b+tree element responses
+    $cmd = "bop create bkey 0 0 1000"; $rst = "CREATED";
+    mem_cmd_is($sock, $cmd, "", $rst);
+    my $buf = "";
+    my $lines = "";
+    for (my $bkey = 0; $bkey < 200; $bkey++) {
+        my $value = elem_value($bkey);
+        $buf .= "bop insert bkey $bkey " . length($value) . " noreply\r\n$value\r\n";
+        $lines .= "$bkey " . length($value) . " $value\n";
+    }
+    print $sock $buf;
+    mem_cmd_is($sock, "set sync 0 0 1", "1", "STORED");
+    $cmd = "bop get bkey 0..199"; $rst = "VALUE 0 200\n" . $lines . "END";
+    mem_cmd_is($sock, $cmd, "", $rst);
+
+    my $stats = mem_stats($sock);
+    my $sends = $stats->{"zerocopy_sends"};
+    cmp_ok($sends, ">", 0, "$backend: large responses are sent with zero-copy");
+
+    # small responses are copied.
+    $cmd = "get small"; $rst = "VALUE small 0 5\nhello\nEND";
+    mem_cmd_is($sock, $cmd, "", $rst);
+    $stats = mem_stats($sock);
+    is($stats->{"zerocopy_sends"}, $sends, "$backend: small responses are copied");
+
+    # the client closes with the zero-copy responses unread.
+    my $conns = $stats->{"curr_connections"};
+    my $conn = $server->new_sock;
+    print $conn "get big big big big\r\n";
+    my $part;
+    read($conn, $part, 1000);
+    close($conn);
+    for (my $i = 0; $i < 50; $i++) {
+        $stats = mem_stats($sock);
+        last if $stats->{"curr_connections"} == $conns;
+        select(undef, undef, undef, 0.1);
+    }
+    is($stats->{"curr_connections"}, $conns, "$backend: closed with the zero-copy responses unread");
+    $cmd = "get big"; $rst = "VALUE big 0 300000\n$big2\nEND";
+    mem_cmd_is($sock, $cmd, "", $rst);
+
+    release_memcached($engine, $server);
+}
+
+test_zerocopy("libevent");
+if (MemcachedTest::supports_io_uring()) {
+    test_zerocopy("io_uring");
+}
@@ -33,6 +33,14 @@
 
 #define ITEMS_PER_ALLOC 64
 
+/* Seconds of persistent imbalance before migrating idle connections */
+#define MIGRATE_PERSIST_SECS 3
+/* Maximum number of idle connections migrated at a time */
+#define MIGRATE_MAX_CONNS    64
+/* Minimum gap of load between the worker threads to migrate */
+#define MIGRATE_MIN_CONNS    4
+#define MIGRATE_MIN_CPU_USEC 100000
+
 #define LOCK_THREAD(t) do {                     \
     if (pthread_mutex_lock(&t->mutex) != 0) {   \
         abort();                                \
@@ -59,6 +67,7 @@ struct conn_queue_item {
     int               event_flags;
     int               read_buffer_size;
     enum network_transport     transport;
+    conn             *conn;     /* an idle connection migrated from another thread */
     CQ_ITEM          *next;
 };
 
@@ -272,6 +281,18 @@ static void setup_thread(LIBEVENT_THREAD *me)
                        "Failed to create memory block pool\n");
         exit(EXIT_FAILURE);
     }
+
+#ifdef ENABLE_IO_URING
+    me->uring = NULL;
+    if (settings.io_backend == io_backend_uring) {
+        me->uring = uring_create(me->base);
+        if (me->uring == NULL) {
+            mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                           "Can't create io_uring, using libevent instead: %s\n",
+                           strerror(errno));
+        }
+    }
+#endif
 }
 
 /*
@@ -306,11 +327,148 @@ static void *worker_libevent(void *arg)
         cqi_free(item);
         item = cq_pop(me->new_conn_queue);
     }
+#ifdef ENABLE_IO_URING
+    if (me->uring != NULL) {
+        uring_destroy(me->uring);
+    }
+#endif
     token_buff_destroy(&me->token_buff);
     mblck_pool_destroy(&me->mblck_pool);
     return NULL;
 }
 
+/*
+ * Creates a new connection on the given thread and links it to
+ * the conn_list of the thread. This must run on the thread itself.
+ */
+static void thread_conn_new(LIBEVENT_THREAD *me, int sfd, STATE_FUNC init_state,
+                            int event_flags, int read_buffer_size,
+                            enum network_transport transport)
+{
+    conn *c = conn_new(sfd, init_state, event_flags,
+                       read_buffer_size, transport, me->base, NULL);
+    if (c == NULL) {
+        if (IS_UDP(transport)) {
+            mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "Can't listen for events on UDP socket\n");
+            exit(1);
+        } else {
+            if (settings.verbose > 0) {
+                mc_logger->log(EXTENSION_LOG_INFO, NULL,
+                        "Can't listen for events on fd %d\n", sfd);
+            }
+            close(sfd);
+        }
+        __atomic_sub_fetch(&me->conn_count, 1, __ATOMIC_RELAXED);
+    } else {
+        assert(c->thread == NULL);
+        c->thread = me;
+        /* link to the conn_list of the thread */
+        if (me->conn_list != NULL) {
+            c->conn_next = me->conn_list;
+            me->conn_list->conn_prev = c;
+        }
+        me->conn_list = c;
+#ifdef ENABLE_IO_URING
+        /* the client connections are served by the io_uring if any */
+        if (me->uring != NULL && init_state == conn_new_cmd &&
+            !IS_UDP(transport) && uring_conn_start(me->uring, c)) {
+            event_del(&c->event);
+            uring_submit(me->uring);
+        }
+#endif
+    }
+}
+
+/*
+ * Takes over an idle connection migrated from another thread.
+ */
+static void thread_conn_adopt(LIBEVENT_THREAD *me, conn *c)
+{
+    assert(c->thread == NULL);
+    c->thread = me;
+    /* link to the conn_list of the thread */
+    if (me->conn_list != NULL) {
+        c->conn_next = me->conn_list;
+        me->conn_list->conn_prev = c;
+    }
+    me->conn_list = c;
+
+    if (!conn_set_event_base(c, me->base)) {
+        if (settings.verbose > 0) {
+            mc_logger->log(EXTENSION_LOG_INFO, c,
+                    "Can't listen for events on migrated fd %d\n", c->sfd);
+        }
+        conn_close(c);
+    }
+}
+
+/*
+ * Hands over the idle connections of this thread to another thread
+ * as requested by threads_balance().
+ */
+static void thread_migrate_conns(LIBEVENT_THREAD *me)
+{
+    LIBEVENT_THREAD *to;
+    conn *c, *next;
+    int count;
+    int moved = 0;
+
+    LOCK_THREAD(me);
+    count = me->migrate_count;
+    to = threads + me->migrate_to;
+    me->migrate_count = 0;
+    UNLOCK_THREAD(me);
+
+    for (c = me->conn_list; c != NULL && moved < count; c = next) {
+        next = c->conn_next;
+        if (!conn_is_idle(c) || event_del(&c->event) == -1) {
+            continue;
+        }
+        /* disconnect it from the conn_list of this thread */
+        if (c->conn_prev != NULL) {
+            c->conn_prev->conn_next = c->conn_next;
+        } else {
+            me->conn_list = c->conn_next;
+        }
+        if (c->conn_next != NULL) {
+            c->conn_next->conn_prev = c->conn_prev;
+        }
+        c->conn_prev = NULL;
+        c->conn_next = NULL;
+        c->thread = NULL;
+        __atomic_sub_fetch(&me->conn_count, 1, __ATOMIC_RELAXED);
+
+        CQ_ITEM *item = cqi_new();
+        if (item == NULL) {
+            /* keep it on this thread */
+            thread_conn_adopt(me, c);
+            __atomic_add_fetch(&me->conn_count, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        item->sfd = c->sfd;
+        item->conn = c;
+        __atomic_add_fetch(&to->conn_count, 1, __ATOMIC_RELAXED);
+        cq_push(to->new_conn_queue, item);
+        if (write(to->notify_send_fd, "", 1) != 1) {
+            mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "Writing to thread notify pipe: %s", strerror(errno));
+        }
+        moved++;
+    }
+
+    if (moved > 0) {
+        LOCK_STATS();
+        mc_stats.migrated_conns += moved;
+        UNLOCK_STATS();
+        if (settings.verbose > 1) {
+            mc_logger->log(EXTENSION_LOG_DEBUG, NULL,
+                    "Worker thread[%d] migrated %d idle connections to thread[%d]\n",
+                    me->index, moved, to->index);
+        }
+    }
+}
+
 /*
  * Processes an incoming "handle a new connection" item. This is called when
  * input arrives on the libevent wakeup pipe.
@@ -341,33 +499,19 @@ static void thread_libevent_process(int fd, short which, void *arg)
 
     item = cq_pop(me->new_conn_queue);
     if (item) {
-        conn *c = conn_new(item->sfd, item->init_state, item->event_flags,
-                           item->read_buffer_size, item->transport, me->base, NULL);
-        if (c == NULL) {
-            if (IS_UDP(item->transport)) {
-                mc_logger->log(EXTENSION_LOG_WARNING, NULL,
-                        "Can't listen for events on UDP socket\n");
-                exit(1);
-            } else {
-                if (settings.verbose > 0) {
-                    mc_logger->log(EXTENSION_LOG_INFO, NULL,
-                            "Can't listen for events on fd %d\n", item->sfd);
-                }
-                close(item->sfd);
-            }
+        if (item->conn != NULL) {
+            thread_conn_adopt(me, item->conn);
         } else {
-            assert(c->thread == NULL);
-            c->thread = me;
-            /* link to the conn_list of the thread */
-            if (me->conn_list != NULL) {
-                c->conn_next = me->conn_list;
-                me->conn_list->conn_prev = c;
-            }
-            me->conn_list = c;
+            thread_conn_new(me, item->sfd, item->init_state, item->event_flags,
+                            item->read_buffer_size, item->transport);
         }
         cqi_free(item);
     }
 
+    if (__atomic_load_n(&me->migrate_count, __ATOMIC_RELAXED) > 0) {
+        thread_migrate_conns(me);
+    }
+
     LOCK_THREAD(me);
     conn* pending = me->pending_io;
     me->pending_io = NULL;
@@ -377,6 +521,13 @@ static void thread_libevent_process(int fd, short which, void *arg)
         assert(me == c->thread);
         pending = pending->next;
         c->next = NULL;
+#ifdef ENABLE_IO_URING
+        if (c->uring != NULL) {
+            c->uring_blocked = false;
+            uring_conn_drive(c, EV_READ);
+            continue;
+        }
+#endif
         event_add(&c->event, 0);
 
         c->nevents = settings.reqs_per_event;
@@ -384,6 +535,11 @@ static void thread_libevent_process(int fd, short which, void *arg)
             /* do task */
         }
     }
+#ifdef ENABLE_IO_URING
+    if (me->uring != NULL) {
+        uring_submit(me->uring);
+    }
+#endif
 }
 
 bool has_cycle(conn *c)
@@ -446,6 +602,9 @@ bool should_io_blocked(const void *cookie)
     if (c->current_io_wait > 0) {
         event_del(&c->event);
         c->io_blocked = true;
+#ifdef ENABLE_IO_URING
+        c->uring_blocked = true;
+#endif
         blocked = true;
     }
 #else
@@ -455,6 +614,9 @@ bool should_io_blocked(const void *cookie)
     } else {
         event_del(&c->event);
         c->io_blocked = true;
+#ifdef ENABLE_IO_URING
+        c->uring_blocked = true;
+#endif
         blocked = true;
     }
 #endif
@@ -599,26 +761,22 @@ void remove_io_pending(const void *cookie)
 static int last_thread = -1;
 
 /*
- * Dispatches a new connection to another thread. This is only ever called
- * from the main thread, either during initialization (for UDP) or because
- * of an incoming connection.
+ * Dispatches a new connection to the given worker thread.
  */
-void dispatch_conn_new(int sfd, STATE_FUNC init_state, int event_flags,
-                       int read_buffer_size, enum network_transport transport)
+void dispatch_conn_thread(int tid, int sfd, STATE_FUNC init_state, int event_flags,
+                          int read_buffer_size, enum network_transport transport)
 {
     CQ_ITEM *item = cqi_new();
-    int tid = (last_thread + 1) % settings.num_threads;
-
     LIBEVENT_THREAD *thread = threads + tid;
 
-    last_thread = tid;
-
     item->sfd = sfd;
     item->init_state = init_state;
     item->event_flags = event_flags;
     item->read_buffer_size = read_buffer_size;
     item->transport = transport;
+    item->conn = NULL;
 
+    __atomic_add_fetch(&thread->conn_count, 1, __ATOMIC_RELAXED);
     cq_push(thread->new_conn_queue, item);
 
     MEMCACHED_CONN_DISPATCH(sfd, (uintptr_t)thread->thread_id);
@@ -628,6 +786,89 @@ void dispatch_conn_new(int sfd, STATE_FUNC init_state, int event_flags,
     }
 }
 
+/*
+ * Picks the worker thread with the fewest connections.
+ * The ties are broken in turn starting from the next thread.
+ */
+static int select_leastconn_thread(int next)
+{
+    int tid = next;
+    int min_count = __atomic_load_n(&threads[next].conn_count, __ATOMIC_RELAXED);
+
+    for (int i = 1; i < settings.num_threads; i++) {
+        int t = (next + i) % settings.num_threads;
+        int count = __atomic_load_n(&threads[t].conn_count, __ATOMIC_RELAXED);
+        if (count < min_count) {
+            min_count = count;
+            tid = t;
+        }
+    }
+    return tid;
+}
+
+/*
+ * Picks the less loaded one of the next thread and a random other thread.
+ * The cpu load is sampled only every second, so choosing among two
+ * keeps a burst of new connections from piling up on a single thread.
+ */
+static int select_leastcpu_thread(int next)
+{
+    static uint32_t seed = 2463534242;
+    int other;
+
+    if (settings.num_threads < 2) {
+        return next;
+    }
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    other = (next + 1 + seed % (settings.num_threads - 1)) % settings.num_threads;
+
+    if (threads[other].recent_cpu < threads[next].recent_cpu ||
+        (threads[other].recent_cpu == threads[next].recent_cpu &&
+         __atomic_load_n(&threads[other].conn_count, __ATOMIC_RELAXED) <
+         __atomic_load_n(&threads[next].conn_count, __ATOMIC_RELAXED))) {
+        return other;
+    }
+    return next;
+}
+
+/*
+ * Dispatches a new connection to another thread. This is only ever called
+ * from the main thread because of an incoming connection.
+ */
+void dispatch_conn_new(int sfd, STATE_FUNC init_state, int event_flags,
+                       int read_buffer_size, enum network_transport transport)
+{
+    int tid = (last_thread + 1) % settings.num_threads;
+
+    last_thread = tid;
+
+    if (settings.conn_placement == conn_place_leastconn) {
+        tid = select_leastconn_thread(tid);
+    } else if (settings.conn_placement == conn_place_leastcpu) {
+        tid = select_leastcpu_thread(tid);
+    }
+
+    dispatch_conn_thread(tid, sfd, init_state, event_flags,
+                         read_buffer_size, transport);
+}
+
+/*
+ * Sets up a new connection on the current worker thread. This is called
+ * from the worker that accepted the connection on its own listen socket,
+ * so no queue item and no notify pipe wakeup are needed.
+ */
+void dispatch_conn_local(LIBEVENT_THREAD *me, int sfd, STATE_FUNC init_state,
+                         int event_flags, int read_buffer_size,
+                         enum network_transport transport)
+{
+    MEMCACHED_CONN_DISPATCH(sfd, (uintptr_t)me->thread_id);
+    __atomic_add_fetch(&me->conn_count, 1, __ATOMIC_RELAXED);
+    thread_conn_new(me, sfd, init_state, event_flags,
+                    read_buffer_size, transport);
+}
+
 /*
  * Returns true if this is the thread that listens for new TCP connections.
  */
@@ -669,6 +910,7 @@ void threadlocal_stats_clear(struct thread_stats *stats)
     stats->bytes_written = 0;
     stats->bytes_read = 0;
     stats->conn_yields = 0;
+    stats->zerocopy_sends = 0;
     /* list command stats */
     stats->cmd_lop_create = 0;
     stats->cmd_lop_insert = 0;
@@ -843,6 +1085,7 @@ void threadlocal_stats_aggregate(struct thread_stats *thread_stats, struct threa
         stats->bytes_read += thread_stats[ii].bytes_read;
         stats->bytes_written += thread_stats[ii].bytes_written;
         stats->conn_yields += thread_stats[ii].conn_yields;
+        stats->zerocopy_sends += thread_stats[ii].zerocopy_sends;
         /* list command stats */
         stats->cmd_lop_create += thread_stats[ii].cmd_lop_create;
         stats->cmd_lop_insert += thread_stats[ii].cmd_lop_insert;
@@ -1052,3 +1295,146 @@ void threads_shutdown(void)
         close(threads[ii].notify_receive_fd);
     }
 }
+
+/*
+ * Binds the worker thread i to the cpus[j] of (j % nthreads == i),
+ * the same mapping as the cpu steering program of the listen sockets.
+ * Returns 0 on success, -1 if the binding is not supported or failed.
+ * On failure, the threads already bound get back their previous affinity.
+ */
+int threads_bind_cpus(const int *cpus, int ncpus)
+{
+#if defined(__linux__) && defined(CPU_SET)
+    cpu_set_t *saved;
+    int ii, jj;
+
+    if (ncpus < nthreads) {
+        return -1;
+    }
+    saved = calloc(nthreads, sizeof(cpu_set_t));
+    if (saved == NULL) {
+        return -1;
+    }
+    for (ii = 0; ii < nthreads; ++ii) {
+        cpu_set_t cpuset;
+        if (pthread_getaffinity_np(thread_ids[ii], sizeof(cpu_set_t), &saved[ii]) != 0) {
+            break;
+        }
+        CPU_ZERO(&cpuset);
+        for (jj = ii; jj < ncpus; jj += nthreads) {
+            CPU_SET(cpus[jj], &cpuset);
+        }
+        if (pthread_setaffinity_np(thread_ids[ii], sizeof(cpuset), &cpuset) != 0) {
+            break;
+        }
+    }
+    if (ii < nthreads) {
+        while (--ii >= 0) {
+            pthread_setaffinity_np(thread_ids[ii], sizeof(cpu_set_t), &saved[ii]);
+        }
+        free(saved);
+        return -1;
+    }
+    free(saved);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*
+ * Returns the cpu time used by the given thread in microseconds.
+ */
+static uint64_t thread_cpu_usec(LIBEVENT_THREAD *t)
+{
+#if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+    clockid_t cid;
+    struct timespec ts;
+
+    if (pthread_getcpuclockid(t->thread_id, &cid) == 0 &&
+        clock_gettime(cid, &ts) == 0) {
+        return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+#endif
+    return 0;
+}
+
+/*
+ * Returns the load of the given thread used to balance the threads.
+ */
+static uint64_t thread_load(LIBEVENT_THREAD *t)
+{
+    if (settings.conn_placement == conn_place_leastcpu) {
+        return t->recent_cpu;
+    }
+    return __atomic_load_n(&t->conn_count, __ATOMIC_RELAXED);
+}
+
+/*
+ * Samples the load of the worker threads, and asks the most loaded thread
+ * to migrate some of its idle connections to the least loaded thread
+ * if the imbalance persists. The load is the cpu time used in the last
+ * period with the leastcpu placement, and the number of connections
+ * otherwise. This is called every second from the main thread.
+ */
+void threads_balance(void)
+{
+    static int imbalanced_secs = 0;
+    uint64_t src_load, dst_load;
+    int src = 0, dst = 0;
+    int count;
+
+    if (nthreads == 0) {
+        return; /* not yet started */
+    }
+    if (settings.conn_placement != conn_place_leastcpu && !settings.conn_migrate) {
+        return;
+    }
+
+    for (int ii = 0; ii < nthreads; ++ii) {
+        LIBEVENT_THREAD *t = &threads[ii];
+        if (settings.conn_placement == conn_place_leastcpu) {
+            uint64_t usec = thread_cpu_usec(t);
+            t->recent_cpu = (usec > t->cpu_usec) ? usec - t->cpu_usec : 0;
+            t->cpu_usec = usec;
+        }
+        if (thread_load(t) > thread_load(&threads[src])) src = ii;
+        if (thread_load(t) < thread_load(&threads[dst])) dst = ii;
+    }
+    if (!settings.conn_migrate) {
+        return;
+    }
+
+    src_load = thread_load(&threads[src]);
+    dst_load = thread_load(&threads[dst]);
+    if (src_load <= dst_load * 2 ||
+        src_load - dst_load < (settings.conn_placement == conn_place_leastcpu
+                               ? MIGRATE_MIN_CPU_USEC : MIGRATE_MIN_CONNS)) {
+        imbalanced_secs = 0;
+        return;
+    }
+    if (++imbalanced_secs < MIGRATE_PERSIST_SECS) {
+        return;
+    }
+    imbalanced_secs = 0;
+
+    /* move the half of the gap */
+    if (settings.conn_placement == conn_place_leastcpu) {
+        count = __atomic_load_n(&threads[src].conn_count, __ATOMIC_RELAXED);
+        count = (int)(count * (src_load - dst_load) / (src_load * 2));
+    } else {
+        count = (int)(src_load - dst_load) / 2;
+    }
+    if (count < 1) count = 1;
+    if (count > MIGRATE_MAX_CONNS) count = MIGRATE_MAX_CONNS;
+
+    LIBEVENT_THREAD *from = &threads[src];
+    LOCK_THREAD(from);
+    from->migrate_to = dst;
+    from->migrate_count = count;
+    UNLOCK_THREAD(from);
+    if (write(from->notify_send_fd, "", 1) != 1) {
+        mc_logger->log(EXTENSION_LOG_WARNING, NULL,
+                "Writing to thread notify pipe: %s", strerror(errno));
+    }
+}
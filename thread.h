@@ -52,6 +52,7 @@ struct thread_stats {
     uint64_t          bytes_read;
     uint64_t          bytes_written;
     uint64_t          conn_yields; /* # of yields for connections (-R option)*/
+    uint64_t          zerocopy_sends; /* # of sends done with zero-copy (-Z option) */
     /* list command stats */
     uint64_t          cmd_lop_create;
     uint64_t          cmd_lop_insert;
@@ -201,10 +202,18 @@ typedef struct {
     bool is_locked;
     struct conn *pending_io;           /* List of connection with pending async io ops */
     struct conn *conn_list;            /* connection list managed by this thread */
+    int conn_count;             /* number of connections assigned to this thread */
+    uint64_t cpu_usec;          /* cpu time of this thread at the last sample */
+    uint64_t recent_cpu;        /* cpu time used in the last sampling period */
+    int migrate_to;             /* thread to migrate idle connections to */
+    int migrate_count;          /* number of idle connections to migrate */
     int index;                  /* index of this thread in the threads array */
     enum thread_type type;      /* Type of IO this thread processes */
     token_buff_t token_buff;    /* token buffer */
     mblck_pool_t mblck_pool;    /* memory block pool */
+#ifdef ENABLE_IO_URING
+    struct uring *uring;        /* io_uring of the TCP connections, or NULL */
+#endif
 } LIBEVENT_THREAD;
 
 bool   has_cycle(struct conn *c);
@@ -218,6 +227,11 @@ void notify_io_complete(const void *cookie, ENGINE_ERROR_CODE status);
 void remove_io_pending(const void *cookie);
 void dispatch_conn_new(int sfd, STATE_FUNC init_state, int event_flags,
                        int read_buffer_size, enum network_transport transport);
+void dispatch_conn_thread(int tid, int sfd, STATE_FUNC init_state, int event_flags,
+                          int read_buffer_size, enum network_transport transport);
+void dispatch_conn_local(LIBEVENT_THREAD *me, int sfd, STATE_FUNC init_state,
+                         int event_flags, int read_buffer_size,
+                         enum network_transport transport);
 int  is_listen_thread(void);
 
 void *threadlocal_stats_create(int num_threads);
@@ -228,4 +242,6 @@ void threadlocal_stats_aggregate(struct thread_stats *thread_stats, struct threa
 
 void thread_init(int nthreads, struct event_base *main_base);
 void threads_shutdown(void);
+int  threads_bind_cpus(const int *cpus, int ncpus);
+void threads_balance(void);
 #endif
@@ -0,0 +1,755 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * arcus-memcached - Arcus memory cache server
+ * Copyright 2010-2014 NAVER Corp.
+ * Copyright 2014-2020 JaM2in Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "config.h"
+#include "memcached.h"
+
+#ifdef ENABLE_IO_URING
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define URING_SQ_ENTRIES    1024
+#define URING_CQ_ENTRIES    (4 * URING_SQ_ENTRIES)
+#define URING_BUF_COUNT     256     /* must be a power of 2 */
+#define URING_BUF_SIZE      4096
+#define URING_BUF_GROUP     0
+#define URING_MAX_SENDS     16      /* max # of linked sendmsg requests */
+#define URING_INBUF_MAX     (16 * URING_BUF_SIZE) /* stash size to stop the recv */
+
+/* The low bits of user_data tell the request kind of a conn.
+ * user_data 0 is used by the requests whose completion is ignored.
+ */
+#define URING_TAG_RECV      1
+#define URING_TAG_SEND      2
+#define URING_TAG_NOP       3
+#define URING_TAG_MASK      3
+
+struct uring {
+    int fd;
+    struct event event;     /* readable when completions are posted */
+
+    /* submission queue */
+    void *sq_ptr;
+    size_t sq_len;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_entries;
+    unsigned *sq_flags;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned sq_local_tail; /* tail of the prepared requests */
+
+    /* completion queue */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* provided buffer ring for the multishot recv */
+    struct io_uring_buf_ring *br;
+    size_t br_len;
+    unsigned short br_tail;
+    char *bufs;
+
+    bool send_zc;           /* IORING_OP_SENDMSG_ZC is supported */
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit,
+                              unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                        flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg,
+                                 unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_buf_recycle(struct uring *ring, unsigned short bid)
+{
+    struct io_uring_buf *buf;
+
+    buf = &ring->br->bufs[ring->br_tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (unsigned long)(ring->bufs + (size_t)bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    ring->br_tail++;
+    __atomic_store_n(&ring->br->tail, ring->br_tail, __ATOMIC_RELEASE);
+}
+
+/*
+ * Makes room for count requests in the submission queue, submitting the
+ * prepared requests if it is full. Returns the number of requests that
+ * can be prepared without a submission in between.
+ */
+static unsigned uring_reserve_sqes(struct uring *ring, unsigned count)
+{
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned space = *ring->sq_entries - (ring->sq_local_tail - head);
+
+    if (space < count) {
+        uring_submit(ring);
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        space = *ring->sq_entries - (ring->sq_local_tail - head);
+    }
+    return space < count ? space : count;
+}
+
+/* Prepares the next request in the space made by uring_reserve_sqes(). */
+static struct io_uring_sqe *uring_next_sqe(struct uring *ring)
+{
+    struct io_uring_sqe *sqe;
+    unsigned index = ring->sq_local_tail & *ring->sq_mask;
+
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static struct io_uring_sqe *uring_get_sqe(struct uring *ring)
+{
+    if (uring_reserve_sqes(ring, 1) == 0) {
+        return NULL;
+    }
+    return uring_next_sqe(ring);
+}
+
+void uring_submit(struct uring *ring)
+{
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned count = ring->sq_local_tail - head;
+
+    if (count == 0) {
+        return;
+    }
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    while (sys_io_uring_enter(ring->fd, count, 0, 0) < 0) {
+        if (errno != EINTR) {
+            /* EAGAIN or EBUSY: the requests are left in the queue
+             * and submitted with the next call.
+             */
+            mc_logger->log(EXTENSION_LOG_DEBUG, NULL,
+                           "Couldn't submit io_uring requests: %s\n",
+                           strerror(errno));
+            break;
+        }
+    }
+}
+
+/*
+ * Connection requests
+ */
+static inline bool uring_conn_drivable(conn *c)
+{
+    return !c->uring_closing && !c->uring_blocked &&
+           !c->uring_resuming && c->uring_sends == 0;
+}
+
+static bool uring_conn_arm_recv(conn *c)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(c->uring);
+    if (sqe == NULL) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c->sfd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = (uintptr_t)c | URING_TAG_RECV;
+    c->uring_recving = true;
+    c->uring_inflight++;
+    return true;
+}
+
+/*
+ * Cancels the multishot recv when the stash has reached its limit,
+ * so that a client sending faster than it is served is not buffered
+ * without bound. The recv is armed again by uring_conn_keep_recv().
+ */
+static bool uring_conn_stop_recv(conn *c)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(c->uring);
+    if (sqe == NULL) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = (uintptr_t)c | URING_TAG_RECV;
+    c->uring_recvstop = true;
+    return true;
+}
+
+/*
+ * Arms the multishot recv again once it has ended. After it has been
+ * stopped, it is armed only when the state machine has drained the stash.
+ */
+static void uring_conn_keep_recv(conn *c)
+{
+    if (c->uring_recving || c->uring_closing || c->uring_recverr != -1) {
+        return;
+    }
+    if (c->uring_inlen >= URING_INBUF_MAX) {
+        c->uring_recvstop = true;
+    }
+    if (c->uring_recvstop) {
+        if (c->uring_inlen > 0) {
+            return;
+        }
+        c->uring_recvstop = false;
+    }
+    if (!uring_conn_arm_recv(c)) {
+        c->uring_recverr = ENOMEM;
+    }
+}
+
+bool uring_conn_start(struct uring *ring, conn *c)
+{
+    c->uring = ring;
+    if (!uring_conn_arm_recv(c)) {
+        c->uring = NULL;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Reads the received data of the connection, the stashed data first.
+ * It has the same return value and errno as read() on a nonblocking socket.
+ */
+ssize_t uring_conn_recv(conn *c, void *buf, size_t len)
+{
+    size_t n;
+
+    if (c->uring_inlen > 0) {
+        n = len < c->uring_inlen ? len : c->uring_inlen;
+        memcpy(buf, c->uring_inbuf + c->uring_inoff, n);
+        c->uring_inoff += n;
+        c->uring_inlen -= n;
+        if (c->uring_inlen == 0) {
+            c->uring_inoff = 0;
+        }
+        return n;
+    }
+    if (c->uring_dlen > 0) {
+        n = len < c->uring_dlen ? len : c->uring_dlen;
+        memcpy(buf, c->uring_data, n);
+        c->uring_data += n;
+        c->uring_dlen -= n;
+        return n;
+    }
+    if (c->uring_recverr == 0) {
+        return 0;
+    }
+    errno = c->uring_recverr > 0 ? c->uring_recverr : EAGAIN;
+    return -1;
+}
+
+static bool uring_conn_stash(conn *c, const char *data, int len)
+{
+    if (c->uring_inoff + c->uring_inlen + len > c->uring_insize) {
+        if (c->uring_inoff > 0) {
+            memmove(c->uring_inbuf, c->uring_inbuf + c->uring_inoff,
+                    c->uring_inlen);
+            c->uring_inoff = 0;
+        }
+        if (c->uring_inlen + len > c->uring_insize) {
+            int size = c->uring_insize > 0 ? c->uring_insize : URING_BUF_SIZE;
+            while (size < c->uring_inlen + len) {
+                size *= 2;
+            }
+            char *inbuf = realloc(c->uring_inbuf, size);
+            if (inbuf == NULL) {
+                return false;
+            }
+            c->uring_inbuf = inbuf;
+            c->uring_insize = size;
+        }
+    }
+    memcpy(c->uring_inbuf + c->uring_inoff + c->uring_inlen, data, len);
+    c->uring_inlen += len;
+    return true;
+}
+
+/*
+ * Sends the remaining messages of the connection with linked sendmsg
+ * requests, so that they go out in order without waiting for each other.
+ * MSG_WAITALL makes a short send fail the link instead of reordering.
+ */
+bool uring_conn_send(conn *c)
+{
+    struct io_uring_sqe *sqe, *last = NULL;
+    unsigned count = 0;
+    int i;
+
+    /* The chain must not be submitted in part, or the requests after
+     * the submission are not linked to the ones before it.
+     */
+    for (i = c->msgcurr; i < c->msgused && c->uring_sends + count < URING_MAX_SENDS; i++) {
+        if (c->msglist[i].msg_iovlen > 0) {
+            count++;
+        }
+    }
+    count = uring_reserve_sqes(c->uring, count);
+
+    for (i = c->msgcurr; i < c->msgused && count > 0; i++) {
+        if (c->msglist[i].msg_iovlen == 0) {
+            continue;
+        }
+        sqe = uring_next_sqe(c->uring);
+        sqe->opcode = IORING_OP_SENDMSG;
+#if HAVE_DECL_IORING_OP_SENDMSG_ZC
+        if (c->uring->send_zc && conn_msg_zerocopy(c, &c->msglist[i])) {
+            sqe->opcode = IORING_OP_SENDMSG_ZC;
+            STATS_ADD(c, zerocopy_sends, 1);
+        }
+#endif
+        sqe->fd = c->sfd;
+        sqe->addr = (uintptr_t)&c->msglist[i];
+        sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        sqe->user_data = (uintptr_t)c | URING_TAG_SEND;
+        if (last != NULL) {
+            last->flags |= IOSQE_IO_LINK;
+        }
+        last = sqe;
+        c->uring_sends++;
+        c->uring_inflight++;
+        count--;
+    }
+    c->uring_sendcurr = c->msgcurr;
+    return c->uring_sends > 0;
+}
+
+/*
+ * Resumes the state machine of the connection from the completion
+ * handler, which is what EV_WRITE does for the libevent backend.
+ */
+bool uring_conn_resume(conn *c)
+{
+    struct io_uring_sqe *sqe;
+
+    if (c->uring_resuming) {
+        return true;
+    }
+    if ((sqe = uring_get_sqe(c->uring)) == NULL) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = (uintptr_t)c | URING_TAG_NOP;
+    c->uring_resuming = true;
+    c->uring_inflight++;
+    return true;
+}
+
+/*
+ * Runs the state machine of the connection as an event of libevent does.
+ * which == 0 continues it after its sendmsg requests have completed,
+ * within the requests per event (-R) of the event that started it.
+ */
+void uring_conn_drive(conn *c, short which)
+{
+    c->uring_inflight++; /* hold the connection */
+    if (which != 0) {
+        event_handler(c->sfd, which, c);
+    } else {
+        while (c->state(c)) {
+            /* do task */
+        }
+    }
+
+    /* the state machine stopped without waiting for a completion
+     * (e.g. a yield), but the received data is already here.
+     */
+    if (uring_conn_drivable(c) &&
+        (c->uring_dlen > 0 || c->uring_inlen > 0 || c->uring_recverr != -1)) {
+        if (!uring_conn_resume(c)) {
+            conn_close(c);
+        }
+    }
+    uring_conn_keep_recv(c);
+    if (--c->uring_inflight == 0 && c->uring_closing) {
+        conn_close(c);
+    }
+}
+
+/*
+ * Closes the connection once all its requests have completed.
+ * Returns true if the close is deferred to the completions.
+ */
+bool uring_conn_close(conn *c)
+{
+    if (c->uring_inflight > 0) {
+        if (!c->uring_closing) {
+            struct io_uring_sqe *sqe = uring_get_sqe(c->uring);
+            c->uring_closing = true;
+            if (sqe != NULL) {
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = c->sfd;
+                sqe->cancel_flags = IORING_ASYNC_CANCEL_FD |
+                                    IORING_ASYNC_CANCEL_ALL;
+            } else {
+                /* the pending requests fail on the shut down socket */
+                shutdown(c->sfd, SHUT_RDWR);
+            }
+        }
+        return true;
+    }
+    free(c->uring_inbuf);
+    c->uring_inbuf = NULL;
+    c->uring_insize = 0;
+    c->uring_inoff = 0;
+    c->uring_inlen = 0;
+    c->uring_recvstop = false;
+    c->uring = NULL;
+    return false;
+}
+
+/*
+ * Completion handlers
+ */
+static void uring_recv_complete(struct uring *ring, conn *c, int res,
+                                unsigned flags)
+{
+    char *data = NULL;
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        data = ring->bufs + (size_t)(flags >> IORING_CQE_BUFFER_SHIFT) * URING_BUF_SIZE;
+    }
+    if (!(flags & IORING_CQE_F_MORE)) {
+        c->uring_recving = false;
+        c->uring_inflight--;
+    }
+
+    if (res > 0 && !c->uring_closing) {
+        if (c->uring_inlen == 0 && uring_conn_drivable(c)) {
+            /* let the state machine read the provided buffer directly */
+            c->uring_data = data;
+            c->uring_dlen = res;
+            uring_conn_drive(c, EV_READ);
+            data += res - c->uring_dlen;
+            res = c->uring_dlen;
+            c->uring_data = NULL;
+            c->uring_dlen = 0;
+        }
+        if (res > 0 && !c->uring_closing &&
+            !uring_conn_stash(c, data, res)) {
+            c->uring_recverr = ENOMEM;
+        }
+    } else if (res == 0) {
+        c->uring_recverr = 0;
+    } else if (res < 0 && res != -ENOBUFS && res != -EAGAIN && res != -ECANCELED) {
+        c->uring_recverr = -res;
+    }
+    if (flags & IORING_CQE_F_BUFFER) {
+        uring_buf_recycle(ring, flags >> IORING_CQE_BUFFER_SHIFT);
+    }
+
+    if (c->uring_recving && !c->uring_recvstop && !c->uring_closing &&
+        c->uring_inlen >= URING_INBUF_MAX) {
+        /* retried with the next completion if the queue is full */
+        (void)uring_conn_stop_recv(c);
+    }
+    /* the multishot recv has ended: on ENOBUFS, by the kernel or canceled */
+    uring_conn_keep_recv(c);
+}
+
+/*
+ * A zero-copy send posts its result with IORING_CQE_F_MORE, and then a
+ * notification once the kernel no longer references the data. The send
+ * is counted until the notification, so that the connection is not
+ * driven to release the items and the elements of the data before it.
+ */
+static void uring_send_complete(conn *c, int res, unsigned flags)
+{
+#if HAVE_DECL_IORING_OP_SENDMSG_ZC
+    if (flags & IORING_CQE_F_NOTIF) {
+        c->uring_sends--;
+        c->uring_inflight--;
+        return;
+    }
+    if (!(flags & IORING_CQE_F_MORE)) {
+        c->uring_sends--;
+        c->uring_inflight--;
+    }
+#else
+    c->uring_sends--;
+    c->uring_inflight--;
+#endif
+    if (c->uring_closing) {
+        return;
+    }
+    if (res >= 0) {
+        while (c->uring_sendcurr < c->msgused &&
+               c->msglist[c->uring_sendcurr].msg_iovlen == 0) {
+            c->uring_sendcurr++;
+        }
+        assert(c->uring_sendcurr < c->msgused);
+        conn_msg_sent(c, &c->msglist[c->uring_sendcurr], res);
+    } else if (res != -ECANCELED && c->uring_senderr == 0) {
+        /* the requests linked after it have been canceled */
+        c->uring_senderr = -res;
+    }
+}
+
+static void uring_complete(struct uring *ring, uint64_t user_data,
+                           int res, unsigned flags)
+{
+    conn *c = (conn *)(uintptr_t)(user_data & ~(uint64_t)URING_TAG_MASK);
+    bool drive = false;
+    short which = EV_READ;
+
+    if (c == NULL) {
+        return;
+    }
+    c->uring_inflight++; /* hold the connection */
+    switch (user_data & URING_TAG_MASK) {
+    case URING_TAG_RECV:
+        uring_recv_complete(ring, c, res, flags);
+        drive = (c->uring_inlen > 0 || c->uring_recverr != -1);
+        break;
+    case URING_TAG_SEND:
+        uring_send_complete(c, res, flags);
+        drive = true;
+        which = 0;
+        break;
+    case URING_TAG_NOP:
+        c->uring_resuming = false;
+        c->uring_inflight--;
+        drive = true;
+        which = EV_WRITE;
+        break;
+    }
+    if (drive && uring_conn_drivable(c)) {
+        uring_conn_drive(c, which);
+    }
+    if (--c->uring_inflight == 0 && c->uring_closing) {
+        conn_close(c);
+    }
+}
+
+static void uring_event_handler(const int fd, const short which, void *arg)
+{
+    struct uring *ring = arg;
+    struct io_uring_cqe *cqe;
+    unsigned head, tail;
+    uint64_t user_data;
+    int res;
+    unsigned flags;
+
+    while (1) {
+        head = *ring->cq_head;
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            cqe = &ring->cqes[head & *ring->cq_mask];
+            user_data = cqe->user_data;
+            res = cqe->res;
+            flags = cqe->flags;
+            head++;
+            __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+            uring_complete(ring, user_data, res, flags);
+            tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        }
+        if (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+            /* flush the overflowed completions into the completion queue */
+            if (sys_io_uring_enter(ring->fd, 0, 0, IORING_ENTER_GETEVENTS) < 0 &&
+                errno != EINTR && errno != EBUSY) {
+                break;
+            }
+            continue;
+        }
+        if (ring->sq_local_tail == __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        /* A sendmsg mostly completes while it is submitted. Handle such
+         * completions now rather than in the next round of the event loop.
+         */
+        uring_submit(ring);
+        if (*ring->cq_head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+}
+
+/*
+ * Ring setup
+ */
+static bool uring_map_rings(struct uring *ring, struct io_uring_params *p)
+{
+    size_t sq_len = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    size_t cq_len = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    char *ptr;
+
+    if (!(p->features & IORING_FEAT_SINGLE_MMAP)) {
+        errno = ENOSYS;
+        return false;
+    }
+    ring->sq_len = sq_len > cq_len ? sq_len : cq_len;
+    ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    ring->sq_ptr = ptr;
+    ring->sq_head = (unsigned *)(ptr + p->sq_off.head);
+    ring->sq_tail = (unsigned *)(ptr + p->sq_off.tail);
+    ring->sq_mask = (unsigned *)(ptr + p->sq_off.ring_mask);
+    ring->sq_entries = (unsigned *)(ptr + p->sq_off.ring_entries);
+    ring->sq_flags = (unsigned *)(ptr + p->sq_off.flags);
+    ring->sq_array = (unsigned *)(ptr + p->sq_off.array);
+    ring->cq_head = (unsigned *)(ptr + p->cq_off.head);
+    ring->cq_tail = (unsigned *)(ptr + p->cq_off.tail);
+    ring->cq_mask = (unsigned *)(ptr + p->cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(ptr + p->cq_off.cqes);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    ring->sqes_len = p->sq_entries * sizeof(struct io_uring_sqe);
+    ptr = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    ring->sqes = (struct io_uring_sqe *)ptr;
+    return true;
+}
+
+static bool uring_setup_bufs(struct uring *ring)
+{
+    struct io_uring_buf_reg reg;
+    unsigned short bid;
+
+    ring->br_len = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    ring->br = mmap(NULL, ring->br_len, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->br == MAP_FAILED) {
+        ring->br = NULL;
+        return false;
+    }
+    ring->bufs = malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (ring->bufs == NULL) {
+        return false;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)ring->br;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return false;
+    }
+    ring->br_tail = 0;
+    for (bid = 0; bid < URING_BUF_COUNT; bid++) {
+        uring_buf_recycle(ring, bid);
+    }
+    return true;
+}
+
+#if HAVE_DECL_IORING_OP_SENDMSG_ZC
+static bool uring_op_supported(struct uring *ring, int op)
+{
+    struct io_uring_probe *probe;
+    size_t len = sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op);
+    bool supported = false;
+
+    if ((probe = calloc(1, len)) == NULL) {
+        return false;
+    }
+    if (sys_io_uring_register(ring->fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+        op <= probe->last_op) {
+        supported = (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+    free(probe);
+    return supported;
+}
+#endif
+
+struct uring *uring_create(struct event_base *base)
+{
+    struct io_uring_params params;
+    struct uring *ring;
+    int error;
+
+    if ((ring = calloc(1, sizeof(struct uring))) == NULL) {
+        return NULL;
+    }
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = URING_CQ_ENTRIES;
+    ring->fd = sys_io_uring_setup(URING_SQ_ENTRIES, &params);
+    if (ring->fd < 0) {
+        free(ring);
+        return NULL;
+    }
+
+    if (!uring_map_rings(ring, &params) || !uring_setup_bufs(ring)) {
+        goto fail;
+    }
+#if HAVE_DECL_IORING_OP_SENDMSG_ZC
+    ring->send_zc = uring_op_supported(ring, IORING_OP_SENDMSG_ZC);
+#endif
+
+    event_set(&ring->event, ring->fd, EV_READ | EV_PERSIST,
+              uring_event_handler, ring);
+    event_base_set(base, &ring->event);
+    if (event_add(&ring->event, 0) == -1) {
+        goto fail;
+    }
+    return ring;
+
+fail:
+    error = errno;
+    uring_destroy(ring);
+    errno = error;
+    return NULL;
+}
+
+void uring_destroy(struct uring *ring)
+{
+    if (ring->event.ev_base != NULL) {
+        event_del(&ring->event);
+    }
+    close(ring->fd); /* cancels all the pending requests */
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_len);
+    }
+    if (ring->sq_ptr != NULL) {
+        munmap(ring->sq_ptr, ring->sq_len);
+    }
+    if (ring->br != NULL) {
+        munmap(ring->br, ring->br_len);
+    }
+    free(ring->bufs);
+    free(ring);
+}
+#endif
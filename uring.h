@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ * arcus-memcached - Arcus memory cache server
+ * Copyright 2010-2014 NAVER Corp.
+ * Copyright 2014-2020 JaM2in Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef URING_H
+#define URING_H
+
+#ifdef ENABLE_IO_URING
+/*
+ * io_uring network backend of the worker threads.
+ *
+ * Each worker thread owns an io_uring instance whose fd is watched by
+ * its libevent base. A TCP connection on the worker keeps a multishot
+ * recv armed with the provided buffer ring of the thread, and sends its
+ * responses with linked sendmsg requests. The connection state machine
+ * is driven by the completions instead of the libevent readiness.
+ */
+struct uring;
+
+struct uring *uring_create(struct event_base *base);
+void uring_destroy(struct uring *ring);
+void uring_submit(struct uring *ring);
+
+bool    uring_conn_start(struct uring *ring, conn *c);
+ssize_t uring_conn_recv(conn *c, void *buf, size_t len);
+bool    uring_conn_send(conn *c);
+bool    uring_conn_resume(conn *c);
+void    uring_conn_drive(conn *c, short which);
+bool    uring_conn_close(conn *c);
+#endif
+
+#endif